@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 // Default paths if not defined by CMake (relative from build output directory)
@@ -18,6 +19,7 @@ namespace AppConfig
 	inline float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 	inline bool isWindowMinimized = false;
 	inline double deltaTime = 0.0;
+	inline uint64_t frameIndex = 0; // counted by the renderer, textures record the last frame sampling them
 	inline float IBLintensity = 1.0f;
 	inline float IBLrotation = 0.0f;
 	inline bool regeneratePrefilteredMap = false;
@@ -32,6 +34,18 @@ namespace AppConfig
 	inline int minBVHDepth = 0;
 	inline bool showLeafsOnly = false;
 
+	inline uint32_t bakeWorkerCount = 0;      // 0 = all hardware threads
+	inline size_t bakeMemoryBudgetMB = 4096;  // estimated peak memory of concurrently running bake jobs
+	inline double bakeMainThreadBudgetMs = 8.0; // GPU bake stages run per frame before the UI is drawn
+	inline bool verboseBakeLog = false;          // per-tile statistics in the bake log
+	inline uint32_t outputWriterThreads = 2;     // threads encoding baked maps to disk, each encoder is parallel itself
+	inline size_t outputQueueLength = 8;         // baked maps waiting for the writer before bakes block
+	inline size_t outputMemoryBudgetMB = 1024;   // baked maps waiting for or being written before bakes block
+	inline std::string bakeCacheDirectory = "bakeCache"; // content-addressed bake results, empty disables the cache
+	inline std::string textureCacheDirectory = "textureCache"; // decoded, mip-mapped textures, empty disables the cache
+	inline bool compressCachedTextures = false; // store cached colour textures as BC7, smaller and faster to upload but lossy
+	inline size_t textureBudgetMB = 2048;        // scene textures, high mips of unused ones are evicted beyond it, 0 = no limit
+
 	inline float getAspectRatio()
 	{
 		return static_cast<float>(viewportWidth) / static_cast<float>(viewportHeight);
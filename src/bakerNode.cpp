@@ -1,10 +1,13 @@
 #include "bakerNode.hpp"
 #include <iostream>
+#include <map>
 
 #include "material.hpp"
 #include "primitive.hpp"
+#include "scene.hpp"
 
 #include "passes/bakerPass.hpp"
+#include "baking/dilation.hpp"
 
 LowPolyNode::LowPolyNode(const std::string_view nodeName)
 {
@@ -50,16 +53,25 @@ Baker::Baker(
 	textureWidth = 1024;
 	cageOffset = 0.1f;
 	useSmoothedNormals = 0;
+	useCPURasterizer = false;
+	dilationDistance = 16;
+	infiniteDilation = false;
 	m_scene = scene;
 }
 
 void Baker::bake()
+{
+	scheduleBakes(getPasses());
+}
+
+bool Baker::isBaking() const
 {
 	for (const auto& [materialName, bakerPass] : m_materialsBakerPasses)
 	{
-		std::cout << "Baking material: " << materialName << std::endl;
-		bakerPass->bake(textureWidth, textureWidth, cageOffset, useSmoothedNormals);
+		if (bakerPass->isBaking())
+			return true;
 	}
+	return false;
 }
 
 void Baker::requestBake()
@@ -75,16 +87,45 @@ void Baker::processPendingBake()
 		bake();
 		m_pendingBake = false;
 	}
+	std::vector<std::shared_ptr<BakerPass>> passesToRebake;
 	for (const auto& [materialName, bakerPass] : m_materialsBakerPasses)
 	{
-		if (bakerPass->needsRebake)
+		if (bakerPass->needsRebake && !bakerPass->isBaking())
 		{
-			std::cout << "Baking material: " << materialName << std::endl;
-			bakerPass->bake(textureWidth, textureWidth, cageOffset, useSmoothedNormals);
 			bakerPass->needsRebake = false;
+			passesToRebake.push_back(bakerPass);
+		}
+	}
+	if (!passesToRebake.empty())
+	{
+		scheduleBakes(passesToRebake);
+	}
+}
+
+void Baker::scheduleBakes(const std::vector<std::shared_ptr<BakerPass>>& passes)
+{
+	Jobs::JobSystem& jobs = m_scene->getBakeJobs();
+	const uint64_t group = reinterpret_cast<uintptr_t>(this);
+
+	// Passes of one Baker usually bake against the same high-poly meshes, build their BLASes only once
+	std::map<std::vector<Primitive*>, std::shared_ptr<SharedHighPoly>> highPolys;
+	for (const auto& bakerPass : passes)
+	{
+		if (bakerPass->isBaking())
+		{
+			bakerPass->needsRebake = true; // rebaked once the running bake finished
+			continue;
 		}
-		else
+		if (bakerPass->restoreFromCache(getBakeSettings()))
 			continue;
+		std::cout << "Baking: " << bakerPass->name << std::endl;
+		const std::vector<Primitive*>& highPolyPrimitives = bakerPass->getPrimitivesToBake().second;
+		std::shared_ptr<SharedHighPoly>& highPoly = highPolys[highPolyPrimitives];
+		if (!highPoly && !highPolyPrimitives.empty())
+		{
+			highPoly = BakerPass::scheduleHighPolyBuild(bakerPass, highPolyPrimitives, jobs, group);
+		}
+		bakerPass->scheduleBake(getBakeSettings(), highPoly, jobs, group);
 	}
 }
 
@@ -97,6 +138,9 @@ void Baker::copyFrom(const SceneNode& node)
 		textureWidth = bakerNode->textureWidth;
 		cageOffset = bakerNode->cageOffset;
 		useSmoothedNormals = bakerNode->useSmoothedNormals;
+		useCPURasterizer = bakerNode->useCPURasterizer;
+		dilationDistance = bakerNode->dilationDistance;
+		infiniteDilation = bakerNode->infiniteDilation;
 		lowPoly = std::unique_ptr<LowPolyNode>(static_cast<LowPolyNode*>(bakerNode->lowPoly->clone().release()));
 		highPoly = std::unique_ptr<HighPolyNode>(static_cast<HighPolyNode*>(bakerNode->highPoly->clone().release()));
 		m_materialsToBake = bakerNode->m_materialsToBake;
@@ -116,12 +160,14 @@ bool Baker::differsFrom(const SceneNode& node) const
 			bool textureWidthDiffers = textureWidth != baker->textureWidth;
 			bool cageOffsetDiffers = cageOffset != baker->cageOffset;
 			bool useSmoothedNormalsDiffers = useSmoothedNormals != baker->useSmoothedNormals;
+			bool useCPURasterizerDiffers = useCPURasterizer != baker->useCPURasterizer;
+			bool dilationDiffers = dilationDistance != baker->dilationDistance || infiniteDilation != baker->infiniteDilation;
 			bool materialsToBakeDiffers = m_materialsToBake != baker->m_materialsToBake;
 			bool materialsPrimitivesMapDiffers = m_materialsPrimitivesMap != baker->m_materialsPrimitivesMap;
 			bool materialsBakerPassesDiffers = m_materialsBakerPasses.size() != baker->m_materialsBakerPasses.size();
 
 			return lowPolyDiffers || highPolyDiffers || textureWidthDiffers
-				|| cageOffsetDiffers || useSmoothedNormalsDiffers || materialsToBakeDiffers
+				|| cageOffsetDiffers || useSmoothedNormalsDiffers || useCPURasterizerDiffers || dilationDiffers || materialsToBakeDiffers
 				|| materialsPrimitivesMapDiffers || materialsBakerPassesDiffers;
 		}
 	}
@@ -220,6 +266,17 @@ void Baker::createOrUpdateBakerPasses()
 
 }
 
+BakeSettings Baker::getBakeSettings() const
+{
+	BakeSettings settings;
+	settings.width = textureWidth;
+	settings.height = textureWidth;
+	settings.cageOffset = cageOffset;
+	settings.useSmoothedNormals = useSmoothedNormals;
+	settings.useCPURasterizer = useCPURasterizer;
+	settings.dilationDistance = infiniteDilation ? Baking::k_infiniteDilation : dilationDistance;
+	return settings;
+}
 
 void Baker::updateState()
 {
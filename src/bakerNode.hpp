@@ -8,6 +8,7 @@
 using namespace Microsoft::WRL;
 
 class BakerPass;
+struct BakeSettings;
 struct Material;
 class Primitive;
 class Scene;
@@ -48,6 +49,7 @@ public:
 	void bake();
 	void requestBake();
 	void processPendingBake();
+	bool isBaking() const;
 
 	void copyFrom(const SceneNode& node) override;
 	bool differsFrom(const SceneNode& node) const override;
@@ -61,12 +63,17 @@ public:
 	uint32_t textureWidth;
 	float cageOffset;
 	uint32_t useSmoothedNormals;
+	bool useCPURasterizer;
+	uint32_t dilationDistance;
+	bool infiniteDilation;
 
 private:
 	void updateState();
 	void collectMaterialsToBake();
 	void collectPrimitivesToBake();
 	void createOrUpdateBakerPasses();
+	void scheduleBakes(const std::vector<std::shared_ptr<BakerPass>>& passes);
+	BakeSettings getBakeSettings() const;
 	bool m_pendingBake = false;
 
 private:
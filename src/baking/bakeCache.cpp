@@ -0,0 +1,215 @@
+#include "bakeCache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "utility/hash.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr const char* k_manifestHeader = "BakeForge bake cache";
+	constexpr size_t k_hashChunkVertices = 4096;
+}
+
+BakeCache::BakeCache(std::filesystem::path directory)
+	: m_directory(std::move(directory))
+{
+	if (m_directory.empty())
+		return;
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	if (error)
+	{
+		std::cerr << "Bake cache disabled, cannot create " << m_directory.string() << ": " << error.message() << std::endl;
+		m_directory.clear();
+	}
+}
+
+bool BakeCache::isEnabled() const
+{
+	return !m_directory.empty();
+}
+
+bool BakeCache::restoreTile(uint64_t tileKey, const std::filesystem::path& outputPath) const
+{
+	if (!isEnabled())
+		return false;
+
+	const std::filesystem::path cachedPath = getTilePath(tileKey, outputPath.extension().string());
+	std::error_code error;
+	if (!std::filesystem::exists(cachedPath, error))
+		return false;
+
+	std::filesystem::copy_file(cachedPath, outputPath, std::filesystem::copy_options::overwrite_existing, error);
+	if (error)
+	{
+		std::cerr << "Failed to restore " << outputPath.string() << " from the bake cache: " << error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void BakeCache::storeTile(uint64_t tileKey, const std::filesystem::path& bakedPath) const
+{
+	if (!isEnabled())
+		return;
+	publish(bakedPath, getTilePath(tileKey, bakedPath.extension().string()));
+}
+
+std::vector<CachedTile> BakeCache::findBake(uint64_t bakeKey, const std::string& extension) const
+{
+	if (!isEnabled())
+		return {};
+
+	std::ifstream manifest(getManifestPath(bakeKey));
+	std::string header;
+	if (!manifest || !std::getline(manifest, header) || header != k_manifestHeader)
+		return {};
+
+	std::vector<CachedTile> tiles;
+	CachedTile tile;
+	std::string key;
+	while (manifest >> tile.number >> key)
+	{
+		tile.key = std::stoull(key, nullptr, 16);
+		std::error_code error;
+		if (!std::filesystem::exists(getTilePath(tile.key, extension), error))
+			return {}; // evicted by hand, bake again
+		tiles.push_back(tile);
+	}
+	return tiles;
+}
+
+void BakeCache::storeBake(uint64_t bakeKey, const std::vector<CachedTile>& tiles) const
+{
+	if (!isEnabled() || tiles.empty())
+		return;
+
+	std::ostringstream manifest;
+	manifest << k_manifestHeader << "\n";
+	for (const CachedTile& tile : tiles)
+	{
+		manifest << tile.number << " " << Hash::toHex(tile.key) << "\n";
+	}
+
+	const std::filesystem::path manifestPath = getManifestPath(bakeKey);
+	std::filesystem::path temporaryPath = manifestPath;
+	temporaryPath += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream file(temporaryPath, std::ios::trunc);
+		file << manifest.str();
+		if (!file)
+		{
+			std::cerr << "Failed to write bake cache manifest " << manifestPath.string() << std::endl;
+			return;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, manifestPath, error);
+	if (error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+	}
+}
+
+std::filesystem::path BakeCache::getTilePath(uint64_t tileKey, const std::string& extension) const
+{
+	return m_directory / (Hash::toHex(tileKey) + extension);
+}
+
+std::filesystem::path BakeCache::getManifestPath(uint64_t bakeKey) const
+{
+	return m_directory / (Hash::toHex(bakeKey) + ".bake");
+}
+
+bool BakeCache::publish(const std::filesystem::path& source, const std::filesystem::path& target) const
+{
+	std::filesystem::path temporaryPath = target;
+	temporaryPath += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	std::error_code error;
+	std::filesystem::copy_file(source, temporaryPath, std::filesystem::copy_options::overwrite_existing, error);
+	if (!error)
+	{
+		std::filesystem::rename(temporaryPath, target, error);
+	}
+	if (error)
+	{
+		std::cerr << "Failed to store " << source.string() << " in the bake cache: " << error.message() << std::endl;
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+uint64_t Baking::hashTileGeometry(const std::vector<UVRasterMesh>& meshes, const UDIMTile& tile)
+{
+	uint64_t hash = Hash::combine(tile.number, tile.indices.size());
+	std::vector<Vertex> chunk;
+	chunk.reserve(k_hashChunkVertices);
+
+	for (size_t meshIndex = 0; meshIndex < meshes.size() && meshIndex < tile.indices.size(); meshIndex++)
+	{
+		const UVRasterMesh& mesh = meshes[meshIndex];
+		const std::vector<uint32_t>& indices = tile.indices[meshIndex];
+		if (indices.empty() || !mesh.vertices)
+			continue;
+
+		// Mesh order decides which of two overlapping islands wins a texel
+		hash = Hash::combine(hash, meshIndex);
+		hash = Hash::combineBytes(hash, mesh.worldMatrix);
+		hash = Hash::combine(hash, indices.size());
+
+		// Vertices are gathered in index order, so topology changes show up as well
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			chunk.push_back(indices[i] < mesh.vertexCount ? mesh.vertices[indices[i]] : Vertex());
+			if (chunk.size() == k_hashChunkVertices || i + 1 == indices.size())
+			{
+				hash = Hash::combine(hash, Hash::bytes(chunk.data(), chunk.size() * sizeof(Vertex)));
+				chunk.clear();
+			}
+		}
+	}
+	return hash;
+}
+
+uint64_t Baking::hashBlendMask(const float* texels, uint32_t width, uint32_t height, size_t rowPitch)
+{
+	const auto* bytes = reinterpret_cast<const uint8_t*>(texels);
+	const float first = width > 0 && height > 0 ? texels[0] : 0.0f;
+	bool uniform = true;
+	for (uint32_t y = 0; y < height && uniform; y++)
+	{
+		const float* row = reinterpret_cast<const float*>(bytes + y * rowPitch);
+		for (uint32_t x = 0; x < width; x++)
+		{
+			if (std::memcmp(&row[x], &first, sizeof(float)) != 0)
+			{
+				uniform = false;
+				break;
+			}
+		}
+	}
+	if (uniform)
+		return hashUniformBlendMask(first);
+
+	uint64_t hash = Hash::combine(width, height);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		hash = Hash::combine(hash, Hash::bytes(bytes + y * rowPitch, width * sizeof(float)));
+	}
+	return hash;
+}
+
+uint64_t Baking::hashUniformBlendMask(float value)
+{
+	return Hash::combineBytes(0x5A17ull, value);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "udim.hpp"
+#include "uvRasterizer.hpp"
+
+namespace Baking
+{
+	// Bump whenever a change to the baker alters its output, invalidates every cached result
+	constexpr uint32_t k_bakerVersion = 1;
+
+	struct CachedTile
+	{
+		uint32_t number = k_firstUDIM;
+		uint64_t key = 0;
+	};
+
+	// Content-addressed store of baked maps. Every output tile is stored under a key derived from
+	// everything that affects its texels, so a partially changed scene only rebakes the tiles it touches.
+	// A manifest per bake key lists the tiles of a complete bake, which lets an unchanged bake be
+	// restored without building any baking resources. Files are written through a temporary and renamed,
+	// so concurrent bakes sharing the cache never see partial results.
+	class BakeCache
+	{
+	public:
+		// An empty directory disables the cache
+		explicit BakeCache(std::filesystem::path directory);
+
+		bool isEnabled() const;
+
+		// Copies the cached tile to outputPath, false on a miss
+		bool restoreTile(uint64_t tileKey, const std::filesystem::path& outputPath) const;
+		void storeTile(uint64_t tileKey, const std::filesystem::path& bakedPath) const;
+
+		// Tiles of a complete bake, empty on a miss or when any tile file is gone
+		std::vector<CachedTile> findBake(uint64_t bakeKey, const std::string& extension) const;
+		void storeBake(uint64_t bakeKey, const std::vector<CachedTile>& tiles) const;
+
+	private:
+		std::filesystem::path getTilePath(uint64_t tileKey, const std::string& extension) const;
+		std::filesystem::path getManifestPath(uint64_t bakeKey) const;
+		bool publish(const std::filesystem::path& source, const std::filesystem::path& target) const;
+
+		std::filesystem::path m_directory;
+	};
+
+	// Hash of the low-poly vertices referenced by the tile, with the transform and position of their mesh
+	uint64_t hashTileGeometry(const std::vector<UVRasterMesh>& meshes, const UDIMTile& tile);
+
+	// Hash of a single channel fp32 blend mask. Masks filled with one value hash like hashUniformBlendMask,
+	// so a cleared mask matches without reading it back.
+	uint64_t hashBlendMask(const float* texels, uint32_t width, uint32_t height, size_t rowPitch);
+	uint64_t hashUniformBlendMask(float value);
+} // namespace Baking
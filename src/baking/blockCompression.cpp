@@ -0,0 +1,419 @@
+#include "blockCompression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "utility/parallelFor.hpp"
+#include "utility/simd.hpp"
+
+using namespace Baking;
+using Simd::Float4;
+
+namespace
+{
+	constexpr int k_blockTexels = 16;
+	constexpr float k_unormTo8Bit = 255.0f / 65535.0f;
+
+	// BC7 4-bit index weights, in 64ths
+	constexpr int k_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct WeightLookup
+	{
+		uint8_t index[65] = {}; // nearest 4-bit index of every weight in 64ths
+
+		WeightLookup()
+		{
+			for (int weight = 0; weight <= 64; weight++)
+			{
+				int best = 0;
+				for (int i = 1; i < 16; i++)
+				{
+					if (std::abs(k_weights4[i] - weight) < std::abs(k_weights4[best] - weight))
+					{
+						best = i;
+					}
+				}
+				index[weight] = static_cast<uint8_t>(best);
+			}
+		}
+	};
+
+	const WeightLookup k_weightLookup;
+
+	// Texels of a block as 0-255 floats, one row of 16 per channel
+	struct BlockTexels
+	{
+		alignas(16) float channels[4][k_blockTexels];
+
+		Float4 load(int channel, int group) const
+		{
+			return Float4::load(channels[channel] + group * 4);
+		}
+	};
+
+	// Bits of a block, least significant first
+	struct BlockBits
+	{
+		uint8_t bytes[k_blockBytes] = {};
+		uint32_t position = 0;
+
+		void write(uint32_t value, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; i++, position++)
+			{
+				bytes[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (position & 7));
+			}
+		}
+	};
+
+	// BC4: two 8-bit endpoints and 3-bit indices. With red0 > red1 the palette is 8 evenly spaced values, index 0 is
+	// red0, index 1 red1 and indices 2-7 the steps in between.
+	void encodeBC4(const float values[k_blockTexels], uint8_t out[8])
+	{
+		Float4 texels[4];
+		Float4 low(255.0f);
+		Float4 high(0.0f);
+		for (int group = 0; group < 4; group++)
+		{
+			texels[group] = Float4::load(values + group * 4);
+			low = Simd::min(low, texels[group]);
+			high = Simd::max(high, texels[group]);
+		}
+		const int lowBase = static_cast<int>(std::lround(Simd::minLane(low)));
+		const int highBase = static_cast<int>(std::lround(Simd::maxLane(high)));
+
+		std::memset(out, 0, 8);
+		if (highBase <= lowBase)
+		{
+			out[0] = out[1] = static_cast<uint8_t>(highBase);
+			return;
+		}
+
+		// The palette is exact in float, only the endpoint rounding is searched
+		float bestError = INFINITY;
+		int best0 = highBase;
+		int best1 = lowBase;
+		for (int highOffset = -1; highOffset <= 1; highOffset++)
+		{
+			for (int lowOffset = -1; lowOffset <= 1; lowOffset++)
+			{
+				const int red0 = std::clamp(highBase + highOffset, 0, 255);
+				const int red1 = std::clamp(lowBase + lowOffset, 0, 255);
+				if (red0 <= red1)
+					continue;
+				const Float4 scale(7.0f / float(red0 - red1));
+				const Float4 step(float(red1 - red0) / 7.0f);
+				Float4 error;
+				for (int group = 0; group < 4; group++)
+				{
+					const Float4 steps = Simd::roundPositive(Simd::clamp((Float4(float(red0)) - texels[group]) * scale, 0.0f, 7.0f));
+					const Float4 difference = Float4(float(red0)) + steps * step - texels[group];
+					error += difference * difference;
+				}
+				const float total = Simd::sum(error);
+				if (total < bestError)
+				{
+					bestError = total;
+					best0 = red0;
+					best1 = red1;
+				}
+			}
+		}
+
+		out[0] = static_cast<uint8_t>(best0);
+		out[1] = static_cast<uint8_t>(best1);
+		const Float4 scale(7.0f / float(best0 - best1));
+		uint64_t indices = 0;
+		for (int group = 0; group < 4; group++)
+		{
+			int32_t steps[4];
+			Simd::toInt(Simd::roundPositive(Simd::clamp((Float4(float(best0)) - texels[group]) * scale, 0.0f, 7.0f)), steps);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const uint64_t index = steps[lane] == 0 ? 0 : steps[lane] == 7 ? 1 : steps[lane] + 1;
+				indices |= index << ((group * 4 + lane) * 3);
+			}
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	// BC7 mode 6: one subset, 7-bit RGBA endpoints with a p-bit each, 4-bit indices
+	struct Mode6Fit
+	{
+		float error = INFINITY;
+		int endpoints[2][4] = {}; // 7-bit
+		int pBits[2] = {};
+		uint8_t indices[k_blockTexels] = {};
+	};
+
+	// Indices by projection onto the quantized endpoint line, error of the texels the decoder reconstructs
+	void fitIndices(const BlockTexels& texels, const int end0[4], const int end1[4], uint8_t indices[k_blockTexels], float& error)
+	{
+		float direction[4];
+		float lengthSquared = 0.0f;
+		for (int channel = 0; channel < 4; channel++)
+		{
+			direction[channel] = float(end1[channel] - end0[channel]);
+			lengthSquared += direction[channel] * direction[channel];
+		}
+		const Float4 scale(lengthSquared > 0.0f ? 64.0f / lengthSquared : 0.0f);
+
+		Float4 total;
+		for (int group = 0; group < 4; group++)
+		{
+			Float4 projection;
+			for (int channel = 0; channel < 4; channel++)
+			{
+				projection += (texels.load(channel, group) - Float4(float(end0[channel]))) * Float4(direction[channel]);
+			}
+			int32_t weights[4];
+			Simd::toInt(Simd::roundPositive(Simd::clamp(projection * scale, 0.0f, 64.0f)), weights);
+			alignas(16) float weight[4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const uint8_t index = k_weightLookup.index[weights[lane]];
+				indices[group * 4 + lane] = index;
+				weight[lane] = float(k_weights4[index]);
+			}
+			const Float4 w1 = Float4::load(weight);
+			const Float4 w0 = Float4(64.0f) - w1;
+			for (int channel = 0; channel < 4; channel++)
+			{
+				const Float4 decoded = Simd::floorPositive(
+					(w0 * Float4(float(end0[channel])) + w1 * Float4(float(end1[channel])) + Float4(32.0f)) * Float4(1.0f / 64.0f));
+				const Float4 difference = decoded - texels.load(channel, group);
+				total += difference * difference;
+			}
+		}
+		error = Simd::sum(total);
+	}
+
+	// Best quantization of two float endpoints over the four p-bit combinations
+	void fitEndpoints(const BlockTexels& texels, const float start[4], const float end[4], Mode6Fit& fit)
+	{
+		for (int pBit0 = 0; pBit0 < 2; pBit0++)
+		{
+			for (int pBit1 = 0; pBit1 < 2; pBit1++)
+			{
+				int quantized[2][4];
+				int end0[4];
+				int end1[4];
+				for (int channel = 0; channel < 4; channel++)
+				{
+					quantized[0][channel] = std::clamp(static_cast<int>(std::lround((start[channel] - pBit0) * 0.5f)), 0, 127);
+					quantized[1][channel] = std::clamp(static_cast<int>(std::lround((end[channel] - pBit1) * 0.5f)), 0, 127);
+					end0[channel] = quantized[0][channel] * 2 + pBit0;
+					end1[channel] = quantized[1][channel] * 2 + pBit1;
+				}
+				uint8_t indices[k_blockTexels];
+				float error;
+				fitIndices(texels, end0, end1, indices, error);
+				if (error < fit.error)
+				{
+					fit.error = error;
+					std::memcpy(fit.endpoints, quantized, sizeof(quantized));
+					fit.pBits[0] = pBit0;
+					fit.pBits[1] = pBit1;
+					std::memcpy(fit.indices, indices, sizeof(indices));
+				}
+			}
+		}
+	}
+
+	void encodeBC7(const BlockTexels& texels, uint8_t out[k_blockBytes])
+	{
+		float mean[4];
+		for (int channel = 0; channel < 4; channel++)
+		{
+			Float4 total;
+			for (int group = 0; group < 4; group++)
+			{
+				total += texels.load(channel, group);
+			}
+			mean[channel] = Simd::sum(total) / k_blockTexels;
+		}
+
+		float covariance[4][4];
+		for (int a = 0; a < 4; a++)
+		{
+			for (int b = a; b < 4; b++)
+			{
+				Float4 total;
+				for (int group = 0; group < 4; group++)
+				{
+					total += (texels.load(a, group) - Float4(mean[a])) * (texels.load(b, group) - Float4(mean[b]));
+				}
+				covariance[a][b] = covariance[b][a] = Simd::sum(total);
+			}
+		}
+
+		// Principal axis by power iteration, started from the row of the channel that varies most
+		int widest = 0;
+		for (int channel = 1; channel < 4; channel++)
+		{
+			if (covariance[channel][channel] > covariance[widest][widest])
+			{
+				widest = channel;
+			}
+		}
+		float axis[4] = { covariance[widest][0], covariance[widest][1], covariance[widest][2], covariance[widest][3] };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < 4; a++)
+			{
+				for (int b = 0; b < 4; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length = std::max(length, std::abs(next[a]));
+			}
+			if (length <= 0.0f)
+				break;
+			for (int a = 0; a < 4; a++)
+			{
+				axis[a] = next[a] / length;
+			}
+		}
+		float axisLength = 0.0f;
+		for (const float value : axis)
+		{
+			axisLength += value * value;
+		}
+		axisLength = std::sqrt(axisLength);
+
+		float start[4];
+		float end[4];
+		if (axisLength > 0.0f)
+		{
+			Float4 low(INFINITY);
+			Float4 high(-INFINITY);
+			for (int group = 0; group < 4; group++)
+			{
+				Float4 projection;
+				for (int channel = 0; channel < 4; channel++)
+				{
+					projection += (texels.load(channel, group) - Float4(mean[channel])) * Float4(axis[channel] / axisLength);
+				}
+				low = Simd::min(low, projection);
+				high = Simd::max(high, projection);
+			}
+			for (int channel = 0; channel < 4; channel++)
+			{
+				start[channel] = std::clamp(mean[channel] + Simd::minLane(low) * axis[channel] / axisLength, 0.0f, 255.0f);
+				end[channel] = std::clamp(mean[channel] + Simd::maxLane(high) * axis[channel] / axisLength, 0.0f, 255.0f);
+			}
+		}
+		else
+		{
+			std::copy(mean, mean + 4, start);
+			std::copy(mean, mean + 4, end);
+		}
+
+		Mode6Fit fit;
+		fitEndpoints(texels, start, end, fit);
+
+		// Endpoints that minimize the squared error for the chosen indices
+		for (int iteration = 0; iteration < 2 && fit.error > 0.0f; iteration++)
+		{
+			float a = 0.0f, b = 0.0f, c = 0.0f;
+			float x0[4] = {};
+			float x1[4] = {};
+			for (int texel = 0; texel < k_blockTexels; texel++)
+			{
+				const float w = k_weights4[fit.indices[texel]] / 64.0f;
+				a += (1.0f - w) * (1.0f - w);
+				b += (1.0f - w) * w;
+				c += w * w;
+				for (int channel = 0; channel < 4; channel++)
+				{
+					x0[channel] += (1.0f - w) * texels.channels[channel][texel];
+					x1[channel] += w * texels.channels[channel][texel];
+				}
+			}
+			const float determinant = a * c - b * b;
+			if (std::abs(determinant) < 1e-6f)
+				break;
+			for (int channel = 0; channel < 4; channel++)
+			{
+				start[channel] = std::clamp((c * x0[channel] - b * x1[channel]) / determinant, 0.0f, 255.0f);
+				end[channel] = std::clamp((a * x1[channel] - b * x0[channel]) / determinant, 0.0f, 255.0f);
+			}
+			const float previousError = fit.error;
+			fitEndpoints(texels, start, end, fit);
+			if (fit.error >= previousError)
+				break;
+		}
+
+		// The most significant bit of the first index is implied zero
+		if (fit.indices[0] & 8)
+		{
+			std::swap(fit.endpoints[0], fit.endpoints[1]);
+			std::swap(fit.pBits[0], fit.pBits[1]);
+			for (uint8_t& index : fit.indices)
+			{
+				index = static_cast<uint8_t>(15 - index);
+			}
+		}
+
+		BlockBits bits;
+		bits.write(1 << 6, 7);
+		for (int channel = 0; channel < 4; channel++)
+		{
+			bits.write(fit.endpoints[0][channel], 7);
+			bits.write(fit.endpoints[1][channel], 7);
+		}
+		bits.write(fit.pBits[0], 1);
+		bits.write(fit.pBits[1], 1);
+		bits.write(fit.indices[0], 3);
+		for (int texel = 1; texel < k_blockTexels; texel++)
+		{
+			bits.write(fit.indices[texel], 4);
+		}
+		std::memcpy(out, bits.bytes, k_blockBytes);
+	}
+}
+
+std::vector<uint8_t> Baking::compressBlocks(BlockFormat format, const uint16_t* pixels, uint32_t width, uint32_t height,
+	size_t rowPitch, uint32_t maxThreads)
+{
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t pitch = rowPitch != 0 ? rowPitch : size_t(width) * 4 * sizeof(uint16_t);
+	std::vector<uint8_t> blocks(size_t(blocksX) * blocksY * k_blockBytes);
+
+	Parallel::parallelFor(blocksY, [&](size_t blockY)
+		{
+			BlockTexels texels;
+			for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+			{
+				for (int texel = 0; texel < k_blockTexels; texel++)
+				{
+					const uint32_t x = std::min(blockX * 4 + texel % 4, width - 1);
+					const uint32_t y = std::min(static_cast<uint32_t>(blockY) * 4 + texel / 4, height - 1);
+					const uint16_t* source = reinterpret_cast<const uint16_t*>(reinterpret_cast<const uint8_t*>(pixels) + y * pitch) + x * 4;
+					for (int channel = 0; channel < 4; channel++)
+					{
+						texels.channels[channel][texel] = source[channel] * k_unormTo8Bit;
+					}
+				}
+
+				uint8_t* out = blocks.data() + (blockY * blocksX + blockX) * k_blockBytes;
+				if (format == BlockFormat::BC5)
+				{
+					encodeBC4(texels.channels[0], out);
+					encodeBC4(texels.channels[1], out + 8);
+				}
+				else
+				{
+					encodeBC7(texels, out);
+				}
+			}
+		}, maxThreads);
+	return blocks;
+}
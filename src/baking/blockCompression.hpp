@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Baking
+{
+	enum class BlockFormat
+	{
+		BC5, // red and green as two BC4 channels, for tangent-space normals
+		BC7  // RGBA colour
+	};
+
+	// Both formats store a 4x4 block of texels in 16 bytes
+	constexpr size_t k_blockBytes = 16;
+
+	// Compresses an RGBA16 image to blocks, block rows top to bottom. Blocks past the right or bottom edge repeat
+	// the last column and row. Block rows are encoded on up to maxThreads threads (0 uses every core), the texels of
+	// a block with SSE2 where available. BC7 uses mode 6, fitted along the principal axis of every block and then
+	// refined by least squares. BC5 searches the endpoints around the range of each channel.
+	std::vector<uint8_t> compressBlocks(BlockFormat format, const uint16_t* pixels, uint32_t width, uint32_t height,
+		size_t rowPitch = 0, uint32_t maxThreads = 0);
+} // namespace Baking
@@ -0,0 +1,146 @@
+#include "cageEstimation.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <unordered_map>
+
+#include "closestPoint.hpp"
+#include "utility/hash.hpp"
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	// The closest point is only a lower bound of the distance along the ray, the margin covers slanted surfaces
+	constexpr float k_cageMargin = 1.25f;
+	// Keeps rays of vertices lying on the high-poly surface from starting on it, relative to the search distance
+	constexpr float k_minOffsetFraction = 0.01f;
+
+	// Same quantization as computeSmoothNormals
+	uint64_t hashPosition(const glm::vec3& p)
+	{
+		const int x = static_cast<int>(p.x * 10000.0f);
+		const int y = static_cast<int>(p.y * 10000.0f);
+		const int z = static_cast<int>(p.z * 10000.0f);
+		return Hash::combine(Hash::combine(Hash::mix(static_cast<uint32_t>(x)), static_cast<uint32_t>(y)), static_cast<uint32_t>(z));
+	}
+}
+
+CageEstimate Baking::estimateCage(const std::vector<Vertex>& vertices,
+	const std::vector<uint32_t>& indices,
+	const glm::mat4& worldMatrix,
+	const CombinedHighPolyData& highPoly,
+	float searchDistance)
+{
+	CageEstimate estimate;
+	estimate.vertexOffsets.resize(vertices.size());
+	if (vertices.empty())
+		return estimate;
+
+	const ClosestPointQuery query(highPoly);
+	const float minOffset = searchDistance * k_minOffsetFraction;
+
+	// Ray start distance needed at a world-space point, 0 without high-poly in reach
+	auto measure = [&](const glm::vec3& position, float& outDepth) -> float
+		{
+			const ClosestPoint closest = query.find(position, searchDistance);
+			outDepth = 0.0f;
+			if (!closest.isValid())
+				return 0.0f;
+			if (glm::dot(closest.position - position, closest.normal) > 0.0f)
+				return std::max(closest.distance * k_cageMargin, minOffset);
+			outDepth = closest.distance;
+			return minOffset;
+		};
+
+	const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(worldMatrix)));
+	std::vector<glm::vec3> positions(vertices.size());
+	std::vector<glm::vec3> normals(vertices.size());
+	std::vector<float> vertexDepths(vertices.size());
+	Parallel::parallelForChunks(vertices.size(), 1024, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				positions[i] = glm::vec3(worldMatrix * glm::vec4(vertices[i].position, 1.0f));
+				normals[i] = normalMatrix * vertices[i].smoothNormal;
+				float depth = 0.0f;
+				estimate.vertexOffsets[i] = measure(positions[i], depth);
+				vertexDepths[i] = depth;
+			}
+		});
+
+	// High-poly detail between the vertices rises above the low-poly triangles, every vertex covers its one-ring
+	const size_t triangleCount = indices.size() / 3;
+	std::vector<float> triangleOffsets(triangleCount);
+	Parallel::parallelForChunks(triangleCount, 1024, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				const uint32_t i0 = indices[t * 3];
+				const uint32_t i1 = indices[t * 3 + 1];
+				const uint32_t i2 = indices[t * 3 + 2];
+				const float height = query.findMaxHeight(positions[i0], positions[i1], positions[i2], normals[i0] + normals[i1] + normals[i2], searchDistance);
+				triangleOffsets[t] = height > 0.0f ? std::max(height * k_cageMargin, minOffset) : 0.0f;
+			}
+		});
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			const uint32_t v = indices[t * 3 + corner];
+			estimate.vertexOffsets[v] = std::max(estimate.vertexOffsets[v], triangleOffsets[t]);
+		}
+	}
+
+	// Vertices split at UV seams and hard edges get the same offset, so the cage has no cracks
+	std::unordered_map<uint64_t, float> weldedOffsets;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		float& offset = weldedOffsets[hashPosition(vertices[i].position)];
+		offset = std::max(offset, estimate.vertexOffsets[i]);
+	}
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		estimate.vertexOffsets[i] = weldedOffsets[hashPosition(vertices[i].position)];
+	}
+
+	for (const float depth : vertexDepths)
+	{
+		estimate.maxDepth = std::max(estimate.maxDepth, depth);
+	}
+
+	size_t matchedCount = 0;
+	double sum = 0.0;
+	estimate.minOffset = FLT_MAX;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		if (estimate.vertexOffsets[i] == 0.0f)
+			continue;
+		const float offset = estimate.vertexOffsets[i];
+		estimate.minOffset = std::min(estimate.minOffset, offset);
+		estimate.maxOffset = std::max(estimate.maxOffset, offset);
+		sum += offset;
+		matchedCount++;
+	}
+	estimate.unmatchedVertices = vertices.size() - matchedCount;
+	if (matchedCount == 0)
+	{
+		// Nothing to measure against, fall back to the search distance everywhere
+		std::fill(estimate.vertexOffsets.begin(), estimate.vertexOffsets.end(), searchDistance);
+		estimate.minOffset = estimate.maxOffset = estimate.averageOffset = estimate.suggestedOffset = searchDistance;
+		return estimate;
+	}
+
+	estimate.averageOffset = static_cast<float>(sum / matchedCount);
+	estimate.suggestedOffset = estimate.maxOffset;
+	for (float& offset : estimate.vertexOffsets)
+	{
+		if (offset == 0.0f)
+		{
+			offset = estimate.suggestedOffset;
+		}
+	}
+	return estimate;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "highPoly.hpp"
+#include "primitiveData.hpp"
+
+namespace Baking
+{
+	struct CageEstimate
+	{
+		// World-space ray start distance of every low-poly vertex, just outside the high-poly surface above it
+		std::vector<float> vertexOffsets;
+		float suggestedOffset = 0.0f; // smallest uniform cage offset covering every matched vertex
+		float minOffset = 0.0f;
+		float maxOffset = 0.0f;
+		float averageOffset = 0.0f;
+		float maxDepth = 0.0f;        // farthest high-poly surface below a vertex
+		size_t unmatchedVertices = 0; // no high-poly within the search distance, these get suggestedOffset
+	};
+
+	// Signed distance from every low-poly vertex to the nearest high-poly surface, positive when the vertex lies
+	// below the surface and the rays have to start above it. The side is taken from the interpolated high-poly
+	// normal at the closest point. High-poly vertices above a low-poly triangle raise the offsets of its corners,
+	// so the interpolated cage clears detail between the vertices. Runs in parallel over the vertices and triangles.
+	CageEstimate estimateCage(const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		const glm::mat4& worldMatrix,
+		const CombinedHighPolyData& highPoly,
+		float searchDistance);
+} // namespace Baking
@@ -0,0 +1,262 @@
+#include "closestPoint.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "meshProcessing.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr uint32_t k_maxStackSize = 64;
+
+	float distanceSquared(const BVH::BBox& box, const glm::vec3& point)
+	{
+		const glm::vec3 d = glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0.0f));
+		return glm::dot(d, d);
+	}
+
+	// Closest point on a triangle by Voronoi region, Real-Time Collision Detection 5.1.5.
+	// Returns the barycentrics of v1 and v2.
+	glm::vec2 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		const glm::vec3 ab = b - a;
+		const glm::vec3 ac = c - a;
+		const glm::vec3 ap = p - a;
+		const float d1 = glm::dot(ab, ap);
+		const float d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return glm::vec2(0.0f, 0.0f);
+
+		const glm::vec3 bp = p - b;
+		const float d3 = glm::dot(ab, bp);
+		const float d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return glm::vec2(1.0f, 0.0f);
+
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return glm::vec2(d1 / (d1 - d3), 0.0f);
+
+		const glm::vec3 cp = p - c;
+		const float d5 = glm::dot(ab, cp);
+		const float d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return glm::vec2(0.0f, 1.0f);
+
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return glm::vec2(0.0f, d2 / (d2 - d6));
+
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return glm::vec2(1.0f - w, w);
+		}
+
+		const float denom = 1.0f / (va + vb + vc);
+		return glm::vec2(vb * denom, vc * denom);
+	}
+}
+
+ClosestPointQuery::ClosestPointQuery(const CombinedHighPolyData& highPoly)
+	: m_highPoly(highPoly)
+{
+}
+
+ClosestPoint ClosestPointQuery::find(const glm::vec3& point, float maxDistance) const
+{
+	ClosestPoint result;
+	result.distance = maxDistance;
+	for (uint32_t i = 0; i < m_highPoly.blasInstances.size(); i++)
+	{
+		if (distanceSquared(m_highPoly.blasInstances[i].worldBBox, point) >= result.distance * result.distance)
+			continue;
+
+		traverseBLAS(point, i, result);
+	}
+	return result;
+}
+
+void ClosestPointQuery::traverseBLAS(const glm::vec3& point, uint32_t instanceIndex, ClosestPoint& result) const
+{
+	const BLASInstance& inst = m_highPoly.blasInstances[instanceIndex];
+
+	// normalMatrix is the inverse world matrix, worldMatrixInv holds it transposed for the shaders
+	const glm::mat4 worldMatrix = glm::inverse(inst.normalMatrix);
+	const glm::vec3 localPoint = glm::vec3(inst.normalMatrix * glm::vec4(point, 1.0f));
+
+	// Local distances scale by at least the smallest singular value of the world matrix,
+	// 1 / |inverse|_F is a cheap lower bound of it that keeps the node pruning conservative
+	const glm::mat3 inverse3(inst.normalMatrix);
+	float frobenius = 0.0f;
+	for (int c = 0; c < 3; c++)
+	{
+		frobenius += glm::dot(inverse3[c], inverse3[c]);
+	}
+	const float minScale = 1.0f / std::sqrt(frobenius);
+
+	const BVH::Node* nodes = m_highPoly.bvhNodes.data() + inst.bvhNodeOffset;
+	const uint32_t* triIndices = m_highPoly.triIndices.data() + inst.triIndicesOffset;
+	const Triangle* tris = m_highPoly.triangles.data() + inst.triangleOffset;
+
+	uint32_t bestTriangle = UINT32_MAX;
+	glm::vec2 bestBary(0.0f);
+
+	uint32_t stack[k_maxStackSize];
+	uint32_t stackPtr = 0;
+	stack[stackPtr++] = 0;
+
+	while (stackPtr > 0)
+	{
+		const BVH::Node& node = nodes[stack[--stackPtr]];
+		const float localBound = result.distance / minScale;
+		if (distanceSquared(node.bbox, localPoint) >= localBound * localBound)
+			continue;
+
+		if (node.numTris > 0)
+		{
+			for (uint32_t i = 0; i < node.numTris; i++)
+			{
+				const uint32_t triangle = triIndices[node.firstTriIndex + i];
+				const Triangle& tri = tris[triangle];
+				const glm::vec2 bary = closestPointOnTriangle(localPoint, tri.v0, tri.v1, tri.v2);
+				const glm::vec3 local = (1.0f - bary.x - bary.y) * tri.v0 + bary.x * tri.v1 + bary.y * tri.v2;
+				const glm::vec3 world = glm::vec3(worldMatrix * glm::vec4(local, 1.0f));
+				const float distance = glm::length(world - point);
+				if (distance < result.distance)
+				{
+					result.position = world;
+					result.distance = distance;
+					bestTriangle = triangle;
+					bestBary = bary;
+				}
+			}
+		}
+		else
+		{
+			const uint32_t left = node.leftChild;
+			const uint32_t right = left + 1;
+			const float dLeft = distanceSquared(nodes[left].bbox, localPoint);
+			const float dRight = distanceSquared(nodes[right].bbox, localPoint);
+
+			// Push the far child first so the near one is searched first and tightens the bound
+			if (stackPtr + 2 > k_maxStackSize)
+				continue;
+			if (dLeft < dRight)
+			{
+				stack[stackPtr++] = right;
+				stack[stackPtr++] = left;
+			}
+			else
+			{
+				stack[stackPtr++] = left;
+				stack[stackPtr++] = right;
+			}
+		}
+	}
+
+	if (bestTriangle != UINT32_MAX)
+	{
+		// Same interpolation and transform as the tracer's shading
+		const Triangle& tri = tris[bestTriangle];
+		const glm::vec3 localN = glm::normalize((1.0f - bestBary.x - bestBary.y) * tri.n0 + bestBary.x * tri.n1 + bestBary.y * tri.n2);
+		result.normal = glm::normalize(glm::vec3(glm::vec4(localN, 0.0f) * inst.normalMatrix));
+		result.instance = instanceIndex;
+		result.triangle = inst.triangleOffset + bestTriangle;
+	}
+}
+
+float ClosestPointQuery::findMaxHeight(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& up, float maxHeight) const
+{
+	const glm::vec3 cross = glm::cross(b - a, c - a);
+	const float area2 = glm::dot(cross, cross);
+	if (area2 <= 0.0f)
+		return 0.0f;
+	const glm::vec3 normal = cross / std::sqrt(area2) * (glm::dot(cross, up) < 0.0f ? -1.0f : 1.0f);
+
+	// The prism is the intersection of the half-spaces dot(plane.xyz, p) + plane.w >= 0: the three sides,
+	// the top at maxHeight and the bottom, which is raised to the best height found so far
+	enum { k_bottom, k_top, k_side0, k_planeCount = k_side0 + 3 };
+	glm::vec4 worldPlanes[k_planeCount];
+	worldPlanes[k_bottom] = glm::vec4(normal, -glm::dot(normal, a));
+	worldPlanes[k_top] = glm::vec4(-normal, maxHeight + glm::dot(normal, a));
+	const glm::vec3 corners[3] = { a, b, c };
+	for (int i = 0; i < 3; i++)
+	{
+		// Points into the triangle for either winding, normal was flipped along with it
+		const glm::vec3 inward = glm::cross(cross, corners[(i + 1) % 3] - corners[i]);
+		worldPlanes[k_side0 + i] = glm::vec4(inward, -glm::dot(inward, corners[i]));
+	}
+
+	float result = 0.0f;
+	uint32_t stack[k_maxStackSize];
+	for (const BLASInstance& inst : m_highPoly.blasInstances)
+	{
+		// Planes in the instance's local space, the heights stay world-space distances
+		const glm::mat4 worldMatrix = glm::inverse(inst.normalMatrix);
+		glm::vec4 planes[k_planeCount];
+		for (int i = 0; i < k_planeCount; i++)
+		{
+			planes[i] = worldPlanes[i] * worldMatrix;
+		}
+
+		auto overlaps = [&](const BVH::BBox& box)
+			{
+				const glm::vec3 center = (box.min + box.max) * 0.5f;
+				const glm::vec3 extent = (box.max - box.min) * 0.5f;
+				for (int i = 0; i < k_planeCount; i++)
+				{
+					const glm::vec3 m(planes[i]);
+					const float offset = planes[i].w - (i == k_bottom ? result : 0.0f);
+					if (glm::dot(m, center) + offset + glm::dot(glm::abs(m), extent) < 0.0f)
+						return false;
+				}
+				return true;
+			};
+		auto testVertex = [&](const glm::vec3& v)
+			{
+				for (int i = k_top; i < k_planeCount; i++)
+				{
+					if (glm::dot(glm::vec3(planes[i]), v) + planes[i].w < 0.0f)
+						return;
+				}
+				result = std::max(result, glm::dot(glm::vec3(planes[k_bottom]), v) + planes[k_bottom].w);
+			};
+
+		if (!overlaps(transformBBox(inst.worldBBox, inst.normalMatrix)))
+			continue;
+
+		const BVH::Node* nodes = m_highPoly.bvhNodes.data() + inst.bvhNodeOffset;
+		const uint32_t* triIndices = m_highPoly.triIndices.data() + inst.triIndicesOffset;
+		const Triangle* tris = m_highPoly.triangles.data() + inst.triangleOffset;
+
+		uint32_t stackPtr = 0;
+		stack[stackPtr++] = 0;
+		while (stackPtr > 0)
+		{
+			const BVH::Node& node = nodes[stack[--stackPtr]];
+			if (!overlaps(node.bbox))
+				continue;
+
+			if (node.numTris > 0)
+			{
+				for (uint32_t i = 0; i < node.numTris; i++)
+				{
+					const Triangle& tri = tris[triIndices[node.firstTriIndex + i]];
+					testVertex(tri.v0);
+					testVertex(tri.v1);
+					testVertex(tri.v2);
+				}
+			}
+			else if (stackPtr + 2 <= k_maxStackSize)
+			{
+				stack[stackPtr++] = node.leftChild;
+				stack[stackPtr++] = node.leftChild + 1;
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "highPoly.hpp"
+
+namespace Baking
+{
+	struct ClosestPoint
+	{
+		glm::vec3 position = glm::vec3(0.0f); // world space
+		glm::vec3 normal = glm::vec3(0.0f);   // interpolated vertex normal at position, world space
+		float distance = FLT_MAX;
+		uint32_t instance = UINT32_MAX;
+		uint32_t triangle = UINT32_MAX; // index into the combined triangle array
+
+		bool isValid() const
+		{
+			return instance != UINT32_MAX;
+		}
+	};
+
+	// Point to nearest triangle queries on the combined high-poly TLAS and BLASes. Instances and BVH nodes
+	// farther away than the best candidate so far are skipped, so queries with a tight maxDistance stay cheap.
+	// Queries are const and may run from any number of threads.
+	class ClosestPointQuery
+	{
+	public:
+		explicit ClosestPointQuery(const CombinedHighPolyData& highPoly);
+
+		ClosestPoint find(const glm::vec3& point, float maxDistance) const;
+		// Height of the highest high-poly vertex above the triangle, inside the prism swept along its normal.
+		// up picks the side of the triangle regardless of its winding. Returns 0 if there is none within maxHeight.
+		float findMaxHeight(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& up, float maxHeight) const;
+
+	private:
+		void traverseBLAS(const glm::vec3& point, uint32_t instanceIndex, ClosestPoint& result) const;
+
+		const CombinedHighPolyData& m_highPoly;
+	};
+} // namespace Baking
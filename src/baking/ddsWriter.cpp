@@ -0,0 +1,83 @@
+#include "ddsWriter.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace Baking;
+
+namespace
+{
+	constexpr uint32_t k_ddsMagic = 0x20534444; // "DDS "
+	constexpr uint32_t k_dx10FourCC = 0x30315844; // "DX10"
+
+	constexpr uint32_t k_flagCaps = 0x1;
+	constexpr uint32_t k_flagHeight = 0x2;
+	constexpr uint32_t k_flagWidth = 0x4;
+	constexpr uint32_t k_flagPixelFormat = 0x1000;
+	constexpr uint32_t k_flagMipCount = 0x20000;
+	constexpr uint32_t k_flagLinearSize = 0x80000;
+	constexpr uint32_t k_pixelFormatFourCC = 0x4;
+	constexpr uint32_t k_capsComplex = 0x8;
+	constexpr uint32_t k_capsTexture = 0x1000;
+	constexpr uint32_t k_capsMipmap = 0x400000;
+
+	constexpr uint32_t k_dxgiBC5Unorm = 83;
+	constexpr uint32_t k_dxgiBC7Unorm = 98;
+	constexpr uint32_t k_dimensionTexture2D = 3;
+
+	void append(std::vector<uint32_t>& out, std::initializer_list<uint32_t> values)
+	{
+		out.insert(out.end(), values.begin(), values.end());
+	}
+
+	size_t getLevelBytes(uint32_t width, uint32_t height)
+	{
+		return size_t((width + 3) / 4) * ((height + 3) / 4) * k_blockBytes;
+	}
+}
+
+bool Baking::writeDDS(const std::filesystem::path& path, const uint16_t* pixels, uint32_t width, uint32_t height,
+	const DDSWriteSettings& settings, size_t rowPitch)
+{
+	if (!pixels || width == 0 || height == 0)
+		return false;
+
+	uint32_t mipCount = 1;
+	if (settings.generateMips)
+	{
+		while ((std::max(width, height) >> mipCount) > 0)
+		{
+			mipCount++;
+		}
+	}
+
+	std::vector<uint32_t> header;
+	append(header, { k_ddsMagic, 124, k_flagCaps | k_flagHeight | k_flagWidth | k_flagPixelFormat | k_flagMipCount | k_flagLinearSize,
+		height, width, static_cast<uint32_t>(getLevelBytes(width, height)), 0, mipCount });
+	header.resize(header.size() + 11, 0); // reserved
+	append(header, { 32, k_pixelFormatFourCC, k_dx10FourCC, 0, 0, 0, 0, 0 });
+	append(header, { k_capsTexture | (mipCount > 1 ? k_capsComplex | k_capsMipmap : 0), 0, 0, 0, 0 });
+	append(header, { settings.format == BlockFormat::BC5 ? k_dxgiBC5Unorm : k_dxgiBC7Unorm, k_dimensionTexture2D, 0, 1, 0 });
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	// The header is little-endian like every platform the baker runs on
+	file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size() * sizeof(uint32_t)));
+
+	const std::vector<uint8_t> top = compressBlocks(settings.format, pixels, width, height, rowPitch, settings.maxThreads);
+	file.write(reinterpret_cast<const char*>(top.data()), static_cast<std::streamsize>(top.size()));
+	if (mipCount > 1)
+	{
+		MipSettings mipSettings;
+		mipSettings.filter = settings.mipFilter;
+		mipSettings.maxThreads = settings.maxThreads;
+		for (const MipLevel& level : generateMips(pixels, width, height, rowPitch, mipSettings))
+		{
+			const std::vector<uint8_t> blocks = compressBlocks(settings.format, level.pixels.data(), level.width, level.height, 0, settings.maxThreads);
+			file.write(reinterpret_cast<const char*>(blocks.data()), static_cast<std::streamsize>(blocks.size()));
+		}
+	}
+	return static_cast<bool>(file);
+}
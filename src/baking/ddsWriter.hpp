@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "blockCompression.hpp"
+#include "mipGenerator.hpp"
+
+namespace Baking
+{
+	struct DDSWriteSettings
+	{
+		BlockFormat format = BlockFormat::BC7;
+		bool generateMips = true; // full chain down to 1x1
+		MipFilter mipFilter = MipFilter::Color;
+		uint32_t maxThreads = 0;  // 0 uses every core
+	};
+
+	// Block compresses an RGBA16 image and its mips into a DDS file with a DX10 header (BC5_UNORM or BC7_UNORM)
+	bool writeDDS(const std::filesystem::path& path, const uint16_t* pixels, uint32_t width, uint32_t height,
+		const DDSWriteSettings& settings = {}, size_t rowPitch = 0);
+} // namespace Baking
@@ -0,0 +1,671 @@
+#include "deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr uint32_t k_windowSize = 32768;
+	constexpr uint32_t k_minMatch = 3;
+	constexpr uint32_t k_maxMatch = 258;
+	constexpr uint32_t k_hashBits = 15;
+	constexpr size_t k_maxBlockTokens = 16384; // per dynamic Huffman block, so the codes follow the data
+	constexpr size_t k_maxStoredBlock = 65535;
+	constexpr uint32_t k_adlerBase = 65521;
+
+	constexpr int k_endOfBlock = 256;
+	constexpr int k_literalLengthCodes = 286;
+	constexpr int k_distanceCodes = 30;
+	constexpr int k_codeLengthCodes = 19;
+	constexpr int k_maxCodeBits = 15;
+	constexpr int k_maxCodeLengthBits = 7;
+
+	constexpr uint16_t k_lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t k_lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr uint16_t k_distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr uint8_t k_distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	constexpr uint8_t k_codeLengthOrder[k_codeLengthCodes] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// Match search effort per level, roughly zlib's configuration table
+	struct LevelParams
+	{
+		uint32_t maxChain;   // hash chain entries tried per position
+		uint32_t niceLength; // stop searching once a match is this long
+		bool lazy;           // defer a match by one byte if the next position has a longer one
+	};
+
+	constexpr LevelParams k_levels[10] = {
+		{ 0, 0, false }, { 4, 8, false }, { 8, 16, false }, { 16, 32, false }, { 16, 32, true },
+		{ 32, 64, true }, { 64, 128, true }, { 128, 258, true }, { 512, 258, true }, { 4096, 258, true }
+	};
+
+	struct Tables
+	{
+		uint8_t lengthCode[k_maxMatch + 1] = {};
+		uint8_t distanceCode[512] = {}; // [d - 1] below 257, [256 + ((d - 1) >> 7)] above
+		uint32_t crc[256] = {};
+
+		Tables()
+		{
+			for (uint8_t code = 0; code < 29; code++)
+			{
+				const uint32_t last = code == 28 ? k_maxMatch : std::min<uint32_t>(k_lengthBase[code] + (1u << k_lengthExtra[code]) - 1, k_maxMatch - 1);
+				for (uint32_t length = k_lengthBase[code]; length <= last; length++)
+				{
+					lengthCode[length] = code;
+				}
+			}
+			for (uint8_t code = 0; code < k_distanceCodes; code++)
+			{
+				for (uint32_t distance = k_distanceBase[code]; distance < k_distanceBase[code] + (1u << k_distanceExtra[code]); distance++)
+				{
+					if (distance - 1 < 256)
+						distanceCode[distance - 1] = code;
+					else
+						distanceCode[256 + ((distance - 1) >> 7)] = code;
+				}
+			}
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				crc[i] = c;
+			}
+		}
+
+		uint32_t getDistanceCode(uint32_t distance) const
+		{
+			return distance - 1 < 256 ? distanceCode[distance - 1] : distanceCode[256 + ((distance - 1) >> 7)];
+		}
+	};
+
+	const Tables& getTables()
+	{
+		static const Tables tables;
+		return tables;
+	}
+
+	// Literal (distance = 0) or back reference
+	struct Token
+	{
+		uint16_t literalOrLength;
+		uint16_t distance;
+	};
+
+	// Deflate packs bits starting at the least significant bit of each byte
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& out)
+			: m_out(out)
+		{
+		}
+
+		void write(uint32_t bits, uint32_t count)
+		{
+			m_buffer |= static_cast<uint64_t>(bits) << m_count;
+			m_count += count;
+			if (m_count >= 32)
+			{
+				const uint8_t bytes[4] = { uint8_t(m_buffer), uint8_t(m_buffer >> 8), uint8_t(m_buffer >> 16), uint8_t(m_buffer >> 24) };
+				m_out.insert(m_out.end(), bytes, bytes + 4);
+				m_buffer >>= 32;
+				m_count -= 32;
+			}
+		}
+
+		void alignToByte()
+		{
+			while (m_count > 0)
+			{
+				m_out.push_back(static_cast<uint8_t>(m_buffer));
+				m_buffer >>= 8;
+				m_count = m_count > 8 ? m_count - 8 : 0;
+			}
+		}
+
+		// Only valid after alignToByte
+		void writeBytes(const uint8_t* data, size_t size)
+		{
+			m_out.insert(m_out.end(), data, data + size);
+		}
+
+	private:
+		std::vector<uint8_t>& m_out;
+		uint64_t m_buffer = 0;
+		uint32_t m_count = 0;
+	};
+
+	// Huffman code lengths limited to maxBits, the overflow is pushed down like miniz does
+	void buildCodeLengths(const uint32_t* frequencies, int count, int maxBits, uint8_t* lengths)
+	{
+		std::vector<std::pair<uint32_t, int>> symbols;
+		for (int i = 0; i < count; i++)
+		{
+			lengths[i] = 0;
+			if (frequencies[i] > 0)
+				symbols.emplace_back(frequencies[i], i);
+		}
+		if (symbols.empty())
+			return;
+		if (symbols.size() == 1)
+		{
+			lengths[symbols[0].second] = 1;
+			return;
+		}
+		std::sort(symbols.begin(), symbols.end());
+
+		// Two-queue construction: leaves are sorted and internal nodes are created in increasing weight
+		const size_t leafCount = symbols.size();
+		std::vector<uint64_t> weights(2 * leafCount - 1);
+		std::vector<uint32_t> parents(2 * leafCount - 1);
+		for (size_t i = 0; i < leafCount; i++)
+		{
+			weights[i] = symbols[i].first;
+		}
+		size_t nextLeaf = 0;
+		size_t nextNode = leafCount;
+		for (size_t node = leafCount; node < weights.size(); node++)
+		{
+			size_t children[2];
+			for (size_t& child : children)
+			{
+				if (nextLeaf < leafCount && (nextNode >= node || weights[nextLeaf] <= weights[nextNode]))
+					child = nextLeaf++;
+				else
+					child = nextNode++;
+			}
+			weights[node] = weights[children[0]] + weights[children[1]];
+			parents[children[0]] = static_cast<uint32_t>(node);
+			parents[children[1]] = static_cast<uint32_t>(node);
+		}
+
+		std::vector<uint32_t> depths(weights.size(), 0);
+		std::array<uint32_t, 64> lengthCounts = {};
+		for (size_t node = weights.size() - 1; node-- > 0;)
+		{
+			depths[node] = depths[parents[node]] + 1;
+			if (node < leafCount)
+				lengthCounts[std::min<uint32_t>(depths[node], maxBits)]++;
+		}
+
+		uint32_t kraft = 0;
+		for (int bits = 1; bits <= maxBits; bits++)
+		{
+			kraft += lengthCounts[bits] << (maxBits - bits);
+		}
+		while (kraft != (1u << maxBits))
+		{
+			lengthCounts[maxBits]--;
+			for (int bits = maxBits - 1; bits > 0; bits--)
+			{
+				if (lengthCounts[bits] > 0)
+				{
+					lengthCounts[bits]--;
+					lengthCounts[bits + 1] += 2;
+					break;
+				}
+			}
+			kraft--;
+		}
+
+		// Least frequent symbols get the longest codes
+		size_t symbol = 0;
+		for (int bits = maxBits; bits > 0; bits--)
+		{
+			for (uint32_t i = 0; i < lengthCounts[bits]; i++)
+			{
+				lengths[symbols[symbol++].second] = static_cast<uint8_t>(bits);
+			}
+		}
+	}
+
+	// Canonical codes, bit-reversed for the LSB-first writer
+	void buildCodes(const uint8_t* lengths, int count, uint16_t* codes)
+	{
+		uint32_t lengthCounts[k_maxCodeBits + 1] = {};
+		for (int i = 0; i < count; i++)
+		{
+			lengthCounts[lengths[i]]++;
+		}
+		lengthCounts[0] = 0;
+		uint32_t nextCode[k_maxCodeBits + 2] = {};
+		for (int bits = 1; bits <= k_maxCodeBits; bits++)
+		{
+			nextCode[bits + 1] = (nextCode[bits] + lengthCounts[bits]) << 1;
+		}
+		for (int i = 0; i < count; i++)
+		{
+			const uint32_t length = lengths[i];
+			if (length == 0)
+				continue;
+			uint32_t code = nextCode[length]++;
+			uint32_t reversed = 0;
+			for (uint32_t bit = 0; bit < length; bit++)
+			{
+				reversed = (reversed << 1) | (code & 1);
+				code >>= 1;
+			}
+			codes[i] = static_cast<uint16_t>(reversed);
+		}
+	}
+
+	void writeStoredBlocks(BitWriter& writer, const uint8_t* data, size_t size, bool isFinal)
+	{
+		size_t offset = 0;
+		do
+		{
+			const size_t blockSize = std::min(size - offset, k_maxStoredBlock);
+			const bool isLast = offset + blockSize == size;
+			writer.write(isFinal && isLast ? 1 : 0, 3); // BTYPE 00
+			writer.alignToByte();
+			writer.write(static_cast<uint32_t>(blockSize), 16);
+			writer.write(static_cast<uint32_t>(~blockSize & 0xFFFF), 16);
+			writer.alignToByte();
+			writer.writeBytes(data + offset, blockSize);
+			offset += blockSize;
+		} while (offset < size);
+	}
+
+	// Tokens covering data[0, size) as one dynamic Huffman block, or as stored blocks if those come out smaller
+	void writeBlock(BitWriter& writer, const std::vector<Token>& tokens, const uint8_t* data, size_t size, bool isFinal)
+	{
+		const Tables& tables = getTables();
+		uint32_t literalFrequencies[k_literalLengthCodes] = {};
+		uint32_t distanceFrequencies[k_distanceCodes] = {};
+		for (const Token& token : tokens)
+		{
+			if (token.distance == 0)
+			{
+				literalFrequencies[token.literalOrLength]++;
+			}
+			else
+			{
+				literalFrequencies[257 + tables.lengthCode[token.literalOrLength]]++;
+				distanceFrequencies[tables.getDistanceCode(token.distance)]++;
+			}
+		}
+		literalFrequencies[k_endOfBlock] = 1;
+
+		uint8_t literalLengths[k_literalLengthCodes];
+		uint8_t distanceLengths[k_distanceCodes];
+		buildCodeLengths(literalFrequencies, k_literalLengthCodes, k_maxCodeBits, literalLengths);
+		buildCodeLengths(distanceFrequencies, k_distanceCodes, k_maxCodeBits, distanceLengths);
+		if (std::all_of(distanceLengths, distanceLengths + k_distanceCodes, [](uint8_t length) { return length == 0; }))
+		{
+			distanceLengths[0] = 1; // a block without matches still describes one distance code
+		}
+
+		int literalCount = k_literalLengthCodes;
+		while (literalCount > 257 && literalLengths[literalCount - 1] == 0)
+		{
+			literalCount--;
+		}
+		int distanceCount = k_distanceCodes;
+		while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0)
+		{
+			distanceCount--;
+		}
+
+		// Run-length coded lengths of both codes: 16 repeats the previous length, 17 and 18 repeat zeros
+		uint8_t allLengths[k_literalLengthCodes + k_distanceCodes];
+		std::copy(literalLengths, literalLengths + literalCount, allLengths);
+		std::copy(distanceLengths, distanceLengths + distanceCount, allLengths + literalCount);
+		const int lengthCount = literalCount + distanceCount;
+		std::vector<std::pair<uint8_t, uint8_t>> runs; // symbol, extra bits value
+		uint32_t codeLengthFrequencies[k_codeLengthCodes] = {};
+		for (int i = 0; i < lengthCount;)
+		{
+			const uint8_t length = allLengths[i];
+			int run = 1;
+			while (i + run < lengthCount && allLengths[i + run] == length)
+			{
+				run++;
+			}
+			i += run;
+			if (length == 0)
+			{
+				while (run >= 11)
+				{
+					const int repeat = std::min(run, 138);
+					runs.emplace_back(18, static_cast<uint8_t>(repeat - 11));
+					run -= repeat;
+				}
+				if (run >= 3)
+				{
+					runs.emplace_back(17, static_cast<uint8_t>(run - 3));
+					run = 0;
+				}
+			}
+			else
+			{
+				runs.emplace_back(length, 0);
+				run--;
+				while (run >= 3)
+				{
+					const int repeat = std::min(run, 6);
+					runs.emplace_back(16, static_cast<uint8_t>(repeat - 3));
+					run -= repeat;
+				}
+			}
+			for (; run > 0; run--)
+			{
+				runs.emplace_back(length, 0);
+			}
+		}
+		for (const auto& [symbol, extra] : runs)
+		{
+			codeLengthFrequencies[symbol]++;
+		}
+		// zlib rejects an incomplete code length code, so it needs at least two symbols
+		if (std::count_if(codeLengthFrequencies, codeLengthFrequencies + k_codeLengthCodes, [](uint32_t f) { return f > 0; }) < 2)
+		{
+			codeLengthFrequencies[codeLengthFrequencies[0] > 0 ? 1 : 0]++;
+		}
+
+		uint8_t codeLengthLengths[k_codeLengthCodes];
+		buildCodeLengths(codeLengthFrequencies, k_codeLengthCodes, k_maxCodeLengthBits, codeLengthLengths);
+		int codeLengthCount = k_codeLengthCodes;
+		while (codeLengthCount > 4 && codeLengthLengths[k_codeLengthOrder[codeLengthCount - 1]] == 0)
+		{
+			codeLengthCount--;
+		}
+
+		constexpr uint8_t k_runExtraBits[3] = { 2, 3, 7 };
+		size_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLengthCount;
+		for (const auto& [symbol, extra] : runs)
+		{
+			dynamicBits += codeLengthLengths[symbol] + (symbol >= 16 ? k_runExtraBits[symbol - 16] : 0);
+		}
+		for (int i = 0; i < k_literalLengthCodes; i++)
+		{
+			dynamicBits += static_cast<size_t>(literalFrequencies[i]) * (literalLengths[i] + (i > 256 ? k_lengthExtra[i - 257] : 0));
+		}
+		for (int i = 0; i < k_distanceCodes; i++)
+		{
+			dynamicBits += static_cast<size_t>(distanceFrequencies[i]) * (distanceLengths[i] + k_distanceExtra[i]);
+		}
+		const size_t storedBits = (size / k_maxStoredBlock + 1) * (3 + 7 + 32) + size * 8;
+		if (storedBits <= dynamicBits)
+		{
+			writeStoredBlocks(writer, data, size, isFinal);
+			return;
+		}
+
+		uint16_t literalCodes[k_literalLengthCodes];
+		uint16_t distanceCodes[k_distanceCodes];
+		uint16_t codeLengthCodes[k_codeLengthCodes];
+		buildCodes(literalLengths, k_literalLengthCodes, literalCodes);
+		buildCodes(distanceLengths, k_distanceCodes, distanceCodes);
+		buildCodes(codeLengthLengths, k_codeLengthCodes, codeLengthCodes);
+
+		writer.write(isFinal ? 1 : 0, 1);
+		writer.write(2, 2); // BTYPE 10, dynamic Huffman codes
+		writer.write(literalCount - 257, 5);
+		writer.write(distanceCount - 1, 5);
+		writer.write(codeLengthCount - 4, 4);
+		for (int i = 0; i < codeLengthCount; i++)
+		{
+			writer.write(codeLengthLengths[k_codeLengthOrder[i]], 3);
+		}
+		for (const auto& [symbol, extra] : runs)
+		{
+			writer.write(codeLengthCodes[symbol], codeLengthLengths[symbol]);
+			if (symbol >= 16)
+				writer.write(extra, k_runExtraBits[symbol - 16]);
+		}
+
+		for (const Token& token : tokens)
+		{
+			if (token.distance == 0)
+			{
+				writer.write(literalCodes[token.literalOrLength], literalLengths[token.literalOrLength]);
+				continue;
+			}
+			const uint32_t lengthCode = tables.lengthCode[token.literalOrLength];
+			writer.write(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+			writer.write(token.literalOrLength - k_lengthBase[lengthCode], k_lengthExtra[lengthCode]);
+			const uint32_t distanceCode = tables.getDistanceCode(token.distance);
+			writer.write(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+			writer.write(token.distance - k_distanceBase[distanceCode], k_distanceExtra[distanceCode]);
+		}
+		writer.write(literalCodes[k_endOfBlock], literalLengths[k_endOfBlock]);
+	}
+
+	// Raw deflate of data[begin, end) with matches reaching back into the 32 KB before begin. Non-final chunks end
+	// with an empty stored block (a zlib sync flush), which leaves the next chunk starting on a byte boundary.
+	void deflateChunk(const uint8_t* data, size_t begin, size_t end, int level, bool isFinal, std::vector<uint8_t>& out)
+	{
+		BitWriter writer(out);
+		if (level <= 0)
+		{
+			writeStoredBlocks(writer, data + begin, end - begin, isFinal);
+		}
+		else
+		{
+			const LevelParams& params = k_levels[std::min(level, 9)];
+			const size_t windowStart = begin > k_windowSize ? begin - k_windowSize : 0;
+			const uint8_t* window = data + windowStart; // positions below are relative to windowStart
+			const uint32_t limit = static_cast<uint32_t>(end - windowStart);
+
+			std::vector<int32_t> head(size_t(1) << k_hashBits, -1);
+			std::vector<int32_t> previous(k_windowSize, -1);
+			auto hash = [&](uint32_t p)
+				{
+					const uint32_t bytes = (uint32_t(window[p]) << 16) | (uint32_t(window[p + 1]) << 8) | window[p + 2];
+					return (bytes * 2654435761u) >> (32 - k_hashBits);
+				};
+			auto insert = [&](uint32_t p)
+				{
+					if (p + k_minMatch > limit)
+						return;
+					const uint32_t h = hash(p);
+					previous[p & (k_windowSize - 1)] = head[h];
+					head[h] = static_cast<int32_t>(p);
+				};
+			auto findMatch = [&](uint32_t p, uint32_t& outDistance) -> uint32_t
+				{
+					const uint32_t maxLength = std::min(k_maxMatch, limit - p);
+					if (maxLength < k_minMatch)
+						return 0;
+					uint32_t bestLength = k_minMatch - 1;
+					int32_t candidate = head[hash(p)];
+					for (uint32_t chain = params.maxChain; candidate >= 0 && chain > 0; chain--)
+					{
+						const uint32_t distance = p - static_cast<uint32_t>(candidate);
+						if (distance > k_windowSize)
+							break;
+						const uint8_t* a = window + candidate;
+						const uint8_t* b = window + p;
+						if (a[bestLength] == b[bestLength] && a[0] == b[0])
+						{
+							uint32_t length = 0;
+							while (length < maxLength && a[length] == b[length])
+							{
+								length++;
+							}
+							if (length > bestLength)
+							{
+								bestLength = length;
+								outDistance = distance;
+								if (length >= params.niceLength || length == maxLength)
+									break;
+							}
+						}
+						const int32_t next = previous[candidate & (k_windowSize - 1)];
+						if (next >= candidate)
+							break;
+						candidate = next;
+					}
+					return bestLength >= k_minMatch ? bestLength : 0;
+				};
+
+			// Prime the dictionary with the window, the inflater has already produced those bytes
+			for (uint32_t p = 0; p < begin - windowStart; p++)
+			{
+				insert(p);
+			}
+
+			std::vector<Token> tokens;
+			tokens.reserve(k_maxBlockTokens);
+			uint32_t blockStart = static_cast<uint32_t>(begin - windowStart);
+			uint32_t p = blockStart;
+			uint32_t matchLength = 0;
+			uint32_t matchDistance = 0;
+			bool isCarried = false; // matchLength was found at p by the lazy check of the previous position
+			while (p < limit)
+			{
+				if (tokens.size() >= k_maxBlockTokens)
+				{
+					writeBlock(writer, tokens, window + blockStart, p - blockStart, false);
+					tokens.clear();
+					blockStart = p;
+				}
+
+				if (!isCarried)
+					matchLength = findMatch(p, matchDistance);
+				isCarried = false;
+				if (matchLength == 0)
+				{
+					insert(p);
+					tokens.push_back({ window[p], 0 });
+					p++;
+					continue;
+				}
+
+				uint32_t firstInsert = p;
+				if (params.lazy && matchLength < params.niceLength && p + 1 < limit)
+				{
+					insert(p);
+					firstInsert = p + 1;
+					uint32_t nextDistance = 0;
+					const uint32_t nextLength = findMatch(p + 1, nextDistance);
+					if (nextLength > matchLength)
+					{
+						tokens.push_back({ window[p], 0 });
+						p++;
+						matchLength = nextLength;
+						matchDistance = nextDistance;
+						isCarried = true;
+						continue;
+					}
+				}
+				tokens.push_back({ static_cast<uint16_t>(matchLength), static_cast<uint16_t>(matchDistance) });
+				for (uint32_t q = firstInsert; q < p + matchLength; q++)
+				{
+					insert(q);
+				}
+				p += matchLength;
+			}
+			if (!tokens.empty() || isFinal)
+				writeBlock(writer, tokens, window + blockStart, limit - blockStart, isFinal);
+		}
+
+		if (!isFinal)
+		{
+			writer.write(0, 3);
+			writer.alignToByte();
+			writer.write(0xFFFF0000u, 32);
+		}
+		writer.alignToByte();
+	}
+
+	uint32_t combineAdler32(uint32_t adler1, uint32_t adler2, size_t length2)
+	{
+		const uint32_t remainder = static_cast<uint32_t>(length2 % k_adlerBase);
+		uint32_t sum1 = adler1 & 0xFFFF;
+		uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(remainder) * sum1) % k_adlerBase);
+		sum1 += (adler2 & 0xFFFF) + k_adlerBase - 1;
+		sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + k_adlerBase - remainder;
+		if (sum1 >= k_adlerBase) sum1 -= k_adlerBase;
+		if (sum1 >= k_adlerBase) sum1 -= k_adlerBase;
+		if (sum2 >= (k_adlerBase << 1)) sum2 -= (k_adlerBase << 1);
+		if (sum2 >= k_adlerBase) sum2 -= k_adlerBase;
+		return sum1 | (sum2 << 16);
+	}
+}
+
+uint32_t Baking::crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+	const Tables& tables = getTables();
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = tables.crc[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+uint32_t Baking::adler32(const uint8_t* data, size_t size, uint32_t adler)
+{
+	// 5552 bytes is the most that can be summed before the 32-bit sums overflow
+	uint32_t sum1 = adler & 0xFFFF;
+	uint32_t sum2 = adler >> 16;
+	while (size > 0)
+	{
+		const size_t run = std::min<size_t>(size, 5552);
+		for (size_t i = 0; i < run; i++)
+		{
+			sum1 += data[i];
+			sum2 += sum1;
+		}
+		sum1 %= k_adlerBase;
+		sum2 %= k_adlerBase;
+		data += run;
+		size -= run;
+	}
+	return sum1 | (sum2 << 16);
+}
+
+std::vector<uint8_t> Baking::zlibCompress(const uint8_t* data, size_t size, int level, uint32_t maxThreads)
+{
+	level = std::clamp(level, 0, 9);
+	const size_t chunkCount = std::max<size_t>(1, (size + k_deflateChunkSize - 1) / k_deflateChunkSize);
+	std::vector<std::vector<uint8_t>> chunks(chunkCount);
+	std::vector<uint32_t> adlers(chunkCount);
+	Parallel::parallelFor(chunkCount, [&](size_t i)
+		{
+			const size_t begin = i * k_deflateChunkSize;
+			const size_t end = std::min(begin + k_deflateChunkSize, size);
+			chunks[i].reserve((end - begin) / 2);
+			deflateChunk(data, begin, end, level, i + 1 == chunkCount, chunks[i]);
+			adlers[i] = adler32(data + begin, end - begin);
+		}, maxThreads);
+
+	// CMF: deflate with a 32 KB window, FLG: the level hint and the check bits
+	const uint8_t cmf = 0x78;
+	uint8_t flg = static_cast<uint8_t>((level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6);
+	flg |= static_cast<uint8_t>(31 - (cmf * 256 + flg) % 31);
+
+	size_t compressedSize = 2 + 4;
+	for (const std::vector<uint8_t>& chunk : chunks)
+	{
+		compressedSize += chunk.size();
+	}
+	std::vector<uint8_t> out;
+	out.reserve(compressedSize);
+	out.push_back(cmf);
+	out.push_back(flg);
+	uint32_t adler = 1;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		out.insert(out.end(), chunks[i].begin(), chunks[i].end());
+		const size_t begin = i * k_deflateChunkSize;
+		adler = combineAdler32(adler, adlers[i], std::min(begin + k_deflateChunkSize, size) - begin);
+		std::vector<uint8_t>().swap(chunks[i]);
+	}
+	for (int shift = 24; shift >= 0; shift -= 8)
+	{
+		out.push_back(static_cast<uint8_t>(adler >> shift));
+	}
+	return out;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Baking
+{
+	// Compression levels as in zlib: 0 only stores, 1 is fastest, 9 searches longest for matches
+	constexpr int k_defaultCompressionLevel = 6;
+	// Uncompressed bytes per independently deflated chunk, the granularity pigz uses
+	constexpr size_t k_deflateChunkSize = 128 * 1024;
+
+	uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+	uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+
+	// zlib stream (RFC 1950) of data. Chunks of k_deflateChunkSize bytes are deflated on up to maxThreads threads,
+	// each primed with the 32 KB window before it, and joined like pigz does: every chunk but the last ends with an
+	// empty stored block that byte-aligns it, so the concatenation is one valid stream for any inflater.
+	// maxThreads = 0 uses every core, 1 compresses on the calling thread.
+	std::vector<uint8_t> zlibCompress(const uint8_t* data, size_t size, int level = k_defaultCompressionLevel, uint32_t maxThreads = 0);
+} // namespace Baking
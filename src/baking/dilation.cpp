@@ -0,0 +1,238 @@
+#include "dilation.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "utility/parallelFor.hpp"
+
+// Exact nearest-covered-texel transform in two separable passes (Felzenszwalb & Huttenlocher).
+// Unlike jump flooding this is O(N) regardless of the padding distance and never picks a wrong seed,
+// and both passes are embarrassingly parallel - over column strips first, then over rows.
+
+namespace
+{
+	constexpr int32_t k_noSeed = -1;
+	constexpr size_t k_columnStripWidth = 256;
+	constexpr size_t k_rowsPerChunk = 16;
+
+	template <size_t N>
+	void copyPixel(uint8_t* dst, const uint8_t* src, size_t)
+	{
+		std::memcpy(dst, src, N);
+	}
+
+	template <>
+	void copyPixel<0>(uint8_t* dst, const uint8_t* src, size_t bytesPerPixel)
+	{
+		std::memcpy(dst, src, bytesPerPixel);
+	}
+
+	// Pass 1: for every texel, the row of the nearest covered texel in the same column.
+	// Sweeps whole row segments so the inner loops vectorize.
+	void findColumnSeeds(const uint8_t* coverage, uint32_t width, uint32_t height, std::vector<int32_t>& outSeedRows)
+	{
+		Parallel::parallelForChunks(width, k_columnStripWidth, [&](size_t begin, size_t end)
+			{
+				int32_t* seedRows = outSeedRows.data();
+				for (size_t x = begin; x < end; x++)
+				{
+					seedRows[x] = coverage[x] ? 0 : k_noSeed;
+				}
+				for (uint32_t y = 1; y < height; y++)
+				{
+					const uint8_t* coverageRow = coverage + size_t(y) * width;
+					const int32_t* prevRow = seedRows + size_t(y - 1) * width;
+					int32_t* row = seedRows + size_t(y) * width;
+					for (size_t x = begin; x < end; x++)
+					{
+						row[x] = coverageRow[x] ? int32_t(y) : prevRow[x];
+					}
+				}
+				for (int32_t y = int32_t(height) - 2; y >= 0; y--)
+				{
+					const int32_t* nextRow = seedRows + size_t(y + 1) * width;
+					int32_t* row = seedRows + size_t(y) * width;
+					for (size_t x = begin; x < end; x++)
+					{
+						const int32_t above = row[x];
+						const int32_t below = nextRow[x];
+						const bool takeBelow = below != k_noSeed && (above == k_noSeed || below - y < y - above);
+						row[x] = takeBelow ? below : above;
+					}
+				}
+			});
+	}
+
+	struct RowScratch
+	{
+		std::vector<int64_t> cost;
+		std::vector<uint32_t> envelope;
+		// Envelope boundaries as exact fractions num / den (den > 0), which avoids a division per column
+		std::vector<int64_t> boundaryNum;
+		std::vector<int64_t> boundaryDen;
+	};
+
+	// Pass 2: lower envelope of the parabolas (x - q)^2 + dy(q)^2 of one row, then copy from the nearest seed
+	template <size_t N>
+	size_t dilateRow(uint8_t* pixels,
+		uint32_t width,
+		size_t rowPitch,
+		size_t bytesPerPixel,
+		const uint8_t* coverage,
+		const int32_t* seedRows,
+		uint32_t y,
+		int64_t maxDistanceSq,
+		RowScratch& scratch)
+	{
+		const int32_t* rowSeeds = seedRows + size_t(y) * width;
+		const uint8_t* rowCoverage = coverage + size_t(y) * width;
+
+		if (!std::memchr(rowCoverage, 0, width))
+			return 0; // fully covered row
+
+		int64_t* cost = scratch.cost.data();
+		uint32_t* envelope = scratch.envelope.data();
+		int64_t* boundaryNum = scratch.boundaryNum.data();
+		int64_t* boundaryDen = scratch.boundaryDen.data();
+
+		int32_t k = -1;
+		for (uint32_t q = 0; q < width; q++)
+		{
+			if (rowSeeds[q] == k_noSeed)
+				continue;
+
+			const int64_t dy = int64_t(y) - rowSeeds[q];
+			cost[q] = dy * dy;
+			if (cost[q] > maxDistanceSq)
+				continue; // too far away vertically to ever be within the padding distance
+
+			// Intersection with the parabola on top of the envelope, k == 0 has an implicit -inf boundary
+			int64_t num = 0;
+			int64_t den = 1;
+			while (k >= 0)
+			{
+				const uint32_t p = envelope[k];
+				num = (cost[q] + int64_t(q) * q) - (cost[p] + int64_t(p) * p);
+				den = 2 * (int64_t(q) - int64_t(p));
+				if (k == 0 || num * boundaryDen[k] > boundaryNum[k] * den)
+					break;
+				k--;
+			}
+			k++;
+			envelope[k] = q;
+			boundaryNum[k] = num;
+			boundaryDen[k] = den;
+		}
+
+		if (k < 0)
+			return 0; // no covered texel within reach
+
+		const int32_t last = k;
+		size_t filled = 0;
+		uint8_t* row = pixels + size_t(y) * rowPitch;
+		k = 0;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			while (k < last && boundaryNum[k + 1] < int64_t(x) * boundaryDen[k + 1])
+			{
+				k++;
+			}
+			if (rowCoverage[x])
+				continue;
+
+			const uint32_t q = envelope[k];
+			const int64_t dx = int64_t(x) - q;
+			if (dx * dx + cost[q] > maxDistanceSq)
+				continue;
+
+			const uint8_t* src = pixels + size_t(rowSeeds[q]) * rowPitch + size_t(q) * bytesPerPixel;
+			copyPixel<N>(row + size_t(x) * bytesPerPixel, src, bytesPerPixel);
+			filled++;
+		}
+		return filled;
+	}
+
+	template <size_t N>
+	size_t dilateRows(uint8_t* pixels,
+		uint32_t width,
+		uint32_t height,
+		size_t rowPitch,
+		size_t bytesPerPixel,
+		const uint8_t* coverage,
+		const std::vector<int32_t>& seedRows,
+		int64_t maxDistanceSq,
+		const Baking::RowsPaddedCallback& onRowsPadded)
+	{
+		std::atomic<size_t> filled = 0;
+		// Rows only write uncovered texels and only read covered ones, so they can run in place
+		Parallel::parallelForChunks(height, k_rowsPerChunk, [&](size_t begin, size_t end)
+			{
+				RowScratch scratch;
+				scratch.cost.resize(width);
+				scratch.envelope.resize(width);
+				scratch.boundaryNum.resize(width);
+				scratch.boundaryDen.resize(width);
+
+				size_t chunkFilled = 0;
+				for (size_t y = begin; y < end; y++)
+				{
+					chunkFilled += dilateRow<N>(pixels, width, rowPitch, bytesPerPixel, coverage, seedRows.data(),
+						uint32_t(y), maxDistanceSq, scratch);
+				}
+				filled += chunkFilled;
+				if (onRowsPadded)
+				{
+					onRowsPadded(uint32_t(begin), uint32_t(end - begin));
+				}
+			});
+		return filled;
+	}
+} // namespace
+
+namespace Baking
+{
+	size_t dilate(uint8_t* pixels,
+		uint32_t width,
+		uint32_t height,
+		size_t rowPitch,
+		size_t bytesPerPixel,
+		const uint8_t* coverage,
+		uint32_t maxDistance,
+		const RowsPaddedCallback& onRowsPadded)
+	{
+		if (!pixels || !coverage || width == 0 || height == 0)
+			return 0;
+		if (maxDistance == 0)
+		{
+			if (onRowsPadded)
+			{
+				Parallel::parallelForChunks(height, k_rowsPerChunk, [&](size_t begin, size_t end)
+					{
+						onRowsPadded(uint32_t(begin), uint32_t(end - begin));
+					});
+			}
+			return 0;
+		}
+
+		std::vector<int32_t> seedRows(size_t(width) * height);
+		findColumnSeeds(coverage, width, height, seedRows);
+
+		const int64_t maxDistanceSq = maxDistance == k_infiniteDilation
+			? std::numeric_limits<int64_t>::max()
+			: int64_t(maxDistance) * maxDistance;
+
+		switch (bytesPerPixel)
+		{
+		case 4:
+			return dilateRows<4>(pixels, width, height, rowPitch, bytesPerPixel, coverage, seedRows, maxDistanceSq, onRowsPadded);
+		case 8:
+			return dilateRows<8>(pixels, width, height, rowPitch, bytesPerPixel, coverage, seedRows, maxDistanceSq, onRowsPadded);
+		case 16:
+			return dilateRows<16>(pixels, width, height, rowPitch, bytesPerPixel, coverage, seedRows, maxDistanceSq, onRowsPadded);
+		default:
+			return dilateRows<0>(pixels, width, height, rowPitch, bytesPerPixel, coverage, seedRows, maxDistanceSq, onRowsPadded);
+		}
+	}
+} // namespace Baking
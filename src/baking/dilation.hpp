@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace Baking
+{
+	// Pass as maxDistance to pad every uncovered texel of the image
+	constexpr uint32_t k_infiniteDilation = UINT32_MAX;
+
+	// Called from the padding threads with rows that are final, in no particular order
+	using RowsPaddedCallback = std::function<void(uint32_t firstRow, uint32_t rowCount)>;
+
+	// Edge padding for baked maps. Every uncovered texel within maxDistance texels (euclidean) of a
+	// covered one receives a copy of the nearest covered texel, so bilinear filtering and mip-mapping
+	// don't bleed the background across UV seams. Covered texels are never modified.
+	// coverage holds one byte per texel (non-zero = covered), tightly packed with width stride.
+	// Returns the number of texels that were filled. onRowsPadded lets a writer consume rows while others are
+	// still padded; every row is reported exactly once, also when nothing needs padding.
+	size_t dilate(uint8_t* pixels,
+		uint32_t width,
+		uint32_t height,
+		size_t rowPitch,
+		size_t bytesPerPixel,
+		const uint8_t* coverage,
+		uint32_t maxDistance,
+		const RowsPaddedCallback& onRowsPadded = nullptr);
+} // namespace Baking
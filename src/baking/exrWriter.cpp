@@ -0,0 +1,816 @@
+#include "exrWriter.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "glm/gtc/packing.hpp"
+
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr uint8_t k_magic[4] = { 0x76, 0x2F, 0x31, 0x01 };
+	constexpr uint32_t k_version = 2;
+	constexpr uint32_t k_tiledFlag = 0x200;
+	constexpr uint8_t k_increasingY = 0;
+	constexpr uint8_t k_randomY = 2;
+
+	constexpr int k_ushortRange = 1 << 16;
+	constexpr int k_bitmapSize = k_ushortRange >> 3;
+
+	// Huffman coder of PIZ, see OpenEXR's ImfHuf.cpp
+	constexpr int k_hufEncodingSize = k_ushortRange + 1; // every 16-bit value and the run-length symbol
+	constexpr int k_hufMaxCodeLength = 58;
+	constexpr int k_shortZeroRun = 59;
+	constexpr int k_longZeroRun = 63;
+	constexpr int k_shortestLongRun = 2 + k_longZeroRun - k_shortZeroRun;
+	constexpr int k_longestLongRun = 255 + k_shortestLongRun;
+
+	void appendLE(std::vector<uint8_t>& out, uint32_t value, int bytes = 4)
+	{
+		for (int i = 0; i < bytes; i++)
+		{
+			out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	void appendFloat(std::vector<uint8_t>& out, float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		appendLE(out, bits);
+	}
+
+	void appendString(std::vector<uint8_t>& out, const std::string& value)
+	{
+		out.insert(out.end(), value.begin(), value.end());
+		out.push_back(0);
+	}
+
+	void appendAttribute(std::vector<uint8_t>& out, const char* name, const char* type, const std::vector<uint8_t>& value)
+	{
+		appendString(out, name);
+		appendString(out, type);
+		appendLE(out, static_cast<uint32_t>(value.size()));
+		out.insert(out.end(), value.begin(), value.end());
+	}
+
+	std::vector<uint8_t> getBox(uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> box;
+		appendLE(box, 0);
+		appendLE(box, 0);
+		appendLE(box, width - 1);
+		appendLE(box, height - 1);
+		return box;
+	}
+
+	// ZIP: bytes split into even and odd halves, then delta coded, which groups the high bytes of similar samples
+	std::vector<uint8_t> zipCompress(const std::vector<uint8_t>& data, int level)
+	{
+		std::vector<uint8_t> predicted(data.size());
+		const size_t half = (data.size() + 1) / 2;
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			predicted[(i & 1) ? half + i / 2 : i / 2] = data[i];
+		}
+		int previous = predicted.empty() ? 0 : predicted[0];
+		for (size_t i = 1; i < predicted.size(); i++)
+		{
+			const int current = predicted[i];
+			predicted[i] = static_cast<uint8_t>(current - previous + 128 + 256);
+			previous = current;
+		}
+		return zlibCompress(predicted.data(), predicted.size(), level, 1);
+	}
+
+	// Haar-like 2D wavelet of OpenEXR's ImfWav.cpp, values below 2^14 use the cheaper lossless 14-bit variant
+	void wavelet14(uint16_t a, uint16_t b, uint16_t& low, uint16_t& high)
+	{
+		const int16_t as = static_cast<int16_t>(a);
+		const int16_t bs = static_cast<int16_t>(b);
+		low = static_cast<uint16_t>(static_cast<int16_t>((as + bs) >> 1));
+		high = static_cast<uint16_t>(static_cast<int16_t>(as - bs));
+	}
+
+	void wavelet16(uint16_t a, uint16_t b, uint16_t& low, uint16_t& high)
+	{
+		const int ao = (a + 0x8000) & 0xFFFF;
+		int m = (ao + b) >> 1;
+		int d = ao - b;
+		if (d < 0)
+		{
+			m = (m + 0x8000) & 0xFFFF;
+		}
+		low = static_cast<uint16_t>(m);
+		high = static_cast<uint16_t>(d & 0xFFFF);
+	}
+
+	void waveletEncode(uint16_t* in, int nx, int ox, int ny, int oy, uint16_t maxValue)
+	{
+		const auto encode = maxValue < (1 << 14) ? wavelet14 : wavelet16;
+		const int n = std::min(nx, ny);
+		int p = 1;
+		int p2 = 2;
+		while (p2 <= n)
+		{
+			uint16_t* py = in;
+			uint16_t* ey = in + oy * (ny - p2);
+			const int oy1 = oy * p;
+			const int oy2 = oy * p2;
+			const int ox1 = ox * p;
+			const int ox2 = ox * p2;
+			uint16_t i00, i01, i10, i11;
+
+			for (; py <= ey; py += oy2)
+			{
+				uint16_t* px = py;
+				uint16_t* ex = py + ox * (nx - p2);
+				for (; px <= ex; px += ox2)
+				{
+					uint16_t* p01 = px + ox1;
+					uint16_t* p10 = px + oy1;
+					uint16_t* p11 = p10 + ox1;
+					encode(*px, *p01, i00, i01);
+					encode(*p10, *p11, i10, i11);
+					encode(i00, i10, *px, *p10);
+					encode(i01, i11, *p01, *p11);
+				}
+				// Odd column
+				if (nx & p)
+				{
+					uint16_t* p10 = px + oy1;
+					encode(*px, *p10, i00, *p10);
+					*px = i00;
+				}
+			}
+			// Odd line
+			if (ny & p)
+			{
+				uint16_t* px = py;
+				uint16_t* ex = py + ox * (nx - p2);
+				for (; px <= ex; px += ox2)
+				{
+					uint16_t* p01 = px + ox1;
+					encode(*px, *p01, i00, *p01);
+					*px = i00;
+				}
+			}
+			p = p2;
+			p2 <<= 1;
+		}
+	}
+
+	// MSB first bit writer of the Huffman coder
+	struct HufBitWriter
+	{
+		std::vector<uint8_t>& out;
+		uint64_t bits = 0;
+		int bitCount = 0;
+
+		void write(int count, uint64_t value)
+		{
+			bits = (bits << count) | value;
+			bitCount += count;
+			while (bitCount >= 8)
+			{
+				bitCount -= 8;
+				out.push_back(static_cast<uint8_t>(bits >> bitCount));
+			}
+		}
+
+		void flush()
+		{
+			if (bitCount > 0)
+			{
+				out.push_back(static_cast<uint8_t>(bits << (8 - bitCount)));
+			}
+		}
+	};
+
+	// Codes are stored as (code << 6) | length
+	int getCodeLength(uint64_t code)
+	{
+		return static_cast<int>(code & 63);
+	}
+
+	void writeCode(HufBitWriter& writer, uint64_t code)
+	{
+		writer.write(getCodeLength(code), code >> 6);
+	}
+
+	// Canonical codes from lengths, shorter codes are numerically higher. Decoders rebuild them the same way.
+	void buildCanonicalCodes(std::vector<uint64_t>& codes)
+	{
+		uint64_t counts[k_hufMaxCodeLength + 1] = {};
+		for (const uint64_t length : codes)
+		{
+			counts[length]++;
+		}
+		uint64_t code = 0;
+		for (int length = k_hufMaxCodeLength; length > 0; length--)
+		{
+			const uint64_t next = (code + counts[length]) >> 1;
+			counts[length] = code;
+			code = next;
+		}
+		for (uint64_t& entry : codes)
+		{
+			const uint64_t length = entry;
+			if (length > 0)
+			{
+				entry = length | (counts[length]++ << 6);
+			}
+		}
+	}
+
+	// Huffman code lengths of the symbols in [minSymbol, maxSymbol], the run-length symbol is appended after them
+	std::vector<uint64_t> buildEncodingTable(std::vector<uint64_t>& frequencies, int& minSymbol, int& maxSymbol)
+	{
+		minSymbol = 0;
+		while (frequencies[minSymbol] == 0)
+		{
+			minSymbol++;
+		}
+		std::vector<int> links(k_hufEncodingSize);
+		std::vector<int> heap;
+		for (int i = minSymbol; i < k_hufEncodingSize; i++)
+		{
+			links[i] = i;
+			if (frequencies[i] != 0)
+			{
+				heap.push_back(i);
+				maxSymbol = i;
+			}
+		}
+		maxSymbol++;
+		frequencies[maxSymbol] = 1;
+		heap.push_back(maxSymbol);
+
+		// Merging two subtrees lengthens the codes of all their leaves, which are kept in linked lists
+		const auto greater = [&](int a, int b) { return frequencies[a] > frequencies[b]; };
+		std::make_heap(heap.begin(), heap.end(), greater);
+		std::vector<uint64_t> lengths(k_hufEncodingSize, 0);
+		while (heap.size() > 1)
+		{
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			const int smallest = heap.back();
+			heap.pop_back();
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			const int second = heap.back();
+			frequencies[second] += frequencies[smallest];
+			std::push_heap(heap.begin(), heap.end(), greater);
+
+			for (int j = second;; j = links[j])
+			{
+				lengths[j]++;
+				if (links[j] == j)
+				{
+					links[j] = smallest;
+					break;
+				}
+			}
+			for (int j = smallest;; j = links[j])
+			{
+				lengths[j]++;
+				if (links[j] == j)
+					break;
+			}
+		}
+		buildCanonicalCodes(lengths);
+		return lengths;
+	}
+
+	// 6-bit code lengths, runs of unused symbols are collapsed
+	void packEncodingTable(const std::vector<uint64_t>& codes, int minSymbol, int maxSymbol, std::vector<uint8_t>& out)
+	{
+		HufBitWriter writer{ out };
+		for (int symbol = minSymbol; symbol <= maxSymbol; symbol++)
+		{
+			const int length = getCodeLength(codes[symbol]);
+			if (length == 0)
+			{
+				int zeroRun = 1;
+				while (symbol < maxSymbol && zeroRun < k_longestLongRun && getCodeLength(codes[symbol + 1]) == 0)
+				{
+					symbol++;
+					zeroRun++;
+				}
+				if (zeroRun >= k_shortestLongRun)
+				{
+					writer.write(6, k_longZeroRun);
+					writer.write(8, zeroRun - k_shortestLongRun);
+					continue;
+				}
+				if (zeroRun >= 2)
+				{
+					writer.write(6, k_shortZeroRun + zeroRun - 2);
+					continue;
+				}
+			}
+			writer.write(6, length);
+		}
+		writer.flush();
+	}
+
+	// Writes runCount + 1 copies of a symbol, as symbol, run symbol and 8-bit count when that is shorter
+	void writeRun(HufBitWriter& writer, uint64_t code, int runCount, uint64_t runCode)
+	{
+		if (getCodeLength(code) + getCodeLength(runCode) + 8 < getCodeLength(code) * runCount)
+		{
+			writeCode(writer, code);
+			writeCode(writer, runCode);
+			writer.write(8, runCount);
+			return;
+		}
+		for (int i = 0; i <= runCount; i++)
+		{
+			writeCode(writer, code);
+		}
+	}
+
+	void hufCompress(const std::vector<uint16_t>& values, std::vector<uint8_t>& out)
+	{
+		std::vector<uint64_t> frequencies(k_hufEncodingSize, 0);
+		for (const uint16_t value : values)
+		{
+			frequencies[value]++;
+		}
+		int minSymbol = 0;
+		int maxSymbol = 0;
+		const std::vector<uint64_t> codes = buildEncodingTable(frequencies, minSymbol, maxSymbol);
+
+		const size_t headerStart = out.size();
+		out.resize(headerStart + 20);
+		packEncodingTable(codes, minSymbol, maxSymbol, out);
+		const size_t tableLength = out.size() - headerStart - 20;
+
+		const size_t dataStart = out.size();
+		HufBitWriter writer{ out };
+		uint16_t symbol = values[0];
+		int runCount = 0;
+		for (size_t i = 1; i < values.size(); i++)
+		{
+			if (values[i] == symbol && runCount < 255)
+			{
+				runCount++;
+				continue;
+			}
+			writeRun(writer, codes[symbol], runCount, codes[maxSymbol]);
+			runCount = 0;
+			symbol = values[i];
+		}
+		writeRun(writer, codes[symbol], runCount, codes[maxSymbol]);
+		const uint64_t bitCount = (out.size() - dataStart) * 8 + writer.bitCount;
+		writer.flush();
+
+		std::vector<uint8_t> header;
+		appendLE(header, static_cast<uint32_t>(minSymbol));
+		appendLE(header, static_cast<uint32_t>(maxSymbol));
+		appendLE(header, static_cast<uint32_t>(tableLength));
+		appendLE(header, static_cast<uint32_t>(bitCount));
+		appendLE(header, 0);
+		std::copy(header.begin(), header.end(), out.begin() + headerStart);
+	}
+
+	// PIZ: every channel is wavelet transformed as a plane of 16-bit values. The values used are first remapped to a
+	// dense range through a bitmap stored with the chunk, then everything is Huffman coded as one stream.
+	std::vector<uint8_t> pizCompress(const std::vector<uint8_t>& data, uint32_t width, uint32_t lines, uint32_t channelCount,
+		uint32_t valuesPerSample)
+	{
+		const size_t lineValues = size_t(width) * valuesPerSample;
+		const size_t planeValues = lineValues * lines;
+		std::vector<uint16_t> values(planeValues * channelCount);
+		const uint8_t* in = data.data();
+		for (uint32_t y = 0; y < lines; y++)
+		{
+			for (uint32_t channel = 0; channel < channelCount; channel++)
+			{
+				uint16_t* out = values.data() + channel * planeValues + y * lineValues;
+				for (size_t i = 0; i < lineValues; i++, in += 2)
+				{
+					out[i] = static_cast<uint16_t>(in[0] | (in[1] << 8));
+				}
+			}
+		}
+
+		std::vector<uint8_t> bitmap(k_bitmapSize, 0);
+		for (const uint16_t value : values)
+		{
+			bitmap[value >> 3] |= static_cast<uint8_t>(1 << (value & 7));
+		}
+		bitmap[0] &= ~1; // zero is always assumed present
+		int minNonZero = k_bitmapSize - 1;
+		int maxNonZero = 0;
+		for (int i = 0; i < k_bitmapSize; i++)
+		{
+			if (bitmap[i])
+			{
+				minNonZero = std::min(minNonZero, i);
+				maxNonZero = std::max(maxNonZero, i);
+			}
+		}
+
+		std::vector<uint16_t> lut(k_ushortRange, 0);
+		int used = 0;
+		for (int i = 0; i < k_ushortRange; i++)
+		{
+			if (i == 0 || (bitmap[i >> 3] & (1 << (i & 7))))
+			{
+				lut[i] = static_cast<uint16_t>(used++);
+			}
+		}
+		const uint16_t maxValue = static_cast<uint16_t>(used - 1);
+		for (uint16_t& value : values)
+		{
+			value = lut[value];
+		}
+
+		std::vector<uint8_t> out;
+		out.reserve(8 + k_bitmapSize + values.size() * 2);
+		appendLE(out, static_cast<uint32_t>(minNonZero), 2);
+		appendLE(out, static_cast<uint32_t>(maxNonZero), 2);
+		if (minNonZero <= maxNonZero)
+		{
+			out.insert(out.end(), bitmap.begin() + minNonZero, bitmap.begin() + maxNonZero + 1);
+		}
+
+		for (uint32_t channel = 0; channel < channelCount; channel++)
+		{
+			for (uint32_t component = 0; component < valuesPerSample; component++)
+			{
+				waveletEncode(values.data() + channel * planeValues + component, static_cast<int>(width), static_cast<int>(valuesPerSample),
+					static_cast<int>(lines), static_cast<int>(lineValues), maxValue);
+			}
+		}
+
+		const size_t lengthPosition = out.size();
+		appendLE(out, 0);
+		hufCompress(values, out);
+		const uint32_t length = static_cast<uint32_t>(out.size() - lengthPosition - 4);
+		for (int i = 0; i < 4; i++)
+		{
+			out[lengthPosition + i] = static_cast<uint8_t>(length >> (i * 8));
+		}
+		return out;
+	}
+}
+
+EXRWriter::EXRWriter(const std::filesystem::path& path, const EXRSettings& settings)
+	: m_settings(settings)
+{
+	const uint32_t channelCount = static_cast<uint32_t>(m_settings.channels.size());
+	if (m_settings.width == 0 || m_settings.height == 0 || channelCount == 0)
+		return;
+	if (isTiled() && m_settings.tileHeight == 0)
+		return;
+
+	m_channelOrder.resize(channelCount);
+	std::iota(m_channelOrder.begin(), m_channelOrder.end(), 0u);
+	std::sort(m_channelOrder.begin(), m_channelOrder.end(), [&](uint32_t a, uint32_t b)
+		{
+			return m_settings.channels[a] < m_settings.channels[b];
+		});
+	m_sampleSize = m_settings.pixelType == EXRPixelType::Float ? 4 : 2;
+	m_chunkCount = isTiled() ? getTileCountX() * getTileCountY() : (m_settings.height + getRowsPerChunk() - 1) / getRowsPerChunk();
+	m_offsets.assign(m_chunkCount, 0);
+
+	m_file.open(path, std::ios::binary);
+	if (m_file)
+	{
+		writeHeader();
+	}
+}
+
+EXRWriter::~EXRWriter()
+{
+	if (isOpen())
+	{
+		finish();
+	}
+}
+
+bool EXRWriter::isOpen() const
+{
+	return m_file.is_open() && !m_isFinished;
+}
+
+bool EXRWriter::isTiled() const
+{
+	return m_settings.tileWidth != 0;
+}
+
+uint32_t EXRWriter::getRowsPerChunk() const
+{
+	if (isTiled())
+		return m_settings.tileHeight;
+	switch (m_settings.compression)
+	{
+	case EXRCompression::ZIP: return 16;
+	case EXRCompression::PIZ: return 32;
+	default: return 1;
+	}
+}
+
+uint32_t EXRWriter::getTileCountX() const
+{
+	return isTiled() ? (m_settings.width + m_settings.tileWidth - 1) / m_settings.tileWidth : 1;
+}
+
+uint32_t EXRWriter::getTileCountY() const
+{
+	return isTiled() ? (m_settings.height + m_settings.tileHeight - 1) / m_settings.tileHeight : 1;
+}
+
+void EXRWriter::writeHeader()
+{
+	std::vector<uint8_t> header(k_magic, k_magic + sizeof(k_magic));
+	appendLE(header, k_version | (isTiled() ? k_tiledFlag : 0));
+
+	std::vector<uint8_t> channels;
+	for (const uint32_t channel : m_channelOrder)
+	{
+		appendString(channels, m_settings.channels[channel]);
+		appendLE(channels, static_cast<uint32_t>(m_settings.pixelType));
+		appendLE(channels, 0); // not perceptually linear, reserved
+		appendLE(channels, 1); // x sampling
+		appendLE(channels, 1); // y sampling
+	}
+	channels.push_back(0);
+	appendAttribute(header, "channels", "chlist", channels);
+	appendAttribute(header, "compression", "compression", { static_cast<uint8_t>(m_settings.compression) });
+	appendAttribute(header, "dataWindow", "box2i", getBox(m_settings.width, m_settings.height));
+	appendAttribute(header, "displayWindow", "box2i", getBox(m_settings.width, m_settings.height));
+	appendAttribute(header, "lineOrder", "lineOrder", { isTiled() ? k_randomY : k_increasingY });
+	std::vector<uint8_t> value;
+	appendFloat(value, 1.0f);
+	appendAttribute(header, "pixelAspectRatio", "float", value);
+	value.clear();
+	appendFloat(value, 0.0f);
+	appendFloat(value, 0.0f);
+	appendAttribute(header, "screenWindowCenter", "v2f", value);
+	value.clear();
+	appendFloat(value, 1.0f);
+	appendAttribute(header, "screenWindowWidth", "float", value);
+	if (isTiled())
+	{
+		value.clear();
+		appendLE(value, m_settings.tileWidth);
+		appendLE(value, m_settings.tileHeight);
+		value.push_back(0); // one level, rounded down
+		appendAttribute(header, "tiles", "tiledesc", value);
+	}
+	header.push_back(0);
+
+	m_file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+	m_offsetTablePosition = m_file.tellp();
+	const std::vector<char> offsetTable(m_chunkCount * sizeof(uint64_t), 0);
+	m_file.write(offsetTable.data(), static_cast<std::streamsize>(offsetTable.size()));
+}
+
+void EXRWriter::convertRow(const float* pixels, uint32_t width, uint8_t* out) const
+{
+	const size_t channelCount = m_channelOrder.size();
+	for (const uint32_t channel : m_channelOrder)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const float sample = pixels[x * channelCount + channel];
+			uint32_t bits;
+			if (m_settings.pixelType == EXRPixelType::Half)
+			{
+				bits = glm::packHalf1x16(sample);
+			}
+			else
+			{
+				std::memcpy(&bits, &sample, sizeof(bits));
+			}
+			for (uint32_t i = 0; i < m_sampleSize; i++)
+			{
+				*out++ = static_cast<uint8_t>(bits >> (i * 8));
+			}
+		}
+	}
+}
+
+EXRWriter::CompressedChunk EXRWriter::compressChunk(uint32_t index, const std::vector<uint8_t>& data) const
+{
+	uint32_t width = m_settings.width;
+	uint32_t lines = std::min(getRowsPerChunk(), m_settings.height - (index / getTileCountX()) * getRowsPerChunk());
+	if (isTiled())
+	{
+		width = std::min(m_settings.tileWidth, m_settings.width - (index % getTileCountX()) * m_settings.tileWidth);
+	}
+
+	CompressedChunk chunk;
+	chunk.index = index;
+	switch (m_settings.compression)
+	{
+	case EXRCompression::ZIP:
+		chunk.data = zipCompress(data, m_settings.compressionLevel);
+		break;
+	case EXRCompression::PIZ:
+		chunk.data = pizCompress(data, width, lines, static_cast<uint32_t>(m_channelOrder.size()), m_sampleSize / 2);
+		break;
+	default:
+		break;
+	}
+	// Readers take a chunk that is not smaller than its raw size as uncompressed
+	if (chunk.data.empty() || chunk.data.size() >= data.size())
+	{
+		chunk.data = data;
+	}
+	return chunk;
+}
+
+void EXRWriter::writeChunk(const CompressedChunk& chunk)
+{
+	m_offsets[chunk.index] = static_cast<uint64_t>(m_file.tellp());
+	std::vector<uint8_t> header;
+	if (isTiled())
+	{
+		appendLE(header, chunk.index % getTileCountX());
+		appendLE(header, chunk.index / getTileCountX());
+		appendLE(header, 0); // level
+		appendLE(header, 0);
+	}
+	else
+	{
+		appendLE(header, chunk.index * getRowsPerChunk());
+	}
+	appendLE(header, static_cast<uint32_t>(chunk.data.size()));
+	m_file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+	m_file.write(reinterpret_cast<const char*>(chunk.data.data()), static_cast<std::streamsize>(chunk.data.size()));
+	m_chunksWritten++;
+	if (!m_file)
+	{
+		m_failed = true;
+	}
+}
+
+void EXRWriter::commitChunk(CompressedChunk chunk)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_offsets[chunk.index] != 0 || m_readyChunks.count(chunk.index) != 0)
+	{
+		m_failed = true; // written twice
+		return;
+	}
+	if (isTiled())
+	{
+		writeChunk(chunk);
+		return;
+	}
+	m_readyChunks.emplace(chunk.index, std::move(chunk));
+	for (auto next = m_readyChunks.find(m_nextChunk); next != m_readyChunks.end(); next = m_readyChunks.find(m_nextChunk))
+	{
+		writeChunk(next->second);
+		m_readyChunks.erase(next);
+		m_nextChunk++;
+	}
+}
+
+bool EXRWriter::writeRows(uint32_t y, uint32_t count, const float* pixels, size_t rowPitch)
+{
+	if (!isOpen() || isTiled() || count == 0 || y + count > m_settings.height)
+		return false;
+
+	const uint32_t rowsPerChunk = getRowsPerChunk();
+	const size_t rowBytes = size_t(m_settings.width) * m_channelOrder.size() * m_sampleSize;
+	const size_t inputPitch = rowPitch != 0 ? rowPitch : m_settings.width * m_channelOrder.size() * sizeof(float);
+	const uint32_t firstChunk = y / rowsPerChunk;
+	const uint32_t lastChunk = (y + count - 1) / rowsPerChunk;
+	const auto getChunkRows = [&](uint32_t chunk)
+		{
+			return std::min(rowsPerChunk, m_settings.height - chunk * rowsPerChunk);
+		};
+
+	// Buffers are created under the lock and filled outside it, a chunk can't complete before these rows are counted
+	std::vector<PendingChunk*> chunks;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (uint32_t chunk = firstChunk; chunk <= lastChunk; chunk++)
+		{
+			std::unique_ptr<PendingChunk>& pending = m_pending[chunk];
+			if (!pending)
+			{
+				pending = std::make_unique<PendingChunk>();
+				pending->data.resize(getChunkRows(chunk) * rowBytes);
+			}
+			chunks.push_back(pending.get());
+		}
+	}
+	for (uint32_t row = 0; row < count; row++)
+	{
+		const uint32_t fileRow = y + row;
+		const float* input = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pixels) + row * inputPitch);
+		PendingChunk* chunk = chunks[fileRow / rowsPerChunk - firstChunk];
+		convertRow(input, m_settings.width, chunk->data.data() + (fileRow % rowsPerChunk) * rowBytes);
+	}
+
+	std::vector<std::pair<uint32_t, std::unique_ptr<PendingChunk>>> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (uint32_t chunk = firstChunk; chunk <= lastChunk; chunk++)
+		{
+			const uint32_t begin = std::max(y, chunk * rowsPerChunk);
+			const uint32_t end = std::min(y + count, chunk * rowsPerChunk + getChunkRows(chunk));
+			auto pending = m_pending.find(chunk);
+			pending->second->rowsWritten += end - begin;
+			if (pending->second->rowsWritten >= getChunkRows(chunk))
+			{
+				completed.emplace_back(chunk, std::move(pending->second));
+				m_pending.erase(pending);
+			}
+		}
+	}
+
+	Parallel::parallelFor(completed.size(), [&](size_t i)
+		{
+			commitChunk(compressChunk(completed[i].first, completed[i].second->data));
+			completed[i].second.reset();
+		}, m_settings.maxThreads);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_failed;
+}
+
+bool EXRWriter::writeTile(uint32_t tileX, uint32_t tileY, const float* pixels, size_t rowPitch)
+{
+	if (!isOpen() || !isTiled() || tileX >= getTileCountX() || tileY >= getTileCountY())
+		return false;
+
+	const uint32_t width = std::min(m_settings.tileWidth, m_settings.width - tileX * m_settings.tileWidth);
+	const uint32_t height = std::min(m_settings.tileHeight, m_settings.height - tileY * m_settings.tileHeight);
+	const size_t rowBytes = size_t(width) * m_channelOrder.size() * m_sampleSize;
+	const size_t inputPitch = rowPitch != 0 ? rowPitch : width * m_channelOrder.size() * sizeof(float);
+	std::vector<uint8_t> data(rowBytes * height);
+	for (uint32_t row = 0; row < height; row++)
+	{
+		const float* input = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pixels) + row * inputPitch);
+		convertRow(input, width, data.data() + row * rowBytes);
+	}
+	commitChunk(compressChunk(tileY * getTileCountX() + tileX, data));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_failed;
+}
+
+bool EXRWriter::finish()
+{
+	if (!isOpen())
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_isFinished = true;
+	const bool complete = !m_failed && m_chunksWritten == m_chunkCount;
+	if (complete)
+	{
+		std::vector<uint8_t> offsetTable;
+		for (const uint64_t offset : m_offsets)
+		{
+			appendLE(offsetTable, static_cast<uint32_t>(offset));
+			appendLE(offsetTable, static_cast<uint32_t>(offset >> 32));
+		}
+		m_file.seekp(m_offsetTablePosition);
+		m_file.write(reinterpret_cast<const char*>(offsetTable.data()), static_cast<std::streamsize>(offsetTable.size()));
+	}
+	m_file.close();
+	m_pending.clear();
+	m_readyChunks.clear();
+	return complete && !m_file.fail();
+}
+
+bool Baking::writeEXR(const std::filesystem::path& path, const float* pixels, const EXRSettings& settings, size_t rowPitch)
+{
+	EXRWriter writer(path, settings);
+	if (!writer.isOpen())
+		return false;
+
+	const size_t pitch = rowPitch != 0 ? rowPitch : settings.width * settings.channels.size() * sizeof(float);
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(pixels);
+	// Every worker hands in whole chunks, which it then compresses itself
+	if (writer.isTiled())
+	{
+		Parallel::parallelFor(size_t(writer.getTileCountX()) * writer.getTileCountY(), [&](size_t tile)
+			{
+				const uint32_t tileX = static_cast<uint32_t>(tile % writer.getTileCountX());
+				const uint32_t tileY = static_cast<uint32_t>(tile / writer.getTileCountX());
+				const size_t offset = tileY * settings.tileHeight * pitch + tileX * settings.tileWidth * settings.channels.size() * sizeof(float);
+				writer.writeTile(tileX, tileY, reinterpret_cast<const float*>(bytes + offset), pitch);
+			}, settings.maxThreads);
+	}
+	else
+	{
+		const uint32_t rowsPerChunk = writer.getRowsPerChunk();
+		Parallel::parallelForChunks(settings.height, rowsPerChunk, [&](size_t begin, size_t end)
+			{
+				writer.writeRows(static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin),
+					reinterpret_cast<const float*>(bytes + begin * pitch), pitch);
+			}, settings.maxThreads);
+	}
+	return writer.finish();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "deflate.hpp"
+
+namespace Baking
+{
+	// Values as stored in the file
+	enum class EXRPixelType : int32_t
+	{
+		Half = 1,
+		Float = 2
+	};
+
+	enum class EXRCompression : uint8_t
+	{
+		None = 0,
+		ZIP = 3, // deflate of 16 scanlines or one tile
+		PIZ = 4  // wavelet and Huffman coding of 32 scanlines or one tile, best for noisy data
+	};
+
+	struct EXRSettings
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<std::string> channels = { "R", "G", "B", "A" }; // in the interleaved order of the input pixels
+		EXRPixelType pixelType = EXRPixelType::Half;
+		EXRCompression compression = EXRCompression::ZIP;
+		uint32_t tileWidth = 0; // 0 writes scanlines, otherwise tiles of tileWidth x tileHeight
+		uint32_t tileHeight = 0;
+		int compressionLevel = k_defaultCompressionLevel; // of ZIP
+		uint32_t maxThreads = 0;                          // 0 uses every core
+	};
+
+	// Streams a single-part OpenEXR image to disk. Rows or tiles may arrive in any order and from any thread:
+	// a chunk is converted and compressed as soon as all of its texels are there, so only unfinished scanline
+	// chunks are held in memory. Scanline chunks are written in increasing y as the format requires, tiles in the
+	// order they finish. The offset table is filled in by finish().
+	class EXRWriter
+	{
+	public:
+		EXRWriter(const std::filesystem::path& path, const EXRSettings& settings);
+		~EXRWriter();
+
+		EXRWriter(const EXRWriter&) = delete;
+		EXRWriter& operator=(const EXRWriter&) = delete;
+
+		bool isOpen() const;
+		bool isTiled() const;
+		uint32_t getRowsPerChunk() const;
+		uint32_t getTileCountX() const;
+		uint32_t getTileCountY() const;
+
+		// count rows of interleaved float samples starting at row y of a scanline image. rowPitch is in bytes,
+		// 0 for tightly packed rows. Chunks completed by the call are compressed in parallel.
+		bool writeRows(uint32_t y, uint32_t count, const float* pixels, size_t rowPitch = 0);
+		// One tile of a tiled image, pixels cover the tile clipped to the image
+		bool writeTile(uint32_t tileX, uint32_t tileY, const float* pixels, size_t rowPitch = 0);
+
+		// Writes the offset table and closes the file, false if any chunk is missing or a write failed
+		bool finish();
+
+	private:
+		struct PendingChunk
+		{
+			std::vector<uint8_t> data; // uncompressed, in file layout
+			uint32_t rowsWritten = 0;
+		};
+
+		struct CompressedChunk
+		{
+			uint32_t index = 0;
+			std::vector<uint8_t> data;
+		};
+
+		void writeHeader();
+		void convertRow(const float* pixels, uint32_t width, uint8_t* out) const;
+		CompressedChunk compressChunk(uint32_t index, const std::vector<uint8_t>& data) const;
+		void commitChunk(CompressedChunk chunk);
+		void writeChunk(const CompressedChunk& chunk);
+
+		EXRSettings m_settings;
+		std::vector<uint32_t> m_channelOrder; // input channel of every file channel, the file sorts them by name
+		uint32_t m_sampleSize = 2;
+		uint32_t m_chunkCount = 0;
+		std::ofstream m_file;
+		std::streamoff m_offsetTablePosition = 0;
+		std::vector<uint64_t> m_offsets;
+
+		std::mutex m_mutex;
+		std::map<uint32_t, std::unique_ptr<PendingChunk>> m_pending;
+		std::map<uint32_t, CompressedChunk> m_readyChunks; // scanline chunks waiting for an earlier chunk
+		uint32_t m_nextChunk = 0;
+		uint32_t m_chunksWritten = 0;
+		bool m_failed = false;
+		bool m_isFinished = false;
+	};
+
+	// Whole image of interleaved float samples, rowPitch in bytes
+	bool writeEXR(const std::filesystem::path& path, const float* pixels, const EXRSettings& settings, size_t rowPitch = 0);
+} // namespace Baking
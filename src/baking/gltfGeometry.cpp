@@ -0,0 +1,372 @@
+#include "gltfGeometry.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <glm/gtc/quaternion.hpp>
+#include <stb_image.h>
+
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+// tinygltf image loader that only keeps the encoded bytes, decoding is left to decodeGLTFImages
+static bool keepEncodedImage(tinygltf::Image* image, const int, std::string*, std::string*, int, int,
+	const unsigned char* bytes, int size, void*)
+{
+	image->image.assign(bytes, bytes + size);
+	image->width = image->height = image->component = -1;
+	image->bits = image->pixel_type = -1;
+	image->as_is = true;
+	return true;
+}
+
+static bool decodeImage(tinygltf::Image& image)
+{
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	// 16-bit images are reduced to 8 bits, the viewer's textures are RGBA8
+	stbi_uc* pixels = stbi_load_from_memory(image.image.data(), static_cast<int>(image.image.size()), &width, &height, &components, 4);
+	if (!pixels)
+	{
+		std::cerr << "Failed to decode image " << (image.name.empty() ? image.uri : image.name) << ": " << stbi_failure_reason() << std::endl;
+		image.image.clear();
+		return false;
+	}
+	image.image.assign(pixels, pixels + size_t(width) * height * 4);
+	stbi_image_free(pixels);
+	image.width = width;
+	image.height = height;
+	image.component = 4;
+	image.bits = 8;
+	image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+	image.as_is = false;
+	return true;
+}
+
+static void readPositions(const tinygltf::Model& model, const tinygltf::Mesh& mesh, const tinygltf::Primitive& primitive, std::vector<Position>& verticies)
+{
+	if (!primitive.attributes.contains("POSITION"))
+	{
+		std::cerr << "No POSITION attribute found in primitive " << mesh.name << std::endl;
+		return;
+	}
+	const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
+	const tinygltf::BufferView& posBufferView = model.bufferViews[posAccessor.bufferView];
+	const tinygltf::Buffer& posBuffer = model.buffers[posBufferView.buffer];
+
+	const unsigned char* posDataPtr = posBuffer.data.data() + posAccessor.byteOffset + posBufferView.byteOffset;
+	const auto posFloatPtr = reinterpret_cast<const float*>(posDataPtr);
+	const size_t vertexCount = posAccessor.count;
+	const int components = (posAccessor.type == TINYGLTF_TYPE_VEC3) ? 3 : 0;
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		Position position(-INFINITY, -INFINITY, -INFINITY);
+		for (int j = 0; j < components; j++)
+		{
+			if (j == 0)
+				position.x = posFloatPtr[i * components + j];
+			else if (j == 1)
+				position.y = posFloatPtr[i * components + j];
+			else if (j == 2)
+				position.z = posFloatPtr[i * components + j];
+		}
+		verticies.push_back(position);
+	}
+}
+
+static void readTexCoords(const tinygltf::Model& model, const tinygltf::Mesh& mesh, const tinygltf::Primitive& primitive, std::vector<TexCoords>& texCoords)
+{
+	if (!primitive.attributes.contains("TEXCOORD_0"))
+	{
+		std::cerr << "No TEXCOORD_0 attribute found in primitive " << mesh.name << std::endl;
+		return;
+	}
+	const tinygltf::Accessor& accessor = model.accessors[primitive.attributes.at("TEXCOORD_0")];
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+
+	const unsigned char* posDataPtr = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
+	const auto posFloatPtr = reinterpret_cast<const float*>(posDataPtr);
+	const size_t vertexCount = accessor.count;
+	const int components = (accessor.type == TINYGLTF_TYPE_VEC2) ? 2 : 0;
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		TexCoords texCoord(-INFINITY, -INFINITY);
+		for (int j = 0; j < components; j++)
+		{
+			if (j == 0)
+				texCoord.x = posFloatPtr[i * components + j];
+			else if (j == 1)
+				texCoord.y = posFloatPtr[i * components + j];
+		}
+		texCoords.push_back(texCoord);
+	}
+}
+
+static void readIndices(const tinygltf::Model& model, const tinygltf::Mesh& mesh, const tinygltf::Primitive& primitive, std::vector<uint32_t>& indicies)
+{
+	if (primitive.indices < 0)
+	{
+		std::cerr << "No indices found in primitive " << mesh.name << std::endl;
+		return;
+	}
+	const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+	const tinygltf::BufferView& indexBufferView = model.bufferViews[indexAccessor.bufferView];
+	const tinygltf::Buffer& indexBuffer = model.buffers[indexBufferView.buffer];
+
+
+	const void* pIndexData = indexBuffer.data.data() + indexBufferView.byteOffset + indexAccessor.byteOffset;
+	const size_t indexCount = indexAccessor.count;
+	if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+	{
+		const auto indices = static_cast<const uint16_t*>(pIndexData);
+		indicies.assign(indices, indices + indexCount);
+	}
+	else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+	{
+		const auto indices = static_cast<const uint32_t*>(pIndexData);
+		indicies.assign(indices, indices + indexCount);
+	}
+	else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+	{
+		const auto indices = static_cast<const uint8_t*>(pIndexData);
+		indicies.assign(indices, indices + indexCount);
+	}
+}
+
+static void readNormals(const tinygltf::Model& model,
+	const tinygltf::Mesh& mesh,
+	const tinygltf::Primitive& primitive,
+	std::vector<Normal>& normals)
+{
+	if (!primitive.attributes.contains("NORMAL"))
+	{
+		std::cerr << "No NORMAL attribute found in primitive " << mesh.name << std::endl;
+		return;
+	}
+	const tinygltf::Accessor& accessor = model.accessors[primitive.attributes.at("NORMAL")];
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+
+	const unsigned char* dataPtr = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
+	const size_t vertexCount = accessor.count;
+
+	// Use byteStride if specified, otherwise assume tightly packed vec3 floats
+	size_t byteStride = bufferView.byteStride;
+	if (byteStride == 0)
+		byteStride = sizeof(float) * 3;  // tightly packed
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* floatPtr = reinterpret_cast<const float*>(dataPtr + i * byteStride);
+		Normal normal;
+		normal.x = floatPtr[0];
+		normal.y = floatPtr[1];
+		normal.z = floatPtr[2];
+		normals.push_back(normal);
+	}
+}
+
+bool Baking::readGLTFFile(const std::string& path, tinygltf::Model& outModel)
+{
+	tinygltf::TinyGLTF loader;
+	loader.SetImageLoader(keepEncodedImage, nullptr);
+	std::string err;
+	std::string warn;
+	std::cout << "Loading glTF file: " << path << std::endl;
+	bool ret = false;
+	if (path.ends_with("gltf"))
+	{
+		ret = loader.LoadASCIIFromFile(&outModel, &err, &warn, path);
+	}
+	else
+	{
+		ret = loader.LoadBinaryFromFile(&outModel, &err, &warn, path);
+	}
+
+	if (!warn.empty())
+		std::cout << "Warn: " << warn << std::endl;
+	if (!err.empty())
+		std::cout << "Err: " << err << std::endl;
+	if (!ret)
+	{
+		std::cout << "Failed to parse glTF" << std::endl;
+		return false;
+	}
+	std::cout << "Loaded " << path << std::endl;
+	return true;
+}
+
+void Baking::readGLTFPrimitive(const tinygltf::Model& model,
+	const tinygltf::Mesh& mesh,
+	const tinygltf::Primitive& primitive,
+	std::vector<Vertex>& outVertices,
+	std::vector<uint32_t>& outIndices)
+{
+	std::vector<Position> posBuffer;
+	std::vector<TexCoords> texCoordsBuffer;
+	std::vector<Normal> normalBuffer;
+
+	readPositions(model, mesh, primitive, posBuffer);
+	readTexCoords(model, mesh, primitive, texCoordsBuffer);
+	readIndices(model, mesh, primitive, outIndices);
+	readNormals(model, mesh, primitive, normalBuffer);
+
+	const auto numVert = posBuffer.size();
+	outVertices.reserve(numVert);
+	for (size_t i = 0; i < numVert; i++)
+	{
+		Vertex interData{};
+		interData.position = posBuffer[i];
+		interData.texCoords = i < texCoordsBuffer.size() ? texCoordsBuffer[i] : TexCoords(0, 0);
+		interData.normal = i < normalBuffer.size() ? normalBuffer[i] : Normal(0, 1, 0);
+		outVertices.push_back(interData);
+	}
+}
+
+Transform Baking::getGLTFMeshTransform(const size_t meshIndex, const tinygltf::Model& model)
+{
+	Transform transform;
+	transform.position = glm::vec3(0.0f, 0.0f, 0.0f);
+	tinygltf::Node node;
+	for (const auto& n : model.nodes)
+	{
+		if (n.mesh == static_cast<int>(meshIndex))
+		{
+			node = n;
+			break;
+		}
+	}
+	if (node.translation.size() != 0)
+	{
+		transform.position = glm::vec3(node.translation[0], node.translation[1],
+			node.translation[2]);
+	}
+
+	transform.rotation = glm::vec3(0.0f, 0.0f, 0.0f);
+	if (node.rotation.size() >= 4)
+	{
+		const glm::quat quatRot(
+			static_cast<float>(node.rotation[3]),  // w
+			static_cast<float>(node.rotation[0]),  // x
+			static_cast<float>(node.rotation[1]),  // y
+			static_cast<float>(node.rotation[2])); // z
+
+		transform.rotation = glm::degrees(glm::eulerAngles(quatRot));
+	}
+
+	transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
+	if (node.scale.size() != 0)
+	{
+		transform.scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+	}
+	transform.matrix = glm::mat4(1.0f);
+	transform.updateMatrix();
+	return transform;
+}
+
+void Baking::decodeGLTFImages(tinygltf::Model& model,
+	const std::vector<size_t>& imageIndices,
+	const std::function<void(size_t, bool)>& onDecoded,
+	uint32_t maxThreads)
+{
+	if (imageIndices.empty())
+		return;
+
+	std::mutex mutex;
+	std::condition_variable decodedCondition;
+	std::deque<std::pair<size_t, bool>> decoded;
+	std::atomic<size_t> nextImage = 0;
+	auto worker = [&]()
+		{
+			for (size_t i = nextImage.fetch_add(1); i < imageIndices.size(); i = nextImage.fetch_add(1))
+			{
+				const size_t imageIndex = imageIndices[i];
+				tinygltf::Image& image = model.images[imageIndex];
+				const bool succeeded = image.as_is ? decodeImage(image) : !image.image.empty();
+				{
+					std::lock_guard lock(mutex);
+					decoded.emplace_back(imageIndex, succeeded);
+				}
+				decodedCondition.notify_one();
+			}
+		};
+
+	// The calling thread only hands out results, it usually owns a device context the callbacks upload with
+	uint32_t threadCount = maxThreads > 0 ? maxThreads : Parallel::getWorkerCount();
+	threadCount = static_cast<uint32_t>(std::min<size_t>(threadCount, imageIndices.size()));
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		threads.emplace_back(worker);
+	}
+
+	// A throwing callback still waits for the decoders, they reference this frame
+	std::exception_ptr failure;
+	for (size_t handed = 0; handed < imageIndices.size(); handed++)
+	{
+		std::pair<size_t, bool> result;
+		{
+			std::unique_lock lock(mutex);
+			decodedCondition.wait(lock, [&]() { return !decoded.empty(); });
+			result = decoded.front();
+			decoded.pop_front();
+		}
+		if (failure)
+			continue;
+		try
+		{
+			onDecoded(result.first, result.second);
+		}
+		catch (...)
+		{
+			failure = std::current_exception();
+		}
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	if (failure)
+		std::rethrow_exception(failure);
+}
+
+std::string Baking::getGLTFMeshName(size_t meshIndex, const tinygltf::Model& model)
+{
+	// Node at the mesh's index, matches the names of meshes imported into the scene
+	if (meshIndex < model.nodes.size())
+		return model.nodes[meshIndex].name;
+	return meshIndex < model.meshes.size() ? model.meshes[meshIndex].name : std::string();
+}
+
+bool Baking::loadGLTFGeometry(const std::string& path, std::vector<MeshGeometry>& outMeshes)
+{
+	tinygltf::Model model;
+	if (!readGLTFFile(path, model))
+		return false;
+
+	for (size_t meshIndex = 0; meshIndex < model.meshes.size(); meshIndex++)
+	{
+		const tinygltf::Mesh& mesh = model.meshes[meshIndex];
+		for (const auto& gltfPrimitive : mesh.primitives)
+		{
+			MeshGeometry geometry;
+			geometry.name = getGLTFMeshName(meshIndex, model);
+			geometry.transform = getGLTFMeshTransform(meshIndex, model);
+			readGLTFPrimitive(model, mesh, gltfPrimitive, geometry.vertices, geometry.indices);
+			outMeshes.push_back(std::move(geometry));
+		}
+	}
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <tiny_gltf.h>
+
+#include "primitiveData.hpp"
+#include "transform.hpp"
+
+// glTF geometry reading without any GPU resources, shared by GLTFModel and the headless baker
+namespace Baking
+{
+	struct MeshGeometry
+	{
+		std::string name;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		Transform transform;
+	};
+
+	// Loads .gltf or .glb by extension, false if the file couldn't be parsed.
+	// Images are kept encoded (Image::as_is), decodeGLTFImages decodes the ones that are needed.
+	bool readGLTFFile(const std::string& path, tinygltf::Model& outModel);
+
+	// Decodes the encoded images at imageIndices to 8-bit RGBA on up to maxThreads threads (0 uses every core).
+	// onDecoded(imageIndex, succeeded) runs on the calling thread for every image as soon as it is decoded,
+	// in completion order, so uploads overlap the decoding of the remaining images.
+	void decodeGLTFImages(tinygltf::Model& model,
+		const std::vector<size_t>& imageIndices,
+		const std::function<void(size_t, bool)>& onDecoded,
+		uint32_t maxThreads = 0);
+
+	// Interleaved vertices of a glTF primitive. Missing UVs default to (0, 0), missing normals to +Y.
+	void readGLTFPrimitive(const tinygltf::Model& model,
+		const tinygltf::Mesh& mesh,
+		const tinygltf::Primitive& primitive,
+		std::vector<Vertex>& outVertices,
+		std::vector<uint32_t>& outIndices);
+
+	// Local transform of the first node referencing the mesh
+	Transform getGLTFMeshTransform(size_t meshIndex, const tinygltf::Model& model);
+	std::string getGLTFMeshName(size_t meshIndex, const tinygltf::Model& model);
+
+	// Every primitive of every mesh in the file, in the order GLTFModel imports them
+	bool loadGLTFGeometry(const std::string& path, std::vector<MeshGeometry>& outMeshes);
+} // namespace Baking
@@ -0,0 +1,174 @@
+#include "highPoly.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+
+#include "bvhBuilder.hpp"
+#include "meshProcessing.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	// Cost model of the flattening heuristic, in units of one ray/box test. Every ray entering an instance pays
+	// the ray transform and a root traversal of its own BLAS, which dominates for parts of a few hundred triangles.
+	constexpr float k_instanceCost = 6.0f;
+	// Parts whose instance overhead is at least this fraction of their whole traversal are flattened
+	constexpr float k_minInstanceOverhead = 1.0f / 3.0f;
+	// Flattening copies every instance, parts that would need more world-space triangles than this stay instanced
+	constexpr size_t k_maxFlattenedTriangles = 65536;
+
+	// Box tests of a ray down to a leaf, the BVH builder stops splitting at two triangles
+	float estimateTraversalCost(size_t triangles)
+	{
+		return 1.0f + std::log2(std::max(1.0f, static_cast<float>(triangles) * 0.5f));
+	}
+
+	float estimateInstanceOverhead(size_t triangles)
+	{
+		return k_instanceCost / (k_instanceCost + estimateTraversalCost(triangles));
+	}
+
+	bool shouldFlatten(size_t triangles, size_t instances)
+	{
+		return estimateInstanceOverhead(triangles) >= k_minInstanceOverhead && triangles * instances <= k_maxFlattenedTriangles;
+	}
+
+	void appendInstance(CombinedHighPolyData& combined,
+		const std::vector<Triangle>& tris,
+		const std::vector<uint32_t>& indices,
+		const std::vector<BVH::Node>& nodes,
+		const BVH::BBox& worldBBox,
+		const glm::mat4& worldMatrix)
+	{
+		// Create BLAS instance with transforms for ray transformation at trace time
+		BLASInstance inst;
+		inst.worldBBox = worldBBox;  // Only this needs world-space (cheap)
+		inst.worldMatrixInv = glm::transpose(glm::inverse(worldMatrix));  // Row-major for HLSL
+		inst.normalMatrix = glm::transpose(inst.worldMatrixInv);
+		inst.triangleOffset = static_cast<uint32_t>(combined.triangles.size());
+		inst.triIndicesOffset = static_cast<uint32_t>(combined.triIndices.size());
+		inst.bvhNodeOffset = static_cast<uint32_t>(combined.bvhNodes.size());
+		inst.numTriangles = static_cast<uint32_t>(tris.size());
+		combined.blasInstances.push_back(inst);
+
+		// Append local-space data directly (no transform!)
+		combined.triangles.insert(combined.triangles.end(), tris.begin(), tris.end());
+		combined.triIndices.insert(combined.triIndices.end(), indices.begin(), indices.end());
+		combined.bvhNodes.insert(combined.bvhNodes.end(), nodes.begin(), nodes.end());
+	}
+
+	void appendWorldSpaceTriangles(const HighPolyMesh& mesh, std::vector<Triangle>& outTriangles)
+	{
+		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(mesh.worldMatrix)));
+		for (const Triangle& local : *mesh.triangles)
+		{
+			Triangle tri = local;
+			tri.v0 = glm::vec3(mesh.worldMatrix * glm::vec4(local.v0, 1.0f));
+			tri.v1 = glm::vec3(mesh.worldMatrix * glm::vec4(local.v1, 1.0f));
+			tri.v2 = glm::vec3(mesh.worldMatrix * glm::vec4(local.v2, 1.0f));
+			tri.n0 = glm::normalize(normalMatrix * local.n0);
+			tri.n1 = glm::normalize(normalMatrix * local.n1);
+			tri.n2 = glm::normalize(normalMatrix * local.n2);
+			outTriangles.push_back(tri);
+		}
+	}
+}
+
+CombinedHighPolyData Baking::combineHighPolys(const std::vector<HighPolyMesh>& meshes)
+{
+	CombinedHighPolyData combined;
+
+	// Instances share the triangle arrays of their part
+	std::unordered_map<const std::vector<Triangle>*, size_t> instanceCounts;
+	for (const HighPolyMesh& mesh : meshes)
+	{
+		instanceCounts[mesh.triangles]++;
+	}
+
+	std::vector<bool> flatten(meshes.size());
+	size_t flattenedInstances = 0;
+	size_t flattenedTriangles = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const size_t triangles = meshes[i].triangles->size();
+		flatten[i] = shouldFlatten(triangles, instanceCounts[meshes[i].triangles]);
+		flattenedInstances += flatten[i] ? 1 : 0;
+		flattenedTriangles += flatten[i] ? triangles : 0;
+	}
+	// A single flattened instance would only trade its transform for a rebuilt BVH
+	if (flattenedInstances < 2)
+	{
+		std::fill(flatten.begin(), flatten.end(), false);
+		flattenedInstances = 0;
+		flattenedTriangles = 0;
+	}
+
+	std::vector<Triangle> mergedTriangles;
+	std::vector<uint32_t> mergedTriIndices;
+	std::vector<BVH::Node> mergedNodes;
+	if (flattenedInstances > 0)
+	{
+		mergedTriangles.reserve(flattenedTriangles);
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			if (flatten[i])
+			{
+				appendWorldSpaceTriangles(meshes[i], mergedTriangles);
+			}
+		}
+		mergedTriIndices.resize(mergedTriangles.size());
+		for (uint32_t i = 0; i < mergedTriIndices.size(); i++)
+		{
+			mergedTriIndices[i] = i;
+		}
+		BVH::BVHBuilder builder(mergedTriangles, mergedTriIndices);
+		mergedNodes = builder.BuildBVH();
+	}
+
+	size_t totalTriangles = mergedTriangles.size();
+	size_t totalTriIndices = mergedTriIndices.size();
+	size_t totalBVHNodes = mergedNodes.size();
+	size_t totalInstances = flattenedInstances > 0 ? 1 : 0;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		if (flatten[i])
+			continue;
+		totalTriangles += meshes[i].triangles->size();
+		totalTriIndices += meshes[i].triangleIndices->size();
+		totalBVHNodes += meshes[i].bvhNodes->size();
+		totalInstances++;
+	}
+
+	std::cout << "Building combined high-poly buffers:" << std::endl;
+	std::cout << "  Total triangles: " << totalTriangles << std::endl;
+	std::cout << "  Total tri indices: " << totalTriIndices << std::endl;
+	std::cout << "  Total BVH nodes: " << totalBVHNodes << std::endl;
+	std::cout << "  Number of BLAS instances: " << totalInstances << std::endl;
+	if (flattenedInstances > 0)
+	{
+		std::cout << "  Flattened " << flattenedInstances << " of " << meshes.size()
+			<< " instances (" << flattenedTriangles << " triangles) into one world-space BLAS: instance overhead >= "
+			<< static_cast<int>(k_minInstanceOverhead * 100.0f + 0.5f) << "% of traversal, <= " << k_maxFlattenedTriangles << " triangles per part" << std::endl;
+	}
+
+	combined.triangles.reserve(totalTriangles);
+	combined.triIndices.reserve(totalTriIndices);
+	combined.bvhNodes.reserve(totalBVHNodes);
+	combined.blasInstances.reserve(totalInstances);
+
+	if (flattenedInstances > 0)
+	{
+		appendInstance(combined, mergedTriangles, mergedTriIndices, mergedNodes, mergedNodes[0].bbox, glm::mat4(1.0f));
+	}
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		if (flatten[i])
+			continue;
+		const HighPolyMesh& mesh = meshes[i];
+		appendInstance(combined, *mesh.triangles, *mesh.triangleIndices, *mesh.bvhNodes, mesh.worldBBox, mesh.worldMatrix);
+	}
+	return combined;
+}
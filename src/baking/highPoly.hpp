@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvhNode.hpp"
+#include "primitiveData.hpp"
+
+namespace Baking
+{
+	// Instance data for TLAS - references into combined buffers
+	// Triangles/BVH nodes stay in local space, ray is transformed to local space when traced
+	struct BLASInstance
+	{
+		BVH::BBox worldBBox;         // 32 bytes - for early TLAS culling
+		glm::mat4 worldMatrixInv;    // 64 bytes - transforms ray from world to local space
+		glm::mat4 normalMatrix;      // 64 bytes - transforms normals from local to world (transpose of inverse)
+		uint32_t triangleOffset;     // offset into combined triangle buffer
+		uint32_t triIndicesOffset;   // offset into combined indices buffer
+		uint32_t bvhNodeOffset;      // offset into combined BVH nodes buffer
+		uint32_t numTriangles;       // number of triangles in this BLAS
+	};
+
+	// Local-space ray tracing data of one high-poly mesh, referenced not copied
+	struct HighPolyMesh
+	{
+		const std::vector<Triangle>* triangles = nullptr;
+		const std::vector<uint32_t>* triangleIndices = nullptr;
+		const std::vector<BVH::Node>* bvhNodes = nullptr;
+		BVH::BBox worldBBox;
+		glm::mat4 worldMatrix = glm::mat4(1.0f);
+	};
+
+	// All high-poly meshes in single arrays, one BLAS instance each. Same layout as the GPU buffers of baker.hlsl.
+	struct CombinedHighPolyData
+	{
+		std::vector<Triangle> triangles;
+		std::vector<uint32_t> triIndices;
+		std::vector<BVH::Node> bvhNodes;
+		std::vector<BLASInstance> blasInstances;
+	};
+
+	CombinedHighPolyData combineHighPolys(const std::vector<HighPolyMesh>& meshes);
+} // namespace Baking
@@ -0,0 +1,147 @@
+#include "meshProcessing.hpp"
+
+#include <cfloat>
+#include <functional>
+#include <unordered_map>
+
+#include "utility/hash.hpp"
+
+using namespace Baking;
+
+void Baking::computeSmoothNormals(std::vector<Vertex>& vertices)
+{
+	// Map from position to accumulated normal
+	std::unordered_map<uint64_t, glm::vec3> positionToNormal;
+
+	auto hashPos = [](const glm::vec3& p) -> uint64_t {
+		// Quantize to avoid floating point issues. Fully mixed, so mirrored positions don't
+		// collide and cancel each other's normals out.
+		int x = static_cast<int>(p.x * 10000.0f);
+		int y = static_cast<int>(p.y * 10000.0f);
+		int z = static_cast<int>(p.z * 10000.0f);
+		return Hash::combine(Hash::combine(Hash::mix(static_cast<uint32_t>(x)), static_cast<uint32_t>(y)), static_cast<uint32_t>(z));
+		};
+
+	// Accumulate normals by position
+	for (const auto& v : vertices)
+	{
+		size_t key = hashPos(v.position);
+		positionToNormal[key] += v.normal;
+	}
+
+	// Normalize accumulated normals
+	for (auto& [key, normal] : positionToNormal)
+	{
+		normal = glm::normalize(normal);
+	}
+
+	// Assign smoothed normals back to vertices
+	for (auto& v : vertices)
+	{
+		size_t key = hashPos(v.position);
+		v.smoothNormal = positionToNormal[key];
+	}
+}
+
+void Baking::computeTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	computeTangents(vertices, indices.data(), indices.size());
+}
+
+void Baking::computeTangents(std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount)
+{
+	for (auto& v : vertices)
+	{
+		v.tangent = glm::vec3(0.0f);
+	}
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		uint32_t i0 = indices[i];
+		uint32_t i1 = indices[i + 1];
+		uint32_t i2 = indices[i + 2];
+
+		const glm::vec3& p0 = vertices[i0].position;
+		const glm::vec3& p1 = vertices[i1].position;
+		const glm::vec3& p2 = vertices[i2].position;
+
+		const glm::vec2& uv0 = vertices[i0].texCoords;
+		const glm::vec2& uv1 = vertices[i1].texCoords;
+		const glm::vec2& uv2 = vertices[i2].texCoords;
+
+		glm::vec3 edge1 = p1 - p0;
+		glm::vec3 edge2 = p2 - p0;
+		glm::vec2 deltaUV1 = uv1 - uv0;
+		glm::vec2 deltaUV2 = uv2 - uv0;
+
+		float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y + 1e-8f);
+
+		glm::vec3 tangent;
+		tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
+		tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
+		tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
+
+		vertices[i0].tangent += tangent;
+		vertices[i1].tangent += tangent;
+		vertices[i2].tangent += tangent;
+	}
+
+	// Normalize and orthogonalize
+	for (auto& v : vertices)
+	{
+		v.tangent = glm::normalize(v.tangent);
+		// Gram-Schmidt orthogonalize
+		v.tangent = glm::normalize(v.tangent - v.normal * glm::dot(v.normal, v.tangent));
+	}
+}
+
+void Baking::buildTriangles(const std::vector<Vertex>& vertices,
+	const std::vector<uint32_t>& indices,
+	std::vector<Triangle>& outTriangles,
+	std::vector<uint32_t>& outTriangleIndices)
+{
+	outTriangles.reserve(outTriangles.size() + indices.size() / 3);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		Triangle tri;
+		tri.v0 = vertices[indices[i]].position;
+		tri.v1 = vertices[indices[i + 1]].position;
+		tri.v2 = vertices[indices[i + 2]].position;
+		tri.n0 = vertices[indices[i]].normal;
+		tri.n1 = vertices[indices[i + 1]].normal;
+		tri.n2 = vertices[indices[i + 2]].normal;
+		outTriangles.push_back(tri);
+	}
+
+	for (uint32_t i = 0; i < outTriangles.size(); i++)
+	{
+		outTriangleIndices.push_back(i);
+	}
+}
+
+BVH::BBox Baking::transformBBox(const BVH::BBox& bbox, const glm::mat4& matrix)
+{
+	// Transform all 8 corners of the local AABB and compute new AABB
+	glm::vec3 corners[8] = {
+		{bbox.min.x, bbox.min.y, bbox.min.z},
+		{bbox.max.x, bbox.min.y, bbox.min.z},
+		{bbox.min.x, bbox.max.y, bbox.min.z},
+		{bbox.max.x, bbox.max.y, bbox.min.z},
+		{bbox.min.x, bbox.min.y, bbox.max.z},
+		{bbox.max.x, bbox.min.y, bbox.max.z},
+		{bbox.min.x, bbox.max.y, bbox.max.z},
+		{bbox.max.x, bbox.max.y, bbox.max.z},
+	};
+
+	BVH::BBox result;
+	result.min = glm::vec3(FLT_MAX);
+	result.max = glm::vec3(-FLT_MAX);
+
+	for (int c = 0; c < 8; c++)
+	{
+		glm::vec3 corner = glm::vec3(matrix * glm::vec4(corners[c], 1.0f));
+		result.min = glm::min(result.min, corner);
+		result.max = glm::max(result.max, corner);
+	}
+	return result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvhNode.hpp"
+#include "primitiveData.hpp"
+
+// CPU-side preparation of imported geometry for baking, shared by Primitive and the headless baker
+namespace Baking
+{
+	// Averages the normals of vertices sharing a position, baking casts rays along them to stay continuous over hard edges
+	void computeSmoothNormals(std::vector<Vertex>& vertices);
+
+	// Per-vertex tangents from UV derivatives, Gram-Schmidt orthogonalized against the normal
+	void computeTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	void computeTangents(std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount);
+
+	// Triangles for ray tracing and the identity triangle order the BVH builder reorders
+	void buildTriangles(const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& indices,
+		std::vector<Triangle>& outTriangles,
+		std::vector<uint32_t>& outTriangleIndices);
+
+	// Bounds of the 8 transformed corners
+	BVH::BBox transformBBox(const BVH::BBox& bbox, const glm::mat4& matrix);
+} // namespace Baking
@@ -0,0 +1,174 @@
+#include "mipGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "utility/parallelFor.hpp"
+#include "utility/simd.hpp"
+
+using namespace Baking;
+using Simd::Float4;
+
+namespace
+{
+	constexpr size_t k_rowsPerJob = 16;
+	constexpr float k_unormScale = 1.0f / 65535.0f;
+
+	// Normals are stored as vectors in [-1, 1], colours and the alpha of normal maps as [0, 1]
+	Float4 decode(const uint16_t* texel, MipFilter filter)
+	{
+		alignas(16) float values[4];
+		for (int channel = 0; channel < 4; channel++)
+		{
+			values[channel] = texel[channel] * k_unormScale;
+		}
+		if (filter == MipFilter::Normal)
+		{
+			for (int channel = 0; channel < 3; channel++)
+			{
+				values[channel] = values[channel] * 2.0f - 1.0f;
+			}
+		}
+		return Float4::load(values);
+	}
+
+	void encode(Float4 value, MipFilter filter, uint16_t* texel)
+	{
+		if (filter == MipFilter::Normal)
+		{
+			alignas(16) float values[4];
+			value.store(values);
+			const float lengthSquared = values[0] * values[0] + values[1] * values[1] + values[2] * values[2];
+			if (lengthSquared > 1e-12f)
+			{
+				const float scale = 0.5f / std::sqrt(lengthSquared);
+				for (int channel = 0; channel < 3; channel++)
+				{
+					values[channel] = values[channel] * scale + 0.5f;
+				}
+			}
+			else
+			{
+				// Normals that cancel out entirely fall back to the unperturbed normal
+				values[0] = values[1] = 0.5f;
+				values[2] = 1.0f;
+			}
+			value = Float4::load(values);
+		}
+		int32_t quantized[4];
+		Simd::toInt(Simd::roundPositive(Simd::clamp(value, 0.0f, 1.0f) * Float4(65535.0f)), quantized);
+		for (int channel = 0; channel < 4; channel++)
+		{
+			texel[channel] = static_cast<uint16_t>(quantized[channel]);
+		}
+	}
+
+	// Source rows or columns under one texel of the next level, weighted by how much of them it covers
+	struct Taps
+	{
+		uint32_t index[3] = {};
+		float weight[3] = {};
+		uint32_t count = 0;
+	};
+
+	// Even sizes take two halves. Odd sizes spread the row or column a plain halving would drop over three taps
+	// (the polyphase box), so every texel of the level above contributes with the same total weight.
+	std::vector<Taps> getTaps(uint32_t size, uint32_t nextSize)
+	{
+		std::vector<Taps> taps(nextSize);
+		const double scale = double(size) / nextSize;
+		for (uint32_t i = 0; i < nextSize; i++)
+		{
+			const double begin = i * scale;
+			const double end = begin + scale;
+			Taps& tap = taps[i];
+			for (uint32_t source = static_cast<uint32_t>(begin); source < size && source < end && tap.count < 3; source++)
+			{
+				const double coverage = std::min(end, source + 1.0) - std::max(begin, double(source));
+				if (coverage < 1e-6)
+					continue;
+				tap.index[tap.count] = source;
+				tap.weight[tap.count] = static_cast<float>(coverage / scale);
+				tap.count++;
+			}
+		}
+		return taps;
+	}
+
+	std::vector<float> downsample(const std::vector<float>& level, uint32_t width, uint32_t height, uint32_t maxThreads)
+	{
+		const uint32_t nextWidth = std::max(1u, width / 2);
+		const uint32_t nextHeight = std::max(1u, height / 2);
+		const std::vector<Taps> columns = getTaps(width, nextWidth);
+		const std::vector<Taps> rows = getTaps(height, nextHeight);
+		std::vector<float> next(size_t(nextWidth) * nextHeight * 4);
+		Parallel::parallelForChunks(nextHeight, k_rowsPerJob, [&](size_t begin, size_t end)
+			{
+				for (size_t y = begin; y < end; y++)
+				{
+					const Taps& row = rows[y];
+					for (uint32_t x = 0; x < nextWidth; x++)
+					{
+						const Taps& column = columns[x];
+						Float4 sum;
+						for (uint32_t rowTap = 0; rowTap < row.count; rowTap++)
+						{
+							const float* source = level.data() + size_t(row.index[rowTap]) * width * 4;
+							Float4 rowSum;
+							for (uint32_t columnTap = 0; columnTap < column.count; columnTap++)
+							{
+								rowSum += Float4::load(source + size_t(column.index[columnTap]) * 4) * Float4(column.weight[columnTap]);
+							}
+							sum += rowSum * Float4(row.weight[rowTap]);
+						}
+						sum.store(next.data() + (y * nextWidth + x) * 4);
+					}
+				}
+			}, maxThreads);
+		return next;
+	}
+}
+
+std::vector<MipLevel> Baking::generateMips(const uint16_t* pixels, uint32_t width, uint32_t height, size_t rowPitch,
+	const MipSettings& settings)
+{
+	std::vector<MipLevel> levels;
+	if (!pixels || width == 0 || height == 0 || (width == 1 && height == 1))
+		return levels;
+
+	const size_t pitch = rowPitch != 0 ? rowPitch : size_t(width) * 4 * sizeof(uint16_t);
+	std::vector<float> level(size_t(width) * height * 4);
+	Parallel::parallelForChunks(height, k_rowsPerJob, [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; y++)
+			{
+				const uint16_t* row = reinterpret_cast<const uint16_t*>(reinterpret_cast<const uint8_t*>(pixels) + y * pitch);
+				for (uint32_t x = 0; x < width; x++)
+				{
+					decode(row + x * 4, settings.filter).store(level.data() + (y * width + x) * 4);
+				}
+			}
+		}, settings.maxThreads);
+
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	while (levelWidth > 1 || levelHeight > 1)
+	{
+		level = downsample(level, levelWidth, levelHeight, settings.maxThreads);
+		levelWidth = std::max(1u, levelWidth / 2);
+		levelHeight = std::max(1u, levelHeight / 2);
+
+		MipLevel& mip = levels.emplace_back();
+		mip.width = levelWidth;
+		mip.height = levelHeight;
+		mip.pixels.resize(size_t(levelWidth) * levelHeight * 4);
+		Parallel::parallelForChunks(size_t(levelWidth) * levelHeight, k_rowsPerJob * levelWidth, [&](size_t begin, size_t end)
+			{
+				for (size_t texel = begin; texel < end; texel++)
+				{
+					encode(Float4::load(level.data() + texel * 4), settings.filter, mip.pixels.data() + texel * 4);
+				}
+			}, settings.maxThreads);
+	}
+	return levels;
+}
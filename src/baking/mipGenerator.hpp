@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Baking
+{
+	enum class MipFilter
+	{
+		Color,  // box filter of every channel
+		Normal  // tangent-space normals in RGB: averaged as vectors and renormalized, alpha box filtered
+	};
+
+	struct MipLevel
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint16_t> pixels; // RGBA16, tightly packed
+	};
+
+	struct MipSettings
+	{
+		MipFilter filter = MipFilter::Color;
+		uint32_t maxThreads = 0; // 0 uses every core
+	};
+
+	// Levels below an RGBA16 image, halving down to 1x1. Every level is filtered in float from the unnormalized
+	// level above, so a normal mip averages all source normals under it before it is renormalized instead of
+	// compounding the quantization and renormalization of every level. Rows of a level are split across threads
+	// and a texel's four channels are filtered in one SIMD register.
+	std::vector<MipLevel> generateMips(const uint16_t* pixels, uint32_t width, uint32_t height, size_t rowPitch = 0,
+		const MipSettings& settings = {});
+} // namespace Baking
@@ -0,0 +1,347 @@
+#include "normalTracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr uint32_t k_maxStackSize = 64; // MAX_STACK_SIZE in baker.hlsl
+	// Texels per traversal/shading batch, small enough for the rays, hits and frames to stay in L1
+	constexpr uint32_t k_batchSize = 256;
+
+	float ditherHash(uint32_t x, uint32_t y)
+	{
+		uint32_t h = x * 1597334673u ^ y * 3812015801u;
+		h = h * 1103515245u + 12345u;
+		return static_cast<float>(h) / 4294967295.0f;
+	}
+
+	// Triangular dither noise, ditherNoise in baker.hlsl
+	glm::vec3 ditherNoise(uint32_t x, uint32_t y)
+	{
+		glm::vec3 noise;
+		noise.x = ditherHash(x, y) + ditherHash(x + 1234, y + 5678) - 1.0f;
+		noise.y = ditherHash(x + 4321, y + 8765) + ditherHash(x + 9999, y + 1111) - 1.0f;
+		noise.z = ditherHash(x + 2468, y + 1357) + ditherHash(x + 7531, y + 8642) - 1.0f;
+		return noise;
+	}
+
+	// Slab test, returns tNear on a hit closer than tMax, otherwise a large value
+	template <typename RayT>
+	float intersectBox(const RayT& ray, const BVH::BBox& box, float tMax)
+	{
+		const glm::vec3 t0 = (box.min - ray.origin) * ray.invDir;
+		const glm::vec3 t1 = (box.max - ray.origin) * ray.invDir;
+
+		const glm::vec3 tmin = glm::min(t0, t1);
+		const glm::vec3 tmax = glm::max(t0, t1);
+
+		const float tNear = std::max(std::max(tmin.x, tmin.y), tmin.z);
+		const float tFar = std::min(std::min(tmax.x, tmax.y), tmax.z);
+
+		return (tNear <= tFar && tFar >= 0.0f && tNear < tMax) ? tNear : 1e30f;
+	}
+
+	// Möller–Trumbore intersection, outputs barycentric coords for normal interpolation
+	template <typename RayT>
+	bool intersectTri(const RayT& ray, const Triangle& tri, float& t, glm::vec2& baryOut)
+	{
+		const glm::vec3 edge1 = tri.v1 - tri.v0;
+		const glm::vec3 edge2 = tri.v2 - tri.v0;
+		const glm::vec3 pvec = glm::cross(ray.dir, edge2);
+		const float det = glm::dot(edge1, pvec);
+
+		if (std::abs(det) < 1e-8f) // small epsilon for near-parallel rays
+			return false;
+
+		const float invDet = 1.0f / det;
+		const glm::vec3 tvec = ray.origin - tri.v0;
+
+		const float u = glm::dot(tvec, pvec) * invDet;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		const glm::vec3 qvec = glm::cross(tvec, edge1);
+		const float v = glm::dot(ray.dir, qvec) * invDet;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		const float hitT = glm::dot(edge2, qvec) * invDet;
+		if (hitT > 0.0001f && hitT < t)
+		{
+			t = hitT;
+			baryOut = glm::vec2(u, v);
+			return true;
+		}
+		return false;
+	}
+
+	uint16_t toUNorm16(float value)
+	{
+		return static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+}
+
+size_t Baking::getTexelSize(TexelFormat format)
+{
+	return format == TexelFormat::RGBA32F ? 4 * sizeof(float) : 4 * sizeof(uint16_t);
+}
+
+void Baking::storeTexel(uint8_t* pixels, size_t rowPitch, uint32_t x, uint32_t y, const float* values, TexelFormat format)
+{
+	uint8_t* texel = pixels + y * rowPitch + x * getTexelSize(format);
+	if (format == TexelFormat::RGBA32F)
+	{
+		std::memcpy(texel, values, 4 * sizeof(float));
+		return;
+	}
+	const uint16_t quantized[4] = { toUNorm16(values[0]), toUNorm16(values[1]), toUNorm16(values[2]), toUNorm16(values[3]) };
+	std::memcpy(texel, quantized, sizeof(quantized));
+}
+
+NormalTracer::NormalTracer(const CombinedHighPolyData& highPoly)
+	: m_highPoly(highPoly)
+{
+	m_localToWorld.reserve(highPoly.blasInstances.size());
+	for (const BLASInstance& inst : highPoly.blasInstances)
+	{
+		// normalMatrix is the inverse world matrix in glm's column convention
+		m_localToWorld.push_back(glm::inverse(inst.normalMatrix));
+		const glm::mat3 worldToLocal(inst.normalMatrix);
+		m_maxLocalScale = std::max(m_maxLocalScale, std::sqrt(glm::dot(worldToLocal[0], worldToLocal[0])
+			+ glm::dot(worldToLocal[1], worldToLocal[1]) + glm::dot(worldToLocal[2], worldToLocal[2])));
+	}
+}
+
+void NormalTracer::trace(const UVRasterResult& texels, const NormalTraceSettings& settings, uint8_t* pixels, size_t rowPitch,
+	TexelFormat format) const
+{
+	Parallel::parallelFor(texels.tiles.size(), [&](size_t tileIndex)
+		{
+			const TexelTileRange& range = texels.tiles[tileIndex];
+			float shaded[k_batchSize * 4];
+			for (uint32_t begin = 0; begin < range.texelCount; begin += k_batchSize)
+			{
+				const TexelRecord* batch = texels.texels.data() + range.texelOffset + begin;
+				const size_t count = std::min<size_t>(k_batchSize, range.texelCount - begin);
+				traceBatch(batch, count, settings, shaded);
+				for (size_t i = 0; i < count; i++)
+				{
+					storeTexel(pixels, rowPitch, batch[i].getX(), batch[i].getY(), shaded + i * 4, format);
+				}
+			}
+		});
+}
+
+void NormalTracer::traceTexels(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, uint16_t* outTexels, uint32_t maxThreads) const
+{
+	Parallel::parallelForChunks(count, k_batchSize, [&](size_t begin, size_t end)
+		{
+			float shaded[k_batchSize * 4];
+			traceBatch(texels + begin, end - begin, settings, shaded);
+			for (size_t i = 0; i < (end - begin) * 4; i++)
+			{
+				outTexels[begin * 4 + i] = toUNorm16(shaded[i]);
+			}
+		}, maxThreads);
+}
+
+void NormalTracer::findSurfaces(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, SurfaceHit* outHits) const
+{
+	TangentFrame frames[k_batchSize];
+	Hit hits[k_batchSize];
+	for (size_t begin = 0; begin < count; begin += k_batchSize)
+	{
+		const size_t batchCount = std::min<size_t>(k_batchSize, count - begin);
+		traverseBatch(texels + begin, batchCount, settings, frames, hits);
+		for (size_t i = 0; i < batchCount; i++)
+		{
+			SurfaceHit& surface = outHits[begin + i];
+			surface.normal = getWorldNormal(hits[i]);
+			surface.position = hits[i].instance == k_noHit ? texels[begin + i].position : getWorldPosition(hits[i]);
+			surface.distance = glm::length(surface.position - texels[begin + i].position);
+		}
+	}
+}
+
+bool NormalTracer::intersect(const glm::vec3& origin, const glm::vec3& dir, float maxDistance, SurfaceHit& outHit) const
+{
+	Ray ray;
+	ray.origin = origin;
+	ray.dir = dir;
+	ray.invDir = 1.0f / dir;
+
+	// Hit distances are compared in the local space of each instance, so the cutoff has to cover the most
+	// scaled one and the world-space distance is checked once the closest hit is known
+	Hit hit;
+	hit.t = maxDistance * m_maxLocalScale;
+	hit.instance = k_noHit;
+	traverseTLAS(ray, hit);
+	if (hit.instance == k_noHit)
+		return false;
+
+	outHit.position = getWorldPosition(hit);
+	outHit.distance = glm::length(outHit.position - origin);
+	if (outHit.distance > maxDistance)
+		return false;
+	outHit.normal = getWorldNormal(hit);
+	return true;
+}
+
+void NormalTracer::traceBatch(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, float* outTexels) const
+{
+	TangentFrame frames[k_batchSize];
+	Hit hits[k_batchSize];
+	traverseBatch(texels, count, settings, frames, hits);
+
+	// Shading, once per texel from the closest hit
+	for (size_t i = 0; i < count; i++)
+	{
+		const TangentFrame& frame = frames[i];
+		const glm::vec3 bestN = getWorldNormal(hits[i]);
+
+		// transforms bestN from world space to tangent space, remapped to [0,1]
+		glm::vec3 tangentSpaceNormal(glm::dot(bestN, frame.T), glm::dot(bestN, frame.B), glm::dot(bestN, frame.N));
+		tangentSpaceNormal = tangentSpaceNormal * 0.5f + 0.5f;
+		if (bestN == glm::vec3(0.0f))
+		{
+			tangentSpaceNormal = glm::vec3(0.5f, 0.5f, 1.0f); // default normal if no intersection
+		}
+
+		float* outTexel = outTexels + i * 4;
+		outTexel[0] = tangentSpaceNormal.x;
+		outTexel[1] = tangentSpaceNormal.y;
+		outTexel[2] = tangentSpaceNormal.z;
+		outTexel[3] = 1.0f;
+	}
+}
+
+void NormalTracer::traverseBatch(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, TangentFrame* frames, Hit* hits) const
+{
+	// Traversal, every ray only keeps its closest hit
+	for (size_t i = 0; i < count; i++)
+	{
+		const TexelRecord& record = texels[i];
+		const glm::vec3 blendedNormal = glm::normalize(glm::mix(record.smoothedNormal, record.normal, settings.rayDirectionBlend));
+
+		TangentFrame& frame = frames[i];
+		frame.N = glm::normalize(record.normal);
+		frame.T = glm::normalize(record.tangent);
+		frame.T = glm::normalize(frame.T - frame.N * glm::dot(frame.N, frame.T));
+		frame.B = glm::cross(frame.N, frame.T);
+
+		// Jitter ray origin in tangent plane (within ~half a texel)
+		const glm::vec3 jitter = ditherNoise(record.getX(), record.getY());
+		const float jitterScale = 0.002f;
+		const glm::vec3 originJitter = (jitter.x * frame.T + jitter.y * frame.B) * jitterScale;
+
+		Ray ray;
+		ray.origin = record.position + originJitter;
+		ray.dir = settings.useSmoothedNormals ? -blendedNormal : -frame.N;
+		ray.origin -= ray.dir * (settings.usePerTexelCage ? record.cageOffset : settings.cageOffset); // offset ray origin back by cage distance
+		ray.invDir = 1.0f / ray.dir;
+
+		hits[i].t = 1e20f;
+		hits[i].instance = k_noHit;
+		traverseTLAS(ray, hits[i]);
+	}
+}
+
+glm::vec3 NormalTracer::getWorldNormal(const Hit& hit) const
+{
+	if (hit.instance == k_noHit)
+		return glm::vec3(0.0f);
+
+	const Triangle& tri = m_highPoly.triangles[hit.triangle];
+	const BLASInstance& inst = m_highPoly.blasInstances[hit.instance];
+	const glm::vec2 bary = hit.barycentrics;
+	const glm::vec3 localN = glm::normalize((1.0f - bary.x - bary.y) * tri.n0 + bary.x * tri.n1 + bary.y * tri.n2);
+	return glm::normalize(glm::vec3(glm::vec4(localN, 0.0f) * inst.normalMatrix));
+}
+
+glm::vec3 NormalTracer::getWorldPosition(const Hit& hit) const
+{
+	const Triangle& tri = m_highPoly.triangles[hit.triangle];
+	const glm::vec2 bary = hit.barycentrics;
+	const glm::vec3 localP = (1.0f - bary.x - bary.y) * tri.v0 + bary.x * tri.v1 + bary.y * tri.v2;
+	return glm::vec3(m_localToWorld[hit.instance] * glm::vec4(localP, 1.0f));
+}
+
+void NormalTracer::traverseTLAS(const Ray& ray, Hit& hit) const
+{
+	for (uint32_t i = 0; i < m_highPoly.blasInstances.size(); i++)
+	{
+		// First test instance's world bounding box
+		if (intersectBox(ray, m_highPoly.blasInstances[i].worldBBox, hit.t) >= hit.t)
+			continue;
+
+		traverseBLAS(ray, i, hit);
+	}
+}
+
+void NormalTracer::traverseBLAS(const Ray& worldRay, uint32_t instanceIndex, Hit& hit) const
+{
+	const BLASInstance& inst = m_highPoly.blasInstances[instanceIndex];
+
+	// Row-vector products mirror mul(v, M) in HLSL with the same transposed matrices
+	Ray localRay;
+	localRay.origin = glm::vec3(glm::vec4(worldRay.origin, 1.0f) * inst.worldMatrixInv);
+	localRay.dir = glm::normalize(glm::vec3(glm::vec4(worldRay.dir, 0.0f) * inst.worldMatrixInv));
+	localRay.invDir = 1.0f / localRay.dir;
+
+	const BVH::Node* nodes = m_highPoly.bvhNodes.data() + inst.bvhNodeOffset;
+	const uint32_t* triIndices = m_highPoly.triIndices.data() + inst.triIndicesOffset;
+	const Triangle* tris = m_highPoly.triangles.data() + inst.triangleOffset;
+
+	uint32_t stack[k_maxStackSize];
+	uint32_t stackPtr = 0;
+	stack[stackPtr++] = 0; // push root node
+
+	while (stackPtr > 0)
+	{
+		const BVH::Node& node = nodes[stack[--stackPtr]];
+
+		// early cull with current best t (using local-space ray)
+		if (intersectBox(localRay, node.bbox, hit.t) >= hit.t)
+			continue;
+
+		if (node.numTris > 0) // leaf node
+		{
+			for (uint32_t i = 0; i < node.numTris; i++)
+			{
+				const uint32_t triangle = triIndices[node.firstTriIndex + i];
+				if (intersectTri(localRay, tris[triangle], hit.t, hit.barycentrics))
+				{
+					hit.instance = instanceIndex;
+					hit.triangle = inst.triangleOffset + triangle;
+				}
+			}
+		}
+		else
+		{
+			const uint32_t leftLocal = node.leftChild;
+			const uint32_t rightLocal = leftLocal + 1;
+			const float tLeft = intersectBox(localRay, nodes[leftLocal].bbox, hit.t);
+			const float tRight = intersectBox(localRay, nodes[rightLocal].bbox, hit.t);
+
+			// Push in far-to-near order so we pop near first
+			if (stackPtr + 2 > k_maxStackSize)
+				continue; // the GPU would overflow here as well, the BVH builder keeps trees far shallower
+			if (tLeft < tRight)
+			{
+				if (tRight < hit.t) stack[stackPtr++] = rightLocal;
+				if (tLeft < hit.t) stack[stackPtr++] = leftLocal;
+			}
+			else
+			{
+				if (tLeft < hit.t) stack[stackPtr++] = leftLocal;
+				if (tRight < hit.t) stack[stackPtr++] = rightLocal;
+			}
+		}
+	}
+}
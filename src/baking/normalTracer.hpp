@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "highPoly.hpp"
+#include "uvRasterizer.hpp"
+
+namespace Baking
+{
+	// Pixel layout the CPU tracers write
+	enum class TexelFormat
+	{
+		RGBA16, // R16G16B16A16_UNORM
+		RGBA32F // R32G32B32A32_FLOAT, unquantized for float outputs
+	};
+
+	size_t getTexelSize(TexelFormat format);
+	// Stores four values in [0, 1] as the texel at x, y
+	void storeTexel(uint8_t* pixels, size_t rowPitch, uint32_t x, uint32_t y, const float* values, TexelFormat format);
+
+	struct NormalTraceSettings
+	{
+		float cageOffset = 0.1f;
+		bool useSmoothedNormals = false;
+		float rayDirectionBlend = 0.0f; // 0 = smoothed normal, 1 = face normal, the GUI paints this per texel
+		bool usePerTexelCage = false;   // start rays at TexelRecord::cageOffset instead of cageOffset
+	};
+
+	// High-poly surface point hit by a ray, for maps shaded from the hit instead of from the low-poly
+	struct SurfaceHit
+	{
+		glm::vec3 position = glm::vec3(0.0f); // world space
+		glm::vec3 normal = glm::vec3(0.0f);   // interpolated vertex normal, world space, zero if the ray missed
+		float distance = 0.0f;                // world-space distance from the ray origin
+	};
+
+	// CPU port of CSBakeNormal in baker.hlsl for machines without a D3D11 device.
+	// Same two-level traversal, intersection tests and dither, so maps match the GPU bake up to float rounding.
+	// Texels are traced in small batches in two passes: traversal only records the closest hit of every ray,
+	// shading then interpolates and encodes one normal per texel instead of one per accepted hit.
+	class NormalTracer
+	{
+	public:
+		explicit NormalTracer(const CombinedHighPolyData& highPoly);
+
+		// Traces every rasterized texel and writes tangent-space normals with alpha = 1.
+		// Texels not in the raster result are left untouched, the caller clears them to flat normal with alpha = 0.
+		void trace(const UVRasterResult& texels, const NormalTraceSettings& settings, uint8_t* pixels, size_t rowPitch,
+			TexelFormat format = TexelFormat::RGBA16) const;
+		// Traces a run of texel records into tightly packed RGBA16 texels, one per record, for distributed baking
+		void traceTexels(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, uint16_t* outTexels, uint32_t maxThreads = 0) const;
+		// Same rays as trace, one hit per record instead of an encoded normal. Runs on the calling thread.
+		void findSurfaces(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, SurfaceHit* outHits) const;
+		// Closest hit of a world-space ray within maxDistance, false if there is none
+		bool intersect(const glm::vec3& origin, const glm::vec3& dir, float maxDistance, SurfaceHit& outHit) const;
+
+	private:
+		struct Ray
+		{
+			glm::vec3 origin;
+			glm::vec3 dir;
+			glm::vec3 invDir;
+		};
+
+		struct TangentFrame
+		{
+			glm::vec3 T;
+			glm::vec3 B;
+			glm::vec3 N;
+		};
+
+		// Closest hit found so far, barycentrics are relative to v1 and v2 of the triangle
+		struct Hit
+		{
+			float t;
+			uint32_t instance; // k_noHit while the ray missed everything
+			uint32_t triangle; // index into the combined triangle array
+			glm::vec2 barycentrics;
+		};
+
+		static constexpr uint32_t k_noHit = UINT32_MAX;
+
+		// At most k_batchSize texels, written as tightly packed float RGBA in [0, 1]
+		void traceBatch(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, float* outTexels) const;
+		void traverseBatch(const TexelRecord* texels, size_t count, const NormalTraceSettings& settings, TangentFrame* frames, Hit* hits) const;
+		void traverseTLAS(const Ray& ray, Hit& hit) const;
+		void traverseBLAS(const Ray& worldRay, uint32_t instanceIndex, Hit& hit) const;
+		glm::vec3 getWorldNormal(const Hit& hit) const;
+		glm::vec3 getWorldPosition(const Hit& hit) const;
+
+		const CombinedHighPolyData& m_highPoly;
+		std::vector<glm::mat4> m_localToWorld; // per instance, only needed for hit positions
+		float m_maxLocalScale = 1.0f;          // bounds local ray lengths per world unit over all instances
+	};
+} // namespace Baking
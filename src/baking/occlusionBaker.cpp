@@ -0,0 +1,197 @@
+#include "occlusionBaker.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "sdfVolume.hpp"
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr uint32_t k_batchSize = 256;
+	constexpr uint32_t k_coneSteps = 8;
+	// Secondary rays start this fraction of maxDistance off the surface to not hit their own triangle
+	constexpr float k_rayBias = 1e-3f;
+
+	uint32_t hashTexel(uint32_t x, uint32_t y)
+	{
+		uint32_t h = x * 1597334673u ^ y * 3812015801u;
+		h ^= h >> 16;
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		h *= 0x846ca68bu;
+		h ^= h >> 16;
+		return h;
+	}
+
+	float toUnitFloat(uint32_t bits)
+	{
+		return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float radicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return toUnitFloat(bits);
+	}
+
+	// Cosine-distributed directions around normal from a Hammersley set, rotated per texel so neighbouring
+	// texels trade banding for noise. Same texel, same directions, so bakes are reproducible.
+	class HemisphereSampler
+	{
+	public:
+		HemisphereSampler(const glm::vec3& normal, uint32_t sampleCount, uint32_t seed)
+			: m_normal(normal)
+			, m_sampleCount(sampleCount)
+			, m_rotation(toUnitFloat(seed), toUnitFloat(seed * 747796405u + 2891336453u))
+		{
+			// Duff et al., Building an Orthonormal Basis, Revisited
+			const float sign = std::copysign(1.0f, normal.z);
+			const float a = -1.0f / (sign + normal.z);
+			const float b = normal.x * normal.y * a;
+			m_tangent = glm::vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+			m_bitangent = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
+		}
+
+		glm::vec3 getDirection(uint32_t index) const
+		{
+			const float u = std::fmod((index + 0.5f) / m_sampleCount + m_rotation.x, 1.0f);
+			const float v = std::fmod(radicalInverse(index) + m_rotation.y, 1.0f);
+			const float r = std::sqrt(u);
+			const float phi = 6.28318530718f * v;
+			return glm::normalize(m_tangent * (r * std::cos(phi)) + m_bitangent * (r * std::sin(phi)) + m_normal * std::sqrt(std::max(0.0f, 1.0f - u)));
+		}
+
+	private:
+		glm::vec3 m_normal;
+		glm::vec3 m_tangent;
+		glm::vec3 m_bitangent;
+		uint32_t m_sampleCount;
+		glm::vec2 m_rotation;
+	};
+
+	float traceAmbientOcclusion(const NormalTracer& tracer, const OcclusionSettings& settings, const glm::vec3& position, const HemisphereSampler& sampler)
+	{
+		uint32_t unblocked = 0;
+		SurfaceHit hit;
+		for (uint32_t i = 0; i < settings.sampleCount; i++)
+		{
+			const glm::vec3 dir = sampler.getDirection(i);
+			if (!tracer.intersect(position + dir * (settings.maxDistance * k_rayBias), dir, settings.maxDistance, hit))
+				unblocked++;
+		}
+		return static_cast<float>(unblocked) / settings.sampleCount;
+	}
+
+	float traceThickness(const NormalTracer& tracer, const OcclusionSettings& settings, const glm::vec3& position, const HemisphereSampler& inwardSampler)
+	{
+		float distance = 0.0f;
+		SurfaceHit hit;
+		for (uint32_t i = 0; i < settings.sampleCount; i++)
+		{
+			const glm::vec3 dir = inwardSampler.getDirection(i);
+			distance += tracer.intersect(position + dir * (settings.maxDistance * k_rayBias), dir, settings.maxDistance, hit) ? hit.distance : settings.maxDistance;
+		}
+		return distance / (settings.sampleCount * settings.maxDistance);
+	}
+
+	// Cone tracing: a cone stays open as long as the distance to the nearest surface keeps up with its radius.
+	// Steps grow geometrically from two voxels, clamped band values mean nothing is near and are skipped.
+	float coneTraceAmbientOcclusion(const SparseSDF& sdf, const OcclusionSettings& settings, const glm::vec3& position, const glm::vec3& normal, const HemisphereSampler& sampler)
+	{
+		// Cones start a voxel above the surface, otherwise grazing ones are closed by the interpolated surface itself
+		const glm::vec3 origin = position + normal * sdf.getVoxelSize();
+		const float coneTan = std::clamp(2.0f / std::sqrt(static_cast<float>(settings.sampleCount)), 0.15f, 1.0f);
+		const float start = std::min(2.0f * sdf.getVoxelSize(), settings.maxDistance);
+		const float growth = std::pow(settings.maxDistance / start, 1.0f / (k_coneSteps - 1));
+		const float bandLimit = sdf.getBandWidth() * 0.999f;
+
+		float visibility = 0.0f;
+		for (uint32_t i = 0; i < settings.sampleCount; i++)
+		{
+			const glm::vec3 dir = sampler.getDirection(i);
+			float coneVisibility = 1.0f;
+			float t = start;
+			for (uint32_t step = 0; step < k_coneSteps && coneVisibility > 0.0f; step++, t *= growth)
+			{
+				const float distance = sdf.sample(origin + dir * t);
+				if (distance < bandLimit)
+				{
+					coneVisibility = std::min(coneVisibility, std::clamp(distance / (t * coneTan), 0.0f, 1.0f));
+				}
+			}
+			visibility += coneVisibility;
+		}
+		return visibility / settings.sampleCount;
+	}
+
+	// Sphere traces through the inside until the field turns positive, inside bricks without samples step a whole band
+	float sphereTraceThickness(const SparseSDF& sdf, const OcclusionSettings& settings, const glm::vec3& position, const HemisphereSampler& inwardSampler)
+	{
+		const float minStep = 0.5f * sdf.getVoxelSize();
+		float distance = 0.0f;
+		for (uint32_t i = 0; i < settings.sampleCount; i++)
+		{
+			const glm::vec3 dir = inwardSampler.getDirection(i);
+			float t = sdf.getVoxelSize();
+			while (t < settings.maxDistance)
+			{
+				const float d = sdf.sample(position + dir * t);
+				if (d >= 0.0f)
+					break;
+				t += std::max(-d, minStep);
+			}
+			distance += std::min(t, settings.maxDistance);
+		}
+		return distance / (settings.sampleCount * settings.maxDistance);
+	}
+}
+
+void Baking::bakeOcclusion(const NormalTracer& tracer,
+	const NormalTraceSettings& traceSettings,
+	const OcclusionSettings& settings,
+	const UVRasterResult& texels,
+	uint8_t* pixels,
+	size_t rowPitch,
+	TexelFormat format)
+{
+	const bool isThickness = settings.map == OcclusionMap::Thickness;
+	Parallel::parallelFor(texels.tiles.size(), [&](size_t tileIndex)
+		{
+			const TexelTileRange& range = texels.tiles[tileIndex];
+			SurfaceHit surfaces[k_batchSize];
+			for (uint32_t begin = 0; begin < range.texelCount; begin += k_batchSize)
+			{
+				const TexelRecord* batch = texels.texels.data() + range.texelOffset + begin;
+				const size_t count = std::min<size_t>(k_batchSize, range.texelCount - begin);
+				tracer.findSurfaces(batch, count, traceSettings, surfaces);
+				for (size_t i = 0; i < count; i++)
+				{
+					// Texels whose ray missed the high-poly are shaded from the low-poly instead
+					const glm::vec3 normal = surfaces[i].normal != glm::vec3(0.0f) ? surfaces[i].normal : glm::normalize(batch[i].normal);
+					const HemisphereSampler sampler(isThickness ? -normal : normal, settings.sampleCount, hashTexel(batch[i].getX(), batch[i].getY()));
+
+					float value = 0.0f;
+					if (settings.sdf)
+					{
+						value = isThickness ? sphereTraceThickness(*settings.sdf, settings, surfaces[i].position, sampler)
+							: coneTraceAmbientOcclusion(*settings.sdf, settings, surfaces[i].position, normal, sampler);
+					}
+					else
+					{
+						value = isThickness ? traceThickness(tracer, settings, surfaces[i].position, sampler)
+							: traceAmbientOcclusion(tracer, settings, surfaces[i].position, sampler);
+					}
+
+					const float gray[4] = { value, value, value, 1.0f };
+					storeTexel(pixels, rowPitch, batch[i].getX(), batch[i].getY(), gray, format);
+				}
+			}
+		});
+}
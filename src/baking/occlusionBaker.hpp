@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "normalTracer.hpp"
+#include "uvRasterizer.hpp"
+
+namespace Baking
+{
+	class SparseSDF;
+
+	enum class OcclusionMap
+	{
+		AmbientOcclusion, // 1 = nothing within maxDistance above the surface
+		Thickness         // 1 = at least maxDistance of material below the surface
+	};
+
+	struct OcclusionSettings
+	{
+		OcclusionMap map = OcclusionMap::AmbientOcclusion;
+		uint32_t sampleCount = 64;      // rays per texel, cone directions with an SDF
+		float maxDistance = 1.0f;       // world units
+		const SparseSDF* sdf = nullptr; // approximate with cones through the distance field instead of tracing rays
+	};
+
+	// Shades every rasterized texel from the high-poly point its normal ray hits, with the rays of traceSettings.
+	// Exact mode traces cosine-distributed rays against the BVH: AO is the fraction leaving the hemisphere above the hit
+	// unblocked within maxDistance, thickness the mean distance rays into the surface travel before they leave it.
+	// With an SDF the same directions are cone traced in a few lookups each, so maps come out smoother and much faster.
+	// Writes grayscale with alpha = 1, like NormalTracer::trace.
+	void bakeOcclusion(const NormalTracer& tracer,
+		const NormalTraceSettings& traceSettings,
+		const OcclusionSettings& settings,
+		const UVRasterResult& texels,
+		uint8_t* pixels,
+		size_t rowPitch,
+		TexelFormat format = TexelFormat::RGBA16);
+} // namespace Baking
@@ -0,0 +1,201 @@
+#include "pngWriter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr uint8_t k_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	constexpr size_t k_idatSize = 1 << 20; // IDAT chunks are CRCed in parallel
+	constexpr size_t k_filterRowsPerJob = 16;
+
+	enum Filter : uint8_t
+	{
+		k_filterNone,
+		k_filterSub,
+		k_filterUp,
+		k_filterAverage,
+		k_filterPaeth,
+		k_filterCount
+	};
+
+	void appendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+		{
+			out.push_back(static_cast<uint8_t>(value >> shift));
+		}
+	}
+
+	void appendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size, uint32_t crc)
+	{
+		appendBigEndian(out, static_cast<uint32_t>(size));
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + size);
+		appendBigEndian(out, crc);
+	}
+
+	uint32_t getChunkCRC(const char* type, const uint8_t* data, size_t size)
+	{
+		return crc32(data, size, crc32(reinterpret_cast<const uint8_t*>(type), 4));
+	}
+
+	uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+	{
+		const int p = int(a) + int(b) - int(c);
+		const int pa = std::abs(p - int(a));
+		const int pb = std::abs(p - int(b));
+		const int pc = std::abs(p - int(c));
+		if (pa <= pb && pa <= pc)
+			return a;
+		return pb <= pc ? b : c;
+	}
+
+	// Row in PNG sample order: 16-bit samples are big-endian
+	void copyRow(const PNGImage& image, size_t rowPitch, uint32_t y, uint8_t* out, size_t rowBytes)
+	{
+		const uint8_t* row = static_cast<const uint8_t*>(image.pixels) + y * rowPitch;
+		if (image.bitDepth == 8)
+		{
+			std::memcpy(out, row, rowBytes);
+			return;
+		}
+		for (size_t i = 0; i < rowBytes; i += 2)
+		{
+			uint16_t sample;
+			std::memcpy(&sample, row + i, sizeof(sample));
+			out[i] = static_cast<uint8_t>(sample >> 8);
+			out[i + 1] = static_cast<uint8_t>(sample);
+		}
+	}
+
+	// Every filter is tried and the one with the smallest sum of absolute signed bytes is kept, libpng's heuristic
+	void filterRow(const uint8_t* row, const uint8_t* previous, size_t rowBytes, size_t bytesPerPixel, bool tryAllFilters,
+		uint8_t* scratch, uint8_t* out)
+	{
+		if (!tryAllFilters)
+		{
+			out[0] = k_filterNone;
+			std::memcpy(out + 1, row, rowBytes);
+			return;
+		}
+
+		uint64_t bestCost = UINT64_MAX;
+		uint8_t bestFilter = k_filterNone;
+		for (uint8_t filter = k_filterNone; filter < k_filterCount; filter++)
+		{
+			uint8_t* filtered = scratch + filter * rowBytes;
+			uint64_t cost = 0;
+			for (size_t i = 0; i < rowBytes; i++)
+			{
+				const uint8_t left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+				const uint8_t up = previous ? previous[i] : 0;
+				const uint8_t upLeft = previous && i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+				uint8_t predictor = 0;
+				switch (filter)
+				{
+				case k_filterSub: predictor = left; break;
+				case k_filterUp: predictor = up; break;
+				case k_filterAverage: predictor = static_cast<uint8_t>((int(left) + int(up)) / 2); break;
+				case k_filterPaeth: predictor = paeth(left, up, upLeft); break;
+				default: break;
+				}
+				filtered[i] = static_cast<uint8_t>(row[i] - predictor);
+				cost += std::abs(static_cast<int8_t>(filtered[i]));
+			}
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestFilter = filter;
+			}
+		}
+		out[0] = bestFilter;
+		std::memcpy(out + 1, scratch + bestFilter * rowBytes, rowBytes);
+	}
+}
+
+std::vector<uint8_t> Baking::encodePNG(const PNGImage& image, const PNGWriteSettings& settings)
+{
+	if (!image.pixels || image.width == 0 || image.height == 0 || (image.channels != 3 && image.channels != 4)
+		|| (image.bitDepth != 8 && image.bitDepth != 16))
+		return {};
+
+	const size_t bytesPerPixel = image.channels * image.bitDepth / 8;
+	const size_t rowBytes = image.width * bytesPerPixel;
+	const size_t rowPitch = image.rowPitch != 0 ? image.rowPitch : rowBytes;
+	const bool tryAllFilters = settings.compressionLevel > 0;
+
+	// Filter byte plus filtered samples per row, every row only needs its unfiltered predecessor
+	std::vector<uint8_t> filtered((rowBytes + 1) * image.height);
+	const size_t jobCount = (image.height + k_filterRowsPerJob - 1) / k_filterRowsPerJob;
+	Parallel::parallelFor(jobCount, [&](size_t job)
+		{
+			std::vector<uint8_t> rows(rowBytes * 2);
+			std::vector<uint8_t> scratch(tryAllFilters ? rowBytes * k_filterCount : 0);
+			uint8_t* row = rows.data();
+			uint8_t* previous = rows.data() + rowBytes;
+			const uint32_t firstRow = static_cast<uint32_t>(job * k_filterRowsPerJob);
+			const uint32_t lastRow = std::min<uint32_t>(firstRow + k_filterRowsPerJob, image.height);
+			if (firstRow > 0)
+			{
+				copyRow(image, rowPitch, firstRow - 1, previous, rowBytes);
+			}
+			for (uint32_t y = firstRow; y < lastRow; y++)
+			{
+				copyRow(image, rowPitch, y, row, rowBytes);
+				filterRow(row, y > 0 ? previous : nullptr, rowBytes, bytesPerPixel, tryAllFilters, scratch.data(),
+					filtered.data() + y * (rowBytes + 1));
+				std::swap(row, previous);
+			}
+		}, settings.maxThreads);
+
+	const std::vector<uint8_t> compressed = zlibCompress(filtered.data(), filtered.size(), settings.compressionLevel, settings.maxThreads);
+	std::vector<uint8_t>().swap(filtered);
+
+	const size_t idatCount = std::max<size_t>(1, (compressed.size() + k_idatSize - 1) / k_idatSize);
+	std::vector<uint32_t> idatCRCs(idatCount);
+	Parallel::parallelFor(idatCount, [&](size_t i)
+		{
+			const size_t begin = i * k_idatSize;
+			idatCRCs[i] = getChunkCRC("IDAT", compressed.data() + begin, std::min(k_idatSize, compressed.size() - begin));
+		}, settings.maxThreads);
+
+	std::vector<uint8_t> png;
+	png.reserve(sizeof(k_signature) + 25 + compressed.size() + idatCount * 12 + 12);
+	png.insert(png.end(), k_signature, k_signature + sizeof(k_signature));
+
+	std::vector<uint8_t> header;
+	appendBigEndian(header, image.width);
+	appendBigEndian(header, image.height);
+	header.push_back(static_cast<uint8_t>(image.bitDepth));
+	header.push_back(image.channels == 4 ? 6 : 2); // truecolour with or without alpha
+	header.push_back(0); // deflate
+	header.push_back(0); // adaptive filtering
+	header.push_back(0); // no interlace
+	appendChunk(png, "IHDR", header.data(), header.size(), getChunkCRC("IHDR", header.data(), header.size()));
+
+	for (size_t i = 0; i < idatCount; i++)
+	{
+		const size_t begin = i * k_idatSize;
+		appendChunk(png, "IDAT", compressed.data() + begin, std::min(k_idatSize, compressed.size() - begin), idatCRCs[i]);
+	}
+	appendChunk(png, "IEND", nullptr, 0, getChunkCRC("IEND", nullptr, 0));
+	return png;
+}
+
+bool Baking::writePNG(const std::filesystem::path& path, const PNGImage& image, const PNGWriteSettings& settings)
+{
+	const std::vector<uint8_t> png = encodePNG(image, settings);
+	if (png.empty())
+		return false;
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "deflate.hpp"
+
+namespace Baking
+{
+	struct PNGWriteSettings
+	{
+		int compressionLevel = k_defaultCompressionLevel; // 0 stores, 1 is fastest, 9 is smallest
+		uint32_t maxThreads = 0;                          // 0 uses every core
+	};
+
+	// RGB or RGBA image of 8-bit or native-endian 16-bit samples
+	struct PNGImage
+	{
+		const void* pixels = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		size_t rowPitch = 0; // bytes between rows, 0 for tightly packed
+		uint32_t channels = 4;
+		uint32_t bitDepth = 8;
+	};
+
+	// Rows are filtered in parallel, the filtered image is deflated in independent chunks (see zlibCompress).
+	// The result is a plain PNG any decoder reads. Returns an empty buffer for unsupported formats.
+	std::vector<uint8_t> encodePNG(const PNGImage& image, const PNGWriteSettings& settings = {});
+	bool writePNG(const std::filesystem::path& path, const PNGImage& image, const PNGWriteSettings& settings = {});
+} // namespace Baking
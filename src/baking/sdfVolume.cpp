@@ -0,0 +1,183 @@
+#include "sdfVolume.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+#include "closestPoint.hpp"
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	// 16M bricks keep the index grid at 64 MB
+	constexpr size_t k_maxBricks = size_t(1) << 24;
+	constexpr float k_defaultBandVoxels = 4.0f;
+
+	// Negative below the surface, sided by the interpolated normal at the closest point
+	float getSignedDistance(const ClosestPoint& closest, const glm::vec3& point)
+	{
+		return glm::dot(point - closest.position, closest.normal) < 0.0f ? -closest.distance : closest.distance;
+	}
+}
+
+SparseSDF::SparseSDF(const CombinedHighPolyData& highPoly, const SDFSettings& settings)
+{
+	if (!(settings.voxelSize > 0.0f))
+		throw std::runtime_error("SDF voxel size must be positive");
+	if (highPoly.blasInstances.empty())
+		throw std::runtime_error("SDF needs high-poly triangles");
+
+	m_voxelSize = settings.voxelSize;
+	m_bandWidth = settings.bandWidth > 0.0f ? settings.bandWidth : m_voxelSize * k_defaultBandVoxels;
+
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+	for (const BLASInstance& instance : highPoly.blasInstances)
+	{
+		boundsMin = glm::min(boundsMin, instance.worldBBox.min);
+		boundsMax = glm::max(boundsMax, instance.worldBBox.max);
+	}
+	m_origin = boundsMin - glm::vec3(m_bandWidth + m_voxelSize);
+	const float brickExtent = m_voxelSize * k_brickSize;
+	const glm::vec3 bricks = glm::ceil((boundsMax + glm::vec3(m_bandWidth + m_voxelSize) - m_origin) / brickExtent);
+	if (static_cast<double>(bricks.x) * bricks.y * bricks.z > static_cast<double>(k_maxBricks))
+		throw std::runtime_error("SDF voxel size is too small for the high-poly bounds");
+	m_gridSize = glm::uvec3(bricks);
+
+	const ClosestPointQuery query(highPoly);
+	const size_t brickCount = static_cast<size_t>(m_gridSize.x) * m_gridSize.y * m_gridSize.z;
+	m_brickIndices.resize(brickCount);
+
+	// Bricks whose center is closer to the surface than their half diagonal plus the band get samples,
+	// the others only need the side of the surface they are on
+	const float brickRadius = 0.5f * std::sqrt(3.0f) * brickExtent + m_bandWidth;
+	std::vector<uint8_t> isCenterInside(brickCount);
+	Parallel::parallelForChunks(brickCount, 64, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const glm::uvec3 brick(i % m_gridSize.x, (i / m_gridSize.x) % m_gridSize.y, i / (static_cast<size_t>(m_gridSize.x) * m_gridSize.y));
+				const glm::vec3 center = m_origin + (glm::vec3(brick) + 0.5f) * brickExtent;
+				const ClosestPoint closest = query.find(center, FLT_MAX);
+				isCenterInside[i] = getSignedDistance(closest, center) < 0.0f;
+				if (closest.distance < brickRadius)
+					m_brickIndices[i] = 0;
+				else
+					m_brickIndices[i] = isCenterInside[i] ? k_emptyInside : k_emptyOutside;
+			}
+		});
+
+	std::vector<size_t> narrowBricks;
+	for (size_t i = 0; i < brickCount; i++)
+	{
+		if (m_brickIndices[i] == 0)
+		{
+			m_brickIndices[i] = static_cast<uint32_t>(narrowBricks.size() * k_samplesPerBrick);
+			narrowBricks.push_back(i);
+		}
+	}
+	if (narrowBricks.size() * k_samplesPerBrick >= k_emptyInside)
+		throw std::runtime_error("SDF voxel size is too small for the high-poly bounds");
+	m_pool.resize(narrowBricks.size() * k_samplesPerBrick);
+
+	const float scale = 32767.0f / m_bandWidth;
+	Parallel::parallelFor(narrowBricks.size(), [&](size_t n)
+		{
+			const size_t i = narrowBricks[n];
+			const glm::uvec3 brick(i % m_gridSize.x, (i / m_gridSize.x) % m_gridSize.y, i / (static_cast<size_t>(m_gridSize.x) * m_gridSize.y));
+			const glm::vec3 corner = m_origin + glm::vec3(brick) * brickExtent;
+			int16_t* samples = m_pool.data() + m_brickIndices[i];
+
+			// Only samples within the band are queried. The sign can only flip across the surface, where neighbouring
+			// samples are both inside the band, so the others take the sign of a neighbour flooded from them.
+			uint16_t queue[k_samplesPerBrick];
+			uint32_t queueEnd = 0;
+			bool isKnown[k_samplesPerBrick] = {};
+			for (uint32_t z = 0; z < k_brickSamples; z++)
+			{
+				for (uint32_t y = 0; y < k_brickSamples; y++)
+				{
+					// Distances change by at most the sample spacing, which bounds the search of the next sample in the row
+					float previousDistance = FLT_MAX;
+					for (uint32_t x = 0; x < k_brickSamples; x++)
+					{
+						const uint32_t index = (z * k_brickSamples + y) * k_brickSamples + x;
+						const glm::vec3 point = corner + glm::vec3(x, y, z) * m_voxelSize;
+						const ClosestPoint closest = query.find(point, std::min(m_bandWidth, previousDistance + m_voxelSize * 1.001f));
+						previousDistance = closest.distance;
+						if (!closest.isValid())
+							continue;
+						const float distance = std::clamp(getSignedDistance(closest, point), -m_bandWidth, m_bandWidth);
+						samples[index] = static_cast<int16_t>(std::lround(distance * scale));
+						isKnown[index] = true;
+						queue[queueEnd++] = static_cast<uint16_t>(index);
+					}
+				}
+			}
+			if (queueEnd == 0)
+			{
+				// The band passes the brick between its samples
+				std::fill(samples, samples + k_samplesPerBrick, static_cast<int16_t>(isCenterInside[i] ? -32767 : 32767));
+				return;
+			}
+
+			for (uint32_t queueBegin = 0; queueBegin < queueEnd; queueBegin++)
+			{
+				const uint32_t index = queue[queueBegin];
+				const int16_t farValue = samples[index] < 0 ? -32767 : 32767;
+				const uint32_t x = index % k_brickSamples;
+				const uint32_t y = (index / k_brickSamples) % k_brickSamples;
+				const uint32_t z = index / (k_brickSamples * k_brickSamples);
+				const uint32_t neighbours[6] = {
+					x > 0 ? index - 1 : index, x + 1 < k_brickSamples ? index + 1 : index,
+					y > 0 ? index - k_brickSamples : index, y + 1 < k_brickSamples ? index + k_brickSamples : index,
+					z > 0 ? index - k_brickSamples * k_brickSamples : index, z + 1 < k_brickSamples ? index + k_brickSamples * k_brickSamples : index
+				};
+				for (uint32_t neighbour : neighbours)
+				{
+					if (isKnown[neighbour])
+						continue;
+					samples[neighbour] = farValue;
+					isKnown[neighbour] = true;
+					queue[queueEnd++] = static_cast<uint16_t>(neighbour);
+				}
+			}
+		});
+}
+
+float SparseSDF::sample(const glm::vec3& position) const
+{
+	const glm::vec3 voxel = (position - m_origin) / m_voxelSize;
+	const glm::vec3 gridVoxels = glm::vec3(m_gridSize * k_brickSize);
+	if (voxel.x < 0.0f || voxel.y < 0.0f || voxel.z < 0.0f || voxel.x >= gridVoxels.x || voxel.y >= gridVoxels.y || voxel.z >= gridVoxels.z)
+		return m_bandWidth;
+
+	const glm::uvec3 brick = glm::min(glm::uvec3(voxel / float(k_brickSize)), m_gridSize - 1u);
+	const uint32_t index = m_brickIndices[(static_cast<size_t>(brick.z) * m_gridSize.y + brick.y) * m_gridSize.x + brick.x];
+	if (index == k_emptyOutside)
+		return m_bandWidth;
+	if (index == k_emptyInside)
+		return -m_bandWidth;
+
+	const glm::vec3 local = voxel - glm::vec3(brick * k_brickSize);
+	const glm::uvec3 base = glm::min(glm::uvec3(local), glm::uvec3(k_brickSize - 1));
+	const glm::vec3 f = glm::clamp(local - glm::vec3(base), 0.0f, 1.0f);
+
+	const int16_t* samples = m_pool.data() + index + (base.z * k_brickSamples + base.y) * k_brickSamples + base.x;
+	constexpr uint32_t dy = k_brickSamples;
+	constexpr uint32_t dz = k_brickSamples * k_brickSamples;
+	const float x00 = glm::mix(float(samples[0]), float(samples[1]), f.x);
+	const float x10 = glm::mix(float(samples[dy]), float(samples[dy + 1]), f.x);
+	const float x01 = glm::mix(float(samples[dz]), float(samples[dz + 1]), f.x);
+	const float x11 = glm::mix(float(samples[dz + dy]), float(samples[dz + dy + 1]), f.x);
+	const float value = glm::mix(glm::mix(x00, x10, f.y), glm::mix(x01, x11, f.y), f.z);
+	return value * (m_bandWidth / 32767.0f);
+}
+
+size_t SparseSDF::getMemoryBytes() const
+{
+	return m_brickIndices.size() * sizeof(uint32_t) + m_pool.size() * sizeof(int16_t);
+}
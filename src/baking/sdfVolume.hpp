@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "highPoly.hpp"
+
+namespace Baking
+{
+	struct SDFSettings
+	{
+		float voxelSize = 0.01f; // world units
+		float bandWidth = 0.0f;  // largest stored distance, 0 = four voxels
+	};
+
+	// Sparse narrow-band signed distance field of the combined high-poly, negative inside.
+	// Space is split into bricks of 8^3 voxels and only bricks near the surface store distances, as 9^3 int16 samples
+	// in one pool, so lookups never need a neighbouring brick. A dense grid of brick indices maps positions to the pool,
+	// empty bricks only record on which side of the surface they are. Built in parallel with closest-point queries.
+	class SparseSDF
+	{
+	public:
+		static constexpr uint32_t k_brickSize = 8;
+		static constexpr uint32_t k_brickSamples = k_brickSize + 1;
+
+		SparseSDF(const CombinedHighPolyData& highPoly, const SDFSettings& settings);
+
+		// Trilinear distance, +-bandWidth away from the narrow band and +bandWidth outside of the grid
+		float sample(const glm::vec3& position) const;
+
+		float getVoxelSize() const { return m_voxelSize; }
+		float getBandWidth() const { return m_bandWidth; }
+		glm::uvec3 getBrickGridSize() const { return m_gridSize; }
+		size_t getBrickCount() const { return m_pool.size() / k_samplesPerBrick; }
+		size_t getMemoryBytes() const;
+
+	private:
+		static constexpr uint32_t k_samplesPerBrick = k_brickSamples * k_brickSamples * k_brickSamples;
+		static constexpr uint32_t k_emptyOutside = UINT32_MAX;
+		static constexpr uint32_t k_emptyInside = UINT32_MAX - 1;
+
+		glm::vec3 m_origin = glm::vec3(0.0f);
+		float m_voxelSize = 0.0f;
+		float m_bandWidth = 0.0f;
+		glm::uvec3 m_gridSize = glm::uvec3(0); // in bricks
+		std::vector<uint32_t> m_brickIndices;  // first sample of the brick in m_pool, or k_emptyOutside / k_emptyInside
+		std::vector<int16_t> m_pool;           // distances scaled so +-32767 is +-bandWidth
+	};
+} // namespace Baking
@@ -0,0 +1,115 @@
+#include "udim.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+using namespace Baking;
+
+namespace
+{
+	// Roughly how many triangles cost as much to rasterize as tracing a fully covered tile
+	constexpr double k_trianglesPerTileCost = 1.0e7;
+	// UV bounds reaching less than this far into a neighbouring tile don't add the triangle to it,
+	// so UVs at 1.0 plus rounding error don't turn a 0-1 layout into a UDIM layout
+	constexpr float k_tileEdgeTolerance = 1.0e-5f;
+}
+
+std::vector<UDIMTile> Baking::binTrianglesByUDIM(const std::vector<UVRasterMesh>& meshes,
+	const std::vector<std::vector<uint32_t>>& meshIndices,
+	size_t& outDroppedTriangles)
+{
+	outDroppedTriangles = 0;
+	std::map<uint32_t, UDIMTile> tiles;
+
+	for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+	{
+		const UVRasterMesh& mesh = meshes[meshIndex];
+		const std::vector<uint32_t>& indices = meshIndices[meshIndex];
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			if (indices[i] >= mesh.vertexCount || indices[i + 1] >= mesh.vertexCount || indices[i + 2] >= mesh.vertexCount)
+				continue;
+
+			const glm::vec2 uv0 = mesh.vertices[indices[i]].texCoords;
+			const glm::vec2 uv1 = mesh.vertices[indices[i + 1]].texCoords;
+			const glm::vec2 uv2 = mesh.vertices[indices[i + 2]].texCoords;
+			const glm::vec2 uvMin = glm::min(uv0, glm::min(uv1, uv2));
+			const glm::vec2 uvMax = glm::max(uv0, glm::max(uv1, uv2));
+			const glm::ivec2 firstTile = glm::ivec2(glm::floor(uvMin + k_tileEdgeTolerance));
+			const glm::ivec2 lastTile = glm::max(firstTile, glm::ivec2(glm::ceil(uvMax - k_tileEdgeTolerance)) - 1);
+			const glm::ivec2 clampedFirst = glm::max(firstTile, glm::ivec2(0));
+			const glm::ivec2 clampedLast = glm::min(lastTile, glm::ivec2(k_udimTilesPerRow - 1, k_maxUDIMRows - 1));
+			if (clampedFirst.x > clampedLast.x || clampedFirst.y > clampedLast.y)
+			{
+				outDroppedTriangles++;
+				continue;
+			}
+
+			// Every tile the UV bounds overlap gets the triangle, the rasterizer clips it to each tile.
+			// The area is split evenly, it only weights the scheduling.
+			const glm::vec2 e0 = uv1 - uv0;
+			const glm::vec2 e1 = uv2 - uv0;
+			const double area = 0.5 * std::abs(static_cast<double>(e0.x) * e1.y - static_cast<double>(e0.y) * e1.x);
+			const double tileArea = area / ((lastTile.x - firstTile.x + 1) * (lastTile.y - firstTile.y + 1));
+			for (int32_t tileV = clampedFirst.y; tileV <= clampedLast.y; tileV++)
+			{
+				for (int32_t tileU = clampedFirst.x; tileU <= clampedLast.x; tileU++)
+				{
+					const uint32_t number = getUDIMNumber(tileU, tileV);
+					UDIMTile& tile = tiles[number];
+					if (tile.indices.empty())
+					{
+						tile.number = number;
+						tile.uvOffset = glm::vec2(static_cast<float>(tileU), static_cast<float>(tileV));
+						tile.indices.resize(meshes.size());
+					}
+					tile.indices[meshIndex].insert(tile.indices[meshIndex].end(), indices.begin() + i, indices.begin() + i + 3);
+					tile.triangleCount++;
+					tile.uvArea += tileArea;
+				}
+			}
+		}
+	}
+
+	std::vector<UDIMTile> result;
+	result.reserve(tiles.size());
+	for (auto& [number, tile] : tiles)
+	{
+		result.push_back(std::move(tile));
+	}
+	return result;
+}
+
+bool Baking::isMultiTile(const std::vector<UDIMTile>& tiles)
+{
+	return tiles.size() > 1 || (tiles.size() == 1 && tiles[0].number != k_firstUDIM);
+}
+
+std::string Baking::getUDIMFilename(const std::string& filename, uint32_t tileNumber)
+{
+	const size_t extension = filename.find_last_of('.');
+	if (extension == std::string::npos)
+		return filename + "." + std::to_string(tileNumber);
+	return filename.substr(0, extension) + "." + std::to_string(tileNumber) + filename.substr(extension);
+}
+
+void Baking::scheduleByCost(std::vector<UDIMTile>& tiles, const std::unordered_map<uint32_t, double>& measuredCosts)
+{
+	const bool allMeasured = std::all_of(tiles.begin(), tiles.end(), [&](const UDIMTile& tile)
+		{
+			return measuredCosts.contains(tile.number);
+		});
+
+	for (UDIMTile& tile : tiles)
+	{
+		tile.cost = allMeasured
+			? measuredCosts.at(tile.number)
+			: std::min(tile.uvArea, 1.0) + tile.triangleCount / k_trianglesPerTileCost;
+	}
+
+	std::stable_sort(tiles.begin(), tiles.end(), [](const UDIMTile& a, const UDIMTile& b)
+		{
+			return a.cost > b.cost;
+		});
+}
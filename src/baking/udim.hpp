@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "uvRasterizer.hpp"
+
+namespace Baking
+{
+	constexpr uint32_t k_firstUDIM = 1001;
+	constexpr int32_t k_udimTilesPerRow = 10;
+	constexpr int32_t k_maxUDIMRows = 100;
+
+	inline uint32_t getUDIMNumber(int32_t tileU, int32_t tileV)
+	{
+		return k_firstUDIM + tileU + k_udimTilesPerRow * tileV;
+	}
+
+	// Low-poly triangles of one UV tile, UVs are baked relative to uvOffset
+	struct UDIMTile
+	{
+		uint32_t number = k_firstUDIM;
+		glm::vec2 uvOffset = glm::vec2(0.0f);
+		std::vector<std::vector<uint32_t>> indices; // per mesh, parallel to the mesh list
+		size_t triangleCount = 0;
+		double uvArea = 0.0; // UV area covered by the tile's triangles, in tiles
+		double cost = 0.0;   // scheduling weight, see scheduleByCost
+	};
+
+	// Bins triangles into every UDIM tile their UV bounds overlap, so triangles crossing a tile border are baked
+	// on both sides. Triangles entirely outside of the 10 x 100 UDIM range are dropped and counted in
+	// outDroppedTriangles. Tiles are sorted by number.
+	std::vector<UDIMTile> binTrianglesByUDIM(const std::vector<UVRasterMesh>& meshes,
+		const std::vector<std::vector<uint32_t>>& meshIndices,
+		size_t& outDroppedTriangles);
+
+	// True when the layout needs more than the plain 0-1 tile
+	bool isMultiTile(const std::vector<UDIMTile>& tiles);
+
+	// "normal.png" -> "normal.1001.png"
+	std::string getUDIMFilename(const std::string& filename, uint32_t tileNumber);
+
+	// Orders tiles most expensive first, so long tiles start early and short ones fill in at the end.
+	// Measured costs (any unit, e.g. ms of the previous bake) are used when every tile has one,
+	// otherwise all tiles fall back to an estimate from covered UV area and triangle count.
+	void scheduleByCost(std::vector<UDIMTile>& tiles, const std::unordered_map<uint32_t, double>& measuredCosts);
+} // namespace Baking
@@ -0,0 +1,459 @@
+#include "uvIslands.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
+
+#include "utility/hash.hpp"
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr double k_uvQuantization = 16384.0;      // hash grid for UV coordinates, steps per UV unit
+	constexpr double k_weldQuantization = 100000.0;   // vertices closer than this are treated as one when joining triangles
+	constexpr double k_shapeQuantization = 4096.0;    // steps for edge lengths relative to the island size
+	constexpr double k_scaleQuantization = 10000.0;   // steps per world unit for the absolute island size
+	constexpr float k_overlapEpsilon = 1e-6f;         // triangles sharing an edge or touching don't count as overlapping
+	constexpr uint32_t k_maxOverlapGridSize = 1024;
+
+	inline int64_t quantize(double value, double scale)
+	{
+		return std::llround(value * scale);
+	}
+
+	// UV + position of a vertex, glTF splits vertices on hard edges so indices alone don't connect islands
+	struct WeldKey
+	{
+		int64_t u, v, x, y, z;
+
+		bool operator==(const WeldKey& other) const
+		{
+			return u == other.u && v == other.v && x == other.x && y == other.y && z == other.z;
+		}
+	};
+
+	struct WeldKeyHash
+	{
+		size_t operator()(const WeldKey& key) const
+		{
+			uint64_t hash = Hash::mix(static_cast<uint64_t>(key.u));
+			hash = Hash::combine(hash, static_cast<uint64_t>(key.v));
+			hash = Hash::combine(hash, static_cast<uint64_t>(key.x));
+			hash = Hash::combine(hash, static_cast<uint64_t>(key.y));
+			hash = Hash::combine(hash, static_cast<uint64_t>(key.z));
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	uint32_t findRoot(std::vector<uint32_t>& parents, uint32_t index)
+	{
+		while (parents[index] != index)
+		{
+			parents[index] = parents[parents[index]];
+			index = parents[index];
+		}
+		return index;
+	}
+
+	bool isValidTriangle(const UVRasterMesh& mesh, size_t triangle)
+	{
+		return mesh.indices[triangle * 3 + 0] < mesh.vertexCount
+			&& mesh.indices[triangle * 3 + 1] < mesh.vertexCount
+			&& mesh.indices[triangle * 3 + 2] < mesh.vertexCount;
+	}
+
+	// Connected components of triangles sharing a welded vertex
+	void findMeshIslands(const UVRasterMesh& mesh, uint32_t meshIndex, std::vector<UVIsland>& outIslands)
+	{
+		const size_t triangleCount = mesh.indexCount / 3;
+
+		std::unordered_map<WeldKey, uint32_t, WeldKeyHash> welded;
+		welded.reserve(mesh.vertexCount);
+		std::vector<uint32_t> weldedIndex(mesh.vertexCount);
+		for (size_t i = 0; i < mesh.vertexCount; i++)
+		{
+			const Vertex& vertex = mesh.vertices[i];
+			const WeldKey key = {
+				quantize(vertex.texCoords.x, k_uvQuantization),
+				quantize(vertex.texCoords.y, k_uvQuantization),
+				quantize(vertex.position.x, k_weldQuantization),
+				quantize(vertex.position.y, k_weldQuantization),
+				quantize(vertex.position.z, k_weldQuantization) };
+			weldedIndex[i] = welded.try_emplace(key, static_cast<uint32_t>(welded.size())).first->second;
+		}
+
+		std::vector<uint32_t> parents(triangleCount);
+		std::iota(parents.begin(), parents.end(), 0u);
+		std::vector<uint32_t> vertexOwner(welded.size(), UINT32_MAX);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (!isValidTriangle(mesh, t))
+				continue;
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t vertex = weldedIndex[mesh.indices[t * 3 + corner]];
+				if (vertexOwner[vertex] == UINT32_MAX)
+				{
+					vertexOwner[vertex] = static_cast<uint32_t>(t);
+					continue;
+				}
+				const uint32_t a = findRoot(parents, static_cast<uint32_t>(t));
+				const uint32_t b = findRoot(parents, vertexOwner[vertex]);
+				if (a != b)
+					parents[std::max(a, b)] = std::min(a, b);
+			}
+		}
+
+		std::vector<uint32_t> rootIsland(triangleCount, UINT32_MAX);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (!isValidTriangle(mesh, t))
+				continue;
+			const uint32_t root = findRoot(parents, static_cast<uint32_t>(t));
+			if (rootIsland[root] == UINT32_MAX)
+			{
+				rootIsland[root] = static_cast<uint32_t>(outIslands.size());
+				outIslands.emplace_back().meshIndex = meshIndex;
+			}
+			outIslands[rootIsland[root]].triangles.push_back(static_cast<uint32_t>(t));
+		}
+	}
+
+	// Sorts the triangles into an order that doesn't depend on the index buffer and hashes the island
+	void describeIsland(const UVRasterMesh& mesh, UVIsland& island)
+	{
+		struct CanonicalTriangle
+		{
+			int64_t u[3];
+			int64_t v[3];
+			uint32_t corner[3]; // triangle corners sorted by UV
+			uint32_t triangle;
+		};
+
+		std::vector<CanonicalTriangle> canonical(island.triangles.size());
+		island.uvMin = glm::vec2(std::numeric_limits<float>::max());
+		island.uvMax = glm::vec2(std::numeric_limits<float>::lowest());
+		for (size_t i = 0; i < island.triangles.size(); i++)
+		{
+			const uint32_t t = island.triangles[i];
+			int64_t u[3], v[3];
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const glm::vec2& uv = mesh.vertices[mesh.indices[t * 3 + corner]].texCoords;
+				island.uvMin = glm::min(island.uvMin, uv);
+				island.uvMax = glm::max(island.uvMax, uv);
+				u[corner] = quantize(uv.x, k_uvQuantization);
+				v[corner] = quantize(uv.y, k_uvQuantization);
+			}
+
+			// Mirrored copies usually come with flipped winding, so the corner order can't be trusted either
+			CanonicalTriangle& entry = canonical[i];
+			entry.triangle = t;
+			entry.corner[0] = 0;
+			entry.corner[1] = 1;
+			entry.corner[2] = 2;
+			std::sort(entry.corner, entry.corner + 3, [&](uint32_t a, uint32_t b)
+				{
+					return u[a] != u[b] ? u[a] < u[b] : v[a] < v[b];
+				});
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				entry.u[corner] = u[entry.corner[corner]];
+				entry.v[corner] = v[entry.corner[corner]];
+			}
+		}
+
+		std::sort(canonical.begin(), canonical.end(), [](const CanonicalTriangle& a, const CanonicalTriangle& b)
+			{
+				const int64_t centroidA[2] = { a.u[0] + a.u[1] + a.u[2], a.v[0] + a.v[1] + a.v[2] };
+				const int64_t centroidB[2] = { b.u[0] + b.u[1] + b.u[2], b.v[0] + b.v[1] + b.v[2] };
+				if (centroidA[0] != centroidB[0])
+					return centroidA[0] < centroidB[0];
+				if (centroidA[1] != centroidB[1])
+					return centroidA[1] < centroidB[1];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					if (a.u[corner] != b.u[corner])
+						return a.u[corner] < b.u[corner];
+					if (a.v[corner] != b.v[corner])
+						return a.v[corner] < b.v[corner];
+				}
+				return a.triangle < b.triangle;
+			});
+
+		// Edge lengths of every triangle in canonical corner order, in world space
+		std::vector<float> edgeLengths(canonical.size() * 3);
+		float islandScale = 0.0f;
+		for (size_t i = 0; i < canonical.size(); i++)
+		{
+			const CanonicalTriangle& entry = canonical[i];
+			glm::vec3 positions[3];
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const Vertex& vertex = mesh.vertices[mesh.indices[entry.triangle * 3 + entry.corner[corner]]];
+				positions[corner] = glm::vec3(mesh.worldMatrix * glm::vec4(vertex.position, 1.0f));
+			}
+			for (uint32_t edge = 0; edge < 3; edge++)
+			{
+				const float length = glm::length(positions[(edge + 1) % 3] - positions[edge]);
+				edgeLengths[i * 3 + edge] = length;
+				islandScale = std::max(islandScale, length);
+			}
+		}
+
+		uint64_t layoutHash = Hash::mix(canonical.size());
+		uint64_t geometryHash = Hash::combine(layoutHash, static_cast<uint64_t>(quantize(islandScale, k_scaleQuantization)));
+		const double invScale = islandScale > 0.0f ? 1.0 / islandScale : 0.0;
+		for (size_t i = 0; i < canonical.size(); i++)
+		{
+			const CanonicalTriangle& entry = canonical[i];
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				layoutHash = Hash::combine(layoutHash, static_cast<uint64_t>(entry.u[corner]));
+				layoutHash = Hash::combine(layoutHash, static_cast<uint64_t>(entry.v[corner]));
+				geometryHash = Hash::combine(geometryHash,
+					static_cast<uint64_t>(quantize(edgeLengths[i * 3 + corner] * invScale, k_shapeQuantization)));
+			}
+			island.triangles[i] = entry.triangle;
+		}
+		island.layoutHash = layoutHash;
+		island.geometryHash = geometryHash;
+	}
+
+	struct OverlapTriangle
+	{
+		glm::vec2 uv[3];
+		uint32_t island;
+	};
+
+	// Separating axis test on the edge normals of a, with a small tolerance so shared edges don't count
+	bool hasSeparatingAxis(const glm::vec2* a, const glm::vec2* b)
+	{
+		for (int edge = 0; edge < 3; edge++)
+		{
+			const glm::vec2 direction = a[(edge + 1) % 3] - a[edge];
+			const glm::vec2 axis = glm::vec2(-direction.y, direction.x);
+			const float epsilon = k_overlapEpsilon * glm::length(axis);
+
+			float minA = glm::dot(axis, a[0]);
+			float maxA = minA;
+			float minB = glm::dot(axis, b[0]);
+			float maxB = minB;
+			for (int corner = 1; corner < 3; corner++)
+			{
+				const float projectedA = glm::dot(axis, a[corner]);
+				const float projectedB = glm::dot(axis, b[corner]);
+				minA = std::min(minA, projectedA);
+				maxA = std::max(maxA, projectedA);
+				minB = std::min(minB, projectedB);
+				maxB = std::max(maxB, projectedB);
+			}
+			if (maxA <= minB + epsilon || maxB <= minA + epsilon)
+				return true;
+		}
+		return false;
+	}
+
+	bool trianglesOverlap(const OverlapTriangle& a, const OverlapTriangle& b)
+	{
+		return !hasSeparatingAxis(a.uv, b.uv) && !hasSeparatingAxis(b.uv, a.uv);
+	}
+
+	// Bins the triangles of all master islands into a uniform UV grid and tests triangle pairs from
+	// different islands that share a cell
+	std::vector<UVIslandOverlap> findOverlaps(const std::vector<UVRasterMesh>& meshes, const std::vector<UVIsland>& islands)
+	{
+		std::vector<OverlapTriangle> triangles;
+		glm::vec2 boundsMin = glm::vec2(std::numeric_limits<float>::max());
+		glm::vec2 boundsMax = glm::vec2(std::numeric_limits<float>::lowest());
+		for (uint32_t i = 0; i < islands.size(); i++)
+		{
+			const UVIsland& island = islands[i];
+			if (island.isDuplicate(i))
+				continue;
+
+			const UVRasterMesh& mesh = meshes[island.meshIndex];
+			for (uint32_t t : island.triangles)
+			{
+				OverlapTriangle triangle;
+				triangle.island = i;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					triangle.uv[corner] = mesh.vertices[mesh.indices[t * 3 + corner]].texCoords;
+				}
+				const glm::vec2 e0 = triangle.uv[1] - triangle.uv[0];
+				const glm::vec2 e1 = triangle.uv[2] - triangle.uv[0];
+				if (std::abs(e0.x * e1.y - e0.y * e1.x) <= k_overlapEpsilon * k_overlapEpsilon)
+					continue; // degenerate in UV space, covers no texels
+				triangles.push_back(triangle);
+			}
+			boundsMin = glm::min(boundsMin, island.uvMin);
+			boundsMax = glm::max(boundsMax, island.uvMax);
+		}
+		if (triangles.empty())
+			return {};
+
+		const uint32_t gridSize = std::clamp(static_cast<uint32_t>(std::sqrt(static_cast<double>(triangles.size()))), 1u, k_maxOverlapGridSize);
+		const glm::vec2 extent = glm::max(boundsMax - boundsMin, glm::vec2(1e-6f));
+		const glm::vec2 cellScale = glm::vec2(static_cast<float>(gridSize)) / extent;
+		auto cellRange = [&](const OverlapTriangle& triangle, glm::uvec2& outMin, glm::uvec2& outMax)
+			{
+				const glm::vec2 triMin = glm::min(glm::min(triangle.uv[0], triangle.uv[1]), triangle.uv[2]);
+				const glm::vec2 triMax = glm::max(glm::max(triangle.uv[0], triangle.uv[1]), triangle.uv[2]);
+				outMin = glm::uvec2(glm::clamp((triMin - boundsMin) * cellScale, glm::vec2(0.0f), glm::vec2(float(gridSize - 1))));
+				outMax = glm::uvec2(glm::clamp((triMax - boundsMin) * cellScale, glm::vec2(0.0f), glm::vec2(float(gridSize - 1))));
+			};
+
+		std::vector<uint32_t> cellOffsets(size_t(gridSize) * gridSize + 1, 0);
+		for (const OverlapTriangle& triangle : triangles)
+		{
+			glm::uvec2 cellMin, cellMax;
+			cellRange(triangle, cellMin, cellMax);
+			for (uint32_t y = cellMin.y; y <= cellMax.y; y++)
+			{
+				for (uint32_t x = cellMin.x; x <= cellMax.x; x++)
+				{
+					cellOffsets[size_t(y) * gridSize + x + 1]++;
+				}
+			}
+		}
+		std::partial_sum(cellOffsets.begin(), cellOffsets.end(), cellOffsets.begin());
+
+		std::vector<uint32_t> cellTriangles(cellOffsets.back());
+		std::vector<uint32_t> cellCursors(cellOffsets.begin(), cellOffsets.end() - 1);
+		for (uint32_t i = 0; i < triangles.size(); i++)
+		{
+			glm::uvec2 cellMin, cellMax;
+			cellRange(triangles[i], cellMin, cellMax);
+			for (uint32_t y = cellMin.y; y <= cellMax.y; y++)
+			{
+				for (uint32_t x = cellMin.x; x <= cellMax.x; x++)
+				{
+					cellTriangles[cellCursors[size_t(y) * gridSize + x]++] = i;
+				}
+			}
+		}
+
+		std::vector<UVIslandOverlap> overlaps;
+		std::mutex overlapsMutex;
+		Parallel::parallelForChunks(size_t(gridSize) * gridSize, gridSize, [&](size_t begin, size_t end)
+			{
+				std::vector<UVIslandOverlap> found;
+				for (size_t cell = begin; cell < end; cell++)
+				{
+					const size_t cellFound = found.size();
+					for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; i++)
+					{
+						const OverlapTriangle& a = triangles[cellTriangles[i]];
+						for (uint32_t j = i + 1; j < cellOffsets[cell + 1]; j++)
+						{
+							const OverlapTriangle& b = triangles[cellTriangles[j]];
+							if (a.island == b.island)
+								continue;
+
+							const UVIslandOverlap pair = { std::min(a.island, b.island), std::max(a.island, b.island) };
+							const bool alreadyFound = std::any_of(found.begin() + cellFound, found.end(), [&](const UVIslandOverlap& overlap)
+								{
+									return overlap.islandA == pair.islandA && overlap.islandB == pair.islandB;
+								});
+							if (!alreadyFound && trianglesOverlap(a, b))
+								found.push_back(pair);
+						}
+					}
+				}
+				std::lock_guard<std::mutex> lock(overlapsMutex);
+				overlaps.insert(overlaps.end(), found.begin(), found.end());
+			});
+
+		std::sort(overlaps.begin(), overlaps.end(), [](const UVIslandOverlap& a, const UVIslandOverlap& b)
+			{
+				return a.islandA != b.islandA ? a.islandA < b.islandA : a.islandB < b.islandB;
+			});
+		overlaps.erase(std::unique(overlaps.begin(), overlaps.end(), [](const UVIslandOverlap& a, const UVIslandOverlap& b)
+			{
+				return a.islandA == b.islandA && a.islandB == b.islandB;
+			}), overlaps.end());
+		return overlaps;
+	}
+}
+
+UVIslandReport Baking::analyzeUVIslands(const std::vector<UVRasterMesh>& meshes)
+{
+	UVIslandReport report;
+
+	std::vector<std::vector<UVIsland>> meshIslands(meshes.size());
+	Parallel::parallelFor(meshes.size(), [&](size_t i)
+		{
+			const UVRasterMesh& mesh = meshes[i];
+			if (mesh.vertices && mesh.indices)
+				findMeshIslands(mesh, static_cast<uint32_t>(i), meshIslands[i]);
+		});
+	for (auto& islands : meshIslands)
+	{
+		std::move(islands.begin(), islands.end(), std::back_inserter(report.islands));
+	}
+
+	Parallel::parallelFor(report.islands.size(), [&](size_t i)
+		{
+			UVIsland& island = report.islands[i];
+			describeIsland(meshes[island.meshIndex], island);
+		});
+
+	// The first island with a given layout and shape is the master, in mesh order
+	std::unordered_map<uint64_t, uint32_t> masters;
+	for (uint32_t i = 0; i < report.islands.size(); i++)
+	{
+		UVIsland& island = report.islands[i];
+		const uint64_t key = Hash::combine(island.layoutHash, island.geometryHash);
+		auto [it, inserted] = masters.try_emplace(key, i);
+		island.master = it->second;
+		if (!inserted)
+		{
+			report.duplicateIslands++;
+			report.skippedTriangles += island.triangles.size();
+		}
+	}
+
+	report.overlaps = findOverlaps(meshes, report.islands);
+	return report;
+}
+
+std::vector<std::vector<uint32_t>> Baking::buildMasterIndices(const std::vector<UVRasterMesh>& meshes, const UVIslandReport& report)
+{
+	std::vector<std::vector<uint8_t>> keepTriangle(meshes.size());
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		keepTriangle[i].resize(meshes[i].indexCount / 3, 0);
+	}
+	for (uint32_t i = 0; i < report.islands.size(); i++)
+	{
+		const UVIsland& island = report.islands[i];
+		if (island.isDuplicate(i))
+			continue;
+		for (uint32_t t : island.triangles)
+		{
+			keepTriangle[island.meshIndex][t] = 1;
+		}
+	}
+
+	// Original submission order is kept so overlapping masters resolve the same way as before
+	std::vector<std::vector<uint32_t>> indices(meshes.size());
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const UVRasterMesh& mesh = meshes[i];
+		indices[i].reserve(mesh.indexCount);
+		for (size_t t = 0; t < keepTriangle[i].size(); t++)
+		{
+			if (!keepTriangle[i][t])
+				continue;
+			indices[i].insert(indices[i].end(), mesh.indices + t * 3, mesh.indices + t * 3 + 3);
+		}
+	}
+	return indices;
+}
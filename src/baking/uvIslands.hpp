@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "uvRasterizer.hpp"
+
+namespace Baking
+{
+	struct UVIsland
+	{
+		uint32_t meshIndex = 0;
+		std::vector<uint32_t> triangles; // triangle indices inside the mesh, in canonical UV order
+		glm::vec2 uvMin = glm::vec2(0.0f);
+		glm::vec2 uvMax = glm::vec2(0.0f);
+		uint64_t layoutHash = 0;   // quantized UV layout, equal for islands stacked on the same texels
+		uint64_t geometryHash = 0; // world-space shape, invariant to translation, rotation and mirroring
+		uint32_t master = 0;       // island baked in place of this one, itself for master islands
+
+		bool isDuplicate(uint32_t islandIndex) const
+		{
+			return master != islandIndex;
+		}
+	};
+
+	// Two master islands covering some of the same texels - whichever is rasterized last wins them
+	struct UVIslandOverlap
+	{
+		uint32_t islandA;
+		uint32_t islandB;
+	};
+
+	struct UVIslandReport
+	{
+		std::vector<UVIsland> islands;
+		std::vector<UVIslandOverlap> overlaps;
+		size_t duplicateIslands = 0;
+		size_t skippedTriangles = 0;
+	};
+
+	// Splits the low-poly meshes into UV islands and finds stacked duplicates: islands with the same UV
+	// layout and the same world-space shape (also mirrored) bake to the same texels, so only the first
+	// of them - the master - has to be rasterized and traced. Overlaps between different islands are
+	// reported since they race for texels.
+	UVIslandReport analyzeUVIslands(const std::vector<UVRasterMesh>& meshes);
+
+	// Index list of every mesh with the triangles of duplicate islands removed
+	std::vector<std::vector<uint32_t>> buildMasterIndices(const std::vector<UVRasterMesh>& meshes, const UVIslandReport& report);
+} // namespace Baking
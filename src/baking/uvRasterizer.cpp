@@ -0,0 +1,390 @@
+#include "uvRasterizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "utility/parallelFor.hpp"
+
+using namespace Baking;
+
+namespace
+{
+	constexpr int64_t k_subPixelBits = 8;
+	constexpr int64_t k_subPixelScale = 1 << k_subPixelBits;
+	constexpr int64_t k_halfTexel = k_subPixelScale / 2;
+
+	// Positive when p lies on the interior side of the edge a->b of a positively oriented triangle
+	inline int64_t edgeFunction(int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t px, int64_t py)
+	{
+		return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+	}
+
+	// D3D top-left rule: texel centers exactly on an edge belong to the triangle only for top or left edges
+	inline int64_t fillRuleBias(int64_t ax, int64_t ay, int64_t bx, int64_t by)
+	{
+		const int64_t dx = bx - ax;
+		const int64_t dy = by - ay;
+		const bool isTop = dy == 0 && dx > 0;
+		const bool isLeft = dy < 0;
+		return (isTop || isLeft) ? 0 : -1;
+	}
+
+	inline glm::vec3 safeNormalize(const glm::vec3& v)
+	{
+		const float len = glm::length(v);
+		return len > 0.0f ? v / len : v;
+	}
+
+	constexpr uint32_t k_emptyTexel = UINT32_MAX;
+}
+
+UVRasterizer::UVRasterizer(uint32_t width, uint32_t height, uint32_t tileSize)
+	: m_width(width)
+	, m_height(height)
+	, m_tileSize(std::max(tileSize, 8u))
+{
+	m_tilesX = (m_width + m_tileSize - 1) / m_tileSize;
+	m_tilesY = (m_height + m_tileSize - 1) / m_tileSize;
+}
+
+void UVRasterizer::addMesh(const UVRasterMesh& mesh)
+{
+	if (!mesh.vertices || !mesh.indices || mesh.indexCount < 3)
+		return;
+	m_meshes.push_back(mesh);
+}
+
+UVRasterResult UVRasterizer::rasterize() const
+{
+	UVRasterResult result;
+	result.width = m_width;
+	result.height = m_height;
+	result.tileSize = m_tileSize;
+	result.tilesX = m_tilesX;
+	result.tilesY = m_tilesY;
+
+	if (m_width == 0 || m_height == 0 || m_meshes.empty())
+		return result;
+
+	std::vector<WorldVertices> world;
+	transformMeshes(world);
+
+	std::vector<SetupTriangle> triangles;
+	setupTriangles(triangles);
+
+	std::vector<uint32_t> tileOffsets;
+	std::vector<uint32_t> tileTriangles;
+	binTriangles(triangles, tileOffsets, tileTriangles);
+
+	// Pass 1: resolve coverage per tile, only the winning triangle and barycentrics are kept per texel
+	const uint32_t numTiles = m_tilesX * m_tilesY;
+	std::vector<std::vector<TexelSample>> tileSamples(numTiles);
+	Parallel::parallelFor(numTiles, [&](size_t tile)
+		{
+			const uint32_t first = tileOffsets[tile];
+			const uint32_t count = tileOffsets[tile + 1] - first;
+			if (count == 0)
+				return;
+			rasterizeTile(static_cast<uint32_t>(tile), triangles, tileTriangles.data() + first, count, tileSamples[tile]);
+		});
+
+	uint32_t totalTexels = 0;
+	for (uint32_t tile = 0; tile < numTiles; tile++)
+	{
+		if (tileSamples[tile].empty())
+			continue;
+		TexelTileRange range;
+		range.tileIndex = tile;
+		range.texelOffset = totalTexels;
+		range.texelCount = static_cast<uint32_t>(tileSamples[tile].size());
+		result.tiles.push_back(range);
+		totalTexels += range.texelCount;
+	}
+
+	// Pass 2: attributes are interpolated once per covered texel, straight into the tile-grouped output
+	result.texels.resize(totalTexels);
+	Parallel::parallelFor(result.tiles.size(), [&](size_t i)
+		{
+			const TexelTileRange& range = result.tiles[i];
+			std::vector<TexelSample>& samples = tileSamples[range.tileIndex];
+			interpolateTile(samples, triangles, world, result.texels.data() + range.texelOffset);
+			std::vector<TexelSample>().swap(samples);
+		});
+
+	return result;
+}
+
+void UVRasterizer::transformMeshes(std::vector<WorldVertices>& outWorld) const
+{
+	outWorld.resize(m_meshes.size());
+	for (size_t m = 0; m < m_meshes.size(); m++)
+	{
+		const UVRasterMesh& mesh = m_meshes[m];
+		WorldVertices& dst = outWorld[m];
+		dst.positions.resize(mesh.vertexCount);
+		dst.normals.resize(mesh.vertexCount);
+		dst.tangents.resize(mesh.vertexCount);
+		dst.smoothedNormals.resize(mesh.vertexCount);
+
+		const glm::mat4 worldMatrix = mesh.worldMatrix;
+		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(worldMatrix)));
+
+		Parallel::parallelForChunks(mesh.vertexCount, 16384, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const Vertex& v = mesh.vertices[i];
+					dst.positions[i] = glm::vec3(worldMatrix * glm::vec4(v.position, 1.0f));
+					dst.normals[i] = safeNormalize(normalMatrix * v.normal);
+					dst.tangents[i] = safeNormalize(normalMatrix * v.tangent);
+					dst.smoothedNormals[i] = safeNormalize(normalMatrix * v.smoothNormal);
+				}
+			});
+	}
+}
+
+void UVRasterizer::setupTriangles(std::vector<SetupTriangle>& outTriangles) const
+{
+	std::vector<size_t> meshTriangleOffsets(m_meshes.size() + 1, 0);
+	for (size_t m = 0; m < m_meshes.size(); m++)
+	{
+		meshTriangleOffsets[m + 1] = meshTriangleOffsets[m] + m_meshes[m].indexCount / 3;
+	}
+	outTriangles.resize(meshTriangleOffsets.back());
+
+	const double scaleX = static_cast<double>(m_width) * k_subPixelScale;
+	const double scaleY = static_cast<double>(m_height) * k_subPixelScale;
+
+	for (size_t m = 0; m < m_meshes.size(); m++)
+	{
+		const UVRasterMesh& mesh = m_meshes[m];
+		const size_t numTris = mesh.indexCount / 3;
+		SetupTriangle* dst = outTriangles.data() + meshTriangleOffsets[m];
+
+		Parallel::parallelForChunks(numTris, 8192, [&](size_t begin, size_t end)
+			{
+				for (size_t t = begin; t < end; t++)
+				{
+					SetupTriangle& tri = dst[t];
+					tri.area = 0; // area == 0 marks a triangle that is skipped by binning
+					tri.meshIndex = static_cast<uint32_t>(m);
+
+					uint32_t idx[3] = { mesh.indices[t * 3], mesh.indices[t * 3 + 1], mesh.indices[t * 3 + 2] };
+					if (idx[0] >= mesh.vertexCount || idx[1] >= mesh.vertexCount || idx[2] >= mesh.vertexCount)
+						continue;
+
+					for (int k = 0; k < 3; k++)
+					{
+						const glm::vec2 uv = mesh.vertices[idx[k]].texCoords - mesh.uvOffset;
+						tri.x[k] = std::llround(uv.x * scaleX);
+						tri.y[k] = std::llround(uv.y * scaleY);
+					}
+
+					int64_t area = edgeFunction(tri.x[0], tri.y[0], tri.x[1], tri.y[1], tri.x[2], tri.y[2]);
+					if (area == 0)
+						continue;
+					if (area < 0) // no culling in UV space - flip to a positive winding
+					{
+						std::swap(tri.x[1], tri.x[2]);
+						std::swap(tri.y[1], tri.y[2]);
+						std::swap(idx[1], idx[2]);
+						area = -area;
+					}
+
+					const int64_t minX = std::min({ tri.x[0], tri.x[1], tri.x[2] });
+					const int64_t maxX = std::max({ tri.x[0], tri.x[1], tri.x[2] });
+					const int64_t minY = std::min({ tri.y[0], tri.y[1], tri.y[2] });
+					const int64_t maxY = std::max({ tri.y[0], tri.y[1], tri.y[2] });
+
+					// Texels whose centers can fall inside the bounds
+					const int64_t firstX = std::max<int64_t>(0, (minX - k_halfTexel + k_subPixelScale - 1) >> k_subPixelBits);
+					const int64_t lastX = std::min<int64_t>(m_width - 1, (maxX - k_halfTexel) >> k_subPixelBits);
+					const int64_t firstY = std::max<int64_t>(0, (minY - k_halfTexel + k_subPixelScale - 1) >> k_subPixelBits);
+					const int64_t lastY = std::min<int64_t>(m_height - 1, (maxY - k_halfTexel) >> k_subPixelBits);
+					if (firstX > lastX || firstY > lastY)
+						continue;
+
+					tri.vertexIndex[0] = idx[0];
+					tri.vertexIndex[1] = idx[1];
+					tri.vertexIndex[2] = idx[2];
+					tri.minTileX = static_cast<uint32_t>(firstX) / m_tileSize;
+					tri.maxTileX = static_cast<uint32_t>(lastX) / m_tileSize;
+					tri.minTileY = static_cast<uint32_t>(firstY) / m_tileSize;
+					tri.maxTileY = static_cast<uint32_t>(lastY) / m_tileSize;
+					tri.area = area;
+				}
+			});
+	}
+}
+
+void UVRasterizer::binTriangles(const std::vector<SetupTriangle>& triangles,
+	std::vector<uint32_t>& outTileOffsets,
+	std::vector<uint32_t>& outTileTriangles) const
+{
+	const uint32_t numTiles = m_tilesX * m_tilesY;
+	std::vector<std::atomic<uint32_t>> tileCounts(numTiles);
+	for (auto& count : tileCounts)
+		count.store(0, std::memory_order_relaxed);
+
+	Parallel::parallelForChunks(triangles.size(), 8192, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				const SetupTriangle& tri = triangles[t];
+				if (tri.area == 0)
+					continue;
+				for (uint32_t ty = tri.minTileY; ty <= tri.maxTileY; ty++)
+					for (uint32_t tx = tri.minTileX; tx <= tri.maxTileX; tx++)
+						tileCounts[ty * m_tilesX + tx].fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+
+	outTileOffsets.assign(numTiles + 1, 0);
+	for (uint32_t tile = 0; tile < numTiles; tile++)
+	{
+		outTileOffsets[tile + 1] = outTileOffsets[tile] + tileCounts[tile].load(std::memory_order_relaxed);
+		tileCounts[tile].store(outTileOffsets[tile], std::memory_order_relaxed); // reuse as fill cursor
+	}
+	outTileTriangles.resize(outTileOffsets.back());
+
+	Parallel::parallelForChunks(triangles.size(), 8192, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				const SetupTriangle& tri = triangles[t];
+				if (tri.area == 0)
+					continue;
+				for (uint32_t ty = tri.minTileY; ty <= tri.maxTileY; ty++)
+					for (uint32_t tx = tri.minTileX; tx <= tri.maxTileX; tx++)
+					{
+						const uint32_t slot = tileCounts[ty * m_tilesX + tx].fetch_add(1, std::memory_order_relaxed);
+						outTileTriangles[slot] = static_cast<uint32_t>(t);
+					}
+			}
+		});
+}
+
+void UVRasterizer::rasterizeTile(uint32_t tileIndex,
+	const std::vector<SetupTriangle>& triangles,
+	const uint32_t* tileTriangles,
+	uint32_t tileTriangleCount,
+	std::vector<TexelSample>& outSamples) const
+{
+	const uint32_t tileX0 = (tileIndex % m_tilesX) * m_tileSize;
+	const uint32_t tileY0 = (tileIndex / m_tilesX) * m_tileSize;
+	const uint32_t tileX1 = std::min(tileX0 + m_tileSize, m_width) - 1;
+	const uint32_t tileY1 = std::min(tileY0 + m_tileSize, m_height) - 1;
+
+	// Binning is parallel, restore submission order so overlaps resolve like the GPU draw (last triangle wins)
+	std::vector<uint32_t> order(tileTriangles, tileTriangles + tileTriangleCount);
+	std::sort(order.begin(), order.end());
+
+	std::vector<TexelSample> samples(static_cast<size_t>(m_tileSize) * m_tileSize, TexelSample{ 0, k_emptyTexel, 0.0f, 0.0f });
+
+	for (uint32_t triIndex : order)
+	{
+		const SetupTriangle& tri = triangles[triIndex];
+
+		const int64_t minX = std::min({ tri.x[0], tri.x[1], tri.x[2] });
+		const int64_t maxX = std::max({ tri.x[0], tri.x[1], tri.x[2] });
+		const int64_t minY = std::min({ tri.y[0], tri.y[1], tri.y[2] });
+		const int64_t maxY = std::max({ tri.y[0], tri.y[1], tri.y[2] });
+		const int64_t firstX = std::max<int64_t>(tileX0, (minX - k_halfTexel + k_subPixelScale - 1) >> k_subPixelBits);
+		const int64_t lastX = std::min<int64_t>(tileX1, (maxX - k_halfTexel) >> k_subPixelBits);
+		const int64_t firstY = std::max<int64_t>(tileY0, (minY - k_halfTexel + k_subPixelScale - 1) >> k_subPixelBits);
+		const int64_t lastY = std::min<int64_t>(tileY1, (maxY - k_halfTexel) >> k_subPixelBits);
+		if (firstX > lastX || firstY > lastY)
+			continue;
+
+		const int64_t bias0 = fillRuleBias(tri.x[1], tri.y[1], tri.x[2], tri.y[2]);
+		const int64_t bias1 = fillRuleBias(tri.x[2], tri.y[2], tri.x[0], tri.y[0]);
+		const int64_t bias2 = fillRuleBias(tri.x[0], tri.y[0], tri.x[1], tri.y[1]);
+
+		// Edge function steps per texel
+		const int64_t stepX0 = -(tri.y[2] - tri.y[1]) * k_subPixelScale;
+		const int64_t stepX1 = -(tri.y[0] - tri.y[2]) * k_subPixelScale;
+		const int64_t stepX2 = -(tri.y[1] - tri.y[0]) * k_subPixelScale;
+		const int64_t stepY0 = (tri.x[2] - tri.x[1]) * k_subPixelScale;
+		const int64_t stepY1 = (tri.x[0] - tri.x[2]) * k_subPixelScale;
+		const int64_t stepY2 = (tri.x[1] - tri.x[0]) * k_subPixelScale;
+
+		const int64_t px = firstX * k_subPixelScale + k_halfTexel;
+		const int64_t py = firstY * k_subPixelScale + k_halfTexel;
+		int64_t row0 = edgeFunction(tri.x[1], tri.y[1], tri.x[2], tri.y[2], px, py);
+		int64_t row1 = edgeFunction(tri.x[2], tri.y[2], tri.x[0], tri.y[0], px, py);
+		int64_t row2 = edgeFunction(tri.x[0], tri.y[0], tri.x[1], tri.y[1], px, py);
+
+		const double invArea = 1.0 / static_cast<double>(tri.area);
+
+		for (int64_t y = firstY; y <= lastY; y++)
+		{
+			int64_t e0 = row0;
+			int64_t e1 = row1;
+			int64_t e2 = row2;
+			TexelSample* sampleRow = samples.data() + (y - tileY0) * m_tileSize - tileX0;
+			for (int64_t x = firstX; x <= lastX; x++)
+			{
+				if ((e0 + bias0) >= 0 && (e1 + bias1) >= 0 && (e2 + bias2) >= 0)
+				{
+					TexelSample& sample = sampleRow[x];
+					sample.triangle = triIndex;
+					sample.w1 = static_cast<float>(e1 * invArea);
+					sample.w2 = static_cast<float>(e2 * invArea);
+				}
+				e0 += stepX0;
+				e1 += stepX1;
+				e2 += stepX2;
+			}
+			row0 += stepY0;
+			row1 += stepY1;
+			row2 += stepY2;
+		}
+	}
+
+	uint32_t coveredCount = 0;
+	for (const TexelSample& sample : samples)
+		coveredCount += sample.triangle != k_emptyTexel ? 1 : 0;
+
+	outSamples.reserve(coveredCount);
+	for (uint32_t y = tileY0; y <= tileY1; y++)
+	{
+		for (uint32_t x = tileX0; x <= tileX1; x++)
+		{
+			TexelSample sample = samples[(y - tileY0) * m_tileSize + (x - tileX0)];
+			if (sample.triangle == k_emptyTexel)
+				continue;
+			sample.texel = x | (y << 16);
+			outSamples.push_back(sample);
+		}
+	}
+}
+
+void UVRasterizer::interpolateTile(const std::vector<TexelSample>& samples,
+	const std::vector<SetupTriangle>& triangles,
+	const std::vector<WorldVertices>& world,
+	TexelRecord* outTexels) const
+{
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const TexelSample& sample = samples[i];
+		const SetupTriangle& tri = triangles[sample.triangle];
+		const WorldVertices& src = world[tri.meshIndex];
+		const uint32_t i0 = tri.vertexIndex[0];
+		const uint32_t i1 = tri.vertexIndex[1];
+		const uint32_t i2 = tri.vertexIndex[2];
+		const float w1 = sample.w1;
+		const float w2 = sample.w2;
+		const float w0 = 1.0f - w1 - w2;
+
+		TexelRecord& record = outTexels[i];
+		record.position = w0 * src.positions[i0] + w1 * src.positions[i1] + w2 * src.positions[i2];
+		record.normal = safeNormalize(w0 * src.normals[i0] + w1 * src.normals[i1] + w2 * src.normals[i2]);
+		record.tangent = safeNormalize(w0 * src.tangents[i0] + w1 * src.tangents[i1] + w2 * src.tangents[i2]);
+		record.smoothedNormal = safeNormalize(w0 * src.smoothedNormals[i0] + w1 * src.smoothedNormals[i1] + w2 * src.smoothedNormals[i2]);
+		const UVRasterMesh& mesh = m_meshes[tri.meshIndex];
+		record.cageOffset = mesh.cageOffsets ? w0 * mesh.cageOffsets[i0] + w1 * mesh.cageOffsets[i1] + w2 * mesh.cageOffsets[i2] : 0.0f;
+		record.primitiveID = mesh.primitiveID;
+		record.texel = sample.texel;
+	}
+}
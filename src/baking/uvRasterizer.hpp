@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "primitiveData.hpp"
+
+namespace Baking
+{
+	// World-space surface sample of a low-poly texel, everything the trace stage needs to build a ray
+	struct TexelRecord
+	{
+		// Left uninitialized on purpose - records are always fully written, and zero-filling
+		// hundreds of MB of output at 4k+ is a measurable part of rasterization time
+		TexelRecord() {}
+
+		glm::vec3 position;
+		uint32_t primitiveID;
+		glm::vec3 normal;
+		uint32_t texel; // packed as x | (y << 16)
+		glm::vec3 tangent;
+		glm::vec3 smoothedNormal;
+		float cageOffset; // interpolated per-vertex cage, 0 for meshes without one
+
+		uint32_t getX() const
+		{
+			return texel & 0xFFFF;
+		}
+		uint32_t getY() const
+		{
+			return texel >> 16;
+		}
+	};
+
+	// Range of TexelRecords belonging to one non-empty raster tile
+	struct TexelTileRange
+	{
+		uint32_t tileIndex; // tileY * tilesX + tileX
+		uint32_t texelOffset;
+		uint32_t texelCount;
+	};
+
+	struct UVRasterMesh
+	{
+		const Vertex* vertices = nullptr;
+		size_t vertexCount = 0;
+		const uint32_t* indices = nullptr;
+		size_t indexCount = 0;
+		glm::mat4 worldMatrix = glm::mat4(1.0f);
+		glm::vec2 uvOffset = glm::vec2(0.0f); // subtracted from texCoords, selects the UV tile to rasterize
+		const float* cageOffsets = nullptr;   // optional world-space ray start distance per vertex
+		uint32_t primitiveID = 0;
+	};
+
+	struct UVRasterResult
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t tileSize = 0;
+		uint32_t tilesX = 0;
+		uint32_t tilesY = 0;
+
+		std::vector<TexelRecord> texels;    // covered texels only, grouped by tile, row-major inside a tile
+		std::vector<TexelTileRange> tiles;  // non-empty tiles only, in tile index order
+
+		float getCoverage() const
+		{
+			const double total = static_cast<double>(width) * height;
+			return total > 0.0 ? static_cast<float>(texels.size() / total) : 0.0f;
+		}
+	};
+
+	// CPU rasterizer of low-poly meshes in UV space.
+	// Triangles are binned into square tiles and every tile is rasterized by one worker with
+	// fixed-point edge functions and the D3D top-left fill rule, so results match the GPU path
+	// texel for texel while keeping full fp32 precision for world-space attributes.
+	class UVRasterizer
+	{
+	public:
+		UVRasterizer(uint32_t width, uint32_t height, uint32_t tileSize = 64);
+
+		void addMesh(const UVRasterMesh& mesh);
+		UVRasterResult rasterize() const;
+
+	private:
+		struct SetupTriangle
+		{
+			int64_t x[3], y[3]; // 8.8 fixed point texel coordinates
+			int64_t area;
+			uint32_t meshIndex;
+			uint32_t vertexIndex[3];
+			uint32_t minTileX, minTileY, maxTileX, maxTileY;
+		};
+
+		struct TexelSample
+		{
+			uint32_t texel;
+			uint32_t triangle;
+			float w1;
+			float w2;
+		};
+
+		struct WorldVertices
+		{
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec3> normals;
+			std::vector<glm::vec3> tangents;
+			std::vector<glm::vec3> smoothedNormals;
+		};
+
+		void transformMeshes(std::vector<WorldVertices>& outWorld) const;
+		void setupTriangles(std::vector<SetupTriangle>& outTriangles) const;
+		void binTriangles(const std::vector<SetupTriangle>& triangles,
+			std::vector<uint32_t>& outTileOffsets,
+			std::vector<uint32_t>& outTileTriangles) const;
+		void rasterizeTile(uint32_t tileIndex,
+			const std::vector<SetupTriangle>& triangles,
+			const uint32_t* tileTriangles,
+			uint32_t tileTriangleCount,
+			std::vector<TexelSample>& outSamples) const;
+		void interpolateTile(const std::vector<TexelSample>& samples,
+			const std::vector<SetupTriangle>& triangles,
+			const std::vector<WorldVertices>& world,
+			TexelRecord* outTexels) const;
+
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_tileSize;
+		uint32_t m_tilesX;
+		uint32_t m_tilesY;
+		std::vector<UVRasterMesh> m_meshes;
+	};
+} // namespace Baking
@@ -0,0 +1,489 @@
+#include "bakeforge.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "baking/dilation.hpp"
+#include "baking/highPoly.hpp"
+#include "baking/meshProcessing.hpp"
+#include "baking/normalTracer.hpp"
+#include "baking/udim.hpp"
+#include "baking/uvIslands.hpp"
+#include "baking/uvRasterizer.hpp"
+#include "bvhBuilder.hpp"
+#include "utility/parallelFor.hpp"
+
+struct bf_mesh
+{
+	const uint8_t* positions = nullptr;
+	size_t positionStride = 0;
+	const uint8_t* normals = nullptr;
+	size_t normalStride = 0;
+	const uint8_t* texCoords = nullptr;
+	size_t texCoordStride = 0;
+	size_t vertexCount = 0;
+
+	// Borrowed when the caller's indices are tightly packed uint32, otherwise widened into ownedIndices
+	const uint32_t* indices = nullptr;
+	size_t indexCount = 0;
+	glm::mat4 transform = glm::mat4(1.0f);
+
+	std::vector<uint8_t> ownedAttributes; // BF_MESH_COPY_DATA only
+	std::vector<uint32_t> ownedIndices;
+
+	// Interleaved vertices with tangents and smoothed normals, built by the first bake using the mesh as a low-poly
+	mutable std::once_flag lowPolyPrepared;
+	mutable std::vector<Vertex> lowPolyVertices;
+
+	glm::vec3 getPosition(size_t vertex) const
+	{
+		glm::vec3 value;
+		std::memcpy(&value, positions + vertex * positionStride, sizeof(value));
+		return value;
+	}
+
+	glm::vec3 getNormal(size_t vertex) const
+	{
+		glm::vec3 value;
+		std::memcpy(&value, normals + vertex * normalStride, sizeof(value));
+		return value;
+	}
+
+	glm::vec2 getTexCoords(size_t vertex) const
+	{
+		glm::vec2 value;
+		std::memcpy(&value, texCoords + vertex * texCoordStride, sizeof(value));
+		return value;
+	}
+};
+
+struct bf_scene
+{
+	Baking::CombinedHighPolyData highPoly;
+};
+
+namespace
+{
+	thread_local std::string t_lastError;
+
+	struct ApiError : std::runtime_error
+	{
+		ApiError(bf_result result_, const std::string& message)
+			: std::runtime_error(message)
+			, result(result_)
+		{
+		}
+
+		bf_result result;
+	};
+
+	// Exceptions never cross the C boundary, they become a result code and the thread's last error
+	template <typename Fn>
+	bf_result guard(Fn&& fn)
+	{
+		try
+		{
+			fn();
+			t_lastError.clear();
+			return BF_OK;
+		}
+		catch (const ApiError& e)
+		{
+			t_lastError = e.what();
+			return e.result;
+		}
+		catch (const std::bad_alloc&)
+		{
+			t_lastError = "out of memory";
+			return BF_ERROR_OUT_OF_MEMORY;
+		}
+		catch (const std::exception& e)
+		{
+			t_lastError = e.what();
+			return BF_ERROR_INTERNAL;
+		}
+		catch (...)
+		{
+			t_lastError = "unknown error";
+			return BF_ERROR_INTERNAL;
+		}
+	}
+
+	void require(bool condition, const char* message)
+	{
+		if (!condition)
+			throw ApiError(BF_ERROR_INVALID_ARGUMENT, message);
+	}
+
+	// Copies one strided attribute into the owned block, returns its offset
+	size_t copyAttribute(std::vector<uint8_t>& block, const void* data, size_t stride, size_t elementSize, size_t count)
+	{
+		const size_t offset = block.size();
+		block.resize(offset + elementSize * count);
+		for (size_t i = 0; i < count; i++)
+		{
+			std::memcpy(block.data() + offset + i * elementSize, static_cast<const uint8_t*>(data) + i * stride, elementSize);
+		}
+		return offset;
+	}
+
+	void prepareLowPoly(const bf_mesh& mesh)
+	{
+		require(mesh.texCoords != nullptr, "low-poly meshes need texcoords");
+		std::call_once(mesh.lowPolyPrepared, [&]()
+			{
+				std::vector<Vertex> vertices(mesh.vertexCount);
+				Parallel::parallelForChunks(mesh.vertexCount, 16384, [&](size_t begin, size_t end)
+					{
+						for (size_t i = begin; i < end; i++)
+						{
+							vertices[i] = Vertex(mesh.getPosition(i), mesh.getNormal(i), mesh.getTexCoords(i), glm::vec3(0.0f));
+						}
+					});
+				Baking::computeSmoothNormals(vertices);
+				Baking::computeTangents(vertices, mesh.indices, mesh.indexCount);
+				mesh.lowPolyVertices = std::move(vertices);
+			});
+	}
+
+	struct HighPolyGeometry
+	{
+		std::vector<Triangle> triangles;
+		std::vector<uint32_t> triangleIndices;
+		std::vector<BVH::Node> bvhNodes;
+	};
+
+	// Triangles are gathered straight from the borrowed arrays, the BVH needs them in its own layout
+	void buildHighPoly(const bf_mesh& mesh, HighPolyGeometry& outGeometry)
+	{
+		const size_t triangleCount = mesh.indexCount / 3;
+		outGeometry.triangles.resize(triangleCount);
+		Parallel::parallelForChunks(triangleCount, 16384, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const uint32_t* corners = mesh.indices + i * 3;
+					Triangle& tri = outGeometry.triangles[i];
+					tri.v0 = mesh.getPosition(corners[0]);
+					tri.v1 = mesh.getPosition(corners[1]);
+					tri.v2 = mesh.getPosition(corners[2]);
+					tri.n0 = mesh.getNormal(corners[0]);
+					tri.n1 = mesh.getNormal(corners[1]);
+					tri.n2 = mesh.getNormal(corners[2]);
+				}
+			});
+
+		outGeometry.triangleIndices.resize(triangleCount);
+		for (uint32_t i = 0; i < triangleCount; i++)
+		{
+			outGeometry.triangleIndices[i] = i;
+		}
+		BVH::BVHBuilder builder(outGeometry.triangles, outGeometry.triangleIndices);
+		outGeometry.bvhNodes = builder.BuildBVH();
+	}
+
+	// Flat normal with alpha = 0, the tracer overwrites covered texels with alpha = 1
+	void clearToFlatNormal(uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch)
+	{
+		Parallel::parallelFor(height, [&](size_t y)
+			{
+				auto* row = reinterpret_cast<uint16_t*>(pixels + y * rowPitch);
+				for (uint32_t x = 0; x < width; x++)
+				{
+					row[x * 4 + 0] = 0x8000;
+					row[x * 4 + 1] = 0x8000;
+					row[x * 4 + 2] = 0xFFFF;
+					row[x * 4 + 3] = 0;
+				}
+			});
+	}
+
+	void padAndFinish(uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, uint32_t dilationDistance)
+	{
+		std::vector<uint8_t> coverage(static_cast<size_t>(width) * height);
+		Parallel::parallelFor(height, [&](size_t y)
+			{
+				auto* row = reinterpret_cast<uint16_t*>(pixels + y * rowPitch);
+				for (uint32_t x = 0; x < width; x++)
+				{
+					coverage[y * width + x] = row[x * 4 + 3] != 0;
+				}
+			});
+
+		Baking::dilate(pixels, width, height, rowPitch, 4 * sizeof(uint16_t), coverage.data(), dilationDistance);
+
+		Parallel::parallelFor(height, [&](size_t y)
+			{
+				auto* row = reinterpret_cast<uint16_t*>(pixels + y * rowPitch);
+				for (uint32_t x = 0; x < width; x++)
+				{
+					row[x * 4 + 3] = 0xFFFF;
+				}
+			});
+	}
+}
+
+uint32_t bf_get_api_version(void)
+{
+	return BF_API_VERSION;
+}
+
+const char* bf_get_last_error(void)
+{
+	return t_lastError.c_str();
+}
+
+void bf_mesh_desc_init(bf_mesh_desc* desc)
+{
+	if (!desc)
+		return;
+	std::memset(desc, 0, sizeof(*desc));
+	desc->struct_size = sizeof(*desc);
+	desc->index_type = BF_INDEX_UINT32;
+}
+
+bf_result bf_mesh_create(const bf_mesh_desc* desc, bf_mesh** out_mesh)
+{
+	return guard([&]()
+		{
+			require(desc && out_mesh, "desc and out_mesh must not be NULL");
+			require(desc->struct_size >= sizeof(bf_mesh_desc), "desc->struct_size is too small, use bf_mesh_desc_init");
+			require(desc->positions && desc->normals, "positions and normals are required");
+			require(desc->index_type == BF_INDEX_UINT32 || desc->index_type == BF_INDEX_UINT16, "unknown index type");
+			require(desc->vertex_count <= UINT32_MAX, "too many vertices");
+			*out_mesh = nullptr;
+
+			auto mesh = std::make_unique<bf_mesh>();
+			mesh->vertexCount = desc->vertex_count;
+			mesh->positionStride = desc->position_stride ? desc->position_stride : sizeof(glm::vec3);
+			mesh->normalStride = desc->normal_stride ? desc->normal_stride : sizeof(glm::vec3);
+			mesh->texCoordStride = desc->texcoord_stride ? desc->texcoord_stride : sizeof(glm::vec2);
+			mesh->positions = static_cast<const uint8_t*>(desc->positions);
+			mesh->normals = static_cast<const uint8_t*>(desc->normals);
+			mesh->texCoords = static_cast<const uint8_t*>(desc->texcoords);
+			if (desc->transform)
+			{
+				mesh->transform = glm::make_mat4(desc->transform);
+			}
+
+			if (desc->flags & BF_MESH_COPY_DATA)
+			{
+				std::vector<uint8_t>& block = mesh->ownedAttributes;
+				const size_t positions = copyAttribute(block, desc->positions, mesh->positionStride, sizeof(glm::vec3), mesh->vertexCount);
+				const size_t normals = copyAttribute(block, desc->normals, mesh->normalStride, sizeof(glm::vec3), mesh->vertexCount);
+				const size_t texCoords = desc->texcoords
+					? copyAttribute(block, desc->texcoords, mesh->texCoordStride, sizeof(glm::vec2), mesh->vertexCount) : 0;
+				mesh->positions = block.data() + positions;
+				mesh->positionStride = sizeof(glm::vec3);
+				mesh->normals = block.data() + normals;
+				mesh->normalStride = sizeof(glm::vec3);
+				mesh->texCoords = desc->texcoords ? block.data() + texCoords : nullptr;
+				mesh->texCoordStride = sizeof(glm::vec2);
+			}
+
+			const size_t indexSize = desc->index_type == BF_INDEX_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+			const size_t indexStride = desc->index_stride ? desc->index_stride : indexSize;
+			mesh->indexCount = desc->indices ? desc->index_count : desc->vertex_count;
+			require(mesh->indexCount % 3 == 0, "index_count must be a multiple of 3");
+			if (!desc->indices)
+			{
+				mesh->ownedIndices.resize(mesh->indexCount);
+				for (size_t i = 0; i < mesh->indexCount; i++)
+				{
+					mesh->ownedIndices[i] = static_cast<uint32_t>(i);
+				}
+				mesh->indices = mesh->ownedIndices.data();
+			}
+			else if (indexSize == sizeof(uint32_t) && indexStride == sizeof(uint32_t) && !(desc->flags & BF_MESH_COPY_DATA))
+			{
+				mesh->indices = static_cast<const uint32_t*>(desc->indices);
+			}
+			else
+			{
+				mesh->ownedIndices.resize(mesh->indexCount);
+				const auto* source = static_cast<const uint8_t*>(desc->indices);
+				for (size_t i = 0; i < mesh->indexCount; i++)
+				{
+					uint16_t index16 = 0;
+					uint32_t index32 = 0;
+					if (indexSize == sizeof(uint16_t))
+						std::memcpy(&index16, source + i * indexStride, sizeof(index16));
+					else
+						std::memcpy(&index32, source + i * indexStride, sizeof(index32));
+					mesh->ownedIndices[i] = indexSize == sizeof(uint16_t) ? index16 : index32;
+				}
+				mesh->indices = mesh->ownedIndices.data();
+			}
+
+			for (size_t i = 0; i < mesh->indexCount; i++)
+			{
+				require(mesh->indices[i] < mesh->vertexCount, "index out of range");
+			}
+			*out_mesh = mesh.release();
+		});
+}
+
+void bf_mesh_destroy(bf_mesh* mesh)
+{
+	delete mesh;
+}
+
+bf_result bf_scene_create(const bf_mesh* const* high_polys, size_t high_poly_count, bf_scene** out_scene)
+{
+	return guard([&]()
+		{
+			require(out_scene && (high_polys || high_poly_count == 0), "high_polys and out_scene must not be NULL");
+			*out_scene = nullptr;
+			for (size_t i = 0; i < high_poly_count; i++)
+			{
+				require(high_polys[i] != nullptr, "high_polys contains NULL");
+			}
+
+			std::vector<HighPolyGeometry> geometry(high_poly_count);
+			Parallel::parallelFor(high_poly_count, [&](size_t i)
+				{
+					if (high_polys[i]->indexCount > 0)
+					{
+						buildHighPoly(*high_polys[i], geometry[i]);
+					}
+				});
+
+			std::vector<Baking::HighPolyMesh> meshes;
+			for (size_t i = 0; i < high_poly_count; i++)
+			{
+				if (geometry[i].triangles.empty())
+					continue;
+				Baking::HighPolyMesh mesh;
+				mesh.triangles = &geometry[i].triangles;
+				mesh.triangleIndices = &geometry[i].triangleIndices;
+				mesh.bvhNodes = &geometry[i].bvhNodes;
+				mesh.worldMatrix = high_polys[i]->transform;
+				mesh.worldBBox = Baking::transformBBox(geometry[i].bvhNodes[0].bbox, mesh.worldMatrix);
+				meshes.push_back(mesh);
+			}
+			if (meshes.empty())
+				throw ApiError(BF_ERROR_NO_GEOMETRY, "high-poly meshes have no triangles");
+
+			auto scene = std::make_unique<bf_scene>();
+			scene->highPoly = Baking::combineHighPolys(meshes);
+			*out_scene = scene.release();
+		});
+}
+
+void bf_scene_destroy(bf_scene* scene)
+{
+	delete scene;
+}
+
+void bf_bake_settings_init(bf_bake_settings* settings)
+{
+	if (!settings)
+		return;
+	std::memset(settings, 0, sizeof(*settings));
+	settings->struct_size = sizeof(*settings);
+	settings->cage_offset = 0.1f;
+	settings->use_smoothed_normals = 0;
+	settings->ray_direction_blend = 0.0f;
+	settings->edge_padding = 16;
+	settings->udim_tile = Baking::k_firstUDIM;
+}
+
+bf_result bf_bake_normals(const bf_mesh* const* low_polys,
+	size_t low_poly_count,
+	const bf_scene* scene,
+	const bf_bake_settings* settings,
+	const bf_image* output)
+{
+	return guard([&]()
+		{
+			require(low_polys && scene && settings && output && output->pixels, "arguments must not be NULL");
+			require(settings->struct_size >= sizeof(bf_bake_settings), "settings->struct_size is too small, use bf_bake_settings_init");
+			require(output->format == BF_FORMAT_RGBA8 || output->format == BF_FORMAT_RGBA16, "unknown pixel format");
+			// Texel coordinates are packed into 16 bits
+			require(output->width > 0 && output->height > 0 && output->width <= 0xFFFF && output->height <= 0xFFFF,
+				"output size must be between 1 and 65535");
+			const size_t texelSize = output->format == BF_FORMAT_RGBA16 ? 4 * sizeof(uint16_t) : 4;
+			const size_t outputPitch = output->row_pitch ? output->row_pitch : output->width * texelSize;
+			require(outputPitch >= output->width * texelSize, "row_pitch is smaller than a row");
+
+			std::vector<Baking::UVRasterMesh> meshes(low_poly_count);
+			for (size_t i = 0; i < low_poly_count; i++)
+			{
+				require(low_polys[i] != nullptr, "low_polys contains NULL");
+				const bf_mesh& lowPoly = *low_polys[i];
+				prepareLowPoly(lowPoly);
+				Baking::UVRasterMesh& mesh = meshes[i];
+				mesh.vertices = lowPoly.lowPolyVertices.data();
+				mesh.vertexCount = lowPoly.lowPolyVertices.size();
+				mesh.indices = lowPoly.indices;
+				mesh.indexCount = lowPoly.indexCount;
+				mesh.worldMatrix = lowPoly.transform;
+				mesh.primitiveID = static_cast<uint32_t>(i);
+			}
+
+			// Same island reuse and tile binning as the GUI and headless bakes, then only the requested tile
+			const Baking::UVIslandReport report = Baking::analyzeUVIslands(meshes);
+			size_t droppedTriangles = 0;
+			const std::vector<Baking::UDIMTile> tiles =
+				Baking::binTrianglesByUDIM(meshes, Baking::buildMasterIndices(meshes, report), droppedTriangles);
+			const auto tile = std::find_if(tiles.begin(), tiles.end(),
+				[&](const Baking::UDIMTile& candidate) { return candidate.number == settings->udim_tile; });
+			if (tile == tiles.end())
+				throw ApiError(BF_ERROR_NO_GEOMETRY, "low-poly meshes have no triangles in udim_tile");
+
+			Baking::UVRasterizer rasterizer(output->width, output->height);
+			for (size_t i = 0; i < meshes.size(); i++)
+			{
+				Baking::UVRasterMesh mesh = meshes[i];
+				mesh.indices = tile->indices[i].data();
+				mesh.indexCount = tile->indices[i].size();
+				mesh.uvOffset = tile->uvOffset;
+				rasterizer.addMesh(mesh);
+			}
+			Baking::UVRasterResult texels = rasterizer.rasterize();
+
+			// RGBA16 output is traced in place, RGBA8 goes through a 16-bit copy
+			std::vector<uint16_t> pixels16;
+			uint8_t* pixels = static_cast<uint8_t*>(output->pixels);
+			size_t rowPitch = outputPitch;
+			if (output->format == BF_FORMAT_RGBA8)
+			{
+				pixels16.resize(static_cast<size_t>(output->width) * output->height * 4);
+				pixels = reinterpret_cast<uint8_t*>(pixels16.data());
+				rowPitch = output->width * 4 * sizeof(uint16_t);
+			}
+
+			clearToFlatNormal(pixels, output->width, output->height, rowPitch);
+			Baking::NormalTraceSettings traceSettings;
+			traceSettings.cageOffset = settings->cage_offset;
+			traceSettings.useSmoothedNormals = settings->use_smoothed_normals != 0;
+			traceSettings.rayDirectionBlend = std::clamp(settings->ray_direction_blend, 0.0f, 1.0f);
+			Baking::NormalTracer(scene->highPoly).trace(texels, traceSettings, pixels, rowPitch);
+			texels = Baking::UVRasterResult();
+
+			const uint32_t dilationDistance = settings->edge_padding < 0 ? Baking::k_infiniteDilation
+				: static_cast<uint32_t>(settings->edge_padding);
+			padAndFinish(pixels, output->width, output->height, rowPitch, dilationDistance);
+
+			if (output->format == BF_FORMAT_RGBA8)
+			{
+				Parallel::parallelFor(output->height, [&](size_t y)
+					{
+						const uint16_t* source = pixels16.data() + y * output->width * 4;
+						uint8_t* target = static_cast<uint8_t*>(output->pixels) + y * outputPitch;
+						for (size_t i = 0; i < output->width * 4; i++)
+						{
+							target[i] = static_cast<uint8_t>((source[i] + 128) / 257);
+						}
+					});
+			}
+		});
+}
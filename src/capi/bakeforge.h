@@ -0,0 +1,129 @@
+#ifndef BAKEFORGE_H
+#define BAKEFORGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// C API of the CPU baker, for calling BakeForge from other applications without going through files.
+// Meshes borrow the caller's vertex and index arrays, results are written into caller-provided images.
+// Meshes and scenes are immutable once created and may be used from several threads at once.
+// Every function returning bf_result stores a message for bf_get_last_error on failure.
+
+#if defined(_WIN32)
+#if defined(BF_BUILD_LIBRARY)
+#define BF_API __declspec(dllexport)
+#else
+#define BF_API __declspec(dllimport)
+#endif
+#else
+#define BF_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BF_API_VERSION 1
+
+	typedef enum bf_result
+	{
+		BF_OK = 0,
+		BF_ERROR_INVALID_ARGUMENT = 1,
+		BF_ERROR_NO_GEOMETRY = 2,
+		BF_ERROR_OUT_OF_MEMORY = 3,
+		BF_ERROR_INTERNAL = 4
+	} bf_result;
+
+	typedef enum bf_index_type
+	{
+		BF_INDEX_UINT32 = 0,
+		BF_INDEX_UINT16 = 1
+	} bf_index_type;
+
+	typedef enum bf_mesh_flags
+	{
+		// Copy the arrays instead of borrowing them, they may be freed right after bf_mesh_create
+		BF_MESH_COPY_DATA = 1
+	} bf_mesh_flags;
+
+	typedef enum bf_pixel_format
+	{
+		BF_FORMAT_RGBA8 = 0,  // 4 x uint8 UNORM
+		BF_FORMAT_RGBA16 = 1  // 4 x uint16 UNORM, written in place without an intermediate copy
+	} bf_pixel_format;
+
+	typedef struct bf_mesh bf_mesh;
+	typedef struct bf_scene bf_scene;
+
+	// Borrowed triangle list. Attributes are float arrays, a stride of 0 means tightly packed.
+	// Unless BF_MESH_COPY_DATA is set the arrays must stay valid and unchanged until bf_mesh_destroy.
+	typedef struct bf_mesh_desc
+	{
+		uint32_t struct_size; // sizeof(bf_mesh_desc), set by bf_mesh_desc_init
+
+		const void* positions; // float3, required
+		size_t position_stride;
+		const void* normals;   // float3, required
+		size_t normal_stride;
+		const void* texcoords; // float2, required for low-poly meshes, unused by high-poly meshes
+		size_t texcoord_stride;
+		size_t vertex_count;
+
+		const void* indices; // NULL for a non-indexed triangle list
+		bf_index_type index_type;
+		size_t index_stride;
+		size_t index_count;
+
+		const float* transform; // 16 floats, column-major local to world matrix, NULL for identity
+		uint32_t flags;         // bf_mesh_flags
+	} bf_mesh_desc;
+
+	typedef struct bf_bake_settings
+	{
+		uint32_t struct_size; // sizeof(bf_bake_settings), set by bf_bake_settings_init
+
+		float cage_offset;         // ray start distance along the low-poly normal
+		int32_t use_smoothed_normals;
+		float ray_direction_blend; // 0 = smoothed normal direction, 1 = face normal direction
+		int32_t edge_padding;      // texels, 0 disables padding, < 0 pads the whole image
+		uint32_t udim_tile;        // UV tile to bake, 1001 is the 0-1 range
+	} bf_bake_settings;
+
+	// Caller-owned output image. Texels outside of the low-poly UVs get the flat normal or edge padding.
+	typedef struct bf_image
+	{
+		void* pixels;
+		uint32_t width;
+		uint32_t height;
+		size_t row_pitch; // bytes between rows, 0 for tightly packed
+		bf_pixel_format format;
+	} bf_image;
+
+	BF_API uint32_t bf_get_api_version(void);
+	// Message of the last failed call on this thread, empty if there is none
+	BF_API const char* bf_get_last_error(void);
+
+	BF_API void bf_mesh_desc_init(bf_mesh_desc* desc);
+	BF_API bf_result bf_mesh_create(const bf_mesh_desc* desc, bf_mesh** out_mesh);
+	BF_API void bf_mesh_destroy(bf_mesh* mesh);
+
+	// Builds the acceleration structure of the high-poly meshes, reusable for any number of bakes.
+	// The meshes may be destroyed once the scene is created.
+	BF_API bf_result bf_scene_create(const bf_mesh* const* high_polys, size_t high_poly_count, bf_scene** out_scene);
+	BF_API void bf_scene_destroy(bf_scene* scene);
+
+	BF_API void bf_bake_settings_init(bf_bake_settings* settings);
+	// Bakes a tangent space normal map of the low-poly meshes against the scene into output.
+	// Returns BF_ERROR_NO_GEOMETRY if no low-poly triangle lies in settings->udim_tile.
+	BF_API bf_result bf_bake_normals(const bf_mesh* const* low_polys,
+		size_t low_poly_count,
+		const bf_scene* scene,
+		const bf_bake_settings* settings,
+		const bf_image* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BAKEFORGE_H
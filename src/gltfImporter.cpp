@@ -5,28 +5,35 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include "baking/gltfGeometry.hpp"
 #include "material.hpp"
 #include "primitive.hpp"
 #include "scene.hpp"
 #include "texture.hpp"
 
+#include "utility/hash.hpp"
+#include "utility/parallelFor.hpp"
+
 
 GLTFModel::GLTFModel(const std::string& path, ComPtr<ID3D11Device> device, Scene* scene)
 	: m_device(device)
 	, m_deferredContext(nullptr)
 	, m_scene(scene)
 	, m_progress(nullptr)
+	, m_contentIndex(scene ? scene->getContentIndex() : SceneContentIndex())
 {
-	const tinygltf::Model model = readGlb(path);
+	tinygltf::Model model = readGlb(path);
 	processGlb(model);
 }
 
 
 
-std::future<AsyncImportResult> GLTFModel::importModelAsync(
-	const std::string& path, ComPtr<ID3D11Device> device, std::shared_ptr<ImportProgress> progress)
+std::future<AsyncImportResult> GLTFModel::importModelAsync(const std::string& path,
+	ComPtr<ID3D11Device> device,
+	std::shared_ptr<ImportProgress> progress,
+	SceneContentIndex contentIndex)
 {
-	return std::async(std::launch::async, [path, device, progress]() -> AsyncImportResult
+	return std::async(std::launch::async, [path, device, progress, contentIndex = std::move(contentIndex)]() mutable -> AsyncImportResult
 		{
 			AsyncImportResult result;
 			result.progress = progress;
@@ -43,7 +50,7 @@ std::future<AsyncImportResult> GLTFModel::importModelAsync(
 					return result;
 				}
 
-				GLTFModel importer(path, device, deferredCtx, progress);
+				GLTFModel importer(path, device, deferredCtx, progress, std::move(contentIndex));
 
 				result.primitives = std::move(importer.m_pendingPrimitives);
 				result.textures = std::move(importer.m_pendingTextures);
@@ -96,45 +103,27 @@ void GLTFModel::finalizeAsyncImport(
 	}
 }
 
-GLTFModel::GLTFModel(const std::string& path, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deferredContext, std::shared_ptr<ImportProgress> progress)
+GLTFModel::GLTFModel(const std::string& path, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deferredContext, std::shared_ptr<ImportProgress> progress,
+	SceneContentIndex contentIndex)
 	: m_device(device)
 	, m_deferredContext(deferredContext)
 	, m_scene(nullptr)
 	, m_progress(progress)
+	, m_contentIndex(std::move(contentIndex))
 {
-	const tinygltf::Model model = readGlb(path);
+	tinygltf::Model model = readGlb(path);
 	processGlb(model);
 }
 
 
 tinygltf::Model GLTFModel::readGlb(const std::string& path)
 {
-	tinygltf::TinyGLTF loader;
 	tinygltf::Model model;
-	std::string err;
-	std::string warn;
-	std::cout << "Loading glTF file: " << path << std::endl;
-	bool ret = false;
-	if (path.ends_with("gltf"))
-	{
-		ret = loader.LoadASCIIFromFile(&model, &err, &warn, path);
-	}
-	else
-	{
-		ret = loader.LoadBinaryFromFile(&model, &err, &warn, path);
-	}
-
-	if (!warn.empty())
-		std::cout << "Warn: " << warn << std::endl;
-	if (!err.empty())
-		std::cout << "Err: " << err << std::endl;
-	if (!ret)
-		std::cout << "Failed to parse glTF" << std::endl;
-	std::cout << "Loaded " << path << std::endl;
+	Baking::readGLTFFile(path, model);
 	return model;
 }
 
-void GLTFModel::processGlb(const tinygltf::Model& model)
+void GLTFModel::processGlb(tinygltf::Model& model)
 {
 	std::cout << "Processing GLTF model with " << model.meshes.size() << " meshes" << std::endl;
 
@@ -171,31 +160,16 @@ void GLTFModel::processGlb(const tinygltf::Model& model)
 	{
 		for (const auto& gltfPrimitive : mesh.primitives)
 		{
-			std::vector<Position> posBuffer;
-			std::vector<TexCoords> texCoordsBuffer;
-			std::vector<Normal> normalBuffer;
+			std::vector<Vertex> vertexData;
 			std::vector<uint32_t> indices;
+			Baking::readGLTFPrimitive(model, mesh, gltfPrimitive, vertexData, indices);
 
-			processPosAttribute(model, mesh, gltfPrimitive, posBuffer);
-			processTexCoordAttribute(model, mesh, gltfPrimitive, texCoordsBuffer);
-			processIndexAttrib(model, mesh, gltfPrimitive, indices);
-			processNormalsAttribute(model, mesh, gltfPrimitive, normalBuffer);
-			std::vector<Vertex> vertexData;
-			const auto numVert = posBuffer.size();
-			for (int i = 0; i < numVert; i++)
-			{
-				Vertex interData{};
-				interData.position = posBuffer[i];
-				interData.texCoords = i < texCoordsBuffer.size() ? texCoordsBuffer[i] : TexCoords(0, 0);
-				interData.normal = i < normalBuffer.size() ? normalBuffer[i] : Normal(0, 1, 0);
-				vertexData.push_back(interData);
-			}
 			size_t meshIndex = &mesh - &model.meshes[0];
-			Transform transform = getTransformFromNode(meshIndex, model);
+			Transform transform = Baking::getGLTFMeshTransform(meshIndex, model);
 			auto primitive = std::make_unique<Primitive>(m_device);
 
 			primitive->transform = transform;
-			primitive->name = model.nodes[meshIndex].name;
+			primitive->name = Baking::getGLTFMeshName(meshIndex, model);
 
 			primitive->setVertexData(std::move(vertexData));
 			primitive->setIndexData(std::move(indices));
@@ -253,25 +227,69 @@ void GLTFModel::processTextures(const tinygltf::Model& model)
 	}
 }
 
-void GLTFModel::processImages(const tinygltf::Model& model)
+void GLTFModel::processImages(tinygltf::Model& model)
 {
-	for (int i = 0; i < model.images.size(); i++)
+	const auto getImageName = [&model](size_t i)
+		{
+			return model.images[i].name.empty() ? model.images[i].uri : model.images[i].name;
+		};
+
+	// The encoded bytes identify an image, whatever it is called and whichever file embeds it
+	std::vector<uint64_t> contentHashes(model.images.size());
+	Parallel::parallelFor(model.images.size(), [&](size_t i)
+		{
+			contentHashes[i] = Hash::bytes(model.images[i].image.data(), model.images[i].image.size());
+		});
+
+	std::vector<size_t> imagesToDecode;
+	std::unordered_map<uint64_t, size_t> decodedImageOfHash;
+	std::vector<std::pair<size_t, size_t>> duplicateImages; // image, the image of this import decoded in its place
+	size_t sharedImages = 0;
+	size_t sharedEncodedBytes = 0;
+	size_t sharedTextureBytes = 0;
+	for (size_t i = 0; i < model.images.size(); i++)
 	{
-		std::string name = model.images[i].name;
-		if (name.empty())
+		if (m_scene && m_scene->getTexture(getImageName(i)) != nullptr)
 		{
-			name = model.images[i].uri;
+			m_imageIndex[static_cast<uint32_t>(i)] = m_scene->getTexture(getImageName(i));
 		}
-
-		std::shared_ptr<Texture> texture;
-		if (m_scene && m_scene->getTexture(name) != nullptr)
+		else if (const auto it = m_contentIndex.textures.find(contentHashes[i]); it != m_contentIndex.textures.end())
 		{
-			texture = m_scene->getTexture(name);
+			m_imageIndex[static_cast<uint32_t>(i)] = it->second.texture;
+			sharedImages++;
+			sharedEncodedBytes += model.images[i].image.size();
+			sharedTextureBytes += it->second.memoryBytes;
+		}
+		else if (const auto [decodedImage, isFirst] = decodedImageOfHash.emplace(contentHashes[i], i); !isFirst)
+		{
+			duplicateImages.emplace_back(i, decodedImage->second);
 		}
 		else
 		{
+			imagesToDecode.push_back(i);
+		}
+	}
+
+	// Images decode on all cores, each one is uploaded as soon as it is ready. The context isn't thread safe,
+	// so uploads stay on this thread.
+	size_t uploadedImages = 0;
+	Baking::decodeGLTFImages(model, imagesToDecode, [&](size_t i, bool decoded)
+		{
+			uploadedImages++;
+			if (m_progress)
+			{
+				m_progress->progress = 0.2f + 0.1f * (static_cast<float>(uploadedImages) / imagesToDecode.size());
+			}
+			if (!decoded)
+				return; // materials using it get no texture
+
+			tinygltf::Image& image = model.images[i];
 			// Pass deferred context for async path, nullptr (immediate) for sync path
-			texture = std::make_shared<Texture>(model.images[i], m_device, m_deferredContext);
+			auto texture = std::make_shared<Texture>(image, m_device, m_deferredContext);
+			texture->contentHash = contentHashes[i];
+			// The upload copied the pixels, release them before the next images arrive
+			std::vector<unsigned char>().swap(image.image);
+			m_contentIndex.textures[texture->contentHash] = { texture, texture->getMemoryBytes() };
 			if (m_scene)
 			{
 				m_scene->addTexture(std::shared_ptr<Texture>(texture));
@@ -280,8 +298,23 @@ void GLTFModel::processImages(const tinygltf::Model& model)
 			{
 				m_pendingTextures.push_back(texture);
 			}
-		}
-		m_imageIndex[i] = texture;
+			m_imageIndex[static_cast<uint32_t>(i)] = texture;
+		});
+
+	for (const auto& [image, decodedImage] : duplicateImages)
+	{
+		const std::shared_ptr<Texture>& texture = m_imageIndex[static_cast<uint32_t>(decodedImage)];
+		m_imageIndex[static_cast<uint32_t>(image)] = texture;
+		sharedImages++;
+		sharedEncodedBytes += model.images[image].image.size();
+		sharedTextureBytes += texture ? texture->getMemoryBytes() : 0;
+	}
+
+	if (sharedImages > 0)
+	{
+		constexpr double bytesPerMB = 1024.0 * 1024.0;
+		std::cout << "Shared " << sharedImages << " images with identical content: " << sharedEncodedBytes / bytesPerMB
+			<< " MB not decoded, " << sharedTextureBytes / bytesPerMB << " MB of textures not uploaded" << std::endl;
 	}
 }
 
@@ -343,171 +376,3 @@ void GLTFModel::processMaterials(const tinygltf::Model& model)
 		std::cout << "Processed " << model.materials.size() << " materials." << std::endl;
 	}
 }
-
-void GLTFModel::processPosAttribute(const tinygltf::Model& model, const tinygltf::Mesh& mesh, const tinygltf::Primitive& primitive, std::vector<Position>& verticies)
-{
-	if (!primitive.attributes.contains("POSITION"))
-	{
-		std::cerr << "No POSITION attribute found in primitive " << mesh.name << std::endl;
-		return;
-	}
-	const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
-	const tinygltf::BufferView& posBufferView = model.bufferViews[posAccessor.bufferView];
-	const tinygltf::Buffer& posBuffer = model.buffers[posBufferView.buffer];
-
-	const unsigned char* posDataPtr = posBuffer.data.data() + posAccessor.byteOffset + posBufferView.byteOffset;
-	const auto posFloatPtr = reinterpret_cast<const float*>(posDataPtr);
-	const size_t vertexCount = posAccessor.count;
-	const int components = (posAccessor.type == TINYGLTF_TYPE_VEC3) ? 3 : 0;
-
-	for (size_t i = 0; i < vertexCount; i++)
-	{
-		Position position(-INFINITY, -INFINITY, -INFINITY);
-		for (int j = 0; j < components; j++)
-		{
-			if (j == 0)
-				position.x = posFloatPtr[i * components + j];
-			else if (j == 1)
-				position.y = posFloatPtr[i * components + j];
-			else if (j == 2)
-				position.z = posFloatPtr[i * components + j];
-		}
-		verticies.push_back(position);
-	}
-}
-
-void GLTFModel::processTexCoordAttribute(const tinygltf::Model& model, const tinygltf::Mesh& mesh, const tinygltf::Primitive& primitive, std::vector<TexCoords>& texCoords)
-{
-	if (!primitive.attributes.contains("TEXCOORD_0"))
-	{
-		std::cerr << "No TEXCOORD_0 attribute found in primitive " << mesh.name << std::endl;
-		return;
-	}
-	const tinygltf::Accessor& accessor = model.accessors[primitive.attributes.at("TEXCOORD_0")];
-	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-	const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
-
-	const unsigned char* posDataPtr = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
-	const auto posFloatPtr = reinterpret_cast<const float*>(posDataPtr);
-	const size_t vertexCount = accessor.count;
-	const int components = (accessor.type == TINYGLTF_TYPE_VEC2) ? 2 : 0;
-
-	for (size_t i = 0; i < vertexCount; i++)
-	{
-		TexCoords texCoord(-INFINITY, -INFINITY);
-		for (int j = 0; j < components; j++)
-		{
-			if (j == 0)
-				texCoord.x = posFloatPtr[i * components + j];
-			else if (j == 1)
-				texCoord.y = posFloatPtr[i * components + j];
-		}
-		texCoords.push_back(texCoord);
-	}
-}
-
-void GLTFModel::processIndexAttrib(const tinygltf::Model& model, const tinygltf::Mesh& mesh, const tinygltf::Primitive& primitive, std::vector<uint32_t>& indicies)
-{
-	if (primitive.indices < 0)
-	{
-		std::cerr << "No indices found in primitive " << mesh.name << std::endl;
-		return;
-	}
-	const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
-	const tinygltf::BufferView& indexBufferView = model.bufferViews[indexAccessor.bufferView];
-	const tinygltf::Buffer& indexBuffer = model.buffers[indexBufferView.buffer];
-
-
-	const void* pIndexData = indexBuffer.data.data() + indexBufferView.byteOffset + indexAccessor.byteOffset;
-	const size_t indexCount = indexAccessor.count;
-	if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-	{
-		const auto indices = static_cast<const uint16_t*>(pIndexData);
-		indicies.assign(indices, indices + indexCount);
-	}
-	else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-	{
-		const auto indices = static_cast<const uint32_t*>(pIndexData);
-		indicies.assign(indices, indices + indexCount);
-	}
-	else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-	{
-		const auto indices = static_cast<const uint8_t*>(pIndexData);
-		indicies.assign(indices, indices + indexCount);
-	}
-}
-
-void GLTFModel::processNormalsAttribute(const tinygltf::Model& model,
-	const tinygltf::Mesh& mesh,
-	const tinygltf::Primitive& primitive,
-	std::vector<Normal>& normals)
-{
-	if (!primitive.attributes.contains("NORMAL"))
-	{
-		std::cerr << "No NORMAL attribute found in primitive " << mesh.name << std::endl;
-		return;
-	}
-	const tinygltf::Accessor& accessor = model.accessors[primitive.attributes.at("NORMAL")];
-	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-	const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
-
-	const unsigned char* dataPtr = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
-	const size_t vertexCount = accessor.count;
-
-	// Use byteStride if specified, otherwise assume tightly packed vec3 floats
-	size_t byteStride = bufferView.byteStride;
-	if (byteStride == 0)
-		byteStride = sizeof(float) * 3;  // tightly packed
-
-	for (size_t i = 0; i < vertexCount; i++)
-	{
-		const float* floatPtr = reinterpret_cast<const float*>(dataPtr + i * byteStride);
-		Normal normal;
-		normal.x = floatPtr[0];
-		normal.y = floatPtr[1];
-		normal.z = floatPtr[2];
-		normals.push_back(normal);
-	}
-}
-
-
-Transform GLTFModel::getTransformFromNode(const size_t meshIndex, const tinygltf::Model& model)
-{
-	Transform transform;
-	transform.position = glm::vec3(0.0f, 0.0f, 0.0f);
-	tinygltf::Node node;
-	for (const auto& n : model.nodes)
-	{
-		if (n.mesh == static_cast<int>(meshIndex))
-		{
-			node = n;
-			break;
-		}
-	}
-	if (node.translation.size() != 0)
-	{
-		transform.position = glm::vec3(node.translation[0], node.translation[1],
-			node.translation[2]);
-	}
-
-	transform.rotation = glm::vec3(0.0f, 0.0f, 0.0f);
-	if (node.rotation.size() >= 4)
-	{
-		const glm::quat quatRot(
-			static_cast<float>(node.rotation[3]),  // w
-			static_cast<float>(node.rotation[0]),  // x
-			static_cast<float>(node.rotation[1]),  // y
-			static_cast<float>(node.rotation[2])); // z
-
-		transform.rotation = glm::degrees(glm::eulerAngles(quatRot));
-	}
-
-	transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
-	if (node.scale.size() != 0)
-	{
-		transform.scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
-	}
-	transform.matrix = glm::mat4(1.0f);
-	transform.updateMatrix();
-	return transform;
-}
@@ -55,6 +55,18 @@ struct AsyncImportResult
 	std::vector<std::shared_ptr<Material>> materials;
 };
 
+// Textures an import shares instead of decoding and uploading them again. Snapshotted from the scene on the
+// main thread, so the async import never reads the scene itself.
+struct SceneContentIndex
+{
+	struct SharedTexture
+	{
+		std::shared_ptr<Texture> texture;
+		size_t memoryBytes = 0; // of its complete mip chain, what a duplicate would have uploaded
+	};
+	std::unordered_map<uint64_t, SharedTexture> textures; // by Texture::contentHash
+};
+
 
 class GLTFModel
 {
@@ -63,8 +75,10 @@ public:
 	GLTFModel(const std::string& path, ComPtr<ID3D11Device> device, Scene* scene);
 	~GLTFModel() = default;
 
-	static std::future<AsyncImportResult>
-	importModelAsync(const std::string& path, ComPtr<ID3D11Device> device, std::shared_ptr<ImportProgress> progress);
+	static std::future<AsyncImportResult> importModelAsync(const std::string& path,
+		ComPtr<ID3D11Device> device,
+		std::shared_ptr<ImportProgress> progress,
+		SceneContentIndex contentIndex = {});
 
 	static void
 	finalizeAsyncImport(AsyncImportResult&& importResult, ComPtr<ID3D11DeviceContext> immediateContext, Scene* scene);
@@ -73,39 +87,20 @@ private:
 	GLTFModel(const std::string& path,
 			  ComPtr<ID3D11Device> device,
 			  ComPtr<ID3D11DeviceContext> deferredContext,
-			  std::shared_ptr<ImportProgress> progress);
+			  std::shared_ptr<ImportProgress> progress,
+			  SceneContentIndex contentIndex);
 
 	static tinygltf::Model readGlb(const std::string& path);
-	void processGlb(const tinygltf::Model& model);
+	void processGlb(tinygltf::Model& model);
 	void processTextures(const tinygltf::Model& model);
-	void processImages(const tinygltf::Model& model);
+	void processImages(tinygltf::Model& model);
 	void processMaterials(const tinygltf::Model& model);
 
-	static void processPosAttribute(const tinygltf::Model& model,
-									const tinygltf::Mesh& mesh,
-									const tinygltf::Primitive& primitive,
-									std::vector<Position>& verticies);
-
-	static void processTexCoordAttribute(const tinygltf::Model& model,
-										 const tinygltf::Mesh& mesh,
-										 const tinygltf::Primitive& primitive,
-										 std::vector<TexCoords>& texCoords);
-
-	static void processIndexAttrib(const tinygltf::Model& model,
-								   const tinygltf::Mesh& mesh,
-								   const tinygltf::Primitive& primitive,
-								   std::vector<uint32_t>& indicies);
-
-	static void processNormalsAttribute(const tinygltf::Model& model,
-										const tinygltf::Mesh& mesh,
-										const tinygltf::Primitive& primitive,
-										std::vector<Normal>& normal);
-
-	static Transform getTransformFromNode(size_t meshIndex, const tinygltf::Model& model);
 	ComPtr<ID3D11Device> m_device;
 	ComPtr<ID3D11DeviceContext> m_deferredContext = nullptr;
 	Scene* m_scene = nullptr;
 	std::shared_ptr<ImportProgress> m_progress;
+	SceneContentIndex m_contentIndex; // grows with the textures this import creates
 
 	std::unordered_map<uint32_t, uint32_t> m_textureIndex;
 	std::unordered_map<uint32_t, std::shared_ptr<Texture>> m_imageIndex;
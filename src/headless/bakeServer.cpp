@@ -0,0 +1,278 @@
+#include "bakeServer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <json.hpp>
+
+#include "baking/bakeCache.hpp"
+#include "batchBaker.hpp"
+#include "sceneCache.hpp"
+#include "socket.hpp"
+#include "utility/hash.hpp"
+#include "utility/jobSystem.hpp"
+
+using namespace Headless;
+
+namespace
+{
+	constexpr int k_pollMs = 200;
+	constexpr size_t k_maxRequestBytes = 64 * 1024 * 1024;
+
+	nlohmann::json makeError(const std::string& error)
+	{
+		return { { "ok", false }, { "error", error } };
+	}
+
+	class BakeServer
+	{
+	public:
+		BakeServer(const ServerSettings& settings, Coordinator* coordinator)
+			: m_settings(settings)
+			, m_jobs(std::max(1u, settings.parallelJobs), settings.memoryBudgetMB * 1024 * 1024)
+			, m_cache(settings.cacheBudgetMB * 1024 * 1024)
+			, m_bakeCache(settings.bakeCacheDirectory)
+		{
+			m_services.coordinator = coordinator;
+			m_services.sceneCache = &m_cache;
+			m_services.bakeCache = m_bakeCache.isEnabled() ? &m_bakeCache : nullptr;
+		}
+
+		int run()
+		{
+			// Requests name arbitrary files to read and write, so only local clients are accepted
+			m_listenSocket = Socket::listen(m_settings.port, true);
+			if (!m_listenSocket.isValid())
+			{
+				std::cerr << "Cannot listen on port " << m_settings.port << std::endl;
+				return k_exitUsage;
+			}
+			std::cout << "Bake server listening on 127.0.0.1:" << m_listenSocket.getLocalPort() << ", "
+				<< m_settings.cacheBudgetMB << " MB scene cache" << std::endl;
+
+			while (!m_stop)
+			{
+				Socket socket = m_listenSocket.accept(k_pollMs);
+				reapClients();
+				if (!socket.isValid())
+					continue;
+
+				auto client = std::make_shared<Client>();
+				client->socket = std::move(socket);
+				client->name = client->socket.getPeerName();
+				client->thread = std::thread(&BakeServer::serveClient, this, client.get());
+				std::lock_guard<std::mutex> lock(m_clientsMutex);
+				m_clients.push_back(std::move(client));
+			}
+
+			m_listenSocket.close();
+			std::list<std::shared_ptr<Client>> clients;
+			{
+				std::lock_guard<std::mutex> lock(m_clientsMutex);
+				clients.swap(m_clients);
+			}
+			for (const std::shared_ptr<Client>& client : clients)
+			{
+				client->thread.join();
+			}
+			std::cout << "Bake server stopped" << std::endl;
+			return k_exitSuccess;
+		}
+
+	private:
+		struct Client
+		{
+			Socket socket;
+			std::string name;
+			std::thread thread;
+			std::atomic<bool> finished = false;
+		};
+
+		void reapClients()
+		{
+			std::lock_guard<std::mutex> lock(m_clientsMutex);
+			for (auto it = m_clients.begin(); it != m_clients.end();)
+			{
+				if ((*it)->finished)
+				{
+					(*it)->thread.join();
+					it = m_clients.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+
+		// One request per line, answered in order. Idle clients are dropped once the server stops.
+		void serveClient(Client* client)
+		{
+			std::string buffer;
+			char chunk[65536];
+			while (!m_stop)
+			{
+				const size_t lineEnd = buffer.find('\n');
+				if (lineEnd != std::string::npos)
+				{
+					const std::string line = buffer.substr(0, lineEnd);
+					buffer.erase(0, lineEnd + 1);
+					if (line.find_first_not_of(" \t\r") == std::string::npos)
+						continue;
+
+					const std::string response = handleRequest(client->name, line).dump() + "\n";
+					if (!client->socket.sendAll(response.data(), response.size()))
+						break;
+					continue;
+				}
+
+				if (buffer.size() > k_maxRequestBytes)
+				{
+					const std::string response = makeError("request too large").dump() + "\n";
+					client->socket.sendAll(response.data(), response.size());
+					break;
+				}
+				if (!client->socket.waitReadable(k_pollMs))
+					continue;
+				const size_t received = client->socket.receive(chunk, sizeof(chunk));
+				if (received == 0)
+					break;
+				buffer.append(chunk, received);
+			}
+			client->socket.close();
+			client->finished = true;
+		}
+
+		nlohmann::json handleRequest(const std::string& clientName, const std::string& line)
+		{
+			std::string command;
+			try
+			{
+				command = nlohmann::json::parse(line).value("command", "");
+			}
+			catch (const nlohmann::json::exception& e)
+			{
+				return makeError(e.what());
+			}
+
+			if (command == "bake")
+				return bake(clientName, line);
+			if (command == "status")
+				return getStatus();
+			if (command == "shutdown")
+			{
+				std::cout << "[" << clientName << "] Shutdown requested" << std::endl;
+				m_stop = true;
+				return { { "ok", true } };
+			}
+			return makeError("unknown command \"" + command + "\"");
+		}
+
+		nlohmann::json bake(const std::string& clientName, const std::string& line)
+		{
+			BatchSettings settings;
+			std::string error;
+			if (!parseJobs(line, std::filesystem::current_path(), settings, error))
+				return makeError(error);
+
+			const auto startTime = std::chrono::steady_clock::now();
+			const uint64_t firstGroup = m_nextGroup.fetch_add(settings.jobs.size());
+			const std::vector<BakeResult> results = bakeJobs(settings.jobs, m_jobs, firstGroup, m_services);
+
+			nlohmann::json response = { { "ok", true }, { "results", nlohmann::json::array() } };
+			size_t baked = 0;
+			for (const BakeResult& result : results)
+			{
+				printResult(result);
+				baked += result.succeeded ? 1 : 0;
+
+				nlohmann::json stages = nlohmann::json::object();
+				for (const auto& [stage, ms] : result.stageMs)
+				{
+					stages[stage] = ms;
+				}
+				nlohmann::json entry = {
+					{ "name", result.name },
+					{ "succeeded", result.succeeded },
+					{ "ms", result.ms },
+					{ "stages", stages },
+					{ "tiles", result.tilesSaved }
+				};
+				if (result.tilesRestored > 0)
+				{
+					entry["tilesFromBakeCache"] = result.tilesRestored;
+				}
+				if (result.lowPolyHash != 0)
+				{
+					entry["lowPolyHash"] = Hash::toHex(result.lowPolyHash);
+				}
+				if (result.highPolyHash != 0)
+				{
+					entry["highPolyHash"] = Hash::toHex(result.highPolyHash);
+				}
+				if (!result.error.empty())
+				{
+					entry["error"] = result.error;
+				}
+				response["results"].push_back(std::move(entry));
+			}
+
+			std::cout << std::fixed << std::setprecision(1) << "[" << clientName << "] " << baked << " of " << results.size()
+				<< " jobs baked in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+				<< " ms" << std::endl;
+			return response;
+		}
+
+		nlohmann::json getStatus() const
+		{
+			const SceneCache::Stats stats = m_cache.getStats();
+			nlohmann::json entries = nlohmann::json::array();
+			for (const SceneCache::EntryInfo& entry : stats.entries)
+			{
+				entries.push_back({
+					{ "hash", Hash::toHex(entry.hash) },
+					{ "type", entry.isHighPoly ? "highPoly" : "lowPoly" },
+					{ "source", entry.source },
+					{ "bytes", entry.bytes }
+				});
+			}
+			return {
+				{ "ok", true },
+				{ "cache", {
+					{ "bytes", stats.bytes },
+					{ "budgetBytes", m_settings.cacheBudgetMB * 1024 * 1024 },
+					{ "hits", stats.hits },
+					{ "misses", stats.misses },
+					{ "evictions", stats.evictions },
+					{ "entries", entries } } }
+			};
+		}
+
+		ServerSettings m_settings;
+		BakeServices m_services;
+		Jobs::JobSystem m_jobs;
+		SceneCache m_cache;
+		Baking::BakeCache m_bakeCache;
+		Socket m_listenSocket;
+		std::atomic<bool> m_stop = false;
+		std::atomic<uint64_t> m_nextGroup = 1;
+
+		std::mutex m_clientsMutex;
+		std::list<std::shared_ptr<Client>> m_clients;
+	};
+}
+
+int Headless::runServer(const ServerSettings& settings, Coordinator* coordinator)
+{
+	BakeServer server(settings, coordinator);
+	return server.run();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Long-running bake service: BakeForge --serve <port>
+// Keeps the prepared meshes of earlier bakes in a SceneCache, so pipelines firing many small bakes against the same
+// heavy high-poly meshes pay for the import and the BVH builds once. Clients connect to 127.0.0.1:<port> and send
+// one JSON request per line, every request is answered with one JSON line:
+//   {"command": "bake", "jobs": [...]}  jobs as in a job file, "lowPolyHash"/"highPolyHash" replace cached paths
+//   {"command": "status"}               cache contents and hit counts
+//   {"command": "shutdown"}             stops accepting clients, running requests still finish
+// Relative paths are resolved against the server's working directory.
+namespace Headless
+{
+	class Coordinator;
+
+	struct ServerSettings
+	{
+		uint16_t port = 7373;
+		uint32_t parallelJobs = 2;    // bake stages running at once over all requests
+		size_t memoryBudgetMB = 4096; // peak memory of the running stages
+		size_t cacheBudgetMB = 2048;  // prepared meshes kept between requests
+		std::filesystem::path bakeCacheDirectory; // outputs of earlier bakes, empty disables the bake cache
+	};
+
+	// Returns once a shutdown request was handled, the coordinator is optional
+	int runServer(const ServerSettings& settings, Coordinator* coordinator);
+} // namespace Headless
@@ -0,0 +1,1406 @@
+#include "batchBaker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include <json.hpp>
+#include <stb_image_write.h>
+
+#include "baking/bakeCache.hpp"
+#include "baking/cageEstimation.hpp"
+#include "baking/ddsWriter.hpp"
+#include "baking/gltfGeometry.hpp"
+#include "baking/highPoly.hpp"
+#include "baking/meshProcessing.hpp"
+#include "baking/normalTracer.hpp"
+#include "baking/occlusionBaker.hpp"
+#include "baking/pngWriter.hpp"
+#include "baking/sdfVolume.hpp"
+#include "baking/udim.hpp"
+#include "baking/uvIslands.hpp"
+#include "baking/uvRasterizer.hpp"
+#include "bvhBuilder.hpp"
+#include "bakeServer.hpp"
+#include "distributedTracer.hpp"
+#include "sceneCache.hpp"
+#include "utility/hash.hpp"
+#include "utility/jobSystem.hpp"
+#include "utility/parallelFor.hpp"
+
+using namespace Headless;
+
+namespace
+{
+	enum Stage
+	{
+		k_stageCache,
+		k_stageLoad,
+		k_stagePrepare,
+		k_stageCage,
+		k_stageSDF,
+		k_stageLayout,
+		k_stageRaster,
+		k_stageTrace,
+		k_stagePad,
+		k_stageSave,
+		k_stageCount
+	};
+
+	constexpr const char* k_stageNames[k_stageCount] = { "cache", "load", "prepare", "cage", "sdf", "layout", "raster", "trace", "pad", "save" };
+
+	// Search distance of the auto cage, relative to the diagonal of the high-poly bounds
+	constexpr float k_cageSearchFraction = 0.05f;
+	// Default reach of AO and thickness rays, relative to the diagonal of the high-poly bounds
+	constexpr float k_occlusionDistanceFraction = 0.1f;
+	// Default SDF voxels per AO and thickness reach
+	constexpr float k_voxelsPerOcclusionDistance = 16.0f;
+
+	// Peak memory of a tile: texel records, the RGBA16 map and its 8-bit copy or the float map of EXR outputs,
+	// and the coverage mask
+	constexpr size_t k_tileBytesPerTexel = sizeof(Baking::TexelRecord) + 16 + 1;
+
+	struct HighPolyGeometry
+	{
+		std::vector<Triangle> triangles;
+		std::vector<uint32_t> triangleIndices;
+		std::vector<BVH::Node> bvhNodes;
+		BVH::BBox worldBBox;
+		glm::mat4 worldMatrix = glm::mat4(1.0f);
+	};
+
+	// Everything one job produces on its way through the stages, shared by its jobs
+	struct BakeRun
+	{
+		BakeRun(const BakeJob& job_, const BakeServices& services)
+			: job(job_)
+			, coordinator(services.coordinator)
+			, sceneCache(services.sceneCache)
+			, bakeCache(services.bakeCache && services.bakeCache->isEnabled() ? services.bakeCache : nullptr)
+			, lowPolyHash(job_.lowPolyHash)
+			, highPolyHash(job_.highPolyHash)
+		{
+		}
+
+		~BakeRun()
+		{
+			releaseScene();
+		}
+
+		const BakeJob& job;
+		Coordinator* coordinator = nullptr;
+		SceneCache* sceneCache = nullptr;
+		const Baking::BakeCache* bakeCache = nullptr;
+		uint64_t lowPolyHash = 0;
+		uint64_t highPolyHash = 0;
+		uint32_t sceneId = 0; // acceleration structure shipped to the coordinator's workers
+		std::atomic<size_t> tilesRemaining = 0;
+		std::vector<Baking::MeshGeometry> lowPolys; // loaded, moved into the prepared meshes
+		std::vector<Baking::MeshGeometry> highPolys;
+		std::shared_ptr<const SceneCache::LowPolyScene> preparedLowPolys; // lowPolyMeshes point into these
+		std::vector<Baking::UVRasterMesh> lowPolyMeshes;
+		std::vector<std::vector<float>> cageOffsets; // per low-poly mesh and vertex, auto cage only
+		std::shared_ptr<const SceneCache::HighPolyScene> highPoly;
+		float occlusionDistance = 0.0f; // AO and thickness maps only
+		std::unique_ptr<Baking::SparseSDF> sdf;
+		std::vector<Baking::UDIMTile> tiles;
+		bool isMultiTile = false;
+		size_t tileCount = 0; // of the layout or of a restored bake
+
+		uint64_t baseKey = 0;           // bake settings and high-poly, shared by all tiles
+		uint64_t bakeKey = 0;           // every input of the bake, names its manifest
+		std::vector<uint64_t> tileKeys; // parallel to tiles, bake cache only
+		bool restoredBake = false;      // every tile came from the bake cache, the stages after the lookup are skipped
+		std::atomic<size_t> tilesRestored = 0;
+		std::vector<Baking::CachedTile> cachedTiles; // restored or stored, the manifest once every tile is in
+
+		std::mutex mutex;
+		double stageMs[k_stageCount] = {}; // summed over tiles, so tile stages may exceed the wall time
+		std::string error;
+		std::atomic<bool> failed = false;
+		std::atomic<size_t> tilesSaved = 0;
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point endTime = startTime;
+
+		void releaseScene()
+		{
+			if (coordinator && sceneId != 0)
+			{
+				coordinator->removeScene(sceneId);
+				sceneId = 0;
+			}
+		}
+
+		// The manifest is only written when every tile made it into the cache
+		void finishTile(const Baking::CachedTile& tile)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			cachedTiles.push_back(tile);
+			if (cachedTiles.size() == tileCount)
+			{
+				std::ranges::sort(cachedTiles, {}, &Baking::CachedTile::number);
+				bakeCache->storeBake(bakeKey, cachedTiles);
+			}
+		}
+
+		void finishStage(Stage stage, std::chrono::steady_clock::time_point stageStart)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			std::lock_guard<std::mutex> lock(mutex);
+			stageMs[stage] += std::chrono::duration<double, std::milli>(now - stageStart).count();
+			endTime = std::max(endTime, now);
+		}
+	};
+
+	// Times the stage and records the first error of the run. Rethrows, so the job system cancels the dependent stages,
+	// stages of a failed run that don't depend on the failed one are skipped.
+	template <typename Fn>
+	void runStage(BakeRun& run, Stage stage, Fn&& fn)
+	{
+		if (run.failed)
+			throw std::runtime_error("skipped, an earlier stage of the job failed");
+		if (run.restoredBake)
+			return;
+
+		const auto stageStart = std::chrono::steady_clock::now();
+		try
+		{
+			fn();
+		}
+		catch (const std::exception& e)
+		{
+			run.finishStage(stage, stageStart);
+			{
+				std::lock_guard<std::mutex> lock(run.mutex);
+				if (run.error.empty())
+				{
+					run.error = std::string(k_stageNames[stage]) + ": " + e.what();
+				}
+			}
+			run.failed = true;
+			throw;
+		}
+		run.finishStage(stage, stageStart);
+	}
+
+	std::filesystem::path resolvePath(const std::filesystem::path& baseDirectory, const std::string& path)
+	{
+		const std::filesystem::path result(path);
+		return result.is_absolute() ? result : baseDirectory / result;
+	}
+
+	void loadMeshes(BakeRun& run, bool isHighPoly)
+	{
+		const std::filesystem::path& path = isHighPoly ? run.job.highPoly : run.job.lowPoly;
+		if (path.empty())
+		{
+			const uint64_t hash = isHighPoly ? run.highPolyHash : run.lowPolyHash;
+			throw std::runtime_error("mesh " + Hash::toHex(hash) + " is not in the scene cache");
+		}
+
+		std::vector<Baking::MeshGeometry>& meshes = isHighPoly ? run.highPolys : run.lowPolys;
+		if (!Baking::loadGLTFGeometry(path.string(), meshes))
+			throw std::runtime_error("cannot read " + path.string());
+		if (meshes.empty())
+			throw std::runtime_error(path.string() + " contains no meshes");
+	}
+
+	// With a scene cache only the content hash is needed if the prepared meshes are cached
+	void loadStage(BakeRun& run, bool isHighPoly)
+	{
+		if (run.sceneCache)
+		{
+			uint64_t& hash = isHighPoly ? run.highPolyHash : run.lowPolyHash;
+			if (hash == 0)
+			{
+				hash = run.sceneCache->hashFile(isHighPoly ? run.job.highPoly : run.job.lowPoly);
+			}
+			if (run.sceneCache->contains(hash, isHighPoly))
+				return;
+		}
+		loadMeshes(run, isHighPoly);
+	}
+
+	std::filesystem::path getOutputPath(const BakeJob& job, bool isMultiTile, uint32_t tileNumber)
+	{
+		std::filesystem::path path = job.output;
+		if (isMultiTile)
+		{
+			path.replace_filename(Baking::getUDIMFilename(path.filename().string(), tileNumber));
+		}
+		return path;
+	}
+
+	// Everything that affects the written files goes into the bake cache keys, output paths don't
+	uint64_t hashBakeSettings(const BakeJob& job)
+	{
+		const std::string extension = job.output.extension().string();
+		uint64_t key = Hash::combine(Baking::k_bakerVersion, Hash::bytes(extension.data(), extension.size()));
+		key = Hash::combine(key, job.width);
+		key = Hash::combine(key, job.height);
+		key = Hash::combine(key, job.bitDepth);
+		key = Hash::combine(key, job.compressionLevel);
+		key = Hash::combine(key, static_cast<uint64_t>(job.exrCompression));
+		key = Hash::combine(key, job.exrTileSize);
+		key = Hash::combine(key, static_cast<uint64_t>(job.ddsFormat));
+		key = Hash::combineBytes(key, job.cageOffset);
+		key = Hash::combine(key, job.autoCage);
+		key = Hash::combine(key, job.useSmoothedNormals);
+		key = Hash::combineBytes(key, job.rayDirectionBlend);
+		key = Hash::combine(key, job.dilationDistance);
+		key = Hash::combine(key, static_cast<uint64_t>(job.map));
+		key = Hash::combine(key, job.samples);
+		key = Hash::combineBytes(key, job.maxDistance);
+		key = Hash::combine(key, job.approximate);
+		return Hash::combineBytes(key, job.voxelSize);
+	}
+
+	bool restoreTile(const BakeRun& run, const Baking::CachedTile& tile, const std::filesystem::path& path)
+	{
+		std::error_code error;
+		if (path.has_parent_path())
+		{
+			std::filesystem::create_directories(path.parent_path(), error);
+		}
+		return run.bakeCache->restoreTile(tile.key, path);
+	}
+
+	// Keys of the bake from the file contents, and the outputs of an unchanged bake copied from the cache.
+	// Nothing is loaded then, every later stage is skipped.
+	void lookupCacheStage(BakeRun& run)
+	{
+		for (bool isHighPoly : { false, true })
+		{
+			uint64_t& hash = isHighPoly ? run.highPolyHash : run.lowPolyHash;
+			if (hash == 0)
+			{
+				const std::filesystem::path& path = isHighPoly ? run.job.highPoly : run.job.lowPoly;
+				hash = run.sceneCache ? run.sceneCache->hashFile(path) : hashSceneFile(path);
+			}
+		}
+		run.baseKey = Hash::combine(hashBakeSettings(run.job), run.highPolyHash);
+		run.bakeKey = Hash::combine(run.baseKey, run.lowPolyHash);
+
+		const std::vector<Baking::CachedTile> tiles = run.bakeCache->findBake(run.bakeKey, run.job.output.extension().string());
+		if (tiles.empty())
+			return;
+
+		// Manifest tiles are sorted by number, same rule as Baking::isMultiTile
+		const bool isMultiTile = tiles.size() > 1 || tiles[0].number != Baking::k_firstUDIM;
+		for (const Baking::CachedTile& tile : tiles)
+		{
+			if (!restoreTile(run, tile, getOutputPath(run.job, isMultiTile, tile.number)))
+				return;
+		}
+		run.isMultiTile = isMultiTile;
+		run.tileCount = tiles.size();
+		run.tilesSaved = tiles.size();
+		run.tilesRestored = tiles.size();
+		run.restoredBake = true;
+		std::cout << "[" << run.job.name << "] Restored " << tiles.size() << " tiles from the bake cache" << std::endl;
+	}
+
+	// Tiles whose inputs didn't change since they were last baked are copied from the cache, returns the others
+	std::vector<size_t> restoreUnchangedTiles(BakeRun& run)
+	{
+		std::vector<size_t> tilesToBake;
+		run.tileKeys.assign(run.tiles.size(), 0);
+		for (size_t i = 0; i < run.tiles.size(); i++)
+		{
+			if (!run.bakeCache)
+			{
+				tilesToBake.push_back(i);
+				continue;
+			}
+			run.tileKeys[i] = Hash::combine(run.baseKey, Baking::hashTileGeometry(run.lowPolyMeshes, run.tiles[i]));
+			const Baking::CachedTile tile = { run.tiles[i].number, run.tileKeys[i] };
+			if (!restoreTile(run, tile, getOutputPath(run.job, run.isMultiTile, tile.number)))
+			{
+				tilesToBake.push_back(i);
+				continue;
+			}
+			run.tilesSaved++;
+			run.tilesRestored++;
+			run.finishTile(tile);
+		}
+		if (run.tilesRestored > 0)
+		{
+			std::cout << "[" << run.job.name << "] Restored " << run.tilesRestored << " of " << run.tiles.size()
+				<< " tiles from the bake cache" << std::endl;
+		}
+		return tilesToBake;
+	}
+
+	// Meshes of the load stage, loaded now if their cache entry was evicted after the load stage found it
+	std::vector<Baking::MeshGeometry> takeLoadedMeshes(BakeRun& run, bool isHighPoly)
+	{
+		std::vector<Baking::MeshGeometry>& meshes = isHighPoly ? run.highPolys : run.lowPolys;
+		if (meshes.empty())
+		{
+			loadMeshes(run, isHighPoly);
+		}
+		return std::move(meshes);
+	}
+
+	// Only normal maps are split across the coordinator's workers, the other maps are traced locally
+	bool isDistributed(const BakeRun& run)
+	{
+		return run.coordinator && run.job.map == BakeMap::Normal;
+	}
+
+	float getBoundsDiagonal(const SceneCache::HighPolyScene& highPoly)
+	{
+		glm::vec3 boundsMin(FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX);
+		for (const Baking::BLASInstance& instance : highPoly.blasInstances)
+		{
+			boundsMin = glm::min(boundsMin, instance.worldBBox.min);
+			boundsMax = glm::max(boundsMax, instance.worldBBox.max);
+		}
+		return glm::length(boundsMax - boundsMin);
+	}
+
+	Baking::NormalTraceSettings getTraceSettings(const BakeJob& job)
+	{
+		Baking::NormalTraceSettings settings;
+		settings.cageOffset = job.cageOffset;
+		settings.useSmoothedNormals = job.useSmoothedNormals;
+		settings.rayDirectionBlend = job.rayDirectionBlend;
+		settings.usePerTexelCage = job.autoCage;
+		return settings;
+	}
+
+	// Same preparation Primitive::fillTriangles does for imported meshes
+	std::shared_ptr<const SceneCache::LowPolyScene> prepareLowPolys(std::vector<Baking::MeshGeometry> meshes)
+	{
+		Parallel::parallelFor(meshes.size(), [&](size_t i)
+			{
+				Baking::computeSmoothNormals(meshes[i].vertices);
+				Baking::computeTangents(meshes[i].vertices, meshes[i].indices);
+			});
+		return std::make_shared<const SceneCache::LowPolyScene>(std::move(meshes));
+	}
+
+	std::shared_ptr<const SceneCache::HighPolyScene> prepareHighPolys(std::vector<Baking::MeshGeometry> highPolys)
+	{
+		std::vector<HighPolyGeometry> geometry(highPolys.size());
+		Parallel::parallelFor(highPolys.size(), [&](size_t i)
+			{
+				Baking::MeshGeometry& mesh = highPolys[i];
+				HighPolyGeometry& highPoly = geometry[i];
+				Baking::computeSmoothNormals(mesh.vertices);
+				Baking::buildTriangles(mesh.vertices, mesh.indices, highPoly.triangles, highPoly.triangleIndices);
+				if (highPoly.triangles.empty())
+					return;
+				BVH::BVHBuilder builder(highPoly.triangles, highPoly.triangleIndices);
+				highPoly.bvhNodes = builder.BuildBVH();
+				highPoly.worldMatrix = mesh.transform.matrix;
+				highPoly.worldBBox = Baking::transformBBox(highPoly.bvhNodes[0].bbox, highPoly.worldMatrix);
+			});
+
+		std::vector<Baking::HighPolyMesh> meshes;
+		for (const HighPolyGeometry& highPoly : geometry)
+		{
+			if (highPoly.triangles.empty())
+				continue;
+			Baking::HighPolyMesh mesh;
+			mesh.triangles = &highPoly.triangles;
+			mesh.triangleIndices = &highPoly.triangleIndices;
+			mesh.bvhNodes = &highPoly.bvhNodes;
+			mesh.worldBBox = highPoly.worldBBox;
+			mesh.worldMatrix = highPoly.worldMatrix;
+			meshes.push_back(mesh);
+		}
+		if (meshes.empty())
+			throw std::runtime_error("high-poly meshes have no triangles");
+
+		// Only the combined copy is traced
+		return std::make_shared<const SceneCache::HighPolyScene>(Baking::combineHighPolys(meshes));
+	}
+
+	void prepareLowPolyStage(BakeRun& run)
+	{
+		auto create = [&]() { return prepareLowPolys(takeLoadedMeshes(run, false)); };
+		run.preparedLowPolys = run.sceneCache ? run.sceneCache->getLowPoly(run.lowPolyHash, run.job.lowPoly.string(), create) : create();
+		run.lowPolys.clear();
+
+		const SceneCache::LowPolyScene& lowPolys = *run.preparedLowPolys;
+		run.lowPolyMeshes.resize(lowPolys.size());
+		for (size_t i = 0; i < lowPolys.size(); i++)
+		{
+			const Baking::MeshGeometry& lowPoly = lowPolys[i];
+			Baking::UVRasterMesh& mesh = run.lowPolyMeshes[i];
+			mesh.vertices = lowPoly.vertices.data();
+			mesh.vertexCount = lowPoly.vertices.size();
+			mesh.indices = lowPoly.indices.data();
+			mesh.indexCount = lowPoly.indices.size();
+			mesh.worldMatrix = lowPoly.transform.matrix;
+			mesh.primitiveID = static_cast<uint32_t>(i);
+		}
+	}
+
+	void prepareHighPolyStage(BakeRun& run)
+	{
+		auto create = [&]() { return prepareHighPolys(takeLoadedMeshes(run, true)); };
+		run.highPoly = run.sceneCache ? run.sceneCache->getHighPoly(run.highPolyHash, run.job.highPoly.string(), create) : create();
+		run.highPolys.clear();
+
+		if (isDistributed(run) && !run.job.autoCage)
+		{
+			// Workers trace against their own copy
+			run.sceneId = run.coordinator->addScene(*run.highPoly, getTraceSettings(run.job));
+			run.highPoly.reset();
+		}
+	}
+
+	// Per-vertex cage of auto cage jobs, measured before the high-poly is shipped to the workers
+	void estimateCageStage(BakeRun& run)
+	{
+		const SceneCache::HighPolyScene& highPoly = *run.highPoly;
+		const float searchDistance = getBoundsDiagonal(highPoly) * k_cageSearchFraction;
+
+		const SceneCache::LowPolyScene& lowPolys = *run.preparedLowPolys;
+		run.cageOffsets.resize(lowPolys.size());
+		float minOffset = FLT_MAX;
+		float maxOffset = 0.0f;
+		float maxDepth = 0.0f;
+		size_t vertexCount = 0;
+		size_t unmatched = 0;
+		for (size_t i = 0; i < lowPolys.size(); i++)
+		{
+			Baking::CageEstimate estimate = Baking::estimateCage(lowPolys[i].vertices, lowPolys[i].indices, lowPolys[i].transform.matrix, highPoly, searchDistance);
+			if (!estimate.vertexOffsets.empty())
+			{
+				minOffset = std::min(minOffset, estimate.minOffset);
+				maxOffset = std::max(maxOffset, estimate.maxOffset);
+			}
+			maxDepth = std::max(maxDepth, estimate.maxDepth);
+			vertexCount += estimate.vertexOffsets.size();
+			unmatched += estimate.unmatchedVertices;
+			run.cageOffsets[i] = std::move(estimate.vertexOffsets);
+			run.lowPolyMeshes[i].cageOffsets = run.cageOffsets[i].data();
+		}
+
+		std::cout << "[" << run.job.name << "] Cage: per-vertex offsets " << minOffset << " to " << maxOffset
+			<< ", a uniform cageOffset of " << maxOffset << " would cover every vertex, high-poly reaches " << maxDepth
+			<< " below the low-poly" << std::endl;
+		if (unmatched > 0)
+		{
+			std::cerr << "[" << run.job.name << "] Warning: " << unmatched << " of " << vertexCount
+				<< " low-poly vertices have no high-poly within " << searchDistance << std::endl;
+		}
+
+		if (isDistributed(run))
+		{
+			run.sceneId = run.coordinator->addScene(*run.highPoly, getTraceSettings(run.job));
+			run.highPoly.reset();
+		}
+	}
+
+	// Reach of the AO and thickness rays, and the distance field approximate maps are sampled from
+	void prepareOcclusionStage(BakeRun& run)
+	{
+		const BakeJob& job = run.job;
+		run.occlusionDistance = job.maxDistance > 0.0f ? job.maxDistance : getBoundsDiagonal(*run.highPoly) * k_occlusionDistanceFraction;
+		if (!job.approximate)
+			return;
+
+		Baking::SDFSettings settings;
+		settings.voxelSize = job.voxelSize > 0.0f ? job.voxelSize : run.occlusionDistance / k_voxelsPerOcclusionDistance;
+		run.sdf = std::make_unique<Baking::SparseSDF>(*run.highPoly, settings);
+
+		const glm::uvec3 grid = run.sdf->getBrickGridSize();
+		const size_t gridBricks = static_cast<size_t>(grid.x) * grid.y * grid.z;
+		std::cout << std::fixed << std::setprecision(1) << "[" << job.name << "] SDF: " << run.sdf->getBrickCount() << " of "
+			<< gridBricks << " bricks in the narrow band, " << run.sdf->getMemoryBytes() / (1024.0 * 1024.0) << " MB"
+			<< std::defaultfloat << ", voxel size " << settings.voxelSize << std::endl;
+	}
+
+	// Island reuse and UDIM binning, same as BakerPass::prepareTexels
+	void layoutTiles(BakeRun& run)
+	{
+		const Baking::UVIslandReport report = Baking::analyzeUVIslands(run.lowPolyMeshes);
+		std::cout << "[" << run.job.name << "] UV islands: " << report.islands.size() << ", "
+			<< report.duplicateIslands << " stacked duplicates reused" << std::endl;
+		if (!report.overlaps.empty())
+		{
+			std::cerr << "[" << run.job.name << "] Warning: " << report.overlaps.size()
+				<< " overlapping UV island pairs race for the same texels" << std::endl;
+		}
+
+		size_t droppedTriangles = 0;
+		run.tiles = Baking::binTrianglesByUDIM(run.lowPolyMeshes, Baking::buildMasterIndices(run.lowPolyMeshes, report), droppedTriangles);
+		if (droppedTriangles > 0)
+		{
+			std::cerr << "[" << run.job.name << "] Warning: " << droppedTriangles
+				<< " low-poly triangles are outside of the UDIM range and won't be baked" << std::endl;
+		}
+		if (run.tiles.empty())
+			throw std::runtime_error("no low-poly triangles inside the UV range");
+
+		run.isMultiTile = Baking::isMultiTile(run.tiles);
+		run.tileCount = run.tiles.size();
+		Baking::scheduleByCost(run.tiles, {});
+	}
+
+	// EXR outputs are traced as floats so half and float files keep more than 16 bits, everything else as RGBA16
+	Baking::TexelFormat getTexelFormat(const BakeJob& job)
+	{
+		return job.output.extension() == ".exr" ? Baking::TexelFormat::RGBA32F : Baking::TexelFormat::RGBA16;
+	}
+
+	void createOutputDirectory(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		if (path.has_parent_path())
+		{
+			std::filesystem::create_directories(path.parent_path(), error);
+		}
+	}
+
+	std::unique_ptr<Baking::EXRWriter> openEXR(const BakeJob& job, const std::filesystem::path& path)
+	{
+		createOutputDirectory(path);
+		Baking::EXRSettings exrSettings;
+		exrSettings.width = job.width;
+		exrSettings.height = job.height;
+		exrSettings.pixelType = job.bitDepth == 32 ? Baking::EXRPixelType::Float : Baking::EXRPixelType::Half;
+		exrSettings.compression = job.exrCompression;
+		exrSettings.tileWidth = job.exrTileSize;
+		exrSettings.tileHeight = job.exrTileSize;
+		exrSettings.compressionLevel = job.compressionLevel;
+		auto writer = std::make_unique<Baking::EXRWriter>(path, exrSettings);
+		return writer->isOpen() ? std::move(writer) : nullptr;
+	}
+
+	// Hands padded rows of the float map to the EXR writer, from the padding threads. Scanline chunks are
+	// completed by the writer itself, a tiled image writes a row of tiles once all of its rows arrived.
+	class EXRRowSink
+	{
+	public:
+		EXRRowSink(Baking::EXRWriter& writer, float* pixels, uint32_t width, uint32_t height, uint32_t tileSize)
+			: m_writer(writer)
+			, m_pixels(pixels)
+			, m_width(width)
+			, m_height(height)
+			, m_tileSize(tileSize)
+			, m_paddedRows(writer.isTiled() ? writer.getTileCountY() : 0)
+		{
+		}
+
+		void addRows(uint32_t firstRow, uint32_t rowCount)
+		{
+			// Texels padding left uncovered still have alpha = 0, covered ones already have 1
+			for (size_t i = size_t(firstRow) * m_width; i < size_t(firstRow + rowCount) * m_width; i++)
+			{
+				m_pixels[i * 4 + 3] = 1.0f;
+			}
+
+			const size_t rowPitch = size_t(m_width) * 4 * sizeof(float);
+			if (!m_writer.isTiled())
+			{
+				if (!m_writer.writeRows(firstRow, rowCount, m_pixels + size_t(firstRow) * m_width * 4, rowPitch))
+				{
+					m_failed = true;
+				}
+				return;
+			}
+			for (uint32_t y = firstRow; y < firstRow + rowCount;)
+			{
+				const uint32_t tileY = y / m_tileSize;
+				const uint32_t tileRowEnd = std::min((tileY + 1) * m_tileSize, m_height);
+				const uint32_t rows = std::min(tileRowEnd, firstRow + rowCount) - y;
+				if (m_paddedRows[tileY].fetch_add(rows) + rows == tileRowEnd - tileY * m_tileSize)
+				{
+					writeTileRow(tileY, rowPitch);
+				}
+				y += rows;
+			}
+		}
+
+		bool hasFailed() const { return m_failed; }
+
+	private:
+		void writeTileRow(uint32_t tileY, size_t rowPitch)
+		{
+			for (uint32_t tileX = 0; tileX < m_writer.getTileCountX(); tileX++)
+			{
+				const float* tile = m_pixels + (size_t(tileY) * m_tileSize * m_width + size_t(tileX) * m_tileSize) * 4;
+				if (!m_writer.writeTile(tileX, tileY, tile, rowPitch))
+				{
+					m_failed = true;
+				}
+			}
+		}
+
+		Baking::EXRWriter& m_writer;
+		float* m_pixels;
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_tileSize;
+		std::vector<std::atomic<uint32_t>> m_paddedRows; // rows padded so far, per row of tiles
+		std::atomic<bool> m_failed = false;
+	};
+
+	// RGBA16 maps, EXR outputs are streamed by EXRRowSink
+	bool saveImage(const BakeJob& job, const std::filesystem::path& path, const uint16_t* pixels)
+	{
+		createOutputDirectory(path);
+
+		const std::string extension = path.extension().string();
+		if (extension == ".dds")
+		{
+			Baking::DDSWriteSettings ddsSettings;
+			ddsSettings.format = job.ddsFormat;
+			ddsSettings.mipFilter = job.map == BakeMap::Normal ? Baking::MipFilter::Normal : Baking::MipFilter::Color;
+			return Baking::writeDDS(path, pixels, job.width, job.height, ddsSettings);
+		}
+
+		Baking::PNGImage image;
+		image.width = job.width;
+		image.height = job.height;
+		image.channels = 4;
+		Baking::PNGWriteSettings pngSettings;
+		pngSettings.compressionLevel = job.compressionLevel;
+		if (extension == ".png" && job.bitDepth == 16)
+		{
+			image.pixels = pixels;
+			image.bitDepth = 16;
+			return Baking::writePNG(path, image, pngSettings);
+		}
+
+		std::vector<uint8_t> pixels8(size_t(job.width) * job.height * 4);
+		Parallel::parallelForChunks(pixels8.size(), 65536, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					pixels8[i] = static_cast<uint8_t>((pixels[i] + 128) / 257);
+				}
+			});
+
+		if (extension == ".png")
+		{
+			image.pixels = pixels8.data();
+			return Baking::writePNG(path, image, pngSettings);
+		}
+		if (extension == ".tga")
+			return stbi_write_tga(path.string().c_str(), job.width, job.height, 4, pixels8.data()) != 0;
+		return false;
+	}
+
+	void bakeTile(BakeRun& run, size_t tileIndex)
+	{
+		const BakeJob& job = run.job;
+		const Baking::UDIMTile& tile = run.tiles[tileIndex];
+		const size_t numTexels = static_cast<size_t>(job.width) * job.height;
+		const std::filesystem::path path = getOutputPath(job, run.isMultiTile, tile.number);
+		const Baking::TexelFormat format = getTexelFormat(job);
+		const size_t texelSize = Baking::getTexelSize(format);
+		const size_t rowPitch = job.width * texelSize;
+
+		Baking::UVRasterResult texels;
+		runStage(run, k_stageRaster, [&]()
+			{
+				Baking::UVRasterizer rasterizer(job.width, job.height);
+				for (size_t i = 0; i < run.lowPolyMeshes.size(); i++)
+				{
+					Baking::UVRasterMesh mesh = run.lowPolyMeshes[i];
+					mesh.indices = tile.indices[i].data();
+					mesh.indexCount = tile.indices[i].size();
+					mesh.uvOffset = tile.uvOffset;
+					rasterizer.addMesh(mesh);
+				}
+				texels = rasterizer.rasterize();
+			});
+
+		// Untraced texels keep the flat normal, no occlusion or no thickness, alpha = 0 marks them for edge padding
+		std::vector<uint8_t> pixels(numTexels * texelSize);
+		runStage(run, k_stageTrace, [&]()
+			{
+				const float gray = job.map == BakeMap::AmbientOcclusion ? 1.0f : 0.0f;
+				const float background[4] = { job.map == BakeMap::Normal ? 0.5f : gray, job.map == BakeMap::Normal ? 0.5f : gray,
+					job.map == BakeMap::Normal ? 1.0f : gray, 0.0f };
+				uint8_t backgroundTexel[4 * sizeof(float)];
+				Baking::storeTexel(backgroundTexel, 0, 0, 0, background, format);
+				for (size_t i = 0; i < numTexels; i++)
+				{
+					std::memcpy(pixels.data() + i * texelSize, backgroundTexel, texelSize);
+				}
+
+				if (job.map != BakeMap::Normal)
+				{
+					Baking::OcclusionSettings settings;
+					settings.map = job.map == BakeMap::Thickness ? Baking::OcclusionMap::Thickness : Baking::OcclusionMap::AmbientOcclusion;
+					settings.sampleCount = job.samples;
+					settings.maxDistance = run.occlusionDistance;
+					settings.sdf = run.sdf.get();
+					Baking::bakeOcclusion(Baking::NormalTracer(*run.highPoly), getTraceSettings(job), settings, texels, pixels.data(), rowPitch, format);
+				}
+				else if (isDistributed(run))
+				{
+					if (!run.coordinator->trace(run.sceneId, texels, pixels.data(), rowPitch, format))
+						throw std::runtime_error("no bake worker available");
+				}
+				else
+				{
+					Baking::NormalTracer(*run.highPoly).trace(texels, getTraceSettings(job), pixels.data(), rowPitch, format);
+				}
+			});
+		texels = Baking::UVRasterResult();
+
+		// EXR rows are compressed as soon as padding finished them, the save stage only completes the file
+		std::unique_ptr<Baking::EXRWriter> exrWriter;
+		runStage(run, k_stagePad, [&]()
+			{
+				std::vector<uint8_t> coverage(numTexels);
+				for (size_t i = 0; i < numTexels; i++)
+				{
+					const uint8_t* texel = pixels.data() + i * texelSize;
+					coverage[i] = format == Baking::TexelFormat::RGBA32F ? reinterpret_cast<const float*>(texel)[3] != 0.0f
+						: reinterpret_cast<const uint16_t*>(texel)[3] != 0;
+				}
+
+				if (format == Baking::TexelFormat::RGBA32F)
+				{
+					exrWriter = openEXR(job, path);
+					if (!exrWriter)
+						throw std::runtime_error("failed to write " + path.string());
+					EXRRowSink sink(*exrWriter, reinterpret_cast<float*>(pixels.data()), job.width, job.height, job.exrTileSize);
+					Baking::dilate(pixels.data(), job.width, job.height, rowPitch, texelSize, coverage.data(), job.dilationDistance,
+						[&](uint32_t firstRow, uint32_t rowCount) { sink.addRows(firstRow, rowCount); });
+					if (sink.hasFailed())
+						throw std::runtime_error("failed to write " + path.string());
+					return;
+				}
+
+				Baking::dilate(pixels.data(), job.width, job.height, rowPitch, texelSize, coverage.data(), job.dilationDistance);
+				uint16_t* pixels16 = reinterpret_cast<uint16_t*>(pixels.data());
+				for (size_t i = 0; i < numTexels; i++)
+				{
+					pixels16[i * 4 + 3] = 0xFFFF;
+				}
+			});
+
+		runStage(run, k_stageSave, [&]()
+			{
+				const bool saved = exrWriter ? exrWriter->finish() : saveImage(job, path, reinterpret_cast<const uint16_t*>(pixels.data()));
+				if (!saved)
+					throw std::runtime_error("failed to write " + path.string());
+				std::cout << "[" << job.name << "] Saved " << path.string() << std::endl;
+				if (run.bakeCache)
+				{
+					run.bakeCache->storeTile(run.tileKeys[tileIndex], path);
+					run.finishTile({ tile.number, run.tileKeys[tileIndex] });
+				}
+			});
+		run.tilesSaved++;
+	}
+
+	// Loading of both files and the preparation of low- and high-poly meshes overlap, tiles are baked in parallel.
+	// With a bake cache its lookup runs first, an unchanged bake loads nothing.
+	void scheduleRun(const std::shared_ptr<BakeRun>& run, Jobs::JobSystem& jobs, uint64_t group)
+	{
+		const BakeJob& job = run->job;
+
+		std::vector<Jobs::JobID> loadDependencies;
+		if (run->bakeCache)
+		{
+			Jobs::JobDesc lookup;
+			lookup.name = "Bake cache lookup: " + job.name;
+			lookup.group = group;
+			lookup.work = [run]()
+				{
+					runStage(*run, k_stageCache, [&]() { lookupCacheStage(*run); });
+				};
+			loadDependencies.push_back(jobs.submit(std::move(lookup)));
+		}
+
+		Jobs::JobDesc loadLowPoly;
+		loadLowPoly.name = "Load low-poly: " + job.name;
+		loadLowPoly.group = group;
+		loadLowPoly.work = [run]()
+			{
+				runStage(*run, k_stageLoad, [&]() { loadStage(*run, false); });
+			};
+		const Jobs::JobID loadLowPolyID = jobs.submit(std::move(loadLowPoly), loadDependencies);
+
+		Jobs::JobDesc loadHighPoly;
+		loadHighPoly.name = "Load high-poly: " + job.name;
+		loadHighPoly.group = group;
+		loadHighPoly.work = [run]()
+			{
+				runStage(*run, k_stageLoad, [&]() { loadStage(*run, true); });
+			};
+		const Jobs::JobID loadHighPolyID = jobs.submit(std::move(loadHighPoly), loadDependencies);
+
+		Jobs::JobDesc prepareLowPoly;
+		prepareLowPoly.name = "Prepare low-poly: " + job.name;
+		prepareLowPoly.group = group;
+		prepareLowPoly.work = [run]()
+			{
+				runStage(*run, k_stagePrepare, [&]() { prepareLowPolyStage(*run); });
+			};
+		const Jobs::JobID prepareLowPolyID = jobs.submit(std::move(prepareLowPoly), { loadLowPolyID });
+
+		Jobs::JobDesc prepareHighPoly;
+		prepareHighPoly.name = "Prepare high-poly: " + job.name;
+		prepareHighPoly.group = group;
+		prepareHighPoly.work = [run]()
+			{
+				runStage(*run, k_stagePrepare, [&]() { prepareHighPolyStage(*run); });
+			};
+		const Jobs::JobID prepareHighPolyID = jobs.submit(std::move(prepareHighPoly), { loadHighPolyID });
+
+		Jobs::JobDesc layout;
+		layout.name = "Layout: " + job.name;
+		layout.group = group;
+		layout.work = [run, &jobs, group]()
+			{
+				if (run->job.autoCage)
+				{
+					runStage(*run, k_stageCage, [&]() { estimateCageStage(*run); });
+				}
+				if (run->job.map != BakeMap::Normal)
+				{
+					runStage(*run, k_stageSDF, [&]() { prepareOcclusionStage(*run); });
+				}
+				runStage(*run, k_stageLayout, [&]() { layoutTiles(*run); });
+				if (run->restoredBake)
+					return;
+
+				std::vector<size_t> tilesToBake;
+				runStage(*run, k_stageCache, [&]() { tilesToBake = restoreUnchangedTiles(*run); });
+				if (tilesToBake.empty())
+				{
+					run->releaseScene();
+					return;
+				}
+
+				const size_t numTexels = static_cast<size_t>(run->job.width) * run->job.height;
+				run->tilesRemaining = tilesToBake.size();
+				for (size_t i : tilesToBake)
+				{
+					Jobs::JobDesc tileJob;
+					tileJob.name = "Bake tile " + std::to_string(run->tiles[i].number) + ": " + run->job.name;
+					tileJob.group = group;
+					tileJob.priority = 1; // finish started bakes before loading the next ones
+					tileJob.memoryBytes = numTexels * k_tileBytesPerTexel;
+					tileJob.work = [run, i]()
+						{
+							try
+							{
+								bakeTile(*run, i);
+							}
+							catch (...)
+							{
+								if (--run->tilesRemaining == 0)
+									run->releaseScene();
+								throw;
+							}
+							if (--run->tilesRemaining == 0)
+								run->releaseScene();
+						};
+					jobs.submit(std::move(tileJob));
+				}
+			};
+		jobs.submit(std::move(layout), { prepareLowPolyID, prepareHighPolyID });
+	}
+
+	bool readDimension(const nlohmann::json& entry, const char* key, uint32_t& value, std::string& outError)
+	{
+		if (!entry.contains(key))
+			return true;
+		const int64_t dimension = entry[key].get<int64_t>();
+		if (dimension <= 0 || dimension > 0xFFFF) // texel coordinates are packed into 16 bits
+		{
+			outError = std::string(key) + " must be between 1 and 65535";
+			return false;
+		}
+		value = static_cast<uint32_t>(dimension);
+		return true;
+	}
+
+	void printUsage()
+	{
+		std::cout << "Usage: BakeForge --bake <jobs.json> [--parallel <stages>] [--cache-dir <directory>]\n"
+			"       BakeForge --bake <jobs.json> --coordinator [--listen <port>] [--local-workers <count>]\n"
+			"                 [--worker-threads <count>] [--worker-timeout <seconds>]\n"
+			"       BakeForge --worker <coordinator host:port> [--threads <count>]\n"
+			"       BakeForge --serve <port> [--cache-mb <size>] [--cache-dir <directory>] [--parallel <stages>] [--coordinator ...]\n"
+			"\n"
+			"A coordinator rasterizes the maps and splits their texels across worker processes.\n"
+			"Workers connect to the coordinator's port, local workers are started on this machine.\n"
+			"A server keeps the prepared meshes of earlier bakes and takes one JSON request per line on 127.0.0.1:\n"
+			"{\"command\": \"bake\", \"jobs\": [...]}, {\"command\": \"status\"} or {\"command\": \"shutdown\"}.\n"
+			"Server jobs may name cached meshes by the \"lowPolyHash\"/\"highPolyHash\" of an earlier result.\n"
+			"A bake cache directory keeps the outputs of earlier bakes, unchanged bakes and UDIM tiles are copied from it.\n"
+			"\n"
+			"Job file:\n"
+			"{\n"
+			"  \"parallelJobs\": 2,\n"
+			"  \"memoryBudgetMB\": 4096,\n"
+			"  \"cacheDirectory\": \"bakeCache\",\n"
+			"  \"jobs\": [\n"
+			"    {\n"
+			"      \"name\": \"crate\",\n"
+			"      \"lowPoly\": \"crate_low.glb\",\n"
+			"      \"highPoly\": \"crate_high.glb\",\n"
+			"      \"output\": \"out/crate_normal.png\",\n"
+			"      \"resolution\": 2048,\n"
+			"      \"cageOffset\": 0.1,\n"
+			"      \"useSmoothedNormals\": true,\n"
+			"      \"rayDirectionBlend\": 0.0,\n"
+			"      \"edgePadding\": 16,\n"
+			"      \"bitDepth\": 16,\n"
+			"      \"compression\": 6\n"
+			"    },\n"
+			"    {\n"
+			"      \"name\": \"crate ao\",\n"
+			"      \"lowPoly\": \"crate_low.glb\",\n"
+			"      \"highPoly\": \"crate_high.glb\",\n"
+			"      \"output\": \"out/crate_ao.png\",\n"
+			"      \"map\": \"ao\",\n"
+			"      \"samples\": 64,\n"
+			"      \"maxDistance\": 0.5,\n"
+			"      \"approximate\": true,\n"
+			"      \"voxelSize\": 0.02\n"
+			"    }\n"
+			"  ]\n"
+			"}\n"
+			"\n"
+			"resolution sets width and height, use \"width\"/\"height\" for non-square maps.\n"
+			"cageOffset \"auto\" measures a per-vertex cage against the high-poly.\n"
+			"map is \"normal\", \"ao\" or \"thickness\". AO and thickness trace samples rays per texel from the high-poly\n"
+			"within maxDistance (default a tenth of its bounds), approximate samples a sparse distance field instead.\n"
+			"bitDepth 16 writes 16-bit PNGs, compression trades PNG size for speed from 0 (stored) to 9.\n"
+			"output .exr writes half (bitDepth 16) or float (bitDepth 32) EXRs, exrCompression is \"none\", \"zip\" or \"piz\",\n"
+			"exrTileSize > 0 writes tiles instead of scanlines.\n"
+			"output .dds writes a block compressed mip chain, ddsFormat is \"bc5\" (default for normals) or \"bc7\".\n"
+			"edgePadding < 0 pads the whole map. Relative paths are resolved against the job file.\n"
+			"Exit codes: 0 all jobs baked, 1 some jobs failed, 2 bad arguments or job file." << std::endl;
+	}
+}
+
+bool Headless::loadJobFile(const std::filesystem::path& path, BatchSettings& outSettings, std::string& outError)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		outError = "cannot open " + path.string();
+		return false;
+	}
+	const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return parseJobs(json, std::filesystem::absolute(path).parent_path(), outSettings, outError);
+}
+
+bool Headless::parseJobs(const std::string& json, const std::filesystem::path& baseDirectory, BatchSettings& outSettings,
+	std::string& outError)
+{
+	try
+	{
+		const nlohmann::json root = nlohmann::json::parse(json);
+		outSettings.parallelJobs = root.value("parallelJobs", outSettings.parallelJobs);
+		outSettings.memoryBudgetMB = root.value("memoryBudgetMB", outSettings.memoryBudgetMB);
+		if (root.contains("cacheDirectory"))
+		{
+			outSettings.cacheDirectory = resolvePath(baseDirectory, root["cacheDirectory"].get<std::string>());
+		}
+
+		if (!root.contains("jobs") || !root["jobs"].is_array())
+		{
+			outError = "missing \"jobs\" array";
+			return false;
+		}
+
+		for (const nlohmann::json& entry : root["jobs"])
+		{
+			BakeJob job;
+			job.name = entry.value("name", "job " + std::to_string(outSettings.jobs.size()));
+			if ((!entry.contains("lowPoly") && !entry.contains("lowPolyHash"))
+				|| (!entry.contains("highPoly") && !entry.contains("highPolyHash")) || !entry.contains("output"))
+			{
+				outError = job.name + ": \"lowPoly\", \"highPoly\" and \"output\" are required";
+				return false;
+			}
+			if (entry.contains("lowPoly"))
+			{
+				job.lowPoly = resolvePath(baseDirectory, entry["lowPoly"].get<std::string>());
+			}
+			if (entry.contains("highPoly"))
+			{
+				job.highPoly = resolvePath(baseDirectory, entry["highPoly"].get<std::string>());
+			}
+			if ((entry.contains("lowPolyHash") && !Hash::fromHex(entry["lowPolyHash"].get<std::string>(), job.lowPolyHash))
+				|| (entry.contains("highPolyHash") && !Hash::fromHex(entry["highPolyHash"].get<std::string>(), job.highPolyHash)))
+			{
+				outError = job.name + ": mesh hashes must be 16 hex digits";
+				return false;
+			}
+			job.output = resolvePath(baseDirectory, entry["output"].get<std::string>());
+
+			const std::string extension = job.output.extension().string();
+			if (extension != ".png" && extension != ".tga" && extension != ".exr" && extension != ".dds")
+			{
+				outError = job.name + ": output must be a .png, .tga, .exr or .dds file";
+				return false;
+			}
+			job.bitDepth = entry.value("bitDepth", extension == ".exr" ? 16u : job.bitDepth);
+			if (extension == ".exr" ? job.bitDepth != 16 && job.bitDepth != 32 : job.bitDepth != 8 && (job.bitDepth != 16 || extension != ".png"))
+			{
+				outError = job.name + ": bitDepth must be 8, or 16 for .png outputs, and 16 or 32 for .exr outputs";
+				return false;
+			}
+			job.compressionLevel = std::clamp(entry.value("compression", job.compressionLevel), 0, 9);
+			const std::string exrCompression = entry.value("exrCompression", "zip");
+			if (exrCompression == "none")
+			{
+				job.exrCompression = Baking::EXRCompression::None;
+			}
+			else if (exrCompression == "piz")
+			{
+				job.exrCompression = Baking::EXRCompression::PIZ;
+			}
+			else if (exrCompression != "zip")
+			{
+				outError = job.name + ": exrCompression must be \"none\", \"zip\" or \"piz\"";
+				return false;
+			}
+			job.exrTileSize = entry.value("exrTileSize", job.exrTileSize);
+
+			uint32_t resolution = 0;
+			if (!readDimension(entry, "resolution", resolution, outError)
+				|| !readDimension(entry, "width", job.width, outError)
+				|| !readDimension(entry, "height", job.height, outError))
+			{
+				outError = job.name + ": " + outError;
+				return false;
+			}
+			if (resolution > 0)
+			{
+				job.width = entry.contains("width") ? job.width : resolution;
+				job.height = entry.contains("height") ? job.height : resolution;
+			}
+
+			if (entry.contains("cageOffset") && entry["cageOffset"].is_string())
+			{
+				if (entry["cageOffset"].get<std::string>() != "auto")
+				{
+					outError = job.name + ": cageOffset must be a number or \"auto\"";
+					return false;
+				}
+				job.autoCage = true;
+			}
+			else
+			{
+				job.cageOffset = entry.value("cageOffset", job.cageOffset);
+			}
+			job.useSmoothedNormals = entry.value("useSmoothedNormals", job.useSmoothedNormals);
+			job.rayDirectionBlend = std::clamp(entry.value("rayDirectionBlend", job.rayDirectionBlend), 0.0f, 1.0f);
+			const int64_t edgePadding = entry.value("edgePadding", static_cast<int64_t>(job.dilationDistance));
+			job.dilationDistance = edgePadding < 0 ? Baking::k_infiniteDilation : static_cast<uint32_t>(edgePadding);
+
+			const std::string map = entry.value("map", "normal");
+			if (map == "ao")
+			{
+				job.map = BakeMap::AmbientOcclusion;
+			}
+			else if (map == "thickness")
+			{
+				job.map = BakeMap::Thickness;
+			}
+			else if (map != "normal")
+			{
+				outError = job.name + ": map must be \"normal\", \"ao\" or \"thickness\"";
+				return false;
+			}
+			const std::string ddsFormat = entry.value("ddsFormat", job.map == BakeMap::Normal ? "bc5" : "bc7");
+			if (ddsFormat == "bc7")
+			{
+				job.ddsFormat = Baking::BlockFormat::BC7;
+			}
+			else if (ddsFormat != "bc5")
+			{
+				outError = job.name + ": ddsFormat must be \"bc5\" or \"bc7\"";
+				return false;
+			}
+			const int64_t samples = entry.value("samples", static_cast<int64_t>(job.samples));
+			job.maxDistance = entry.value("maxDistance", job.maxDistance);
+			job.approximate = entry.value("approximate", job.approximate);
+			job.voxelSize = entry.value("voxelSize", job.voxelSize);
+			if (samples < 1 || samples > 65536 || job.maxDistance < 0.0f || job.voxelSize < 0.0f)
+			{
+				outError = job.name + ": samples must be between 1 and 65536, maxDistance and voxelSize must not be negative";
+				return false;
+			}
+			job.samples = static_cast<uint32_t>(samples);
+
+			outSettings.jobs.push_back(std::move(job));
+		}
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		outError = e.what();
+		return false;
+	}
+
+	if (outSettings.jobs.empty())
+	{
+		outError = "no jobs";
+		return false;
+	}
+	return true;
+}
+
+std::vector<BakeResult> Headless::bakeJobs(const std::vector<BakeJob>& jobs, Jobs::JobSystem& jobSystem, uint64_t firstGroup,
+	const BakeServices& services)
+{
+	std::vector<std::shared_ptr<BakeRun>> runs;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		runs.push_back(std::make_shared<BakeRun>(jobs[i], services));
+		scheduleRun(runs.back(), jobSystem, firstGroup + i);
+	}
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		jobSystem.waitGroup(firstGroup + i);
+	}
+
+	std::vector<BakeResult> results;
+	for (const std::shared_ptr<BakeRun>& run : runs)
+	{
+		BakeResult result;
+		result.name = run->job.name;
+		result.succeeded = !run->failed && run->tileCount > 0 && run->tilesSaved == run->tileCount;
+		result.ms = std::chrono::duration<double, std::milli>(run->endTime - run->startTime).count();
+		for (int stage = 0; stage < k_stageCount; stage++)
+		{
+			if ((stage == k_stageCache && !run->bakeCache) || (stage == k_stageCage && !run->job.autoCage) || (stage == k_stageSDF && (!run->job.approximate || run->job.map == BakeMap::Normal)))
+				continue;
+			result.stageMs.emplace_back(k_stageNames[stage], run->stageMs[stage]);
+		}
+		result.tileCount = run->tileCount;
+		result.tilesSaved = run->tilesSaved;
+		result.tilesRestored = run->tilesRestored;
+		result.isMultiTile = run->isMultiTile;
+		result.error = run->error;
+		result.lowPolyHash = run->lowPolyHash;
+		result.highPolyHash = run->highPolyHash;
+		results.push_back(std::move(result));
+	}
+	return results;
+}
+
+void Headless::printResult(const BakeResult& result)
+{
+	std::ostringstream line;
+	line << std::fixed << std::setprecision(1) << (result.succeeded ? "OK     " : "FAILED ") << result.name << " in " << result.ms << " ms (";
+	for (size_t stage = 0; stage < result.stageMs.size(); stage++)
+	{
+		line << (stage > 0 ? ", " : "") << result.stageMs[stage].first << " " << result.stageMs[stage].second;
+	}
+	line << ")";
+	if (result.isMultiTile)
+	{
+		line << ", " << result.tilesSaved << "/" << result.tileCount << " UDIM tiles";
+	}
+	if (result.tilesRestored > 0)
+	{
+		line << ", " << result.tilesRestored << " tiles from the bake cache";
+	}
+	if (!result.error.empty())
+	{
+		line << "\n       " << result.error;
+	}
+	std::cout << line.str() << std::endl;
+}
+
+int Headless::runBatch(const BatchSettings& settings, const BakeServices& services)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	std::cout << "Baking " << settings.jobs.size() << " jobs, " << settings.parallelJobs << " stages in parallel" << std::endl;
+
+	const Baking::BakeCache bakeCache(settings.cacheDirectory);
+	BakeServices batchServices = services;
+	if (bakeCache.isEnabled())
+	{
+		batchServices.bakeCache = &bakeCache;
+	}
+
+	std::vector<BakeResult> results;
+	{
+		Jobs::JobSystem jobs(std::max(1u, settings.parallelJobs), settings.memoryBudgetMB * 1024 * 1024);
+		results = bakeJobs(settings.jobs, jobs, 1, batchServices);
+	}
+
+	size_t failedJobs = 0;
+	for (const BakeResult& result : results)
+	{
+		failedJobs += result.succeeded ? 0 : 1;
+		printResult(result);
+	}
+
+	std::cout << std::fixed << std::setprecision(1) << settings.jobs.size() - failedJobs << " of " << settings.jobs.size()
+		<< " jobs baked in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+		<< " ms" << std::endl;
+	return failedJobs > 0 ? k_exitJobFailed : k_exitSuccess;
+}
+
+bool Headless::isBatchCommandLine(const std::vector<std::string>& args)
+{
+	for (const std::string& arg : args)
+	{
+		if (arg == "--bake" || arg == "--serve" || arg == "--worker" || arg == "--help")
+			return true;
+	}
+	return false;
+}
+
+int Headless::runCommandLine(const std::vector<std::string>& args)
+{
+	std::filesystem::path jobFile;
+	int32_t parallelJobs = -1;
+	bool isCoordinator = false;
+	CoordinatorSettings coordinatorSettings;
+	std::string workerAddress;
+	WorkerSettings workerSettings;
+	bool isServer = false;
+	ServerSettings serverSettings;
+	std::filesystem::path cacheDirectory;
+
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		const bool hasValue = i + 1 < args.size();
+		if (args[i] == "--bake" && hasValue)
+		{
+			jobFile = args[++i];
+		}
+		else if (args[i] == "--parallel" && hasValue)
+		{
+			parallelJobs = std::atoi(args[++i].c_str());
+		}
+		else if (args[i] == "--serve" && hasValue)
+		{
+			isServer = true;
+			serverSettings.port = static_cast<uint16_t>(std::atoi(args[++i].c_str()));
+		}
+		else if (args[i] == "--cache-mb" && hasValue)
+		{
+			serverSettings.cacheBudgetMB = static_cast<size_t>(std::max(0, std::atoi(args[++i].c_str())));
+		}
+		else if (args[i] == "--cache-dir" && hasValue)
+		{
+			cacheDirectory = args[++i];
+		}
+		else if (args[i] == "--coordinator")
+		{
+			isCoordinator = true;
+		}
+		else if (args[i] == "--listen" && hasValue)
+		{
+			coordinatorSettings.port = static_cast<uint16_t>(std::atoi(args[++i].c_str()));
+		}
+		else if (args[i] == "--local-workers" && hasValue)
+		{
+			coordinatorSettings.localWorkers = static_cast<uint32_t>(std::max(0, std::atoi(args[++i].c_str())));
+		}
+		else if (args[i] == "--worker-threads" && hasValue)
+		{
+			coordinatorSettings.localWorkerThreads = static_cast<uint32_t>(std::max(0, std::atoi(args[++i].c_str())));
+		}
+		else if (args[i] == "--worker-timeout" && hasValue)
+		{
+			coordinatorSettings.workerTimeoutSeconds = std::max(1.0, std::atof(args[++i].c_str()));
+		}
+		else if (args[i] == "--worker" && hasValue)
+		{
+			workerAddress = args[++i];
+		}
+		else if (args[i] == "--threads" && hasValue)
+		{
+			workerSettings.threads = static_cast<uint32_t>(std::max(0, std::atoi(args[++i].c_str())));
+		}
+		else if (args[i] == "--help")
+		{
+			printUsage();
+			return k_exitSuccess;
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << args[i] << std::endl;
+			printUsage();
+			return k_exitUsage;
+		}
+	}
+
+	if (!workerAddress.empty())
+	{
+		if (!parseAddress(workerAddress, workerSettings.host, workerSettings.port))
+		{
+			std::cerr << "Invalid coordinator address " << workerAddress << ", expected host:port" << std::endl;
+			return k_exitUsage;
+		}
+		return runWorker(workerSettings);
+	}
+
+	if (jobFile.empty() && !isServer)
+	{
+		printUsage();
+		return k_exitUsage;
+	}
+
+	BatchSettings settings;
+	std::string error;
+	if (!isServer)
+	{
+		if (!loadJobFile(jobFile, settings, error))
+		{
+			std::cerr << "Invalid job file " << jobFile.string() << ": " << error << std::endl;
+			return k_exitUsage;
+		}
+		if (parallelJobs > 0)
+		{
+			settings.parallelJobs = static_cast<uint32_t>(parallelJobs);
+		}
+		if (!cacheDirectory.empty())
+		{
+			settings.cacheDirectory = cacheDirectory;
+		}
+	}
+	else
+	{
+		if (parallelJobs > 0)
+		{
+			serverSettings.parallelJobs = static_cast<uint32_t>(parallelJobs);
+		}
+		serverSettings.bakeCacheDirectory = cacheDirectory;
+	}
+
+	std::unique_ptr<Coordinator> coordinator;
+	if (isCoordinator)
+	{
+		coordinator = std::make_unique<Coordinator>(coordinatorSettings);
+		if (!coordinator->start(error))
+		{
+			std::cerr << "Cannot start coordinator: " << error << std::endl;
+			return k_exitUsage;
+		}
+	}
+
+	if (isServer)
+		return runServer(serverSettings, coordinator.get());
+
+	BakeServices services;
+	services.coordinator = coordinator.get();
+	return runBatch(settings, services);
+}
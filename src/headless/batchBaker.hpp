@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "baking/blockCompression.hpp"
+#include "baking/dilation.hpp"
+#include "baking/exrWriter.hpp"
+
+// Bakes without a window or D3D11 device: BakeForge --bake jobs.json
+// Every job bakes all meshes of a low-poly glTF against all meshes of a high-poly glTF with the CPU
+// rasterizer and tracer, so it runs on build machines and render-farm workers without a GPU.
+namespace Jobs
+{
+	class JobSystem;
+}
+
+namespace Baking
+{
+	class BakeCache;
+}
+
+namespace Headless
+{
+	class Coordinator;
+	class SceneCache;
+
+	enum ExitCode : int
+	{
+		k_exitSuccess = 0,
+		k_exitJobFailed = 1, // at least one job failed, the others still ran
+		k_exitUsage = 2      // bad arguments or unreadable job file, nothing was baked
+	};
+
+	enum class BakeMap
+	{
+		Normal,
+		AmbientOcclusion,
+		Thickness
+	};
+
+	struct BakeJob
+	{
+		std::string name;
+		std::filesystem::path lowPoly;
+		std::filesystem::path highPoly;
+		std::filesystem::path output; // .png, .tga, .exr or .dds, UDIM layouts get one file per tile
+		uint32_t width = 1024;
+		uint32_t height = 1024;
+		uint32_t bitDepth = 8;    // 8 or 16 for PNG, 16 (half) or 32 (float) for EXR
+		int compressionLevel = 6; // PNG and EXR ZIP deflate level, 0 stores, 9 is smallest
+		Baking::EXRCompression exrCompression = Baking::EXRCompression::ZIP;
+		uint32_t exrTileSize = 0; // 0 writes scanline EXRs
+		Baking::BlockFormat ddsFormat = Baking::BlockFormat::BC5; // BC7 by default for AO and thickness
+		float cageOffset = 0.1f;
+		bool autoCage = false; // "cageOffset": "auto", per-vertex cage measured against the high-poly
+		bool useSmoothedNormals = false;
+		float rayDirectionBlend = 0.0f;
+		uint32_t dilationDistance = 16;
+		BakeMap map = BakeMap::Normal;
+		uint32_t samples = 64;    // AO and thickness rays per texel
+		float maxDistance = 0.0f; // AO and thickness reach, 0 = a tenth of the high-poly bounds diagonal
+		bool approximate = false; // AO and thickness from a sparse SDF of the high-poly instead of rays
+		float voxelSize = 0.0f;   // of the SDF, 0 = maxDistance / 16
+		// Content hashes of meshes in the server's scene cache, used instead of the paths when set
+		uint64_t lowPolyHash = 0;
+		uint64_t highPolyHash = 0;
+	};
+
+	struct BatchSettings
+	{
+		std::vector<BakeJob> jobs;
+		uint32_t parallelJobs = 2;     // bake stages running at once, each stage is multithreaded itself
+		size_t memoryBudgetMB = 4096;
+		std::filesystem::path cacheDirectory; // bake results of earlier runs, empty disables the bake cache
+	};
+
+	struct BakeServices
+	{
+		Coordinator* coordinator = nullptr; // splits the trace stage of every tile across its workers
+		SceneCache* sceneCache = nullptr;   // reuses prepared meshes of earlier bakes
+		const Baking::BakeCache* bakeCache = nullptr; // restores the outputs of unchanged bakes and tiles
+	};
+
+	struct BakeResult
+	{
+		std::string name;
+		bool succeeded = false;
+		double ms = 0.0;
+		std::vector<std::pair<std::string, double>> stageMs; // summed over tiles, so tile stages may exceed the wall time
+		size_t tileCount = 0;
+		size_t tilesSaved = 0;
+		size_t tilesRestored = 0; // of the saved tiles, copied from the bake cache
+		bool isMultiTile = false;
+		std::string error;
+		uint64_t lowPolyHash = 0; // content hashes, only known with a scene cache
+		uint64_t highPolyHash = 0;
+	};
+
+	// Relative paths in the job file are resolved against the job file's directory
+	bool loadJobFile(const std::filesystem::path& path, BatchSettings& outSettings, std::string& outError);
+	bool parseJobs(const std::string& json, const std::filesystem::path& baseDirectory, BatchSettings& outSettings,
+		std::string& outError);
+
+	// Bakes the jobs on an existing job system and waits for them, each job gets its own group starting at firstGroup
+	std::vector<BakeResult> bakeJobs(const std::vector<BakeJob>& jobs, Jobs::JobSystem& jobSystem, uint64_t firstGroup,
+		const BakeServices& services);
+	void printResult(const BakeResult& result);
+	int runBatch(const BatchSettings& settings, const BakeServices& services = {});
+
+	// True if the arguments ask for a headless bake or worker, the GUI starts otherwise
+	bool isBatchCommandLine(const std::vector<std::string>& args);
+	int runCommandLine(const std::vector<std::string>& args);
+} // namespace Headless
@@ -0,0 +1,720 @@
+#include "distributedTracer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+using namespace Headless;
+
+namespace
+{
+	enum class MessageType : uint32_t
+	{
+		Hello,        // worker -> coordinator, payload HelloPayload
+		Scene,        // coordinator -> worker, payload SceneHeader and the combined high-poly arrays
+		ReleaseScene, // coordinator -> worker, no payload
+		Work,         // coordinator -> worker, payload TexelRecords
+		Result,       // worker -> coordinator, payload RGBA16 texels, one per record
+		Shutdown,     // coordinator -> worker, no payload
+		Heartbeat     // coordinator -> worker while idle, no payload
+	};
+
+	struct MessageHeader
+	{
+		MessageType type;
+		uint32_t sceneId;
+		uint64_t id;
+		uint64_t size; // payload bytes following the header
+	};
+
+	// Records and acceleration structures are sent as raw memory, so both ends must agree on their layout
+	struct HelloPayload
+	{
+		uint32_t version = k_distributedProtocolVersion;
+		uint32_t triangleSize = sizeof(Triangle);
+		uint32_t nodeSize = sizeof(BVH::Node);
+		uint32_t instanceSize = sizeof(Baking::BLASInstance);
+		uint32_t texelRecordSize = sizeof(Baking::TexelRecord);
+		uint32_t littleEndian = 1;
+
+		bool operator==(const HelloPayload& other) const = default;
+	};
+
+	struct SceneHeader
+	{
+		float cageOffset;
+		uint32_t useSmoothedNormals;
+		float rayDirectionBlend;
+		uint32_t usePerTexelCage;
+		uint64_t triangleCount;
+		uint64_t triIndexCount;
+		uint64_t bvhNodeCount;
+		uint64_t instanceCount;
+	};
+
+	// Chunks running this many times longer than average are traced again by an idle worker
+	constexpr double k_speculativeFactor = 3.0;
+	constexpr double k_minSpeculativeMs = 1000.0;
+	constexpr int k_acceptPollMs = 200;
+	constexpr int k_heartbeatMs = 5000;
+	// Local workers still running this long after the shutdown, e.g. still trying to connect, are terminated
+	constexpr int k_localWorkerGraceMs = 5000;
+
+	bool sendMessage(const Socket& socket, MessageType type, uint32_t sceneId, uint64_t id, const void* payload, size_t size)
+	{
+		const MessageHeader header = { type, sceneId, id, size };
+		return socket.sendAll(&header, sizeof(header)) && (size == 0 || socket.sendAll(payload, size));
+	}
+
+	void appendBytes(std::vector<uint8_t>& buffer, const void* data, size_t size)
+	{
+		if (size == 0)
+			return;
+		const size_t offset = buffer.size();
+		buffer.resize(offset + size);
+		std::memcpy(buffer.data() + offset, data, size);
+	}
+
+	template <typename T>
+	void appendBytes(std::vector<uint8_t>& buffer, const std::vector<T>& values)
+	{
+		appendBytes(buffer, values.data(), values.size() * sizeof(T));
+	}
+
+	template <typename T>
+	bool readArray(const uint8_t*& cursor, const uint8_t* end, uint64_t count, std::vector<T>& outValues)
+	{
+		const size_t bytes = count * sizeof(T);
+		if (static_cast<size_t>(end - cursor) < bytes)
+			return false;
+		outValues.resize(count);
+		std::memcpy(outValues.data(), cursor, bytes);
+		cursor += bytes;
+		return true;
+	}
+
+	double elapsedMs(std::chrono::steady_clock::time_point since)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+	}
+}
+
+struct Coordinator::Batch
+{
+	uint32_t sceneId = 0;
+	const Baking::UVRasterResult* texels = nullptr;
+	uint8_t* pixels = nullptr;
+	size_t rowPitch = 0;
+	Baking::TexelFormat format = Baking::TexelFormat::RGBA16;
+	std::vector<Chunk> chunks;
+	size_t remainingChunks = 0;
+	uint32_t activeSends = 0; // texel records are read from the caller's memory until the send finished
+};
+
+Coordinator::Coordinator(const CoordinatorSettings& settings)
+	: m_settings(settings)
+	, m_lastWorkerSeen(std::chrono::steady_clock::now())
+{
+}
+
+Coordinator::~Coordinator()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shutdown = true;
+	}
+	m_workCondition.notify_all();
+	if (m_acceptThread.joinable())
+	{
+		m_acceptThread.join();
+	}
+
+	// Workers that connected after the accept loop stopped wait in the backlog, shut them down before closing it
+	while (true)
+	{
+		Socket socket = m_listenSocket.accept(0);
+		if (!socket.isValid())
+			break;
+		sendMessage(socket, MessageType::Shutdown, 0, 0, nullptr, 0);
+	}
+	m_listenSocket.close();
+
+	size_t chunksTraced = 0;
+	for (std::unique_ptr<Worker>& worker : m_workers)
+	{
+		worker->thread.join();
+		chunksTraced += worker->chunksTraced;
+	}
+	for (const std::unique_ptr<Worker>& worker : m_workers)
+	{
+		if (worker->chunksTraced == 0)
+			continue;
+		std::cout << "Worker " << worker->name << ": " << worker->chunksTraced << " chunks, "
+			<< worker->texelsTraced << " texels (" << 100.0 * worker->chunksTraced / chunksTraced << "%)" << std::endl;
+	}
+	if (m_rescheduledChunks > 0)
+	{
+		std::cout << m_rescheduledChunks << " chunks rescheduled from failed or slow workers" << std::endl;
+	}
+	waitForLocalWorkers();
+}
+
+bool Coordinator::start(std::string& outError)
+{
+	m_listenSocket = Socket::listen(m_settings.port);
+	if (!m_listenSocket.isValid())
+	{
+		outError = "cannot listen on port " + std::to_string(m_settings.port);
+		return false;
+	}
+	std::cout << "Coordinator listening on port " << getPort() << std::endl;
+
+	m_lastWorkerSeen = std::chrono::steady_clock::now();
+	m_acceptThread = std::thread(&Coordinator::acceptLoop, this);
+	startLocalWorkers();
+	return true;
+}
+
+uint16_t Coordinator::getPort() const
+{
+	return m_listenSocket.getLocalPort();
+}
+
+uint32_t Coordinator::addScene(const Baking::CombinedHighPolyData& highPoly, const Baking::NormalTraceSettings& settings)
+{
+	SceneHeader header = {};
+	header.cageOffset = settings.cageOffset;
+	header.useSmoothedNormals = settings.useSmoothedNormals ? 1 : 0;
+	header.rayDirectionBlend = settings.rayDirectionBlend;
+	header.usePerTexelCage = settings.usePerTexelCage ? 1 : 0;
+	header.triangleCount = highPoly.triangles.size();
+	header.triIndexCount = highPoly.triIndices.size();
+	header.bvhNodeCount = highPoly.bvhNodes.size();
+	header.instanceCount = highPoly.blasInstances.size();
+
+	auto payload = std::make_shared<std::vector<uint8_t>>();
+	payload->reserve(sizeof(header) + highPoly.triangles.size() * sizeof(Triangle) + highPoly.triIndices.size() * sizeof(uint32_t)
+		+ highPoly.bvhNodes.size() * sizeof(BVH::Node) + highPoly.blasInstances.size() * sizeof(Baking::BLASInstance));
+	appendBytes(*payload, &header, sizeof(header));
+	appendBytes(*payload, highPoly.triangles);
+	appendBytes(*payload, highPoly.triIndices);
+	appendBytes(*payload, highPoly.bvhNodes);
+	appendBytes(*payload, highPoly.blasInstances);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const uint32_t sceneId = m_nextSceneId++;
+	m_scenes[sceneId].payload = std::move(payload);
+	return sceneId;
+}
+
+void Coordinator::removeScene(uint32_t sceneId)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_scenes.erase(sceneId);
+	}
+	m_workCondition.notify_all(); // idle workers drop their copy right away
+}
+
+bool Coordinator::trace(uint32_t sceneId, const Baking::UVRasterResult& texels, uint8_t* pixels, size_t rowPitch,
+	Baking::TexelFormat format)
+{
+	auto batch = std::make_shared<Batch>();
+	batch->sceneId = sceneId;
+	batch->texels = &texels;
+	batch->pixels = pixels;
+	batch->rowPitch = rowPitch;
+	batch->format = format;
+
+	// Whole raster tiles per chunk keep the rays of a chunk coherent
+	Chunk chunk;
+	for (const Baking::TexelTileRange& range : texels.tiles)
+	{
+		if (chunk.texelCount == 0)
+		{
+			chunk.texelOffset = range.texelOffset;
+		}
+		chunk.texelCount += range.texelCount;
+		if (chunk.texelCount >= m_settings.texelsPerChunk)
+		{
+			batch->chunks.push_back(chunk);
+			chunk = Chunk();
+		}
+	}
+	if (chunk.texelCount > 0)
+	{
+		batch->chunks.push_back(chunk);
+	}
+	if (batch->chunks.empty())
+		return true;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	batch->remainingChunks = batch->chunks.size();
+	for (size_t i = 0; i < batch->chunks.size(); i++)
+	{
+		m_pendingChunks.push_back({ batch, i });
+	}
+	m_workCondition.notify_all();
+
+	const auto timeout = std::chrono::duration<double>(m_settings.workerTimeoutSeconds);
+	while (batch->remainingChunks > 0 || batch->activeSends > 0)
+	{
+		m_batchCondition.wait_for(lock, std::chrono::milliseconds(500));
+		if (batch->remainingChunks == 0)
+			continue;
+
+		if (m_connectedWorkers == 0 && std::chrono::steady_clock::now() - m_lastWorkerSeen > timeout)
+		{
+			// Nothing can be in flight without workers, the queued chunks are the only references left
+			std::erase_if(m_pendingChunks, [&](const ChunkRef& ref) { return ref.batch == batch; });
+			std::cerr << "No bake worker connected for " << m_settings.workerTimeoutSeconds << " s, giving up on the tile" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void Coordinator::acceptLoop()
+{
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_shutdown)
+				break;
+		}
+
+		Socket socket = m_listenSocket.accept(k_acceptPollMs);
+		if (!socket.isValid())
+			continue;
+
+		HelloPayload hello;
+		MessageHeader header = {};
+		socket.setReceiveTimeout(5000);
+		if (!socket.receiveAll(&header, sizeof(header)) || header.type != MessageType::Hello || header.size != sizeof(hello)
+			|| !socket.receiveAll(&hello, sizeof(hello)) || !(hello == HelloPayload()))
+		{
+			std::cerr << "Rejected bake worker " << socket.getPeerName() << ": incompatible build" << std::endl;
+			continue;
+		}
+		socket.setReceiveTimeout(static_cast<int>(m_settings.workerTimeoutSeconds * 1000.0));
+
+		auto worker = std::make_unique<Worker>();
+		worker->name = socket.getPeerName();
+		worker->socket = std::move(socket);
+		std::cout << "Bake worker " << worker->name << " connected" << std::endl;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_connectedWorkers++;
+		m_lastWorkerSeen = std::chrono::steady_clock::now();
+		Worker& workerRef = *worker;
+		worker->thread = std::thread(&Coordinator::workerLoop, this, std::ref(workerRef));
+		m_workers.push_back(std::move(worker));
+	}
+}
+
+void Coordinator::workerLoop(Worker& worker)
+{
+	std::unordered_map<uint32_t, bool> sentScenes;
+	std::vector<uint16_t> result;
+	bool connected = true;
+
+	while (connected)
+	{
+		// Drop scenes the coordinator no longer bakes, then wait for work
+		std::vector<uint32_t> releasedScenes;
+		ChunkRef chunkRef;
+		std::shared_ptr<const std::vector<uint8_t>> scenePayload;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (const auto& [sceneId, sent] : sentScenes)
+			{
+				if (!m_scenes.contains(sceneId))
+					releasedScenes.push_back(sceneId);
+			}
+		}
+		for (uint32_t sceneId : releasedScenes)
+		{
+			sentScenes.erase(sceneId);
+			connected &= sendMessage(worker.socket, MessageType::ReleaseScene, sceneId, 0, nullptr, 0);
+		}
+		if (!connected || !takeChunk(chunkRef))
+			break;
+		if (!chunkRef.batch)
+		{
+			// Idle for a while, the worker drops coordinators that stay silent
+			connected = sendMessage(worker.socket, MessageType::Heartbeat, 0, 0, nullptr, 0);
+			continue;
+		}
+
+		Batch& batch = *chunkRef.batch;
+		Chunk& chunk = batch.chunks[chunkRef.chunk];
+		if (!sentScenes.contains(batch.sceneId))
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				auto scene = m_scenes.find(batch.sceneId);
+				if (scene != m_scenes.end())
+					scenePayload = scene->second.payload;
+			}
+			connected = scenePayload && sendMessage(worker.socket, MessageType::Scene, batch.sceneId, 0, scenePayload->data(), scenePayload->size());
+			sentScenes[batch.sceneId] = true;
+		}
+
+		const uint64_t chunkId = (static_cast<uint64_t>(batch.sceneId) << 32) | chunkRef.chunk;
+		connected = connected && sendMessage(worker.socket, MessageType::Work, batch.sceneId, chunkId,
+			batch.texels->texels.data() + chunk.texelOffset, chunk.texelCount * sizeof(Baking::TexelRecord));
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			batch.activeSends--;
+		}
+		m_batchCondition.notify_all();
+
+		MessageHeader header = {};
+		result.resize(static_cast<size_t>(chunk.texelCount) * 4);
+		connected = connected
+			&& worker.socket.receiveAll(&header, sizeof(header))
+			&& header.type == MessageType::Result && header.id == chunkId && header.size == result.size() * sizeof(uint16_t)
+			&& worker.socket.receiveAll(result.data(), result.size() * sizeof(uint16_t));
+
+		if (!connected)
+		{
+			returnChunk(chunkRef);
+			break;
+		}
+		worker.chunksTraced++;
+		worker.texelsTraced += chunk.texelCount;
+		completeChunk(chunkRef, result);
+	}
+
+	if (!connected)
+	{
+		std::cerr << "Bake worker " << worker.name << " failed or timed out, its work is rescheduled" << std::endl;
+	}
+	else
+	{
+		sendMessage(worker.socket, MessageType::Shutdown, 0, 0, nullptr, 0);
+	}
+	worker.socket.close();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_connectedWorkers--;
+		m_lastWorkerSeen = std::chrono::steady_clock::now();
+	}
+	m_batchCondition.notify_all();
+}
+
+bool Coordinator::takeChunk(ChunkRef& outChunk)
+{
+	const auto idleStart = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		if (m_shutdown)
+			return false;
+		if (elapsedMs(idleStart) >= k_heartbeatMs)
+		{
+			outChunk = ChunkRef();
+			return true;
+		}
+
+		while (!m_pendingChunks.empty())
+		{
+			ChunkRef ref = std::move(m_pendingChunks.front());
+			m_pendingChunks.pop_front();
+			Chunk& chunk = ref.batch->chunks[ref.chunk];
+			if (chunk.done)
+				continue; // a speculative copy finished first
+			chunk.copies++;
+			chunk.startTime = std::chrono::steady_clock::now();
+			ref.batch->activeSends++;
+			m_inFlightChunks.push_back(ref);
+			outChunk = std::move(ref);
+			return true;
+		}
+
+		// Nothing queued: trace again the oldest chunk that takes far longer than usual, the first result wins
+		const double slowMs = std::max(k_minSpeculativeMs, m_averageChunkMs * k_speculativeFactor);
+		for (ChunkRef& ref : m_inFlightChunks)
+		{
+			Chunk& chunk = ref.batch->chunks[ref.chunk];
+			if (chunk.done || chunk.copies > 1 || elapsedMs(chunk.startTime) < slowMs)
+				continue;
+			chunk.copies++;
+			m_rescheduledChunks++;
+			ref.batch->activeSends++;
+			outChunk = ref;
+			m_inFlightChunks.push_back(outChunk);
+			return true;
+		}
+
+		// Idle workers recheck for slow chunks, so no condition covers every wake-up reason
+		m_workCondition.wait_for(lock, std::chrono::milliseconds(m_inFlightChunks.empty() ? 1000 : 100));
+	}
+}
+
+void Coordinator::returnChunk(const ChunkRef& chunkRef)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Chunk& chunk = chunkRef.batch->chunks[chunkRef.chunk];
+		auto it = std::find_if(m_inFlightChunks.begin(), m_inFlightChunks.end(), [&](const ChunkRef& ref)
+			{
+				return ref.batch == chunkRef.batch && ref.chunk == chunkRef.chunk;
+			});
+		if (it != m_inFlightChunks.end())
+			m_inFlightChunks.erase(it);
+
+		chunk.copies--;
+		if (!chunk.done && chunk.copies == 0)
+		{
+			m_rescheduledChunks++;
+			m_pendingChunks.push_front(chunkRef);
+		}
+	}
+	m_workCondition.notify_all();
+}
+
+void Coordinator::completeChunk(const ChunkRef& chunkRef, const std::vector<uint16_t>& result)
+{
+	Batch& batch = *chunkRef.batch;
+	Chunk& chunk = batch.chunks[chunkRef.chunk];
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = std::find_if(m_inFlightChunks.begin(), m_inFlightChunks.end(), [&](const ChunkRef& ref)
+			{
+				return ref.batch == chunkRef.batch && ref.chunk == chunkRef.chunk;
+			});
+		if (it != m_inFlightChunks.end())
+			m_inFlightChunks.erase(it);
+		chunk.copies--;
+		if (chunk.done)
+			return; // the other copy won
+
+		chunk.done = true;
+		const double chunkMs = elapsedMs(chunk.startTime);
+		m_averageChunkMs = m_averageChunkMs == 0.0 ? chunkMs : m_averageChunkMs * 0.9 + chunkMs * 0.1;
+	}
+
+	// Only the winning copy writes, and trace() waits for it before the pixels go away
+	const Baking::TexelRecord* records = batch.texels->texels.data() + chunk.texelOffset;
+	for (uint32_t i = 0; i < chunk.texelCount; i++)
+	{
+		if (batch.format == Baking::TexelFormat::RGBA32F)
+		{
+			const float values[4] = { result[i * 4] / 65535.0f, result[i * 4 + 1] / 65535.0f, result[i * 4 + 2] / 65535.0f, result[i * 4 + 3] / 65535.0f };
+			Baking::storeTexel(batch.pixels, batch.rowPitch, records[i].getX(), records[i].getY(), values, batch.format);
+			continue;
+		}
+		uint16_t* texel = reinterpret_cast<uint16_t*>(batch.pixels + records[i].getY() * batch.rowPitch) + records[i].getX() * 4;
+		std::memcpy(texel, result.data() + i * 4, 4 * sizeof(uint16_t));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		batch.remainingChunks--;
+	}
+	m_batchCondition.notify_all();
+}
+
+void Coordinator::startLocalWorkers()
+{
+	if (m_settings.localWorkers == 0)
+		return;
+
+	const std::string address = "127.0.0.1:" + std::to_string(getPort());
+	const std::string threads = std::to_string(m_settings.localWorkerThreads);
+	for (uint32_t i = 0; i < m_settings.localWorkers; i++)
+	{
+#ifdef _WIN32
+		wchar_t executable[MAX_PATH];
+		GetModuleFileNameW(nullptr, executable, MAX_PATH);
+		std::wstring commandLine = L"\"" + std::wstring(executable) + L"\" --worker " + std::wstring(address.begin(), address.end())
+			+ L" --threads " + std::wstring(threads.begin(), threads.end());
+
+		STARTUPINFOW startupInfo = { sizeof(startupInfo) };
+		PROCESS_INFORMATION processInfo = {};
+		if (!CreateProcessW(executable, commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+		{
+			std::cerr << "Failed to start local bake worker " << i << std::endl;
+			continue;
+		}
+		CloseHandle(processInfo.hThread);
+		m_localProcesses.push_back(reinterpret_cast<intptr_t>(processInfo.hProcess));
+#else
+		std::string executable = "/proc/self/exe";
+		std::vector<std::string> args = { "BakeForge", "--worker", address, "--threads", threads };
+		std::vector<char*> argv;
+		for (std::string& arg : args)
+		{
+			argv.push_back(arg.data());
+		}
+		argv.push_back(nullptr);
+
+		pid_t pid = 0;
+		if (posix_spawn(&pid, executable.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+		{
+			std::cerr << "Failed to start local bake worker " << i << std::endl;
+			continue;
+		}
+		m_localProcesses.push_back(pid);
+#endif
+	}
+	std::cout << "Started " << m_localProcesses.size() << " local bake workers" << std::endl;
+}
+
+void Coordinator::waitForLocalWorkers()
+{
+	const auto waitStart = std::chrono::steady_clock::now();
+	for (intptr_t process : m_localProcesses)
+	{
+#ifdef _WIN32
+		const int remainingMs = std::max(0, k_localWorkerGraceMs - static_cast<int>(elapsedMs(waitStart)));
+		const HANDLE handle = reinterpret_cast<HANDLE>(process);
+		if (WaitForSingleObject(handle, remainingMs) == WAIT_TIMEOUT)
+		{
+			std::cerr << "Terminating unresponsive local bake worker" << std::endl;
+			TerminateProcess(handle, 1);
+			WaitForSingleObject(handle, INFINITE);
+		}
+		CloseHandle(handle);
+#else
+		const pid_t pid = static_cast<pid_t>(process);
+		int status = 0;
+		while (waitpid(pid, &status, WNOHANG) == 0)
+		{
+			if (elapsedMs(waitStart) >= k_localWorkerGraceMs)
+			{
+				std::cerr << "Terminating unresponsive local bake worker" << std::endl;
+				kill(pid, SIGTERM);
+				waitpid(pid, &status, 0);
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+#endif
+	}
+	m_localProcesses.clear();
+}
+
+int Headless::runWorker(const WorkerSettings& settings)
+{
+	struct WorkerScene
+	{
+		Baking::CombinedHighPolyData highPoly;
+		Baking::NormalTraceSettings settings;
+		std::unique_ptr<Baking::NormalTracer> tracer;
+	};
+
+	const auto connectStart = std::chrono::steady_clock::now();
+	Socket socket;
+	while (!socket.isValid())
+	{
+		socket = Socket::connect(settings.host, settings.port);
+		if (socket.isValid())
+			break;
+		if (elapsedMs(connectStart) > settings.connectTimeoutSeconds * 1000.0)
+		{
+			std::cerr << "Cannot connect to coordinator " << settings.host << ":" << settings.port << std::endl;
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	}
+
+	const HelloPayload hello;
+	if (!sendMessage(socket, MessageType::Hello, 0, 0, &hello, sizeof(hello)))
+		return 1;
+	socket.setReceiveTimeout(static_cast<int>(settings.coordinatorTimeoutSeconds * 1000.0));
+	std::cout << "Connected to coordinator " << settings.host << ":" << settings.port << std::endl;
+
+	std::unordered_map<uint32_t, std::unique_ptr<WorkerScene>> scenes;
+	std::vector<uint8_t> payload;
+	std::vector<Baking::TexelRecord> texels;
+	std::vector<uint16_t> result;
+	while (true)
+	{
+		MessageHeader header = {};
+		if (!socket.receiveAll(&header, sizeof(header)))
+		{
+			std::cerr << "Lost connection to coordinator" << std::endl;
+			return 1;
+		}
+
+		switch (header.type)
+		{
+		case MessageType::Scene:
+		{
+			payload.resize(header.size);
+			if (!socket.receiveAll(payload.data(), payload.size()) || payload.size() < sizeof(SceneHeader))
+				return 1;
+
+			SceneHeader sceneHeader;
+			std::memcpy(&sceneHeader, payload.data(), sizeof(sceneHeader));
+			auto scene = std::make_unique<WorkerScene>();
+			scene->settings.cageOffset = sceneHeader.cageOffset;
+			scene->settings.useSmoothedNormals = sceneHeader.useSmoothedNormals != 0;
+			scene->settings.rayDirectionBlend = sceneHeader.rayDirectionBlend;
+			scene->settings.usePerTexelCage = sceneHeader.usePerTexelCage != 0;
+
+			const uint8_t* cursor = payload.data() + sizeof(sceneHeader);
+			const uint8_t* end = payload.data() + payload.size();
+			if (!readArray(cursor, end, sceneHeader.triangleCount, scene->highPoly.triangles)
+				|| !readArray(cursor, end, sceneHeader.triIndexCount, scene->highPoly.triIndices)
+				|| !readArray(cursor, end, sceneHeader.bvhNodeCount, scene->highPoly.bvhNodes)
+				|| !readArray(cursor, end, sceneHeader.instanceCount, scene->highPoly.blasInstances))
+			{
+				std::cerr << "Malformed scene " << header.sceneId << std::endl;
+				return 1;
+			}
+			payload = std::vector<uint8_t>();
+			scene->tracer = std::make_unique<Baking::NormalTracer>(scene->highPoly);
+			std::cout << "Received scene " << header.sceneId << " (" << scene->highPoly.triangles.size() << " triangles)" << std::endl;
+			scenes[header.sceneId] = std::move(scene);
+			break;
+		}
+		case MessageType::ReleaseScene:
+			scenes.erase(header.sceneId);
+			break;
+		case MessageType::Heartbeat:
+			break;
+		case MessageType::Work:
+		{
+			texels.resize(header.size / sizeof(Baking::TexelRecord));
+			if (!socket.receiveAll(texels.data(), header.size))
+				return 1;
+
+			auto scene = scenes.find(header.sceneId);
+			if (scene == scenes.end())
+			{
+				std::cerr << "Work for unknown scene " << header.sceneId << std::endl;
+				return 1;
+			}
+			result.resize(texels.size() * 4);
+			scene->second->tracer->traceTexels(texels.data(), texels.size(), scene->second->settings, result.data(), settings.threads);
+			if (!sendMessage(socket, MessageType::Result, header.sceneId, header.id, result.data(), result.size() * sizeof(uint16_t)))
+				return 1;
+			break;
+		}
+		case MessageType::Shutdown:
+			return 0;
+		default:
+			std::cerr << "Unexpected message from coordinator" << std::endl;
+			return 1;
+		}
+	}
+}
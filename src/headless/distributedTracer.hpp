@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "baking/highPoly.hpp"
+#include "baking/normalTracer.hpp"
+#include "socket.hpp"
+
+// Distributed tracing for headless bakes. A coordinator rasterizes the tiles itself and splits their texels
+// into chunks traced by worker processes, local or on other hosts: BakeForge --worker host:port.
+// Workers connect to the coordinator, receive the acceleration structure of a bake once and then trace
+// chunks until the coordinator shuts them down. Both sides must run the same build.
+namespace Headless
+{
+	constexpr uint32_t k_distributedProtocolVersion = 3;
+
+	struct CoordinatorSettings
+	{
+		uint16_t port = 0;                  // 0 picks a free port, only useful with local workers
+		uint32_t localWorkers = 0;          // worker processes started on this machine
+		uint32_t localWorkerThreads = 0;    // trace threads of each local worker, 0 = all hardware threads
+		size_t texelsPerChunk = 65536;
+		double workerTimeoutSeconds = 300.0; // workers silent for longer are dropped and their chunks rescheduled
+	};
+
+	class Coordinator
+	{
+	public:
+		explicit Coordinator(const CoordinatorSettings& settings);
+		~Coordinator(); // shuts the workers down, waits briefly for local worker processes and then terminates them
+		Coordinator(const Coordinator&) = delete;
+		Coordinator& operator=(const Coordinator&) = delete;
+
+		bool start(std::string& outError);
+		uint16_t getPort() const;
+
+		// Serializes the scene once, workers receive it before their first chunk of it
+		uint32_t addScene(const Baking::CombinedHighPolyData& highPoly, const Baking::NormalTraceSettings& settings);
+		// Workers release their copy before tracing their next chunk, no-op for removed scenes
+		void removeScene(uint32_t sceneId);
+
+		// Same output as NormalTracer::trace. Blocks until every chunk is traced,
+		// false if no worker was connected for the worker timeout.
+		// Workers always send RGBA16, RGBA32F pixels receive the widened values.
+		bool trace(uint32_t sceneId, const Baking::UVRasterResult& texels, uint8_t* pixels, size_t rowPitch,
+			Baking::TexelFormat format = Baking::TexelFormat::RGBA16);
+
+	private:
+		struct Batch;
+		struct Chunk
+		{
+			uint32_t texelOffset = 0;
+			uint32_t texelCount = 0;
+			uint32_t copies = 0; // in flight on this many workers, more than one once rescheduled speculatively
+			bool done = false;
+			std::chrono::steady_clock::time_point startTime;
+		};
+		struct ChunkRef
+		{
+			std::shared_ptr<Batch> batch;
+			size_t chunk = 0;
+		};
+		struct Scene
+		{
+			std::shared_ptr<const std::vector<uint8_t>> payload;
+		};
+		struct Worker
+		{
+			Socket socket;
+			std::string name;
+			std::thread thread;
+			size_t chunksTraced = 0;
+			size_t texelsTraced = 0;
+		};
+
+		void acceptLoop();
+		void workerLoop(Worker& worker);
+		// False on shutdown, an empty chunk once idle long enough for a heartbeat
+		bool takeChunk(ChunkRef& outChunk);
+		void returnChunk(const ChunkRef& chunk);
+		void completeChunk(const ChunkRef& chunk, const std::vector<uint16_t>& result);
+		void startLocalWorkers();
+		void waitForLocalWorkers();
+
+		CoordinatorSettings m_settings;
+		Socket m_listenSocket;
+		std::thread m_acceptThread;
+
+		std::mutex m_mutex;
+		std::condition_variable m_workCondition;  // chunks queued or shutdown
+		std::condition_variable m_batchCondition; // chunks finished or workers gone
+		std::unordered_map<uint32_t, Scene> m_scenes;
+		uint32_t m_nextSceneId = 1;
+		std::deque<ChunkRef> m_pendingChunks;
+		std::vector<ChunkRef> m_inFlightChunks;
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		size_t m_connectedWorkers = 0;
+		std::chrono::steady_clock::time_point m_lastWorkerSeen;
+		double m_averageChunkMs = 0.0;
+		size_t m_rescheduledChunks = 0;
+		bool m_shutdown = false;
+
+		std::vector<intptr_t> m_localProcesses;
+	};
+
+	struct WorkerSettings
+	{
+		std::string host = "127.0.0.1";
+		uint16_t port = 0;
+		uint32_t threads = 0;              // 0 = all hardware threads
+		double connectTimeoutSeconds = 30.0; // coordinator may still be starting up
+		double coordinatorTimeoutSeconds = 60.0; // idle coordinators send heartbeats, silence for longer means it is gone
+	};
+
+	// Traces chunks for a coordinator until it shuts the worker down, returns a process exit code
+	int runWorker(const WorkerSettings& settings);
+} // namespace Headless
@@ -0,0 +1,11 @@
+#include <string>
+#include <vector>
+
+#include "batchBaker.hpp"
+
+// Entry point of the console build on platforms without D3D11, the Windows build handles --bake in wWinMain
+int main(int argc, char** argv)
+{
+	const std::vector<std::string> args(argv + 1, argv + argc);
+	return Headless::runCommandLine(args);
+}
@@ -0,0 +1,235 @@
+#include "sceneCache.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <json.hpp>
+
+#include "utility/hash.hpp"
+
+using namespace Headless;
+
+namespace
+{
+	std::vector<uint8_t> readFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			throw std::runtime_error("cannot read " + path.string());
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	// External buffers of a .gltf file hold the geometry, so they are part of its content.
+	// Images don't affect the prepared meshes and are skipped.
+	std::vector<std::filesystem::path> getExternalBuffers(const std::filesystem::path& path, const std::vector<uint8_t>& contents)
+	{
+		std::vector<std::filesystem::path> buffers;
+		if (path.extension() != ".gltf")
+			return buffers;
+
+		const nlohmann::json root = nlohmann::json::parse(contents.begin(), contents.end(), nullptr, false);
+		if (root.is_discarded() || !root.contains("buffers") || !root["buffers"].is_array())
+			return buffers;
+
+		for (const nlohmann::json& buffer : root["buffers"])
+		{
+			const std::string uri = buffer.value("uri", "");
+			if (!uri.empty() && uri.rfind("data:", 0) != 0)
+			{
+				buffers.push_back(path.parent_path() / uri);
+			}
+		}
+		return buffers;
+	}
+
+	uint64_t getCacheKey(uint64_t hash, bool isHighPoly)
+	{
+		return Hash::combine(hash, isHighPoly ? 2 : 1);
+	}
+
+	size_t getLowPolyBytes(const void* scene)
+	{
+		size_t bytes = 0;
+		for (const Baking::MeshGeometry& mesh : *static_cast<const SceneCache::LowPolyScene*>(scene))
+		{
+			bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+		}
+		return bytes;
+	}
+
+	size_t getHighPolyBytes(const void* scene)
+	{
+		const auto& highPoly = *static_cast<const SceneCache::HighPolyScene*>(scene);
+		return highPoly.triangles.size() * sizeof(Triangle) + highPoly.triIndices.size() * sizeof(uint32_t)
+			+ highPoly.bvhNodes.size() * sizeof(BVH::Node) + highPoly.blasInstances.size() * sizeof(Baking::BLASInstance);
+	}
+}
+
+SceneCache::SceneCache(size_t memoryBudget)
+	: m_memoryBudget(memoryBudget)
+{
+}
+
+uint64_t SceneCache::hashFile(const std::filesystem::path& path)
+{
+	const std::string key = std::filesystem::absolute(path).lexically_normal().string();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_fileHashes.find(key);
+		if (it != m_fileHashes.end())
+		{
+			bool isCurrent = true;
+			for (const FileStamp& stamp : it->second.files)
+			{
+				std::error_code error;
+				isCurrent = isCurrent && std::filesystem::file_size(stamp.path, error) == stamp.size && !error
+					&& std::filesystem::last_write_time(stamp.path, error) == stamp.writeTime && !error;
+			}
+			if (isCurrent)
+				return it->second.hash;
+		}
+	}
+
+	// Stamps are taken before reading, a file written meanwhile is hashed again next time
+	FileHash fileHash;
+	auto stampAndRead = [&](const std::filesystem::path& file)
+		{
+			std::error_code error;
+			FileStamp stamp;
+			stamp.path = file;
+			stamp.size = std::filesystem::file_size(file, error);
+			stamp.writeTime = std::filesystem::last_write_time(file, error);
+			if (error)
+				throw std::runtime_error("cannot read " + file.string() + ": " + error.message());
+			fileHash.files.push_back(stamp);
+
+			const std::vector<uint8_t> contents = readFile(file);
+			fileHash.hash = Hash::bytes(contents.data(), contents.size(), fileHash.hash);
+			return contents;
+		};
+
+	const std::vector<uint8_t> contents = stampAndRead(path);
+	for (const std::filesystem::path& buffer : getExternalBuffers(path, contents))
+	{
+		stampAndRead(buffer);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_fileHashes[key] = fileHash;
+	return fileHash.hash;
+}
+
+bool SceneCache::contains(uint64_t hash, bool isHighPoly) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.contains(getCacheKey(hash, isHighPoly));
+}
+
+std::shared_ptr<const SceneCache::LowPolyScene> SceneCache::getLowPoly(uint64_t hash, const std::string& source,
+	const std::function<std::shared_ptr<const LowPolyScene>()>& create)
+{
+	return std::static_pointer_cast<const LowPolyScene>(get(hash, false, source, getLowPolyBytes, create));
+}
+
+std::shared_ptr<const SceneCache::HighPolyScene> SceneCache::getHighPoly(uint64_t hash, const std::string& source,
+	const std::function<std::shared_ptr<const HighPolyScene>()>& create)
+{
+	return std::static_pointer_cast<const HighPolyScene>(get(hash, true, source, getHighPolyBytes, create));
+}
+
+SceneCache::Value SceneCache::get(uint64_t hash, bool isHighPoly, const std::string& source,
+	size_t (*getBytes)(const void*), const std::function<Value()>& create)
+{
+	const uint64_t key = getCacheKey(hash, isHighPoly);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(key);
+	if (it != m_entries.end())
+	{
+		m_recency.splice(m_recency.begin(), m_recency, it->second.recency);
+		m_hits++;
+		const std::shared_future<Value> value = it->second.value;
+		lock.unlock();
+		return value.get();
+	}
+
+	m_misses++;
+	std::promise<Value> promise;
+	Entry& entry = m_entries[key];
+	entry.info.hash = hash;
+	entry.info.isHighPoly = isHighPoly;
+	entry.info.source = source;
+	entry.value = promise.get_future().share();
+	m_recency.push_front(key);
+	entry.recency = m_recency.begin();
+	lock.unlock();
+
+	// Entries being created are never evicted, so the entry is still there afterwards
+	Value value;
+	try
+	{
+		value = create();
+	}
+	catch (...)
+	{
+		lock.lock();
+		m_recency.erase(m_entries.at(key).recency);
+		m_entries.erase(key);
+		lock.unlock();
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+	promise.set_value(value);
+
+	lock.lock();
+	Entry& created = m_entries.at(key);
+	created.info.bytes = getBytes(value.get());
+	created.isReady = true;
+	m_bytes += created.info.bytes;
+	evict();
+	return value;
+}
+
+void SceneCache::evict()
+{
+	auto it = m_recency.end();
+	while (m_bytes > m_memoryBudget && it != m_recency.begin())
+	{
+		--it;
+		auto entry = m_entries.find(*it);
+		if (!entry->second.isReady)
+			continue;
+
+		m_bytes -= entry->second.info.bytes;
+		m_evictions++;
+		m_entries.erase(entry);
+		it = m_recency.erase(it);
+	}
+}
+
+SceneCache::Stats SceneCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Stats stats;
+	stats.bytes = m_bytes;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evictions = m_evictions;
+	for (uint64_t key : m_recency)
+	{
+		stats.entries.push_back(m_entries.at(key).info);
+	}
+	return stats;
+}
+
+uint64_t Headless::hashSceneFile(const std::filesystem::path& path)
+{
+	const std::vector<uint8_t> contents = readFile(path);
+	uint64_t hash = Hash::bytes(contents.data(), contents.size());
+	for (const std::filesystem::path& buffer : getExternalBuffers(path, contents))
+	{
+		const std::vector<uint8_t> bufferContents = readFile(buffer);
+		hash = Hash::bytes(bufferContents.data(), bufferContents.size(), hash);
+	}
+	return hash;
+}
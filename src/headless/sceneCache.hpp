@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "baking/gltfGeometry.hpp"
+#include "baking/highPoly.hpp"
+
+namespace Headless
+{
+	// Prepared meshes of earlier bakes, keyed by the content hash of their glTF file. Low-polys are kept with smoothed
+	// normals and tangents, high-polys as the combined BLASes and TLAS, so a repeat bake skips import and all BVH builds.
+	// The least recently used entries are evicted once the memory budget is exceeded, running bakes keep their
+	// entries alive until they finish.
+	class SceneCache
+	{
+	public:
+		using LowPolyScene = std::vector<Baking::MeshGeometry>;
+		using HighPolyScene = Baking::CombinedHighPolyData;
+
+		struct EntryInfo
+		{
+			uint64_t hash = 0;
+			bool isHighPoly = false;
+			std::string source; // file the entry was created from
+			size_t bytes = 0;
+		};
+
+		struct Stats
+		{
+			size_t bytes = 0;
+			size_t hits = 0;
+			size_t misses = 0;
+			size_t evictions = 0;
+			std::vector<EntryInfo> entries; // most recently used first
+		};
+
+		explicit SceneCache(size_t memoryBudget);
+
+		// Content hash of the file, remembered until the file's size or write time changes. Throws if it can't be read.
+		uint64_t hashFile(const std::filesystem::path& path);
+
+		bool contains(uint64_t hash, bool isHighPoly) const;
+
+		// Returns the cached scene or calls create and caches its result. Concurrent requests for the same
+		// hash wait for the first one instead of preparing the meshes again. Exceptions of create are rethrown.
+		std::shared_ptr<const LowPolyScene> getLowPoly(uint64_t hash, const std::string& source,
+			const std::function<std::shared_ptr<const LowPolyScene>()>& create);
+		std::shared_ptr<const HighPolyScene> getHighPoly(uint64_t hash, const std::string& source,
+			const std::function<std::shared_ptr<const HighPolyScene>()>& create);
+
+		Stats getStats() const;
+
+	private:
+		using Value = std::shared_ptr<const void>;
+
+		struct Entry
+		{
+			EntryInfo info;
+			std::shared_future<Value> value;
+			bool isReady = false; // only ready entries are counted and evicted
+			std::list<uint64_t>::iterator recency;
+		};
+
+		struct FileStamp
+		{
+			std::filesystem::path path;
+			uintmax_t size = 0;
+			std::filesystem::file_time_type writeTime;
+		};
+
+		struct FileHash
+		{
+			std::vector<FileStamp> files; // the glTF file and its external buffers
+			uint64_t hash = 0;
+		};
+
+		Value get(uint64_t hash, bool isHighPoly, const std::string& source, size_t (*getBytes)(const void*),
+			const std::function<Value()>& create);
+		void evict();
+
+		size_t m_memoryBudget = 0;
+		mutable std::mutex m_mutex;
+		std::unordered_map<uint64_t, Entry> m_entries; // by cache key, see getKey
+		std::list<uint64_t> m_recency;                 // cache keys, most recently used first
+		std::unordered_map<std::string, FileHash> m_fileHashes;
+		size_t m_bytes = 0;
+		size_t m_hits = 0;
+		size_t m_misses = 0;
+		size_t m_evictions = 0;
+	};
+
+	// Content hash of a glTF file and its external buffers, the same SceneCache::hashFile returns but not remembered.
+	// Throws if it can't be read.
+	uint64_t hashSceneFile(const std::filesystem::path& path);
+} // namespace Headless
@@ -0,0 +1,283 @@
+#include "socket.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace Headless;
+
+namespace
+{
+#ifdef _WIN32
+	void initializeSockets()
+	{
+		static std::once_flag initialized;
+		std::call_once(initialized, []()
+			{
+				WSADATA data;
+				WSAStartup(MAKEWORD(2, 2), &data);
+			});
+	}
+
+	void closeHandle(SocketHandle handle)
+	{
+		closesocket(static_cast<SOCKET>(handle));
+	}
+
+	constexpr int k_sendFlags = 0;
+#else
+	void initializeSockets()
+	{
+	}
+
+	void closeHandle(SocketHandle handle)
+	{
+		::close(handle);
+	}
+
+	constexpr int k_sendFlags = MSG_NOSIGNAL; // a dead peer is an error, not a signal
+#endif
+
+	// Work messages are large, latency of the small ones matters more than packet count
+	void setNoDelay(SocketHandle handle)
+	{
+		int enable = 1;
+		setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enable), sizeof(enable));
+	}
+}
+
+Socket::Socket(SocketHandle handle)
+	: m_handle(handle)
+{
+}
+
+Socket::~Socket()
+{
+	close();
+}
+
+Socket::Socket(Socket&& other) noexcept
+	: m_handle(other.m_handle)
+{
+	other.m_handle = invalidHandle();
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		m_handle = other.m_handle;
+		other.m_handle = invalidHandle();
+	}
+	return *this;
+}
+
+Socket Socket::listen(uint16_t port, bool loopbackOnly)
+{
+	initializeSockets();
+	Socket socket(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+	if (!socket.isValid())
+		return Socket();
+
+	int reuse = 1;
+	setsockopt(socket.m_handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+	address.sin_port = htons(port);
+	if (::bind(socket.m_handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+		|| ::listen(socket.m_handle, SOMAXCONN) != 0)
+	{
+		return Socket();
+	}
+	return socket;
+}
+
+Socket Socket::connect(const std::string& host, uint16_t port)
+{
+	initializeSockets();
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+		return Socket();
+
+	Socket socket;
+	for (addrinfo* address = addresses; address; address = address->ai_next)
+	{
+		Socket candidate(::socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+		if (candidate.isValid() && ::connect(candidate.m_handle, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0)
+		{
+			setNoDelay(candidate.m_handle);
+			socket = std::move(candidate);
+			break;
+		}
+	}
+	freeaddrinfo(addresses);
+	return socket;
+}
+
+bool Socket::isValid() const
+{
+	return m_handle != invalidHandle();
+}
+
+uint16_t Socket::getLocalPort() const
+{
+	sockaddr_in address = {};
+	socklen_t length = sizeof(address);
+	if (getsockname(m_handle, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+		return 0;
+	return ntohs(address.sin_port);
+}
+
+std::string Socket::getPeerName() const
+{
+	sockaddr_storage address = {};
+	socklen_t length = sizeof(address);
+	if (getpeername(m_handle, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+		return "unknown";
+
+	char host[NI_MAXHOST] = {};
+	char port[NI_MAXSERV] = {};
+	if (getnameinfo(reinterpret_cast<const sockaddr*>(&address), length, host, sizeof(host), port, sizeof(port),
+		NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+	{
+		return "unknown";
+	}
+	return std::string(host) + ":" + port;
+}
+
+Socket Socket::accept(int timeoutMs) const
+{
+	if (!waitReadable(timeoutMs))
+		return Socket();
+	Socket socket(::accept(m_handle, nullptr, nullptr));
+	if (socket.isValid())
+	{
+		setNoDelay(socket.m_handle);
+	}
+	return socket;
+}
+
+bool Socket::sendAll(const void* data, size_t size) const
+{
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+		const auto sent = ::send(m_handle, bytes, chunk, k_sendFlags);
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= static_cast<size_t>(sent);
+	}
+	return true;
+}
+
+bool Socket::receiveAll(void* data, size_t size) const
+{
+	char* bytes = static_cast<char*>(data);
+	while (size > 0)
+	{
+		const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+		const auto received = ::recv(m_handle, bytes, chunk, 0);
+		if (received <= 0)
+			return false; // closed, failed or timed out
+		bytes += received;
+		size -= static_cast<size_t>(received);
+	}
+	return true;
+}
+
+size_t Socket::receive(void* data, size_t size) const
+{
+	const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+	const auto received = ::recv(m_handle, static_cast<char*>(data), chunk, 0);
+	return received > 0 ? static_cast<size_t>(received) : 0;
+}
+
+bool Socket::waitReadable(int timeoutMs) const
+{
+#ifdef _WIN32
+	WSAPOLLFD descriptor = { static_cast<SOCKET>(m_handle), POLLIN, 0 };
+	return WSAPoll(&descriptor, 1, timeoutMs) > 0;
+#else
+	pollfd descriptor = { m_handle, POLLIN, 0 };
+	return poll(&descriptor, 1, timeoutMs) > 0;
+#endif
+}
+
+void Socket::setReceiveTimeout(int timeoutMs) const
+{
+#ifdef _WIN32
+	const DWORD timeout = static_cast<DWORD>(timeoutMs);
+	setsockopt(static_cast<SOCKET>(m_handle), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#else
+	timeval timeout = {};
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+	setsockopt(m_handle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+}
+
+void Socket::shutdown() const
+{
+	if (!isValid())
+		return;
+#ifdef _WIN32
+	::shutdown(static_cast<SOCKET>(m_handle), SD_BOTH);
+#else
+	::shutdown(m_handle, SHUT_RDWR);
+#endif
+}
+
+void Socket::close()
+{
+	if (!isValid())
+		return;
+	closeHandle(m_handle);
+	m_handle = invalidHandle();
+}
+
+SocketHandle Socket::invalidHandle()
+{
+#ifdef _WIN32
+	return static_cast<SocketHandle>(INVALID_SOCKET);
+#else
+	return -1;
+#endif
+}
+
+bool Headless::parseAddress(const std::string& address, std::string& outHost, uint16_t& outPort)
+{
+	const size_t separator = address.rfind(':');
+	if (separator == std::string::npos || separator + 1 == address.size())
+		return false;
+
+	const int port = std::atoi(address.c_str() + separator + 1);
+	if (port <= 0 || port > 0xFFFF)
+		return false;
+
+	outHost = separator > 0 ? address.substr(0, separator) : "127.0.0.1";
+	outPort = static_cast<uint16_t>(port);
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Headless
+{
+#ifdef _WIN32
+	using SocketHandle = uintptr_t;
+#else
+	using SocketHandle = int;
+#endif
+
+	// Blocking TCP socket, closed on destruction. All calls return false on errors and closed connections.
+	class Socket
+	{
+	public:
+		Socket() = default;
+		explicit Socket(SocketHandle handle);
+		~Socket();
+		Socket(Socket&& other) noexcept;
+		Socket& operator=(Socket&& other) noexcept;
+		Socket(const Socket&) = delete;
+		Socket& operator=(const Socket&) = delete;
+
+		// port 0 picks a free port, see getLocalPort. Loopback only sockets accept connections from this machine.
+		static Socket listen(uint16_t port, bool loopbackOnly = false);
+		static Socket connect(const std::string& host, uint16_t port);
+
+		bool isValid() const;
+		uint16_t getLocalPort() const;
+		std::string getPeerName() const;
+
+		// Waits up to timeoutMs for a connection, an invalid socket on timeout
+		Socket accept(int timeoutMs) const;
+		bool sendAll(const void* data, size_t size) const;
+		bool receiveAll(void* data, size_t size) const;
+		// Receives what is available, up to size bytes. 0 once the connection is closed or failed.
+		size_t receive(void* data, size_t size) const;
+		// True once data or the end of the connection can be received, false on timeout
+		bool waitReadable(int timeoutMs) const;
+		// 0 waits forever
+		void setReceiveTimeout(int timeoutMs) const;
+		// Unblocks a receive pending on another thread
+		void shutdown() const;
+		void close();
+
+	private:
+		SocketHandle m_handle = invalidHandle();
+
+		static SocketHandle invalidHandle();
+	};
+
+	// "host:port" -> host, port
+	bool parseAddress(const std::string& address, std::string& outHost, uint16_t& outPort);
+} // namespace Headless
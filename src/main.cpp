@@ -4,6 +4,11 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 #include <windows.h>
+#include <shellapi.h>
+#include <string>
+#include <vector>
+
+#include "headless/batchBaker.hpp"
 #include "renderer.hpp"
 #include "window.hpp"
 
@@ -30,6 +35,37 @@ static void SetHighDpiAwarenessAtRuntime()
 	}
 }
 
+// Command line arguments without the executable, UTF-8 encoded
+static std::vector<std::string> getCommandLineArgs()
+{
+	std::vector<std::string> args;
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (!argv)
+		return args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const int size = WideCharToMultiByte(CP_UTF8, 0, argv[i], -1, nullptr, 0, nullptr, nullptr);
+		std::string arg(size > 0 ? size - 1 : 0, '\0');
+		WideCharToMultiByte(CP_UTF8, 0, argv[i], -1, arg.data(), size, nullptr, nullptr);
+		args.push_back(std::move(arg));
+	}
+	LocalFree(argv);
+	return args;
+}
+
+// The executable is a GUI application, headless bakes report to the console they were started from
+static void attachConsole()
+{
+	if (!AttachConsole(ATTACH_PARENT_PROCESS) && !AllocConsole())
+		return;
+
+	FILE* pCout;
+	freopen_s(&pCout, "CONOUT$", "w", stdout);
+	freopen_s(&pCout, "CONOUT$", "w", stderr);
+}
+
 using namespace Microsoft::WRL;
 
 int WINAPI wWinMain(const HINSTANCE hInstance, HINSTANCE, PWSTR, int)
@@ -41,6 +77,13 @@ int WINAPI wWinMain(const HINSTANCE hInstance, HINSTANCE, PWSTR, int)
 // 	freopen_s(&pCout, "CONOUT$", "w", stderr);
 // #endif
 
+	const std::vector<std::string> args = getCommandLineArgs();
+	if (Headless::isBatchCommandLine(args))
+	{
+		attachConsole();
+		return Headless::runCommandLine(args);
+	}
+
 	// Ensure high-DPI awareness without a manifest, before any window is created
 	SetHighDpiAwarenessAtRuntime();
 
@@ -8,3 +8,14 @@ ID3D11ShaderResourceView* const* Material::getSRVs()
 	m_srvCache[2] = normal ? normal->srv.Get() : nullptr;
 	return m_srvCache;
 }
+
+void Material::markTexturesUsed(uint32_t sampledSize) const
+{
+	for (const std::shared_ptr<Texture>& texture : { albedo, metallicRoughness, normal })
+	{
+		if (texture)
+		{
+			texture->markUsed(sampledSize);
+		}
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -30,6 +31,8 @@ struct Material
 	bool needsPreviewUpdate = true;
 
 	ID3D11ShaderResourceView* const* getSRVs();
+	// Records that a draw samples the textures this frame, at up to sampledSize texels (0 = full resolution)
+	void markTexturesUsed(uint32_t sampledSize = 0) const;
 	
 	struct Preview
 	{
@@ -103,6 +103,7 @@ void GBuffer::draw(const glm::mat4& view,
 		update(view, projection, cameraPosition, scene, objectID, prim);
 		m_context->IASetVertexBuffers(0, 1, prim->getVertexBuffer().GetAddressOf(), &stride, &offset);
 		m_context->IASetIndexBuffer(prim->getIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+		prim->material->markTexturesUsed();
 		ID3D11ShaderResourceView* const* SRVs = prim->material->getSRVs();
 		m_context->PSSetShaderResources(0, 3, SRVs);
 		m_context->DrawIndexed(static_cast<UINT>(prim->getIndexData().size()), 0, 0);
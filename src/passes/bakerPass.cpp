@@ -1,8 +1,12 @@
 #include "bakerPass.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <mutex>
 
 #include "glm/glm.hpp"
+#include "glm/gtc/packing.hpp"
 #include "DirectXTex.h"
 
 #include "appConfig.hpp"
@@ -15,6 +19,18 @@
 #include "texture.hpp"
 #include "textureHistory.hpp"
 
+#include "baking/bakeCache.hpp"
+#include "baking/dilation.hpp"
+#include "baking/highPoly.hpp"
+#include "baking/pngWriter.hpp"
+#include "baking/udim.hpp"
+#include "baking/uvIslands.hpp"
+#include "baking/uvRasterizer.hpp"
+#include "utility/hash.hpp"
+#include "utility/jobSystem.hpp"
+#include "utility/outputWriter.hpp"
+#include "utility/parallelFor.hpp"
+
 
 #define PROFILE_BAKER_PASS 1
 
@@ -26,9 +42,19 @@ struct alignas(16) BakerCB
 	float cageOffset;
 	uint32_t useSmoothedNormals;
 	uint32_t numBLASInstances;
-	float padding[3];
+	glm::vec2 uvTileOffset;
+	float padding;
+};
+
+// Must match TexelTile in baker.hlsl
+struct TexelTile
+{
+	uint32_t texelOffset;
+	uint32_t texelCount;
 };
 
+static constexpr uint32_t k_texelTileSize = 16; // TEXEL_TILE_SIZE in baker.hlsl
+
 struct alignas(16) RaycastVisCB
 {
 	glm::mat4 viewProjection;
@@ -54,6 +80,177 @@ static constexpr D3D11_INPUT_ELEMENT_DESC uvRasterInputLayoutDesc[] = {
 	{"NORMAL", 1, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}, // smooth normal for baking
 };
 
+// Rough peak memory of a tile's trace stage per texel: fp32 position, three fp16 attributes,
+// the baked normal, its staging copy and the texel list
+static constexpr size_t k_traceBytesPerTexel = 16 + 3 * 8 + 8 + 8 + 4;
+
+struct HighPolySource
+{
+	std::shared_ptr<const SharedPrimitiveData> data;
+	BVH::BBox worldBBox;
+	glm::mat4 worldMatrix;
+};
+
+// Main thread only: the in-memory preview of a bake and whether its file was written yet
+struct PreviewHandoff
+{
+	std::shared_ptr<Texture> texture;
+	bool written = false;
+};
+
+struct SharedHighPoly
+{
+	std::vector<HighPolySource> sources;
+	Baking::CombinedHighPolyData data; // released once uploaded
+	CombinedHighPolyBuffers buffers;
+	Jobs::JobID uploadJob = Jobs::k_invalidJob;
+};
+
+// Everything a bake needs, captured on the main thread when it is scheduled
+struct BakerPass::BakeState
+{
+	explicit BakeState(std::shared_ptr<BakerPass> bakerPass)
+		: pass(std::move(bakerPass))
+		, cache(AppConfig::bakeCacheDirectory)
+	{
+		pass->m_bakesInFlight++;
+	}
+	~BakeState()
+	{
+		pass->m_bakesInFlight--;
+	}
+
+	std::shared_ptr<BakerPass> pass;
+	BakeSettings settings;
+	std::string directory;
+	std::string filename;
+	uint64_t group = 0;
+
+	std::vector<Primitive*> lowPolys;
+	std::vector<std::string> lowPolyNames;
+	std::vector<std::shared_ptr<const SharedPrimitiveData>> keepAlive; // lowPolyMeshes point into these
+	std::vector<Baking::UVRasterMesh> lowPolyMeshes;
+	std::shared_ptr<SharedHighPoly> highPoly;
+
+	// Filled by the prepare stage
+	std::vector<std::vector<uint32_t>> masterIndices; // stacked duplicate UV islands removed
+	std::vector<Baking::UDIMTile> tiles;
+	bool isMultiTile = false;
+	std::vector<uint64_t> tileKeys; // parallel to tiles, 0 when the cache is disabled
+
+	Baking::BakeCache cache;
+	uint64_t baseKey = 0; // inputs shared by all tiles
+	uint64_t bakeKey = 0; // every input of the bake, names its manifest
+
+	std::mutex finishedMutex;
+	std::vector<Baking::CachedTile> finishedTiles;
+	size_t totalTiles = 0;
+	size_t tilesRemaining = 0;
+
+	// Traced texels summed over the tiles for the bake log, main thread only
+	uint64_t coveredTexels = 0;
+	uint64_t totalTexels = 0;
+
+	std::string getOutputPath(uint32_t tileNumber) const
+	{
+		return directory + "\\" + (isMultiTile ? Baking::getUDIMFilename(filename, tileNumber) : filename);
+	}
+
+	// Called once per tile, restored or saved. The manifest is only written when every tile made it into the cache.
+	void finishTile(const Baking::CachedTile& tile, bool stored)
+	{
+		std::lock_guard lock(finishedMutex);
+		if (stored)
+		{
+			finishedTiles.push_back(tile);
+		}
+		if (--tilesRemaining == 0 && finishedTiles.size() == totalTiles)
+		{
+			std::ranges::sort(finishedTiles, {}, &Baking::CachedTile::number);
+			cache.storeBake(bakeKey, finishedTiles);
+		}
+	}
+};
+
+static bool saveBakedNormal(const std::string& fullPath, const DirectX::Image& image)
+{
+	std::cout << "Saving baked normal texture to: " << fullPath << std::endl;
+	HRESULT hr = E_FAIL;
+	if (fullPath.ends_with(".png"))
+	{
+		// Written by the in-tree encoder: 16-bit like the bake, filtered and deflated on every core
+		Baking::PNGImage png;
+		png.pixels = image.pixels;
+		png.width = static_cast<uint32_t>(image.width);
+		png.height = static_cast<uint32_t>(image.height);
+		png.rowPitch = image.rowPitch;
+		png.channels = 4;
+		png.bitDepth = 16;
+		hr = Baking::writePNG(fullPath, png) ? S_OK : E_FAIL;
+	}
+	else if (fullPath.ends_with(".tga"))
+	{
+		hr = DirectX::SaveToTGAFile(
+			image,
+			DirectX::TGA_FLAGS_NONE,
+			std::wstring(fullPath.begin(), fullPath.end()).c_str());
+	}
+	else
+	{
+		std::cerr << "Unsupported file format for saving texture: " << fullPath << std::endl;
+		return false;
+	}
+
+	if (FAILED(hr))
+	{
+		std::cerr << "Failed to save texture to: " << fullPath << std::endl;
+		return false;
+	}
+	std::cout << "Finished saving texture to: " << fullPath << std::endl;
+	return true;
+}
+
+// Pads untraced texels (alpha = 0) of a captured R16G16B16A16_UNORM baked normal from the nearest
+// traced texel and makes the whole map opaque. Texels beyond the padding distance keep the flat normal.
+static void padBakedNormal(const DirectX::Image& image, uint32_t dilationDistance)
+{
+	if (image.format != DXGI_FORMAT_R16G16B16A16_UNORM)
+	{
+		std::cerr << "padBakedNormal: unexpected format " << image.format << std::endl;
+		return;
+	}
+
+	const auto startTime = std::chrono::steady_clock::now();
+	const uint32_t width = static_cast<uint32_t>(image.width);
+	const uint32_t height = static_cast<uint32_t>(image.height);
+
+	std::vector<uint8_t> coverage(static_cast<size_t>(width) * height);
+	Parallel::parallelFor(height, [&](size_t y)
+		{
+			const uint16_t* row = reinterpret_cast<const uint16_t*>(image.pixels + y * image.rowPitch);
+			uint8_t* coverageRow = coverage.data() + y * width;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				coverageRow[x] = row[x * 4 + 3] != 0;
+			}
+		});
+
+	const size_t filled = Baking::dilate(image.pixels, width, height, image.rowPitch, 4 * sizeof(uint16_t), coverage.data(), dilationDistance);
+
+	Parallel::parallelFor(height, [&](size_t y)
+		{
+			uint16_t* row = reinterpret_cast<uint16_t*>(image.pixels + y * image.rowPitch);
+			for (uint32_t x = 0; x < width; x++)
+			{
+				row[x * 4 + 3] = 0xFFFF;
+			}
+		});
+
+	std::cout << "Edge padding took "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+		<< " ms (" << filled << " texels filled)" << std::endl;
+}
+
 
 BakerPass::BakerPass(
 	ComPtr<ID3D11Device> device,
@@ -70,6 +267,7 @@ BakerPass::BakerPass(
 
 	m_shaderManager = std::make_unique<ShaderManager>(device);
 	m_shaderManager->LoadComputeShader("bakerBakeNormal", ShaderManager::GetShaderPath(L"baker.hlsl"), "CSBakeNormal");
+	m_shaderManager->LoadComputeShader("bakerBuildTexelList", ShaderManager::GetShaderPath(L"baker.hlsl"), "CSBuildTexelList");
 	m_shaderManager->LoadVertexShader("raycastDebug", ShaderManager::GetShaderPath(L"raycastDebug.hlsl"), "VS");
 	m_shaderManager->LoadPixelShader("raycastDebug", ShaderManager::GetShaderPath(L"raycastDebug.hlsl"), "PS");
 	m_shaderManager->LoadVertexShader("uvRasterize", ShaderManager::GetShaderPath(L"uvRasterize.hlsl"), "VS");
@@ -101,51 +299,433 @@ BakerPass::BakerPass(
 
 }
 
-void BakerPass::bake(uint32_t width, uint32_t height, float cageOffset, uint32_t useSmoothedNormals)
+std::shared_ptr<SharedHighPoly> BakerPass::scheduleHighPolyBuild(std::shared_ptr<BakerPass> uploader,
+	const std::vector<Primitive*>& highPolys,
+	Jobs::JobSystem& jobs,
+	uint64_t group)
+{
+	auto highPoly = std::make_shared<SharedHighPoly>();
+	size_t totalBytes = 0;
+	for (Primitive* hp : highPolys)
+	{
+		if (!hp)
+			continue;
+		HighPolySource source;
+		source.data = hp->getSharedData();
+		source.worldBBox = hp->getWorldBBox();
+		source.worldMatrix = hp->getWorldMatrix();
+		highPoly->sources.push_back(std::move(source));
+		totalBytes += hp->getTriangles().size() * sizeof(Triangle)
+			+ hp->getTriangleIndices().size() * sizeof(uint32_t)
+			+ hp->getBVHNodes().size() * sizeof(BVH::Node);
+	}
+
+	Jobs::JobDesc combineJob;
+	combineJob.name = "Combine high-poly";
+	combineJob.group = group;
+	combineJob.memoryBytes = totalBytes;
+	combineJob.work = [highPoly]()
+		{
+			std::vector<Baking::HighPolyMesh> meshes;
+			for (const HighPolySource& source : highPoly->sources)
+			{
+				Baking::HighPolyMesh mesh;
+				mesh.triangles = &source.data->triangles;
+				mesh.triangleIndices = &source.data->triangleIndices;
+				mesh.bvhNodes = &source.data->bvhNodes;
+				mesh.worldBBox = source.worldBBox;
+				mesh.worldMatrix = source.worldMatrix;
+				meshes.push_back(mesh);
+			}
+			highPoly->data = Baking::combineHighPolys(meshes);
+		};
+	const Jobs::JobID combineID = jobs.submit(std::move(combineJob));
+
+	Jobs::JobDesc uploadJob;
+	uploadJob.name = "Upload high-poly";
+	uploadJob.thread = Jobs::JobThread::Main;
+	uploadJob.group = group;
+	uploadJob.memoryBytes = totalBytes;
+	uploadJob.work = [highPoly, uploader]()
+		{
+			highPoly->buffers = uploader->uploadCombinedHighPoly(highPoly->data);
+			// GPU copy is all the trace needs
+			highPoly->data = Baking::CombinedHighPolyData();
+			highPoly->sources.clear();
+		};
+	highPoly->uploadJob = jobs.submit(std::move(uploadJob), { combineID });
+	return highPoly;
+}
+
+bool BakerPass::scheduleBake(const BakeSettings& settings,
+	std::shared_ptr<SharedHighPoly> highPoly,
+	Jobs::JobSystem& jobs,
+	uint64_t group)
 {
 	if (directory.empty() || filename.empty())
 	{
 		std::cerr << "BakerPass::bake: No output path specified!" << std::endl;
-		return;
+		return false;
 	}
-	if (m_primitivesToBake.first.empty() || m_primitivesToBake.second.empty())
+	if (m_primitivesToBake.first.empty() || m_primitivesToBake.second.empty() || !highPoly)
 	{
 		std::cerr << "BakerPass::bake: No primitives to bake!" << std::endl;
-		return;
+		return false;
 	}
 	std::cout << "Started baking: " << name << std::endl;
-	m_lastWidth = width;
-	m_lastHeight = height;
-	m_cageOffset = cageOffset;
-	m_useSmoothedNormals = useSmoothedNormals;
-	createInterpolatedTexturesResources();
-	createBakedNormalResources();
-	m_combinedHighPolyBuffers = createCombinedHighPolyBuffers();
-
-	float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-	m_context->ClearRenderTargetView(m_wsTexelPositionRTV.Get(), clearColor);
-	m_context->ClearRenderTargetView(m_wsTexelNormalRTV.Get(), clearColor);
-	m_context->ClearRenderTargetView(m_wsTexelTangentRTV.Get(), clearColor);
-	m_context->ClearRenderTargetView(m_wsTexelSmoothedNormalRTV.Get(), clearColor);
-	for (size_t i = 0; i < m_primitivesToBake.first.size(); ++i)
+
+	// Everything the jobs need is captured here on the main thread, the scene may change while they run
+	auto state = std::make_shared<BakeState>(shared_from_this());
+	state->settings = settings;
+	state->directory = directory;
+	state->filename = filename;
+	state->group = group;
+	state->lowPolys = m_primitivesToBake.first;
+	state->lowPolyMeshes = getLowPolyRasterMeshes();
+	state->highPoly = std::move(highPoly);
+	const BakeKeys keys = computeBakeKeys(settings);
+	state->baseKey = keys.base;
+	state->bakeKey = keys.bake;
+	for (Primitive* lowPoly : m_primitivesToBake.first)
+	{
+		state->lowPolyNames.push_back(lowPoly ? lowPoly->name : std::string());
+		if (lowPoly)
+			state->keepAlive.push_back(lowPoly->getSharedData());
+	}
+
+	Jobs::JobDesc prepareJob;
+	prepareJob.name = "Prepare texels: " + name;
+	prepareJob.group = group;
+	prepareJob.work = [state, &jobs]()
+		{
+			state->pass->prepareTexels(*state);
+			state->pass->scheduleTiles(state, jobs);
+		};
+	jobs.submit(std::move(prepareJob));
+	return true;
+}
+
+bool BakerPass::isBaking() const
+{
+	return m_bakesInFlight.load() > 0;
+}
+
+bool BakerPass::restoreFromCache(const BakeSettings& settings)
+{
+	if (directory.empty() || filename.empty() || m_primitivesToBake.first.empty() || isBaking())
+		return false;
+
+	const Baking::BakeCache cache(AppConfig::bakeCacheDirectory);
+	if (!cache.isEnabled())
+		return false;
+
+	const auto startTime = std::chrono::steady_clock::now();
+	const BakeKeys keys = computeBakeKeys(settings);
+	const std::vector<Baking::CachedTile> tiles = cache.findBake(keys.bake, std::filesystem::path(filename).extension().string());
+	if (tiles.empty())
+		return false;
+
+	// Manifest tiles are sorted by number, same rule as Baking::isMultiTile
+	const bool isMultiTile = tiles.size() > 1 || tiles[0].number != Baking::k_firstUDIM;
+	for (const Baking::CachedTile& tile : tiles)
+	{
+		const std::string tileFilename = isMultiTile ? Baking::getUDIMFilename(filename, tile.number) : filename;
+		if (!cache.restoreTile(tile.key, directory + "\\" + tileFilename))
+			return false;
+	}
+	m_previewTile = isMultiTile ? tiles[0].number : 0;
+	m_bakedPreview.reset(); // the restored files replace the last bake
+
+	std::cout << "Restored " << name << " from the bake cache (" << tiles.size() << " tiles) in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << " ms" << std::endl;
+	return true;
+}
+
+// Everything that affects the baked texels goes into the keys, output paths don't
+BakerPass::BakeKeys BakerPass::computeBakeKeys(const BakeSettings& settings)
+{
+	const std::string extension = std::filesystem::path(filename).extension().string();
+	uint64_t key = Hash::combine(Baking::k_bakerVersion, settings.width);
+	key = Hash::combine(key, settings.height);
+	key = Hash::combineBytes(key, settings.cageOffset);
+	key = Hash::combine(key, settings.useSmoothedNormals);
+	key = Hash::combine(key, settings.useCPURasterizer);
+	key = Hash::combine(key, settings.dilationDistance);
+	key = Hash::combine(key, Hash::bytes(extension.data(), extension.size()));
+	key = Hash::combine(key, getBlendMaskHash(settings.width, settings.height));
+	for (Primitive* highPoly : m_primitivesToBake.second)
+	{
+		if (!highPoly)
+			continue;
+		key = Hash::combine(key, highPoly->getContentHash());
+		key = Hash::combineBytes(key, highPoly->getWorldMatrix());
+	}
+
+	BakeKeys keys;
+	keys.base = key;
+	for (size_t i = 0; i < m_primitivesToBake.first.size(); i++)
 	{
 		Primitive* lowPoly = m_primitivesToBake.first[i];
 		if (!lowPoly)
 			continue;
-		rasterizeUVSpace(lowPoly);
+		key = Hash::combine(key, i);
+		key = Hash::combine(key, lowPoly->getContentHash());
+		key = Hash::combineBytes(key, lowPoly->getWorldMatrix());
 	}
-	updateBakerCB(m_combinedHighPolyBuffers);
+	keys.bake = key;
+	return keys;
+}
+
+uint64_t BakerPass::getBlendMaskHash(uint32_t width, uint32_t height)
+{
+	if (!m_rayDirectionBlendTexture)
+		return Baking::hashUniformBlendMask(0.0f); // created cleared by the bake
+
+	D3D11_TEXTURE2D_DESC desc;
+	m_rayDirectionBlendTexture->GetDesc(&desc);
+	if (desc.Width != width || desc.Height != height)
+		return Baking::hashUniformBlendMask(0.0f); // recreated cleared by the bake
+
+	if (!m_blendMaskHash)
+	{
+		DirectX::ScratchImage mask;
+		if (FAILED(DirectX::CaptureTexture(m_device.Get(), m_context.Get(), m_rayDirectionBlendTexture.Get(), mask)))
+		{
+			std::cerr << "Failed to read back the blend mask, the bake cache is bypassed" << std::endl;
+			return Hash::mix(std::chrono::steady_clock::now().time_since_epoch().count()); // never matches a stored key
+		}
+		const DirectX::Image& image = *mask.GetImage(0, 0, 0);
+		m_blendMaskHash = Baking::hashBlendMask(reinterpret_cast<const float*>(image.pixels),
+			static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), image.rowPitch);
+	}
+	return *m_blendMaskHash;
+}
+
+// Worker thread: stacked island detection and UDIM binning, no D3D calls
+void BakerPass::prepareTexels(BakeState& state)
+{
+	state.masterIndices = findStackedUVIslands(state.lowPolyMeshes, state.lowPolyNames);
+
+	size_t droppedTriangles = 0;
+	state.tiles = Baking::binTrianglesByUDIM(state.lowPolyMeshes, state.masterIndices, droppedTriangles);
+	if (droppedTriangles > 0)
+	{
+		std::cerr << "Warning: " << droppedTriangles << " low-poly triangles are outside of the UDIM range and won't be baked" << std::endl;
+	}
+
+	if (state.tiles.empty())
+	{
+		std::cerr << "BakerPass::bake: No low-poly triangles inside the UV range!" << std::endl;
+		return;
+	}
+
+	state.isMultiTile = Baking::isMultiTile(state.tiles);
+	m_previewTile = state.isMultiTile ? state.tiles[0].number : 0; // tiles are still sorted by number here
+	Baking::scheduleByCost(state.tiles, m_tileCosts);
+	state.totalTiles = state.tiles.size();
+	state.tilesRemaining = state.tiles.size();
+	state.tileKeys.assign(state.tiles.size(), 0);
+	if (state.isMultiTile)
+	{
+		std::cout << "Baking " << state.tiles.size() << " UDIM tiles" << std::endl;
+	}
+	if (!state.cache.isEnabled())
+		return;
+
+	// Tiles whose inputs didn't change since they were last baked are copied from the cache instead
+	Parallel::parallelFor(state.tiles.size(), [&](size_t i)
+		{
+			state.tileKeys[i] = Hash::combine(state.baseKey, Baking::hashTileGeometry(state.lowPolyMeshes, state.tiles[i]));
+		});
+	size_t tilesToBake = 0;
+	for (size_t i = 0; i < state.tiles.size(); i++)
+	{
+		const Baking::CachedTile tile = { state.tiles[i].number, state.tileKeys[i] };
+		if (state.cache.restoreTile(tile.key, state.getOutputPath(tile.number)))
+		{
+			state.finishTile(tile, true);
+			continue;
+		}
+		state.tiles[tilesToBake] = std::move(state.tiles[i]);
+		state.tileKeys[tilesToBake] = state.tileKeys[i];
+		tilesToBake++;
+	}
+	if (tilesToBake < state.tiles.size())
+	{
+		std::cout << "Bake cache: restored " << state.tiles.size() - tilesToBake << " of " << state.tiles.size() << " tiles" << std::endl;
+	}
+	state.tiles.resize(tilesToBake);
+	state.tileKeys.resize(tilesToBake);
+}
+
+// Tiles share the high-poly acceleration structure and the texel resources, so their GPU work is chained on
+// the main thread, most expensive first. Padding and encoding of finished tiles run on the workers meanwhile.
+void BakerPass::scheduleTiles(std::shared_ptr<BakeState> state, Jobs::JobSystem& jobs)
+{
+	if (state->tiles.empty())
+		return; // nothing to bake or everything restored from the cache
+
+	const size_t numTexels = static_cast<size_t>(state->settings.width) * state->settings.height;
+	Jobs::JobID previousTile = state->highPoly->uploadJob;
+	for (size_t i = 0; i < state->tiles.size(); i++)
+	{
+		Jobs::JobDesc traceJob;
+		traceJob.name = "Trace tile " + std::to_string(state->tiles[i].number) + ": " + name;
+		traceJob.thread = Jobs::JobThread::Main;
+		traceJob.group = state->group;
+		traceJob.priority = 1; // keep the GPU fed before starting more encodes
+		traceJob.memoryBytes = numTexels * k_traceBytesPerTexel;
+		traceJob.work = [state, i, &jobs]()
+			{
+				state->pass->traceTile(state, i, jobs);
+			};
+		previousTile = jobs.submit(std::move(traceJob), { previousTile });
+	}
+}
+
+// Main thread: rasterize and trace one tile, then hand the captured result to the workers
+void BakerPass::traceTile(std::shared_ptr<BakeState> state, size_t tileIndex, Jobs::JobSystem& jobs)
+{
+	const Baking::UDIMTile& tile = state->tiles[tileIndex];
+	const auto tileStartTime = std::chrono::steady_clock::now();
+
+	if (tileIndex == 0)
+	{
+		m_lastWidth = state->settings.width;
+		m_lastHeight = state->settings.height;
+		m_cageOffset = state->settings.cageOffset;
+		m_useSmoothedNormals = state->settings.useSmoothedNormals;
+		m_combinedHighPolyBuffers = state->highPoly->buffers;
+		createInterpolatedTexturesResources();
+		createBakedNormalResources();
+		createTexelListResources();
+	}
+
+	if (state->settings.useCPURasterizer)
+	{
+		rasterizeUVSpaceCPU(state->lowPolyMeshes, tile);
+	}
+	else
+	{
+		float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		float clearCoverage[4] = { 0.0f, 0.0f, 0.0f, 0.0f }; // alpha = 0 marks texels not covered by any UV triangle
+		m_context->ClearRenderTargetView(m_wsTexelPositionRTV.Get(), clearCoverage);
+		m_context->ClearRenderTargetView(m_wsTexelNormalRTV.Get(), clearColor);
+		m_context->ClearRenderTargetView(m_wsTexelTangentRTV.Get(), clearColor);
+		m_context->ClearRenderTargetView(m_wsTexelSmoothedNormalRTV.Get(), clearColor);
+		for (size_t i = 0; i < state->lowPolys.size(); ++i)
+		{
+			Primitive* lowPoly = state->lowPolys[i];
+			if (!lowPoly)
+				continue;
+			rasterizeUVSpace(lowPoly, tile.indices[i], tile.uvOffset);
+		}
+	}
+	updateBakerCB(m_combinedHighPolyBuffers); // UV rasterization overwrites the shared constant buffer
+	buildTexelList();
 	bakeNormals(m_combinedHighPolyBuffers);
-	asyncSaveTextureToFile(directory + "\\" + filename,
-		m_device,
-		m_context,
-		m_bakedNormalTexture);
+
+	auto image = captureBakedNormal();
+	readTexelCoverage(*state, tileIndex);
+	m_tileCosts[tile.number] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tileStartTime).count();
+	if (state->isMultiTile)
+	{
+		std::cout << "Tile " << tile.number << " (" << tile.triangleCount << " triangles) took " << m_tileCosts[tile.number] << " ms" << std::endl;
+	}
+	if (!image)
+		return;
+
+	const std::string fullPath = state->getOutputPath(tile.number);
+	const std::string tileFilename = std::filesystem::path(fullPath).filename().string();
+	const size_t imageBytes = image->GetPixelsSize();
+
+	// The tile shown in the viewport goes straight from the baked buffer to the material, the file is only written for export
+	std::shared_ptr<PreviewHandoff> preview = fullPath == getBakedNormalPath() ? std::make_shared<PreviewHandoff>() : nullptr;
+
+	Jobs::OutputWriter& writer = m_scene->getOutputWriter();
+	Jobs::JobDesc padJob;
+	padJob.name = "Pad " + tileFilename;
+	padJob.group = state->group;
+	padJob.memoryBytes = imageBytes + imageBytes / 2; // coverage mask and nearest texel rows
+	if (preview)
+	{
+		padJob.memoryBytes += imageBytes / 3; // mip chain of the preview texture
+	}
+	padJob.work = [image, fullPath, tileFilename, imageBytes, state, tile = Baking::CachedTile{ tile.number, state->tileKeys[tileIndex] },
+		preview, &writer, &jobs]()
+		{
+			padBakedNormal(*image->GetImage(0, 0, 0), state->settings.dilationDistance);
+
+			// Encoding runs on the writer threads. While they are behind this blocks the worker,
+			// which holds back padding of further tiles instead of piling up images.
+			Jobs::OutputTask saveTask;
+			saveTask.name = tileFilename;
+			saveTask.memoryBytes = imageBytes;
+			saveTask.write = [image, fullPath]()
+				{
+					return saveBakedNormal(fullPath, *image->GetImage(0, 0, 0));
+				};
+			saveTask.onComplete = [fullPath, tileFilename, state, tile, preview, &jobs](bool saved)
+				{
+					if (saved)
+					{
+						state->cache.storeTile(tile.key, fullPath);
+					}
+					state->finishTile(tile, saved);
+					if (!saved || !preview)
+						return;
+
+					// From now on external edits of the file reload the preview again
+					Jobs::JobDesc writtenJob;
+					writtenJob.name = "Written " + tileFilename;
+					writtenJob.thread = Jobs::JobThread::Main;
+					writtenJob.group = state->group;
+					writtenJob.work = [preview]()
+						{
+							preview->written = true;
+							if (preview->texture)
+							{
+								preview->texture->markWritten();
+							}
+						};
+					jobs.submit(std::move(writtenJob));
+				};
+			writer.submit(std::move(saveTask));
+
+			// Built while the file is encoded, both only read the padded image
+			if (preview)
+			{
+				auto texture = std::make_shared<Texture>(*image->GetImage(0, 0, 0), fullPath, state->pass->m_device, true);
+				Jobs::JobDesc handoffJob;
+				handoffJob.name = "Preview " + tileFilename;
+				handoffJob.thread = Jobs::JobThread::Main;
+				handoffJob.group = state->group;
+				handoffJob.work = [pass = state->pass, preview, texture]()
+					{
+						preview->texture = texture;
+						if (preview->written)
+						{
+							texture->markWritten();
+						}
+						pass->handOffPreview(texture);
+					};
+				jobs.submit(std::move(handoffJob));
+			}
+		};
+	jobs.submit(std::move(padJob));
+}
+
+std::string BakerPass::getBakedNormalPath() const
+{
+	return directory + "\\" + (m_previewTile != 0 ? Baking::getUDIMFilename(filename, m_previewTile) : filename);
 }
 
 void BakerPass::previewBakedNormal()
 {
-	std::string fullPath = directory + "\\" + filename;
-	std::shared_ptr<Texture> newNormal = std::make_shared<Texture>(fullPath, m_device, m_context);
+	std::string fullPath = getBakedNormalPath();
+	// The last bake is still in memory, only bakes from the cache or an earlier session are loaded from disk
+	std::shared_ptr<Texture> newNormal = m_bakedPreview && m_bakedPreview->filepath == fullPath ? m_bakedPreview
+		: std::make_shared<Texture>(fullPath, m_device, m_context, true);
 	auto material = m_primitivesToBake.first[0]->material;
 	if (!material)
 	{
@@ -157,6 +737,21 @@ void BakerPass::previewBakedNormal()
 	material->needsPreviewUpdate = true;
 }
 
+void BakerPass::handOffPreview(std::shared_ptr<Texture> texture)
+{
+	m_bakedPreview = texture;
+	if (m_primitivesToBake.first.empty() || texture->filepath != getBakedNormalPath())
+		return;
+	// A preview that is already shown follows the bake, otherwise the Preview button picks it up
+	const auto& material = m_primitivesToBake.first[0]->material;
+	if (material && material->normal && material->normal->filepath == texture->filepath)
+	{
+		m_scene->addTexture(texture);
+		material->normal = std::move(texture);
+		material->needsPreviewUpdate = true;
+	}
+}
+
 void BakerPass::drawRaycastVisualization(const glm::mat4& view, const glm::mat4& projection)
 {
 	if (m_lastWidth == 0 || m_lastHeight == 0)
@@ -218,8 +813,7 @@ bool BakerPass::bakedNormalExists() const
 {
 	if (directory.empty() || filename.empty())
 		return false;
-	std::string fullPath = directory + "\\" + filename;
-	return std::filesystem::exists(fullPath);
+	return std::filesystem::exists(getBakedNormalPath());
 }
 
 ComPtr<ID3D11Texture2D> BakerPass::getBlendTexture() const
@@ -229,6 +823,7 @@ ComPtr<ID3D11Texture2D> BakerPass::getBlendTexture() const
 		std::cerr << "Blend texture not created yet!" << std::endl;
 		return nullptr;
 	}
+	m_blendMaskHash.reset(); // handed out for writing, e.g. undo of a paint stroke
 	return m_rayDirectionBlendTexture;
 }
 
@@ -262,6 +857,7 @@ void BakerPass::paintAtUV(float u, float v, float value, float brushSize)
 {
 	if (!m_rayDirectionBlendTexture)
 		return;
+	m_blendMaskHash.reset();
 
 	updateRayDirectionBlendCB(u, v, brushSize, value);
 	m_context->CSSetShader(m_shaderManager->getComputeShader("rayDirectionBlendPainter"), nullptr, 0);
@@ -278,6 +874,7 @@ void BakerPass::clearBlendTexture(float value)
 
 	float clearColor[4] = { value, value, value, 1.0f };
 	m_context->ClearUnorderedAccessViewFloat(m_rayDirectionBlendUAV.Get(), clearColor);
+	m_blendMaskHash = Baking::hashUniformBlendMask(value);
 }
 
 const std::pair<std::vector<Primitive*>, std::vector<Primitive*>>& BakerPass::getPrimitivesToBake() const
@@ -285,102 +882,37 @@ const std::pair<std::vector<Primitive*>, std::vector<Primitive*>>& BakerPass::ge
 	return m_primitivesToBake;
 }
 
-CombinedHighPolyBuffers BakerPass::createCombinedHighPolyBuffers()
+CombinedHighPolyBuffers BakerPass::uploadCombinedHighPoly(const Baking::CombinedHighPolyData& data)
 {
 	CombinedHighPolyBuffers combinedBuffers;
-
-	size_t totalTriangles = 0;
-	size_t totalTriIndices = 0;
-	size_t totalBVHNodes = 0;
-
-	for (Primitive* hp : m_primitivesToBake.second)
-	{
-		if (!hp) continue;
-		totalTriangles += hp->getTriangles().size();
-		totalTriIndices += hp->getTriangleIndices().size();
-		totalBVHNodes += hp->getBVHNodes().size();
-	}
-
-	std::cout << "Building combined high-poly buffers:" << std::endl;
-	std::cout << "  Total triangles: " << totalTriangles << std::endl;
-	std::cout << "  Total tri indices: " << totalTriIndices << std::endl;
-	std::cout << "  Total BVH nodes: " << totalBVHNodes << std::endl;
-	std::cout << "  Number of BLAS instances: " << m_primitivesToBake.second.size() << std::endl;
-
-	// Allocate combined CPU-side vectors
-	std::vector<Triangle> allTriangles;
-	std::vector<uint32_t> allTriIndices;
-	std::vector<BVH::Node> allBVHNodes;
-	std::vector<BLASInstance> blasInstances;
-
-	allTriangles.reserve(totalTriangles);
-	allTriIndices.reserve(totalTriIndices);
-	allBVHNodes.reserve(totalBVHNodes);
-	blasInstances.reserve(m_primitivesToBake.second.size());
-
-	uint32_t triangleOffset = 0;
-	uint32_t triIndicesOffset = 0;
-	uint32_t bvhNodeOffset = 0;
-
-	for (Primitive* hp : m_primitivesToBake.second)
-	{
-		if (!hp) continue;
-
-		// Use references - NO COPY! Triangles/BVH stay in local space
-		const auto& tris = hp->getTriangles();         // reference, not copy
-		const auto& indices = hp->getTriangleIndices();
-		const auto& nodes = hp->getBVHNodes();         // reference, not copy
-
-		// Create BLAS instance with transforms for GPU-side ray transformation
-		BLASInstance inst;
-		inst.worldBBox = hp->getWorldBBox();  // Only this needs world-space (cheap)
-		glm::mat4 worldMatrix = hp->getWorldMatrix();
-		inst.worldMatrixInv = glm::transpose(glm::inverse(worldMatrix));  // Row-major for HLSL
-		inst.normalMatrix = glm::transpose(inst.worldMatrixInv);
-		inst.triangleOffset = triangleOffset;
-		inst.triIndicesOffset = triIndicesOffset;
-		inst.bvhNodeOffset = bvhNodeOffset;
-		inst.numTriangles = static_cast<uint32_t>(tris.size());
-		blasInstances.push_back(inst);
-
-		// Append local-space data directly (no transform!)
-		allTriangles.insert(allTriangles.end(), tris.begin(), tris.end());
-		allTriIndices.insert(allTriIndices.end(), indices.begin(), indices.end());
-		allBVHNodes.insert(allBVHNodes.end(), nodes.begin(), nodes.end());
-
-		triangleOffset += static_cast<uint32_t>(tris.size());
-		triIndicesOffset += static_cast<uint32_t>(indices.size());
-		bvhNodeOffset += static_cast<uint32_t>(nodes.size());
-	}
-	combinedBuffers.numBLASInstances = static_cast<uint32_t>(blasInstances.size());
-
+	combinedBuffers.numBLASInstances = static_cast<uint32_t>(data.blasInstances.size());
 
 	// Create GPU buffers
-	if (!allTriangles.empty())
+	if (!data.triangles.empty())
 	{
 		combinedBuffers.triangleBuffer = createStructuredBuffer(sizeof(Triangle),
-			static_cast<UINT>(allTriangles.size()), SBPreset::Immutable, allTriangles.data());
+			static_cast<UINT>(data.triangles.size()), SBPreset::Immutable, data.triangles.data());
 		combinedBuffers.trianglesSRV = createShaderResourceView(combinedBuffers.triangleBuffer.Get(), SRVPreset::StructuredBuffer);
 	}
 
-	if (!allTriIndices.empty())
+	if (!data.triIndices.empty())
 	{
 		combinedBuffers.triIndicesBuffer = createStructuredBuffer(sizeof(uint32_t),
-			static_cast<UINT>(allTriIndices.size()), SBPreset::Immutable, allTriIndices.data());
+			static_cast<UINT>(data.triIndices.size()), SBPreset::Immutable, data.triIndices.data());
 		combinedBuffers.triIndicesSRV = createShaderResourceView(combinedBuffers.triIndicesBuffer.Get(), SRVPreset::StructuredBuffer);
 	}
 
-	if (!allBVHNodes.empty())
+	if (!data.bvhNodes.empty())
 	{
 		combinedBuffers.bvhNodesBuffer = createStructuredBuffer(sizeof(BVH::Node),
-			static_cast<UINT>(allBVHNodes.size()), SBPreset::Immutable, allBVHNodes.data());
+			static_cast<UINT>(data.bvhNodes.size()), SBPreset::Immutable, data.bvhNodes.data());
 		combinedBuffers.bvhNodesSRV = createShaderResourceView(combinedBuffers.bvhNodesBuffer.Get(), SRVPreset::StructuredBuffer);
 	}
 
-	if (!blasInstances.empty())
+	if (!data.blasInstances.empty())
 	{
-		combinedBuffers.blasInstancesBuffer = createStructuredBuffer(sizeof(BLASInstance),
-			static_cast<UINT>(blasInstances.size()), SBPreset::Immutable, blasInstances.data());
+		combinedBuffers.blasInstancesBuffer = createStructuredBuffer(sizeof(Baking::BLASInstance),
+			static_cast<UINT>(data.blasInstances.size()), SBPreset::Immutable, data.blasInstances.data());
 		combinedBuffers.blasInstancesSRV = createShaderResourceView(combinedBuffers.blasInstancesBuffer.Get(), SRVPreset::StructuredBuffer);
 	}
 
@@ -388,8 +920,10 @@ CombinedHighPolyBuffers BakerPass::createCombinedHighPolyBuffers()
 	return combinedBuffers;
 }
 
-void BakerPass::rasterizeUVSpace(Primitive* lowPoly)
+void BakerPass::rasterizeUVSpace(Primitive* lowPoly, const std::vector<uint32_t>& indices, const glm::vec2& uvTileOffset)
 {
+	if (indices.empty())
+		return; // nothing of this primitive in the tile, or only stacked duplicate islands
 
 #if PROFILE_BAKER_PASS
 	m_context->Begin(m_disjointQuery.Get());
@@ -407,6 +941,7 @@ void BakerPass::rasterizeUVSpace(Primitive* lowPoly)
 		data->worldMatrixInvTranspose = glm::inverse(lowPoly->getWorldMatrix());
 		data->cageOffset = m_cageOffset;
 		data->useSmoothedNormals = m_useSmoothedNormals;
+		data->uvTileOffset = uvTileOffset;
 		m_context->Unmap(m_constantBuffer.Get(), 0);
 	}
 
@@ -431,10 +966,15 @@ void BakerPass::rasterizeUVSpace(Primitive* lowPoly)
 	UINT offset = 0;
 	auto vb = lowPoly->getVertexBuffer();
 	auto ib = lowPoly->getIndexBuffer();
+	if (indices.size() != lowPoly->getIndexData().size())
+	{
+		// Only the tile's triangles, without stacked duplicate islands
+		ib = createIndexBuffer(static_cast<UINT>(indices.size() * sizeof(uint32_t)), indices.data());
+	}
 	m_context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
 	m_context->IASetIndexBuffer(ib.Get(), DXGI_FORMAT_R32_UINT, 0);
 
-	m_context->DrawIndexed(static_cast<UINT>(lowPoly->getIndexData().size()), 0, 0);
+	m_context->DrawIndexed(static_cast<UINT>(indices.size()), 0, 0);
 
 	unbindRenderTargets(4);
 
@@ -465,6 +1005,167 @@ void BakerPass::rasterizeUVSpace(Primitive* lowPoly)
 }
 
 
+void BakerPass::buildTexelList()
+{
+	beginDebugEvent(L"Baker::Build Texel List");
+
+	const uint32_t resetCounters[4] = { 0, 1, 1, 0 };
+	m_context->UpdateSubresource(m_texelCountersBuffer.Get(), 0, nullptr, resetCounters, 0, 0);
+
+	m_context->CSSetShader(m_shaderManager->getComputeShader("bakerBuildTexelList"), nullptr, 0);
+	m_context->CSSetConstantBuffers(0, 1, m_constantBuffer.GetAddressOf());
+	m_context->CSSetShaderResources(4, 1, m_wsTexelPositionSRV.GetAddressOf());
+
+	ID3D11UnorderedAccessView* texelListUAVs[3] = {
+		m_texelTilesUAV.Get(),
+		m_texelListUAV.Get(),
+		m_texelCountersUAV.Get()
+	};
+	m_context->CSSetUnorderedAccessViews(1, 3, texelListUAVs, nullptr);
+
+	const UINT tilesX = (m_lastWidth + k_texelTileSize - 1) / k_texelTileSize;
+	const UINT tilesY = (m_lastHeight + k_texelTileSize - 1) / k_texelTileSize;
+	m_context->Dispatch(tilesX, tilesY, 1);
+	unbindComputeUAVs(1, 3);
+	unbindShaderResources(4, 1);
+
+	endDebugEvent();
+
+	// Queued behind the list build, read by readTexelCoverage once the baked tile has been captured
+	m_context->CopyResource(m_texelCountersStaging.Get(), m_texelCountersBuffer.Get());
+}
+
+void BakerPass::readTexelCoverage(BakeState& state, size_t tileIndex)
+{
+	// Capturing the baked normal map already waited for the trace, so the counters copied before it are ready
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(m_context->Map(m_texelCountersStaging.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped)))
+		return;
+	const auto* counters = static_cast<const uint32_t*>(mapped.pData);
+	const uint32_t coveredTiles = counters[0];
+	const uint32_t coveredTexels = counters[3];
+	m_context->Unmap(m_texelCountersStaging.Get(), 0);
+
+	const uint64_t totalTexels = static_cast<uint64_t>(m_lastWidth) * m_lastHeight;
+	state.coveredTexels += coveredTexels;
+	state.totalTexels += totalTexels;
+	if (AppConfig::verboseBakeLog)
+	{
+		const UINT tilesX = (m_lastWidth + k_texelTileSize - 1) / k_texelTileSize;
+		const UINT tilesY = (m_lastHeight + k_texelTileSize - 1) / k_texelTileSize;
+		const double coverage = totalTexels > 0 ? 100.0 * coveredTexels / static_cast<double>(totalTexels) : 0.0;
+		std::cout << "Tile " << state.tiles[tileIndex].number << " texel coverage: " << coveredTexels << " / " << totalTexels
+			<< " texels (" << coverage << "%), " << coveredTiles << " / " << tilesX * tilesY << " texel tiles" << std::endl;
+	}
+
+	if (tileIndex + 1 == state.tiles.size())
+	{
+		const double coverage = state.totalTexels > 0 ? 100.0 * state.coveredTexels / static_cast<double>(state.totalTexels) : 0.0;
+		std::cout << "Texel coverage: " << state.coveredTexels << " / " << state.totalTexels << " texels (" << coverage << "%)" << std::endl;
+	}
+}
+
+std::vector<Baking::UVRasterMesh> BakerPass::getLowPolyRasterMeshes() const
+{
+	std::vector<Baking::UVRasterMesh> meshes(m_primitivesToBake.first.size());
+	for (size_t i = 0; i < m_primitivesToBake.first.size(); ++i)
+	{
+		Primitive* lowPoly = m_primitivesToBake.first[i];
+		if (!lowPoly)
+			continue;
+
+		Baking::UVRasterMesh& mesh = meshes[i];
+		mesh.vertices = lowPoly->getVertexData().data();
+		mesh.vertexCount = lowPoly->getVertexData().size();
+		mesh.indices = lowPoly->getIndexData().data();
+		mesh.indexCount = lowPoly->getIndexData().size();
+		mesh.worldMatrix = lowPoly->getWorldMatrix();
+		mesh.primitiveID = static_cast<uint32_t>(i);
+	}
+	return meshes;
+}
+
+std::vector<std::vector<uint32_t>> BakerPass::findStackedUVIslands(const std::vector<Baking::UVRasterMesh>& meshes,
+	const std::vector<std::string>& meshNames)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	const Baking::UVIslandReport report = Baking::analyzeUVIslands(meshes);
+
+	std::cout << "UV islands: " << report.islands.size() << ", " << report.duplicateIslands
+		<< " stacked duplicates reused (" << report.skippedTriangles << " triangles skipped), analysis took "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << " ms" << std::endl;
+
+	constexpr size_t maxReportedOverlaps = 8;
+	for (size_t i = 0; i < std::min(report.overlaps.size(), maxReportedOverlaps); i++)
+	{
+		const Baking::UVIsland& a = report.islands[report.overlaps[i].islandA];
+		const Baking::UVIsland& b = report.islands[report.overlaps[i].islandB];
+		std::cerr << "Warning: overlapping UV islands in " << meshNames[a.meshIndex]
+			<< " (" << a.uvMin.x << ", " << a.uvMin.y << ")-(" << a.uvMax.x << ", " << a.uvMax.y << ") and "
+			<< meshNames[b.meshIndex]
+			<< " (" << b.uvMin.x << ", " << b.uvMin.y << ")-(" << b.uvMax.x << ", " << b.uvMax.y << ")"
+			<< " race for the same texels" << std::endl;
+	}
+	if (report.overlaps.size() > maxReportedOverlaps)
+	{
+		std::cerr << "Warning: " << report.overlaps.size() - maxReportedOverlaps << " more overlapping UV island pairs" << std::endl;
+	}
+	return Baking::buildMasterIndices(meshes, report);
+}
+
+void BakerPass::rasterizeUVSpaceCPU(const std::vector<Baking::UVRasterMesh>& meshes, const Baking::UDIMTile& tile)
+{
+	beginDebugEvent(L"Baker::Rasterize UV Space (CPU)");
+	const auto startTime = std::chrono::steady_clock::now();
+
+	Baking::UVRasterizer rasterizer(m_lastWidth, m_lastHeight);
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		Baking::UVRasterMesh mesh = meshes[i];
+		mesh.indices = tile.indices[i].data();
+		mesh.indexCount = tile.indices[i].size();
+		mesh.uvOffset = tile.uvOffset;
+		rasterizer.addMesh(mesh);
+	}
+	const Baking::UVRasterResult result = rasterizer.rasterize();
+
+	const auto rasterTime = std::chrono::steady_clock::now();
+
+	// Expand the compact records into the texel textures consumed by the trace and debug passes.
+	// Uncovered texels stay zero, which leaves position alpha = 0 for the texel list pass.
+	const size_t numTexels = static_cast<size_t>(m_lastWidth) * m_lastHeight;
+	std::vector<glm::vec4> positions(numTexels, glm::vec4(0.0f));
+	std::vector<uint64_t> normals(numTexels, 0);
+	std::vector<uint64_t> tangents(numTexels, 0);
+	std::vector<uint64_t> smoothedNormals(numTexels, 0);
+
+	Parallel::parallelForChunks(result.texels.size(), 65536, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const Baking::TexelRecord& record = result.texels[i];
+				const size_t texelIndex = static_cast<size_t>(record.getY()) * m_lastWidth + record.getX();
+				positions[texelIndex] = glm::vec4(record.position, 1.0f);
+				normals[texelIndex] = glm::packHalf4x16(glm::vec4(record.normal, 1.0f));
+				tangents[texelIndex] = glm::packHalf4x16(glm::vec4(record.tangent, 1.0f));
+				smoothedNormals[texelIndex] = glm::packHalf4x16(glm::vec4(record.smoothedNormal, 1.0f));
+			}
+		});
+
+	m_context->UpdateSubresource(m_wsTexelPositionTexture.Get(), 0, nullptr, positions.data(), m_lastWidth * sizeof(glm::vec4), 0);
+	m_context->UpdateSubresource(m_wsTexelNormalTexture.Get(), 0, nullptr, normals.data(), m_lastWidth * sizeof(uint64_t), 0);
+	m_context->UpdateSubresource(m_wsTexelTangentTexture.Get(), 0, nullptr, tangents.data(), m_lastWidth * sizeof(uint64_t), 0);
+	m_context->UpdateSubresource(m_wsTexelSmoothedNormalTexture.Get(), 0, nullptr, smoothedNormals.data(), m_lastWidth * sizeof(uint64_t), 0);
+
+	endDebugEvent();
+
+	const auto endTime = std::chrono::steady_clock::now();
+	std::cout << "CPU UV rasterization took "
+		<< std::chrono::duration<double, std::milli>(rasterTime - startTime).count() << " ms ("
+		<< result.texels.size() << " texels in " << result.tiles.size() << " tiles), upload took "
+		<< std::chrono::duration<double, std::milli>(endTime - rasterTime).count() << " ms" << std::endl;
+}
+
 void BakerPass::bakeNormals(const CombinedHighPolyBuffers& combinedBuffers)
 {
 	beginDebugEvent(L"Baker::Bake Normals");
@@ -480,7 +1181,12 @@ void BakerPass::bakeNormals(const CombinedHighPolyBuffers& combinedBuffers)
 	ID3D11UnorderedAccessView* bakedNormalUAVs[1] = { m_bakedNormalUAV.Get() };
 	m_context->CSSetUnorderedAccessViews(0, 1, bakedNormalUAVs, nullptr);
 
-	ID3D11ShaderResourceView* hpSRVs[9] = {
+	// Texels outside of the UV layout are never traced, they keep the flat normal.
+	// Alpha = 0 marks them for edge padding when the map is saved
+	float flatNormal[4] = { 0.5f, 0.5f, 1.0f, 0.0f };
+	m_context->ClearUnorderedAccessViewFloat(m_bakedNormalUAV.Get(), flatNormal);
+
+	ID3D11ShaderResourceView* hpSRVs[11] = {
 		combinedBuffers.blasInstancesSRV.Get(),
 		combinedBuffers.trianglesSRV.Get(),
 		combinedBuffers.triIndicesSRV.Get(),
@@ -489,15 +1195,15 @@ void BakerPass::bakeNormals(const CombinedHighPolyBuffers& combinedBuffers)
 		m_wsTexelNormalSRV.Get(),
 		m_wsTexelTangentSRV.Get(),
 		m_wsTexelSmoothedNormalSRV.Get(),
-		m_rayDirectionBlendSRV.Get()
+		m_rayDirectionBlendSRV.Get(),
+		m_texelTilesSRV.Get(),
+		m_texelListSRV.Get()
 	};
 
-	m_context->CSSetShaderResources(0, 9, hpSRVs);
-	UINT threadGroupX = (m_lastWidth + 15) / 16;
-	UINT threadGroupY = (m_lastHeight + 15) / 16;
-	m_context->Dispatch(threadGroupX, threadGroupY, 1);
+	m_context->CSSetShaderResources(0, 11, hpSRVs);
+	m_context->DispatchIndirect(m_texelCountersBuffer.Get(), 0); // one group per non-empty tile
 	unbindComputeUAVs(0, 1);
-	unbindShaderResources(0, 9);
+	unbindShaderResources(0, 11);
 
 	endDebugEvent();
 
@@ -537,6 +1243,7 @@ void BakerPass::updateBakerCB(const CombinedHighPolyBuffers& combinedBuffers)
 		data->cageOffset = m_cageOffset;
 		data->useSmoothedNormals = m_useSmoothedNormals;
 		data->numBLASInstances = combinedBuffers.numBLASInstances;
+		data->uvTileOffset = glm::vec2(0.0f);
 		m_context->Unmap(m_constantBuffer.Get(), 0);
 	}
 }
@@ -560,78 +1267,16 @@ void BakerPass::updateRayDirectionBlendCB(float u, float v, float brushSize, flo
 	}
 }
 
-void BakerPass::saveToTextureFile()
+std::shared_ptr<DirectX::ScratchImage> BakerPass::captureBakedNormal()
 {
-	std::string fullPath = directory + "\\" + filename;
-	std::cout << "Saving baked normal texture to: " << fullPath << std::endl;
-	DirectX::ScratchImage image;
+	auto image = std::make_shared<DirectX::ScratchImage>();
 	if (FAILED(DirectX::CaptureTexture(m_device.Get(), m_context.Get(),
-		m_bakedNormalTexture.Get(), image)))
-	{
-		std::cerr << "Failed to capture texture for saving." << std::endl;
-		return;
-	}
-	if (filename.ends_with(".png"))
-	{
-		HRESULT hr = DirectX::SaveToWICFile(
-			*image.GetImage(0, 0, 0),
-			DirectX::WIC_FLAGS_NONE,
-			DirectX::GetWICCodec(DirectX::WIC_CODEC_PNG),
-			std::wstring(fullPath.begin(), fullPath.end()).c_str());
-	}
-	else if (filename.ends_with(".tga"))
-	{
-		HRESULT hr = DirectX::SaveToTGAFile(
-			*image.GetImage(0, 0, 0),
-			DirectX::TGA_FLAGS_NONE,
-			std::wstring(fullPath.begin(), fullPath.end()).c_str());
-	}
-	else
-	{
-		std::cerr << "Unsupported file format for saving texture: " << filename << std::endl;
-	}
-}
-
-void BakerPass::asyncSaveTextureToFile(const std::string& fullPath,
-	ComPtr<ID3D11Device> device,
-	ComPtr<ID3D11DeviceContext> context,
-	ComPtr<ID3D11Texture2D> texture)
-
-{
-	std::cout << "Saving baked normal texture to: " << fullPath << std::endl;
-	DirectX::ScratchImage capturedImage;
-	if (FAILED(DirectX::CaptureTexture(device.Get(), context.Get(),
-		texture.Get(), capturedImage)))
+		m_bakedNormalTexture.Get(), *image)))
 	{
 		std::cerr << "Failed to capture texture for saving." << std::endl;
-		return;
+		return nullptr;
 	}
-
-	m_saveTextureFuture = std::async(std::launch::async, [fullPath, image = std::move(capturedImage)]() mutable
-		{
-
-			if (fullPath.ends_with(".png"))
-			{
-				HRESULT hr = DirectX::SaveToWICFile(
-					*image.GetImage(0, 0, 0),
-					DirectX::WIC_FLAGS_NONE,
-					DirectX::GetWICCodec(DirectX::WIC_CODEC_PNG),
-					std::wstring(fullPath.begin(), fullPath.end()).c_str());
-				std::cout << "Finished saving texture to: " << fullPath << std::endl;
-			}
-			else if (fullPath.ends_with(".tga"))
-			{
-				HRESULT hr = DirectX::SaveToTGAFile(
-					*image.GetImage(0, 0, 0),
-					DirectX::TGA_FLAGS_NONE,
-					std::wstring(fullPath.begin(), fullPath.end()).c_str());
-				std::cout << "Finished saving texture to: " << fullPath << std::endl;
-			}
-			else
-			{
-				std::cerr << "Unsupported file format for saving texture: " << fullPath << std::endl;
-			}
-		});
+	return image;
 }
 
 void BakerPass::updateRaycastVisualization(const glm::mat4& view, const glm::mat4& projection)
@@ -698,7 +1343,8 @@ void BakerPass::createInterpolatedTexturesResources()
 	}
 
 	std::cout << "Creating interpolated textures of size: " << m_lastWidth << "x" << m_lastHeight << std::endl;
-	m_wsTexelPositionTexture = createTexture2D(m_lastWidth, m_lastHeight, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET);
+	// fp32 positions - half precision is not enough for world-space positions of large assets
+	m_wsTexelPositionTexture = createTexture2D(m_lastWidth, m_lastHeight, DXGI_FORMAT_R32G32B32A32_FLOAT, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET);
 	m_wsTexelPositionSRV = createShaderResourceView(m_wsTexelPositionTexture.Get(), SRVPreset::Texture2D);
 	m_wsTexelPositionUAV = createUnorderedAccessView(m_wsTexelPositionTexture.Get(), UAVPreset::Texture2D, 0);
 	m_wsTexelPositionRTV = createRenderTargetView(m_wsTexelPositionTexture.Get(), RTVPreset::Texture2D);
@@ -741,3 +1387,59 @@ void BakerPass::createBakedNormalResources()
 	m_rtvCollector->addRTV(name + "::BakedNormalTexture", m_bakedNormalSRV.Get());
 }
 
+void BakerPass::createTexelListResources()
+{
+	const UINT tilesX = (m_lastWidth + k_texelTileSize - 1) / k_texelTileSize;
+	const UINT tilesY = (m_lastHeight + k_texelTileSize - 1) / k_texelTileSize;
+	const UINT numTiles = tilesX * tilesY;
+	const UINT numTexels = m_lastWidth * m_lastHeight;
+
+	if (m_texelListBuffer != nullptr)
+	{
+		// Same texel count doesn't mean same tile count, e.g. 1000 x 1000 and 500 x 2000
+		D3D11_BUFFER_DESC listDesc;
+		D3D11_BUFFER_DESC tilesDesc;
+		m_texelListBuffer->GetDesc(&listDesc);
+		m_texelTilesBuffer->GetDesc(&tilesDesc);
+		if (listDesc.ByteWidth == numTexels * sizeof(uint32_t) && tilesDesc.ByteWidth == numTiles * sizeof(TexelTile))
+			return;
+
+		m_texelTilesBuffer.Reset();
+		m_texelTilesSRV.Reset();
+		m_texelTilesUAV.Reset();
+		m_texelListBuffer.Reset();
+		m_texelListSRV.Reset();
+		m_texelListUAV.Reset();
+	}
+
+	// Worst case: every tile / texel is covered
+	m_texelTilesBuffer = createStructuredBuffer(sizeof(TexelTile), numTiles, SBPreset::Default);
+	m_texelTilesSRV = createShaderResourceView(m_texelTilesBuffer.Get(), SRVPreset::StructuredBuffer);
+	m_texelTilesUAV = createUnorderedAccessView(m_texelTilesBuffer.Get(), UAVPreset::StructuredBuffer);
+
+	m_texelListBuffer = createStructuredBuffer(sizeof(uint32_t), numTexels, SBPreset::Default);
+	m_texelListSRV = createShaderResourceView(m_texelListBuffer.Get(), SRVPreset::StructuredBuffer);
+	m_texelListUAV = createUnorderedAccessView(m_texelListBuffer.Get(), UAVPreset::StructuredBuffer);
+
+	if (m_texelCountersBuffer == nullptr)
+	{
+		D3D11_BUFFER_DESC counterDesc = {};
+		counterDesc.ByteWidth = 4 * sizeof(uint32_t);
+		counterDesc.Usage = D3D11_USAGE_DEFAULT;
+		counterDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+		counterDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+		HRESULT hr = m_device->CreateBuffer(&counterDesc, nullptr, &m_texelCountersBuffer);
+		if (FAILED(hr))
+		{
+			std::cerr << "Failed to create texel counters buffer hr=" << hr << std::endl;
+			return;
+		}
+		m_texelCountersUAV = createUnorderedAccessView(m_texelCountersBuffer.Get(), UAVPreset::RawBuffer);
+
+		counterDesc.Usage = D3D11_USAGE_STAGING;
+		counterDesc.BindFlags = 0;
+		counterDesc.MiscFlags = 0;
+		counterDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		m_device->CreateBuffer(&counterDesc, nullptr, &m_texelCountersStaging);
+	}
+}
@@ -1,17 +1,35 @@
 #pragma once
 
 #include "basePass.hpp"
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <string>
-#include <future>
+#include <unordered_map>
 
 #include "glm/glm.hpp"
 #include "bvhNode.hpp"
+#include "utility/jobSystem.hpp"
 
 
 class TextureHistory;
+struct Texture;
 class Scene;
 class RTVCollector;
 class Primitive;
+struct SharedHighPoly;
+
+namespace DirectX
+{
+	class ScratchImage;
+}
+
+namespace Baking
+{
+	struct UVRasterMesh;
+	struct UDIMTile;
+	struct CombinedHighPolyData;
+}
 
 
 struct LowPolyPrimitiveBuffers
@@ -45,20 +63,17 @@ struct CombinedHighPolyBuffers
 	uint32_t numBLASInstances = 0;
 };
 
-// Instance data for TLAS - references into combined buffers
-// Triangles/BVH nodes stay in local space, ray is transformed to local space on GPU
-struct BLASInstance
+struct BakeSettings
 {
-	BVH::BBox worldBBox;         // 32 bytes - for early TLAS culling
-	glm::mat4 worldMatrixInv;    // 64 bytes - transforms ray from world to local space
-	glm::mat4 normalMatrix;      // 64 bytes - transforms normals from local to world (transpose of inverse)
-	uint32_t triangleOffset;     // offset into combined triangle buffer
-	uint32_t triIndicesOffset;   // offset into combined indices buffer
-	uint32_t bvhNodeOffset;      // offset into combined BVH nodes buffer
-	uint32_t numTriangles;       // number of triangles in this BLAS
+	uint32_t width = 1024;
+	uint32_t height = 1024;
+	float cageOffset = 0.1f;
+	uint32_t useSmoothedNormals = 0;
+	bool useCPURasterizer = false;
+	uint32_t dilationDistance = 16; // edge padding in texels, 0 disables it, Baking::k_infiniteDilation fills the whole map
 };
 
-class BakerPass : public BasePass
+class BakerPass : public BasePass, public std::enable_shared_from_this<BakerPass>
 {
 public:
 	explicit BakerPass(
@@ -69,7 +84,19 @@ public:
 
 	std::string name = "Baker Pass";
 
-	void bake(uint32_t width, uint32_t height, float cageOffset, uint32_t useSmoothedNormals);
+	// Combines and uploads the high-poly BLASes once, so passes baking against the same high-poly meshes share them
+	static std::shared_ptr<SharedHighPoly> scheduleHighPolyBuild(std::shared_ptr<BakerPass> uploader,
+		const std::vector<Primitive*>& highPolys,
+		Jobs::JobSystem& jobs,
+		uint64_t group);
+	// Snapshots the primitives and submits the bake stages, returns false if there is nothing to bake
+	bool scheduleBake(const BakeSettings& settings,
+		std::shared_ptr<SharedHighPoly> highPoly,
+		Jobs::JobSystem& jobs,
+		uint64_t group);
+	bool isBaking() const;
+	// Copies a complete earlier bake with identical inputs to the output path, false on a cache miss
+	bool restoreFromCache(const BakeSettings& settings);
 	void previewBakedNormal();
 	void drawRaycastVisualization(const glm::mat4& view, const glm::mat4& projection);
 	void createOrResize();
@@ -87,6 +114,13 @@ public:
 	std::string filename = "";
 
 private:
+	struct BakeState;
+	struct BakeKeys
+	{
+		uint64_t base = 0; // settings, blend mask and high-poly meshes, combined with each tile's geometry
+		uint64_t bake = 0; // base and all low-poly meshes
+	};
+
 	Scene* m_scene = nullptr;
 	uint32_t m_lastWidth = 0;
 	uint32_t m_lastHeight = 0;
@@ -94,7 +128,7 @@ private:
 	std::pair<std::vector<Primitive*>, std::vector<Primitive*>> m_primitivesToBake;
 
 	std::shared_ptr<TextureHistory> m_textureHistory;
-	std::future<void> m_saveTextureFuture;
+	std::atomic<uint32_t> m_bakesInFlight = 0;
 
 	ComPtr<ID3D11Buffer> m_constantBuffer;
 	ComPtr<ID3D11Buffer> m_rayDirectionBlendCB;
@@ -104,6 +138,12 @@ private:
 
 	CombinedHighPolyBuffers m_combinedHighPolyBuffers;
 
+	// Duration of the last bake of every UDIM tile in ms, used to schedule the next bake
+	std::unordered_map<uint32_t, double> m_tileCosts;
+	std::atomic<uint32_t> m_previewTile = 0; // UDIM tile shown by previewBakedNormal, 0 for single tile bakes
+	std::shared_ptr<Texture> m_bakedPreview; // last bake of the preview tile, built from memory while its file is written
+	mutable std::optional<uint64_t> m_blendMaskHash; // cached content hash of the blend mask, reset when it may change
+
 	// ## Resources for rasterizing UV space of low-poly meshes ##
 	ComPtr<ID3D11Texture2D> m_wsTexelPositionTexture;
 	ComPtr<ID3D11ShaderResourceView> m_wsTexelPositionSRV;
@@ -130,6 +170,19 @@ private:
 	ComPtr<ID3D11ShaderResourceView> m_bakedNormalSRV;
 	ComPtr<ID3D11UnorderedAccessView> m_bakedNormalUAV;
 
+	// ## Sparse texel list - only covered texels are traced ##
+	ComPtr<ID3D11Buffer> m_texelTilesBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_texelTilesSRV;
+	ComPtr<ID3D11UnorderedAccessView> m_texelTilesUAV;
+
+	ComPtr<ID3D11Buffer> m_texelListBuffer;
+	ComPtr<ID3D11ShaderResourceView> m_texelListSRV;
+	ComPtr<ID3D11UnorderedAccessView> m_texelListUAV;
+
+	ComPtr<ID3D11Buffer> m_texelCountersBuffer; // also used as DispatchIndirect args
+	ComPtr<ID3D11UnorderedAccessView> m_texelCountersUAV;
+	ComPtr<ID3D11Buffer> m_texelCountersStaging;
+
 	ComPtr<ID3D11Texture2D> m_rayDirectionBlendTexture;
 	ComPtr<ID3D11ShaderResourceView> m_rayDirectionBlendSRV;
 	ComPtr<ID3D11UnorderedAccessView> m_rayDirectionBlendUAV;
@@ -154,24 +207,36 @@ private:
 	ComPtr<ID3D11RasterizerState> m_uvRasterRasterizerState;
 	ComPtr<ID3D11DepthStencilState> m_uvRasterDepthStencilState;
 
-	CombinedHighPolyBuffers createCombinedHighPolyBuffers();
+	CombinedHighPolyBuffers uploadCombinedHighPoly(const Baking::CombinedHighPolyData& data);
 
+	BakeKeys computeBakeKeys(const BakeSettings& settings);
+	uint64_t getBlendMaskHash(uint32_t width, uint32_t height);
+	void prepareTexels(BakeState& state);
+	void scheduleTiles(std::shared_ptr<BakeState> state, Jobs::JobSystem& jobs);
+	void traceTile(std::shared_ptr<BakeState> state, size_t tileIndex, Jobs::JobSystem& jobs);
+
+	void buildTexelList();
+	void readTexelCoverage(BakeState& state, size_t tileIndex);
 	void bakeNormals(const CombinedHighPolyBuffers& hpBuffers);
 
 	void updateBakerCB(const CombinedHighPolyBuffers& combinedBuffers);
 	void updateRayDirectionBlendCB(float u, float v, float brushSize, float blendValue);
 
-	void saveToTextureFile();
-	void asyncSaveTextureToFile(const std::string& fullPath,
-		ComPtr<ID3D11Device> device,
-		ComPtr<ID3D11DeviceContext> context,
-		ComPtr<ID3D11Texture2D> texture);
+	std::string getBakedNormalPath() const;
+	// Main thread: keeps a freshly baked preview and swaps it into the material if that already shows the output
+	void handOffPreview(std::shared_ptr<Texture> texture);
+	std::shared_ptr<DirectX::ScratchImage> captureBakedNormal();
 
-	void rasterizeUVSpace(Primitive* lowPoly);
+	std::vector<Baking::UVRasterMesh> getLowPolyRasterMeshes() const;
+	static std::vector<std::vector<uint32_t>> findStackedUVIslands(const std::vector<Baking::UVRasterMesh>& meshes,
+		const std::vector<std::string>& meshNames);
+	void rasterizeUVSpace(Primitive* lowPoly, const std::vector<uint32_t>& indices, const glm::vec2& uvTileOffset);
+	void rasterizeUVSpaceCPU(const std::vector<Baking::UVRasterMesh>& meshes, const Baking::UDIMTile& tile);
 	void updateRaycastVisualization(const glm::mat4& view, const glm::mat4& projection);
 
 	void createInterpolatedTexturesResources();
 	void createBakedNormalResources();
+	void createTexelListResources();
 
 	std::unique_ptr<RTVCollector> m_rtvCollector;
 };
\ No newline at end of file
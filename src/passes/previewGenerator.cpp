@@ -120,6 +120,8 @@ void PreviewGenerator::generatePreview(Scene* scene)
 		m_context->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
 		m_context->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
 
+		// Evicted mips streamed back later draw the preview again
+		mat->markTexturesUsed(PREVIEW_SIZE);
 		m_context->PSSetShaderResources(0, 3, mat->getSRVs());
 		m_context->PSSetSamplers(0, 1, m_samplerState.GetAddressOf());
 
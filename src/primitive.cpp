@@ -8,7 +8,9 @@
 #include "assert.h"
 
 #include "bvhBuilder.hpp"
+#include "baking/meshProcessing.hpp"
 #include "primitiveData.hpp"
+#include "utility/hash.hpp"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -30,12 +32,14 @@ void Primitive::setVertexData(std::vector<Vertex>&& vertexData) const
 {
 
 	m_sharedData->vertexData = std::move(vertexData);
+	m_sharedData->contentHash = 0;
 	const auto numVerts = m_sharedData->vertexData.size();
 }
 
 void Primitive::setIndexData(std::vector<uint32_t>&& indexData) const
 {
 	m_sharedData->indexData = std::move(indexData);
+	m_sharedData->contentHash = 0;
 
 	D3D11_BUFFER_DESC indexBufferDesc = {};
 	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
@@ -52,23 +56,7 @@ void Primitive::fillTriangles()
 {
 	// Compute smooth normals BEFORE filling triangles so we can use them for baking
 	computeSmoothNormals();
-
-	for (size_t i = 0; i < m_sharedData->indexData.size(); i += 3)
-	{
-		Triangle tri;
-		tri.v0 = m_sharedData->vertexData[m_sharedData->indexData[i]].position;
-		tri.v1 = m_sharedData->vertexData[m_sharedData->indexData[i + 1]].position;
-		tri.v2 = m_sharedData->vertexData[m_sharedData->indexData[i + 2]].position;
-		tri.n0 = m_sharedData->vertexData[m_sharedData->indexData[i]].normal;
-		tri.n1 = m_sharedData->vertexData[m_sharedData->indexData[i + 1]].normal;
-		tri.n2 = m_sharedData->vertexData[m_sharedData->indexData[i + 2]].normal;
-		m_sharedData->triangles.push_back(tri);
-	}
-
-	for (uint32_t i = 0; i < m_sharedData->triangles.size(); i++)
-	{
-		m_sharedData->triangleIndices.push_back(i);
-	}
+	Baking::buildTriangles(m_sharedData->vertexData, m_sharedData->indexData, m_sharedData->triangles, m_sharedData->triangleIndices);
 
 	buildBVH(); // Build BVH BEFORE creating GPU buffers - BVH builder reorders triangleIndices
 
@@ -127,116 +115,17 @@ void Primitive::fillTriangles()
 
 BVH::BBox Primitive::getWorldBBox()
 {
-	BVH::BBox localBBox = m_sharedData->bvhNodes[0].bbox;
-	glm::mat4 worldMatrix = getWorldMatrix();
-
-	// Transform all 8 corners of the local AABB to world space and compute new AABB
-	glm::vec3 corners[8] = {
-		{localBBox.min.x, localBBox.min.y, localBBox.min.z},
-		{localBBox.max.x, localBBox.min.y, localBBox.min.z},
-		{localBBox.min.x, localBBox.max.y, localBBox.min.z},
-		{localBBox.max.x, localBBox.max.y, localBBox.min.z},
-		{localBBox.min.x, localBBox.min.y, localBBox.max.z},
-		{localBBox.max.x, localBBox.min.y, localBBox.max.z},
-		{localBBox.min.x, localBBox.max.y, localBBox.max.z},
-		{localBBox.max.x, localBBox.max.y, localBBox.max.z},
-	};
-
-	BVH::BBox worldBBox;
-	worldBBox.min = glm::vec3(FLT_MAX);
-	worldBBox.max = glm::vec3(-FLT_MAX);
-
-	for (int c = 0; c < 8; c++)
-	{
-		glm::vec3 worldCorner = glm::vec3(worldMatrix * glm::vec4(corners[c], 1.0f));
-		worldBBox.min = glm::min(worldBBox.min, worldCorner);
-		worldBBox.max = glm::max(worldBBox.max, worldCorner);
-	}
-
-	return worldBBox;
+	return Baking::transformBBox(m_sharedData->bvhNodes[0].bbox, getWorldMatrix());
 }
 
 void Primitive::computeTangents()
 {
-	const auto& indices = getIndexData();
-
-	for (auto& v : m_sharedData->vertexData)
-	{
-		v.tangent = glm::vec3(0.0f);
-	}
-
-	for (size_t i = 0; i < indices.size(); i += 3)
-	{
-		uint32_t i0 = indices[i];
-		uint32_t i1 = indices[i + 1];
-		uint32_t i2 = indices[i + 2];
-
-		const glm::vec3& p0 = m_sharedData->vertexData[i0].position;
-		const glm::vec3& p1 = m_sharedData->vertexData[i1].position;
-		const glm::vec3& p2 = m_sharedData->vertexData[i2].position;
-
-		const glm::vec2& uv0 = m_sharedData->vertexData[i0].texCoords;
-		const glm::vec2& uv1 = m_sharedData->vertexData[i1].texCoords;
-		const glm::vec2& uv2 = m_sharedData->vertexData[i2].texCoords;
-
-		glm::vec3 edge1 = p1 - p0;
-		glm::vec3 edge2 = p2 - p0;
-		glm::vec2 deltaUV1 = uv1 - uv0;
-		glm::vec2 deltaUV2 = uv2 - uv0;
-
-		float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y + 1e-8f);
-
-		glm::vec3 tangent;
-		tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-		tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-		tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-		m_sharedData->vertexData[i0].tangent += tangent;
-		m_sharedData->vertexData[i1].tangent += tangent;
-		m_sharedData->vertexData[i2].tangent += tangent;
-	}
-
-	// Normalize and orthogonalize
-	for (auto& v : m_sharedData->vertexData)
-	{
-		v.tangent = glm::normalize(v.tangent);
-		// Gram-Schmidt orthogonalize
-		v.tangent = glm::normalize(v.tangent - v.normal * glm::dot(v.normal, v.tangent));
-	}
+	Baking::computeTangents(m_sharedData->vertexData, m_sharedData->indexData);
 }
 
 void Primitive::computeSmoothNormals()
 {
-	// Map from position to accumulated normal
-	std::unordered_map<size_t, glm::vec3> positionToNormal;
-
-	auto hashPos = [](const glm::vec3& p) -> size_t {
-		// Quantize to avoid floating point issues
-		int x = static_cast<int>(p.x * 10000.0f);
-		int y = static_cast<int>(p.y * 10000.0f);
-		int z = static_cast<int>(p.z * 10000.0f);
-		return std::hash<int>()(x) ^ (std::hash<int>()(y) << 1) ^ (std::hash<int>()(z) << 2);
-		};
-
-	// Accumulate normals by position
-	for (const auto& v : m_sharedData->vertexData)
-	{
-		size_t key = hashPos(v.position);
-		positionToNormal[key] += v.normal;
-	}
-
-	// Normalize accumulated normals
-	for (auto& [key, normal] : positionToNormal)
-	{
-		normal = glm::normalize(normal);
-	}
-
-	// Assign smoothed normals back to vertices
-	for (auto& v : m_sharedData->vertexData)
-	{
-		size_t key = hashPos(v.position);
-		v.smoothNormal = positionToNormal[key];
-	}
+	Baking::computeSmoothNormals(m_sharedData->vertexData);
 }
 
 
@@ -311,6 +200,25 @@ std::vector<BVH::Node>& Primitive::getBVHNodes() const
 {
 	return m_sharedData->bvhNodes;
 }
+
+std::shared_ptr<const SharedPrimitiveData> Primitive::getSharedData() const
+{
+	return m_sharedData;
+}
+
+uint64_t Primitive::getContentHash() const
+{
+	if (m_sharedData->contentHash == 0)
+	{
+		const auto& vertices = m_sharedData->vertexData;
+		const auto& indices = m_sharedData->indexData;
+		const uint64_t vertexHash = Hash::bytes(vertices.data(), vertices.size() * sizeof(Vertex));
+		const uint64_t indexHash = Hash::bytes(indices.data(), indices.size() * sizeof(uint32_t));
+		m_sharedData->contentHash = Hash::combine(vertexHash, indexHash) | 1; // never 0
+	}
+	return m_sharedData->contentHash;
+}
+
 std::vector<BVH::Node> Primitive::getWorldSpaceBVHNodes()
 {
 	std::vector<BVH::Node> worldNodes;
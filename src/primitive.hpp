@@ -23,6 +23,7 @@ struct SharedPrimitiveData
 	std::vector<Triangle> triangles;
 	std::vector<uint32_t> triangleIndices;
 	std::vector<BVH::Node> bvhNodes;
+	uint64_t contentHash = 0; // of vertexData and indexData, 0 = not computed yet
 
 	ComPtr<ID3D11Buffer> indexBuffer;
 	ComPtr<ID3D11Buffer> vertexBuffer;
@@ -74,6 +75,10 @@ public:
 	const std::vector<uint32_t>& getTriangleIndices() const;
 	std::vector<BVH::Node>& getBVHNodes() const;
 	std::vector<BVH::Node> getWorldSpaceBVHNodes();
+	// Keeps the geometry alive for bake jobs that outlive a frame
+	std::shared_ptr<const SharedPrimitiveData> getSharedData() const;
+	// Identifies the geometry for the bake cache, computed on first use
+	uint64_t getContentHash() const;
 
 	void copyFrom(const SceneNode& node) override;
 	bool differsFrom(const SceneNode& node) const override;
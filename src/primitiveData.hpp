@@ -1,6 +1,7 @@
 #pragma once
 
-#include <d3d11_4.h>
+#include <cstdint>
+
 #include <glm/glm.hpp>
 
 using Position = glm::vec3;
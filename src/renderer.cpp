@@ -122,6 +122,7 @@ void Renderer::draw()
 	}
 
 	// --- CPU Updates ---
+	AppConfig::frameIndex++;
 	m_scene->updateState();
 
 	if (m_scene->isEnvironmentMapDirty()) 	// Check for environment map changes
@@ -1,21 +1,40 @@
 #include "scene.hpp"
 
+#include <algorithm>
 #include <consoleapi.h>
 #include <iostream>
 #include <ranges>
 
+#include "appConfig.hpp"
 #include "bakerNode.hpp"
 #include "camera.hpp"
 #include "light.hpp"
 #include "material.hpp"
 #include "primitive.hpp"
 #include "texture.hpp"
+#include "textureResidency.hpp"
+
+#include "utility/jobSystem.hpp"
+#include "utility/outputWriter.hpp"
 
 Scene::Scene(const std::string_view name, ComPtr<ID3D11Device> device)
 {
 	this->name = name;
 	m_device = device;
 	nodeHandle = SceneNodeHandle::generateHandle();
+	m_bakeJobs = std::make_unique<Jobs::JobSystem>(AppConfig::bakeWorkerCount, AppConfig::bakeMemoryBudgetMB * 1024 * 1024);
+	m_outputWriter = std::make_unique<Jobs::OutputWriter>(AppConfig::outputWriterThreads, AppConfig::outputQueueLength,
+		AppConfig::outputMemoryBudgetMB * 1024 * 1024);
+	m_textureResidency = std::make_unique<TextureResidency>(m_device, AppConfig::textureBudgetMB * 1024 * 1024);
+}
+
+Scene::~Scene()
+{
+	// Bake jobs reference primitives and passes owned by the nodes
+	m_bakeJobs->waitIdle();
+	// Finish writing baked maps, their completion may still queue preview updates on the main thread
+	m_outputWriter->flush();
+	m_bakeJobs->waitIdle();
 }
 
 SceneNodeHandle Scene::findHandleOfNode(SceneNode* node) const
@@ -271,13 +290,31 @@ void Scene::processPendingBakes()
 	{
 		baker->processPendingBake();
 	}
+	// Stages of the Baker the user is looking at jump the queue
+	m_bakeJobs->setFocusGroup(dynamic_cast<Baker*>(m_activeNode) ? reinterpret_cast<uintptr_t>(m_activeNode) : 0);
+	m_bakeJobs->runMainThreadJobs(AppConfig::bakeMainThreadBudgetMs);
+}
+
+Jobs::JobSystem& Scene::getBakeJobs()
+{
+	return *m_bakeJobs;
+}
+
+Jobs::OutputWriter& Scene::getOutputWriter()
+{
+	return *m_outputWriter;
+}
+
+const TextureResidency& Scene::getTextureResidency() const
+{
+	return *m_textureResidency;
 }
 
 void Scene::checkTextureUpdates()
 {
 	for (auto& [name, texture] : m_textures)
 	{
-		if (texture->filepath.empty())
+		if (texture->filepath.empty() || texture->isWritePending)
 			continue;
 		bool alreadyPending = std::ranges::any_of(m_pendingTextureReloads,
 			[&name](const PendingTextureReload& p) { return p.name == name; });
@@ -328,6 +365,7 @@ void Scene::updateAsyncPendingTextureReloads()
 			existingTexture->textureResource = result.texture->textureResource;
 			existingTexture->srv = result.texture->srv;
 			existingTexture->texDesc = result.texture->texDesc;
+			existingTexture->residency.residentMip = 0;
 			std::cout << "Texture reloaded successfully: " << it->name << std::endl;
 		}
 		catch (const std::exception& e)
@@ -338,6 +376,25 @@ void Scene::updateAsyncPendingTextureReloads()
 	}
 }
 
+void Scene::updateTextureResidency()
+{
+	const std::vector<std::shared_ptr<Texture>> restored = m_textureResidency->update(m_textures);
+	if (restored.empty())
+		return;
+	// Previews drawn while the mips were evicted are drawn again
+	for (auto& [name, material] : m_materials)
+	{
+		const bool usesRestored = std::ranges::any_of(restored, [&material](const std::shared_ptr<Texture>& texture)
+			{
+				return texture == material->albedo || texture == material->metallicRoughness || texture == material->normal;
+			});
+		if (usesRestored)
+		{
+			material->needsPreviewUpdate = true;
+		}
+	}
+}
+
 void Scene::addBakerNode(BakerNode* node)
 {
 	validateName(node);
@@ -367,6 +424,19 @@ void Scene::addTexture(std::shared_ptr<Texture> texture)
 	m_textures[texture->name] = std::move(texture);
 }
 
+SceneContentIndex Scene::getContentIndex() const
+{
+	SceneContentIndex index;
+	for (const auto& [name, texture] : m_textures)
+	{
+		if (texture->contentHash != 0)
+		{
+			index.textures.emplace(texture->contentHash, SceneContentIndex::SharedTexture{ texture, texture->getMemoryBytes() });
+		}
+	}
+	return index;
+}
+
 std::shared_ptr<Material> Scene::getMaterial(const std::string_view name)
 {
 	const auto it = m_materials.find(name);
@@ -479,6 +549,15 @@ void Scene::setActiveCamera(Camera* camera)
 
 void Scene::deleteNode(SceneNode* node)
 {
+	// Bakes only read the meshes of their own Baker, the jobs of the Baker owning the node are dropped
+	for (SceneNode* owner = node; owner; owner = owner->parent)
+	{
+		if (dynamic_cast<Baker*>(owner))
+		{
+			m_bakeJobs->cancelGroup(reinterpret_cast<uintptr_t>(owner));
+			break;
+		}
+	}
 	node->nodeHandle = SceneNodeHandle::invalidHandle();
 
 	while (!node->children.empty())
@@ -628,6 +707,7 @@ void Scene::updateState()
 	processPendingBakes();
 	checkTextureUpdates();
 	updateAsyncPendingTextureReloads();
+	updateTextureResidency();
 	updateAsyncImport();
 }
 
@@ -646,7 +726,7 @@ void Scene::importModel(const std::string& filepath)
 
 	m_isImporting = true;
 	m_importProgress = std::make_shared<ImportProgress>();
-	m_importFuture = GLTFModel::importModelAsync(filepath, m_device, m_importProgress);
+	m_importFuture = GLTFModel::importModelAsync(filepath, m_device, m_importProgress, getContentIndex());
 
 	std::cout << "Started async import: " << filepath << std::endl;
 }
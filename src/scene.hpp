@@ -21,9 +21,16 @@ class Light;
 class Camera;
 class Baker;
 class BakerNode;
+class TextureResidency;
 
 struct PendingTextureReload;
 
+namespace Jobs
+{
+	class JobSystem;
+	class OutputWriter;
+}
+
 using namespace Microsoft::WRL;
 
 
@@ -31,7 +38,7 @@ class Scene : public SceneNode
 {
 public:
 	explicit Scene(std::string_view name = "Default Scene", ComPtr<ID3D11Device> device = nullptr);
-	~Scene() override = default;
+	~Scene() override;
 
 	SceneNodeHandle findHandleOfNode(SceneNode* node) const;
 	SceneNode* getNodeByHandle(SceneNodeHandle handle);
@@ -52,6 +59,9 @@ public:
 
 	std::shared_ptr<Texture> getTexture(std::string_view name);
 	void addTexture(std::shared_ptr<Texture> texture);
+	// Imports share the scene's textures with identical content. Materials are never shared, the baker
+	// preview and the material editor replace their textures in place
+	SceneContentIndex getContentIndex() const;
 
 	std::shared_ptr<Material> getMaterial(std::string_view name);
 	void addMaterial(std::shared_ptr<Material> material);
@@ -91,6 +101,10 @@ public:
 	void importModel(const std::string& filepath);
 	std::shared_ptr<ImportProgress> getImportProgress() const;
 
+	Jobs::JobSystem& getBakeJobs();
+	Jobs::OutputWriter& getOutputWriter();
+	const TextureResidency& getTextureResidency() const;
+
 	void saveScene(std::string_view filepath);
 	void loadScene(std::string_view filepath);
 	void clearScene();
@@ -100,6 +114,7 @@ private:
 	void processPendingBakes();
 	void checkTextureUpdates();
 	void updateAsyncPendingTextureReloads();
+	void updateTextureResidency();
 	void addLight(Light* light);
 	void addPrimitive(Primitive* primitive);
 	void addCamera(Camera* camera);
@@ -121,6 +136,9 @@ private:
 	std::shared_ptr<ImportProgress> m_importProgress;
 	ComPtr<ID3D11Device> m_device;
 	std::vector<PendingTextureReload> m_pendingTextureReloads;
+	std::unique_ptr<Jobs::JobSystem> m_bakeJobs;
+	std::unique_ptr<Jobs::OutputWriter> m_outputWriter;
+	std::unique_ptr<TextureResidency> m_textureResidency;
 
 	std::unordered_set<SceneNode*> m_selectedNodes;
 
@@ -8,7 +8,8 @@ cbuffer Constants : register(b0)
 	float cageOffset;
 	uint useSmoothedNormals;
 	uint numBLASInstances;
-	uint3 _pad;
+	float2 uvTileOffset;
+	float _pad;
 };
 
 struct BLASInstance
@@ -34,10 +35,27 @@ Texture2D<float4> gWorldSpaceTangents : register(t6);
 Texture2D<float4> gWorldSpaceSmoothedNormals : register(t7);
 Texture2D<float> gRayDirectionBlend : register(t8);
 
+// Sparse texel list produced by CSBuildTexelList
+struct TexelTile
+{
+	uint texelOffset; // first entry of this tile in gTexelList
+	uint texelCount;  // number of covered texels in this tile
+};
+StructuredBuffer<TexelTile> gTexelTiles : register(t9);
+StructuredBuffer<uint> gTexelList : register(t10); // packed as x | (y << 16)
+
 
 //this one is for baking output
 RWTexture2D<float4> oBakedNormal : register(u0);
 
+// those are written by CSBuildTexelList
+RWStructuredBuffer<TexelTile> oTexelTiles : register(u1);
+RWStructuredBuffer<uint> oTexelList : register(u2);
+// [0] non-empty tile count (doubles as ThreadGroupCountX for DispatchIndirect), [1..2] = 1, [3] covered texel count
+RWByteAddressBuffer oTexelCounters : register(u3);
+
+#define TEXEL_TILE_SIZE 16
+
 
 float hash(uint2 p) // Hash function for dithering
 {
@@ -175,17 +193,63 @@ void TraverseTLAS(Ray ray, inout float bestT, inout float3 bestN)
 	}
 }
 
-[numthreads(16, 16, 1)]
-void CSBakeNormal(uint3 DTid : SV_DispatchThreadID)
+groupshared uint gsTileTexelCount;
+groupshared uint gsTileTexelOffset;
+
+// One group per 16x16 tile: compacts covered texels (position alpha != 0) into gTexelList.
+// Empty tiles never get a TexelTile record, so the trace pass does not even launch a group for them.
+[numthreads(TEXEL_TILE_SIZE, TEXEL_TILE_SIZE, 1)]
+void CSBuildTexelList(uint3 DTid : SV_DispatchThreadID, uint GI : SV_GroupIndex)
 {
-	if (DTid.x >= dimensions.x || DTid.y >= dimensions.y)
+	if (GI == 0)
+		gsTileTexelCount = 0;
+
+	GroupMemoryBarrierWithGroupSync();
+
+	bool covered = false;
+	if (DTid.x < dimensions.x && DTid.y < dimensions.y)
+		covered = gWorldSpacePositions.Load(int3(DTid.xy, 0)).a != 0.0f;
+
+	uint localIndex = 0;
+	if (covered)
+		InterlockedAdd(gsTileTexelCount, 1, localIndex);
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (GI == 0 && gsTileTexelCount > 0)
+	{
+		uint tileSlot;
+		oTexelCounters.InterlockedAdd(12, gsTileTexelCount, gsTileTexelOffset);
+		oTexelCounters.InterlockedAdd(0, 1, tileSlot);
+
+		TexelTile tile;
+		tile.texelOffset = gsTileTexelOffset;
+		tile.texelCount = gsTileTexelCount;
+		oTexelTiles[tileSlot] = tile;
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (covered)
+		oTexelList[gsTileTexelOffset + localIndex] = DTid.x | (DTid.y << 16);
+}
+
+// Dispatched indirectly with one group per non-empty tile from CSBuildTexelList
+[numthreads(TEXEL_TILE_SIZE, TEXEL_TILE_SIZE, 1)]
+void CSBakeNormal(uint3 Gid : SV_GroupID, uint GI : SV_GroupIndex)
+{
+	TexelTile tile = gTexelTiles[Gid.x];
+	if (GI >= tile.texelCount)
 		return;
 
-	float4 worldPos = gWorldSpacePositions.Load(int3(DTid.xy, 0));
-	float4 worldNormal = gWorldSpaceNormals.Load(int3(DTid.xy, 0));
-	float4 worldTangent = gWorldSpaceTangents.Load(int3(DTid.xy, 0));
-	float4 worldSmoothedNormal = gWorldSpaceSmoothedNormals.Load(int3(DTid.xy, 0));
-	float blendValue = gRayDirectionBlend.Load(int3(DTid.xy, 0)).x;
+	uint packedTexel = gTexelList[tile.texelOffset + GI];
+	uint2 texel = uint2(packedTexel & 0xFFFF, packedTexel >> 16);
+
+	float4 worldPos = gWorldSpacePositions.Load(int3(texel, 0));
+	float4 worldNormal = gWorldSpaceNormals.Load(int3(texel, 0));
+	float4 worldTangent = gWorldSpaceTangents.Load(int3(texel, 0));
+	float4 worldSmoothedNormal = gWorldSpaceSmoothedNormals.Load(int3(texel, 0));
+	float blendValue = gRayDirectionBlend.Load(int3(texel, 0)).x;
 
 	float3 blendedNormal = normalize(lerp(worldSmoothedNormal.xyz, worldNormal.xyz, blendValue));
 
@@ -198,7 +262,7 @@ void CSBakeNormal(uint3 DTid : SV_DispatchThreadID)
 	float3 B = cross(N, T);
 
 	// Jitter ray origin in tangent plane (within ~half a texel)
-	float3 jitter = ditherNoise(DTid.xy);
+	float3 jitter = ditherNoise(texel);
 	float jitterScale = 0.002f;
 	float3 originJitter = (jitter.x * T + jitter.y * B) * jitterScale;
 
@@ -230,6 +294,6 @@ void CSBakeNormal(uint3 DTid : SV_DispatchThreadID)
 		tangentSpaceNormal = float3(0.5f, 0.5f, 1.0f); // default normal if no intersection
 	}
 
-	oBakedNormal[DTid.xy] = float4(tangentSpaceNormal, 1.0f);
+	oBakedNormal[texel] = float4(tangentSpaceNormal, 1.0f);
 
 }
\ No newline at end of file
@@ -5,6 +5,9 @@ cbuffer Constants : register(b0)
 	float4x4 worldMatrixInvTranspose;
 	uint2 dimensions;
 	float cageOffset;
+	uint useSmoothedNormals;
+	uint numBLASInstances;
+	float2 uvTileOffset; // lower-left corner of the UDIM tile being rasterized
 };
 
 struct VSInput
@@ -36,7 +39,7 @@ struct PSOutput
 PSInput VS(VSInput input)
 {
 	PSInput output;
-	float2 clipPos = input.texCoord * 2.0f - 1.0f; // clip-space position [0,1] to [-1,1]
+	float2 clipPos = (input.texCoord - uvTileOffset) * 2.0f - 1.0f; // clip-space position [0,1] to [-1,1]
 	clipPos.y = -clipPos.y;  
 	output.position = float4(clipPos, 0.0f, 1.0f);
 	
@@ -1,9 +1,15 @@
 #include "texture.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include "DirectXTex.h"
 
+#include "appConfig.hpp"
+#include "textureCache.hpp"
+#include "baking/mipGenerator.hpp"
+
 Texture::Texture(const ComPtr<ID3D11Device>& _device)
 	: device(_device)
 {
@@ -16,6 +22,9 @@ Texture::Texture(Texture&& other, ComPtr<ID3D11Device> _device)
 	name = std::move(other.name);
 	filepath = std::move(other.filepath);
 	textureResource = std::move(other.textureResource);
+	isNormalMap = other.isNormalMap;
+	contentHash = other.contentHash;
+	residency = other.residency;
 }
 
 
@@ -82,10 +91,77 @@ Texture::Texture(const tinygltf::Image& image, ComPtr<ID3D11Device> _device, Com
 
 uint32_t GetBytesPerPixel(DXGI_FORMAT format);
 
-Texture::Texture(std::string filepath, ComPtr<ID3D11Device> _device, ComPtr<ID3D11DeviceContext> context)
+namespace
+{
+	std::string getFilename(const std::string& filepath)
+	{
+		return filepath.find_last_of("/\\") != std::string::npos ?
+			filepath.substr(filepath.find_last_of("/\\") + 1) : filepath;
+	}
+
+	// Mip chain of a normal map in RGBA16, filtered by the baker's vector aware mip generator
+	HRESULT generateNormalMapMips(const DirectX::Image& image, DirectX::ScratchImage& chain)
+	{
+		DirectX::ScratchImage converted;
+		const DirectX::Image* source = &image;
+		if (image.format != DXGI_FORMAT_R16G16B16A16_UNORM)
+		{
+			HRESULT hr = DirectX::Convert(image, DXGI_FORMAT_R16G16B16A16_UNORM,
+				DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+			if (FAILED(hr))
+				return hr;
+			source = converted.GetImage(0, 0, 0);
+		}
+
+		const DirectX::Image& top = *source;
+		Baking::MipSettings settings;
+		settings.filter = Baking::MipFilter::Normal;
+		const std::vector<Baking::MipLevel> levels = Baking::generateMips(reinterpret_cast<const uint16_t*>(top.pixels),
+			static_cast<uint32_t>(top.width), static_cast<uint32_t>(top.height), top.rowPitch, settings);
+
+		HRESULT hr = chain.Initialize2D(DXGI_FORMAT_R16G16B16A16_UNORM, top.width, top.height, 1, levels.size() + 1);
+		if (FAILED(hr))
+			return hr;
+		const auto copyRows = [](const void* source, size_t sourcePitch, const DirectX::Image& target)
+			{
+				for (size_t y = 0; y < target.height; y++)
+				{
+					std::memcpy(target.pixels + y * target.rowPitch, static_cast<const uint8_t*>(source) + y * sourcePitch,
+						target.width * 4 * sizeof(uint16_t));
+				}
+			};
+		copyRows(top.pixels, top.rowPitch, *chain.GetImage(0, 0, 0));
+		for (size_t mip = 0; mip < levels.size(); mip++)
+		{
+			copyRows(levels[mip].pixels.data(), levels[mip].width * 4 * sizeof(uint16_t), *chain.GetImage(mip + 1, 0, 0));
+		}
+		return S_OK;
+	}
+
+	HRESULT generateMipChain(const DirectX::Image& image, bool isNormalMap, DirectX::ScratchImage& chain)
+	{
+		if (isNormalMap && !DirectX::IsCompressed(image.format))
+			return generateNormalMapMips(image, chain);
+		return DirectX::GenerateMipMaps(image, DirectX::TEX_FILTER_DITHER, 0, chain);
+	}
+}
+
+Texture::Texture(std::string filepath, ComPtr<ID3D11Device> _device, ComPtr<ID3D11DeviceContext> context, bool isNormalMap)
 {
 
 	device = _device;
+	this->isNormalMap = isNormalMap;
+
+	// A sidecar of an earlier load skips decoding and mip generation, its mapped mips are uploaded as they are
+	const TextureCache cache(AppConfig::textureCacheDirectory);
+	if (const std::unique_ptr<MappedTexture> cached = cache.find(filepath, isNormalMap))
+	{
+		lastModifiedTime = std::filesystem::last_write_time(filepath);
+		name = getFilename(filepath);
+		this->filepath = filepath;
+		createResources(*cached);
+		return;
+	}
 
 	bool isTga = false;
 	bool isDds = false;
@@ -160,26 +236,98 @@ Texture::Texture(std::string filepath, ComPtr<ID3D11Device> _device, ComPtr<ID3D
 			tempImage);
 	}
 
-	DirectX::ScratchImage mipChain;
-	hr = DirectX::GenerateMipMaps(tempImage.GetImages(), tempImage.GetImageCount(), tempImage.GetMetadata(), DirectX::TEX_FILTER_DITHER, 0, mipChain);
+	if (isNormalMap && SUCCEEDED(hr) && !DirectX::IsCompressed(tempImage.GetMetadata().format))
+	{
+		DirectX::ScratchImage mipChain;
+		hr = generateNormalMapMips(*tempImage.GetImage(0, 0, 0), mipChain);
+		if (SUCCEEDED(hr))
+		{
+			tempImage = std::move(mipChain);
+		}
+	}
+	else
+	{
+		DirectX::ScratchImage mipChain;
+		hr = DirectX::GenerateMipMaps(tempImage.GetImages(), tempImage.GetImageCount(), tempImage.GetMetadata(), DirectX::TEX_FILTER_DITHER, 0, mipChain);
+		if (SUCCEEDED(hr))
+		{
+			tempImage = std::move(mipChain);
+		}
+	}
+
 	if (SUCCEEDED(hr))
 	{
-		tempImage = std::move(mipChain);
+		cache.store(filepath, isNormalMap, tempImage, AppConfig::compressCachedTextures);
 	}
 
 	lastModifiedTime = std::filesystem::last_write_time(filepath);
-	name = filepath.find_last_of("/\\") != std::string::npos ?
-		filepath.substr(filepath.find_last_of("/\\") + 1) : filepath;
+	name = getFilename(filepath);
 
 
 	this->filepath = filepath;
+	createResources(tempImage);
+}
+
+Texture::Texture(const DirectX::Image& image, std::string filepath, ComPtr<ID3D11Device> _device, bool isNormalMap)
+{
+	device = _device;
+	name = getFilename(filepath);
+	this->filepath = std::move(filepath);
+	this->isNormalMap = isNormalMap;
+	isWritePending = true; // lastModifiedTime is set by markWritten
+
+	DirectX::ScratchImage mipChain;
+	HRESULT hr = generateMipChain(image, isNormalMap, mipChain);
+	if (FAILED(hr))
+	{
+		std::cerr << "Failed to generate mips for " << this->filepath << " hr=" << hr << std::endl;
+		return;
+	}
+	createResources(mipChain);
+}
+
+void Texture::markWritten()
+{
+	std::error_code error;
+	const auto writeTime = std::filesystem::last_write_time(filepath, error);
+	if (!error)
+	{
+		lastModifiedTime = writeTime;
+		isWritePending = false;
+	}
+}
+
+void Texture::markUsed(uint32_t sampledSize)
+{
+	// Most detailed mip that still has sampledSize texels along the larger side
+	uint32_t mip = 0;
+	if (sampledSize > 0 && residency.fullDesc.Width > 0)
+	{
+		uint32_t size = std::max(residency.fullDesc.Width, residency.fullDesc.Height);
+		while (size / 2 >= sampledSize && mip + 1 < residency.fullDesc.MipLevels)
+		{
+			size /= 2;
+			mip++;
+		}
+	}
+	if (residency.lastUsedFrame != AppConfig::frameIndex)
+	{
+		residency.lastUsedFrame = AppConfig::frameIndex;
+		residency.requestedMip = mip;
+	}
+	else
+	{
+		residency.requestedMip = std::min(residency.requestedMip, mip);
+	}
+}
 
+void Texture::createResources(const DirectX::ScratchImage& tempImage)
+{
 	const auto& metadata = tempImage.GetMetadata();
-	const auto* image = tempImage.GetImage(0, 0, 0);
 
 	// Use DirectXTex helper to create texture - handles row pitch correctly
 	ComPtr<ID3D11Resource> resource;
-	hr = DirectX::CreateTexture(
+	HRESULT hr = DirectX::CreateTexture(
 		device.Get(),
 		tempImage.GetImages(),
 		tempImage.GetImageCount(),
@@ -216,6 +364,23 @@ Texture::Texture(std::string filepath, ComPtr<ID3D11Device> _device, ComPtr<ID3D
 	}
 }
 
+void Texture::createResources(const MappedTexture& mapped)
+{
+	HRESULT hr = device->CreateTexture2D(&mapped.desc, mapped.subresources.data(), &textureResource);
+	if (FAILED(hr))
+	{
+		std::cerr << "Failed to create texture " << filepath << " from the texture cache hr=" << hr << std::endl;
+		return;
+	}
+	textureResource->GetDesc(&texDesc);
+
+	hr = device->CreateShaderResourceView(textureResource.Get(), nullptr, &srv);
+	if (FAILED(hr))
+	{
+		std::cerr << "Failed to create shader resource view = " << hr << std::endl;
+	}
+}
+
 uint32_t Texture::getWidth() const
 {
 	return texDesc.Width;
@@ -226,6 +391,23 @@ uint32_t Texture::getHeight() const
 	return texDesc.Height;
 }
 
+size_t Texture::getMemoryBytes() const
+{
+	const D3D11_TEXTURE2D_DESC& desc = residency.residentMip == 0 ? texDesc : residency.fullDesc;
+	size_t bytes = 0;
+	for (uint32_t mip = 0; mip < desc.MipLevels; mip++)
+	{
+		size_t rowPitch = 0;
+		size_t slicePitch = 0;
+		if (SUCCEEDED(DirectX::ComputePitch(desc.Format, std::max(1u, desc.Width >> mip), std::max(1u, desc.Height >> mip),
+			rowPitch, slicePitch)))
+		{
+			bytes += slicePitch;
+		}
+	}
+	return bytes * desc.ArraySize;
+}
+
 std::future<AsyncTextureResult> Texture::loadTextureAsync(const std::string& filepath, ComPtr<ID3D11Device> device, std::shared_ptr<TextureLoadProgress> progress)
 {
 	if (!progress)
@@ -11,6 +11,13 @@
 
 using namespace Microsoft::WRL;
 
+namespace DirectX
+{
+	struct Image;
+	class ScratchImage;
+}
+
+class MappedTexture;
 struct Texture;
 
 struct TextureLoadProgress
@@ -44,15 +51,41 @@ struct Texture
 	ComPtr<ID3D11Texture2D> textureResource;
 	ComPtr<ID3D11ShaderResourceView> srv;
 	D3D11_TEXTURE2D_DESC texDesc;
+	bool isWritePending = false; // the image is still being written to filepath, not reloaded until markWritten
+	bool isNormalMap = false;    // mips are filtered as vectors, streamed mips come from the matching sidecar
+	uint64_t contentHash = 0;    // of the encoded image an import created it from, 0 if it was loaded otherwise
+
+	// Maintained by TextureResidency, texDesc only describes the resident mips
+	struct Residency
+	{
+		D3D11_TEXTURE2D_DESC fullDesc = {}; // the complete mip chain, recorded while it is resident
+		uint32_t residentMip = 0;   // mips above it were evicted to stay within the texture budget
+		uint32_t requestedMip = 0;  // most detailed mip sampled in lastUsedFrame
+		uint64_t lastUsedFrame = 0; // AppConfig::frameIndex of the last draw sampling the texture
+		uint64_t retryFrame = 0;    // a failed stream is not retried before this frame
+		bool isStreaming = false;
+	} residency;
 
 	explicit Texture(const ComPtr<ID3D11Device>& device);
 	Texture(Texture&& other, ComPtr<ID3D11Device> device);
 	Texture(const Texture& other) = delete;
 	Texture(const tinygltf::Image& image, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context = nullptr);
-	Texture(std::string filepath, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context = nullptr);
+	// Normal maps get mips averaged as vectors and renormalized instead of a colour box filter
+	Texture(std::string filepath, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context = nullptr, bool isNormalMap = false);
+	// Builds the texture from pixels in memory that are being written to filepath in the background.
+	// Only uses the device, so it can run on a worker thread.
+	Texture(const DirectX::Image& image, std::string filepath, ComPtr<ID3D11Device> device, bool isNormalMap = false);
+
+	// Main thread: the file at filepath now holds the image, later changes to it are reloaded again
+	void markWritten();
+	// Main thread: a draw this frame samples the texture at up to sampledSize texels, 0 for full resolution.
+	// TextureResidency streams the mip back if it was evicted.
+	void markUsed(uint32_t sampledSize = 0);
 
 	uint32_t getWidth() const;
 	uint32_t getHeight() const;
+	// Bytes of the complete mip chain, including mips TextureResidency evicted
+	size_t getMemoryBytes() const;
 
 	static std::future<AsyncTextureResult> loadTextureAsync(const std::string& filepath,
 		ComPtr<ID3D11Device> device,
@@ -62,4 +95,8 @@ struct Texture
 		ComPtr<ID3D11DeviceContext> immContext);
 
 	ComPtr<ID3D11Device> device;
+
+private:
+	void createResources(const DirectX::ScratchImage& image);
+	void createResources(const MappedTexture& mapped);
 };
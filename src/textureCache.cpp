@@ -0,0 +1,314 @@
+#include "textureCache.hpp"
+
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+#include "DirectXTex.h"
+
+#include "baking/blockCompression.hpp"
+#include "utility/hash.hpp"
+
+namespace
+{
+	constexpr uint32_t k_sidecarMagic = 0x43544642; // "BFTC"
+	// Bump whenever decoding or mip generation changes, invalidates every sidecar
+	constexpr uint32_t k_sidecarVersion = 1;
+	constexpr uint64_t k_dataAlignment = 16;
+
+	struct SidecarHeader
+	{
+		uint32_t magic = k_sidecarMagic;
+		uint32_t version = k_sidecarVersion;
+		int64_t sourceTime = 0; // last_write_time of the source as file_time_type ticks
+		uint64_t sourceSize = 0;
+		uint64_t contentHash = 0;
+		uint32_t format = 0; // DXGI_FORMAT
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 0;
+	};
+
+	struct SidecarLevel
+	{
+		uint64_t offset = 0; // from the start of the file
+		uint64_t rowPitch = 0;
+		uint64_t slicePitch = 0;
+	};
+
+	struct SourceStamp
+	{
+		int64_t time = 0;
+		uint64_t size = 0;
+	};
+
+	bool getSourceStamp(const std::filesystem::path& sourcePath, SourceStamp& outStamp)
+	{
+		std::error_code error;
+		const auto time = std::filesystem::last_write_time(sourcePath, error);
+		if (error)
+			return false;
+		const uintmax_t size = std::filesystem::file_size(sourcePath, error);
+		if (error)
+			return false;
+		outStamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+		outStamp.size = size;
+		return true;
+	}
+
+	bool hashFile(const std::filesystem::path& path, uint64_t& outHash)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		const std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		outHash = Hash::bytes(content.data(), content.size());
+		return true;
+	}
+
+	// Levels of the chain as they will be stored, block compressed when requested and possible
+	struct StoredLevel
+	{
+		std::vector<uint8_t> blocks; // empty when the level is stored from the chain as is
+		const DirectX::Image* image = nullptr;
+		uint64_t rowPitch = 0;
+		uint64_t slicePitch = 0;
+	};
+
+	bool canCompress(const DirectX::TexMetadata& metadata)
+	{
+		// BC7 is 8-bit per channel LDR, and D3D11 requires block aligned top levels
+		return !DirectX::IsCompressed(metadata.format)
+			&& DirectX::FormatDataType(metadata.format) == DirectX::FORMAT_TYPE_UNORM
+			&& DirectX::BitsPerColor(metadata.format) <= 16
+			&& metadata.width % 4 == 0 && metadata.height % 4 == 0;
+	}
+
+	bool compressLevel(const DirectX::Image& image, StoredLevel& outLevel)
+	{
+		// Viewed as linear so sRGB data is copied, not converted, and stays tagged sRGB on the BC7 format
+		DirectX::Image linearImage = image;
+		linearImage.format = DirectX::MakeLinear(image.format);
+		DirectX::ScratchImage converted;
+		const DirectX::Image* source = &linearImage;
+		if (linearImage.format != DXGI_FORMAT_R16G16B16A16_UNORM)
+		{
+			if (FAILED(DirectX::Convert(linearImage, DXGI_FORMAT_R16G16B16A16_UNORM, DirectX::TEX_FILTER_DEFAULT,
+				DirectX::TEX_THRESHOLD_DEFAULT, converted)))
+				return false;
+			source = converted.GetImage(0, 0, 0);
+		}
+		outLevel.blocks = Baking::compressBlocks(Baking::BlockFormat::BC7, reinterpret_cast<const uint16_t*>(source->pixels),
+			static_cast<uint32_t>(source->width), static_cast<uint32_t>(source->height), source->rowPitch);
+		outLevel.rowPitch = ((source->width + 3) / 4) * Baking::k_blockBytes;
+		outLevel.slicePitch = outLevel.blocks.size();
+		return true;
+	}
+
+	uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + k_dataAlignment - 1) / k_dataAlignment * k_dataAlignment;
+	}
+}
+
+MappedTexture::~MappedTexture()
+{
+	if (m_view)
+		UnmapViewOfFile(m_view);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+}
+
+TextureCache::TextureCache(std::filesystem::path directory)
+	: m_directory(std::move(directory))
+{
+	if (m_directory.empty())
+		return;
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	if (error)
+	{
+		std::cerr << "Texture cache disabled, cannot create " << m_directory.string() << ": " << error.message() << std::endl;
+		m_directory.clear();
+	}
+}
+
+bool TextureCache::isEnabled() const
+{
+	return !m_directory.empty();
+}
+
+std::unique_ptr<MappedTexture> TextureCache::find(const std::filesystem::path& sourcePath, bool isNormalMap) const
+{
+	if (!isEnabled())
+		return nullptr;
+
+	SourceStamp stamp;
+	if (!getSourceStamp(sourcePath, stamp))
+		return nullptr;
+
+	const std::filesystem::path sidecarPath = getSidecarPath(sourcePath, isNormalMap);
+	SidecarHeader header;
+	{
+		std::ifstream sidecar(sidecarPath, std::ios::binary);
+		if (!sidecar || !sidecar.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return nullptr;
+	}
+	if (header.magic != k_sidecarMagic || header.version != k_sidecarVersion || header.sourceSize != stamp.size)
+		return nullptr;
+
+	if (header.sourceTime != stamp.time)
+	{
+		// Touched, e.g. saved again or checked out. Unchanged content keeps the sidecar, which then takes the new time.
+		uint64_t contentHash = 0;
+		if (!hashFile(sourcePath, contentHash) || contentHash != header.contentHash)
+			return nullptr;
+		header.sourceTime = stamp.time;
+		std::fstream sidecar(sidecarPath, std::ios::binary | std::ios::in | std::ios::out);
+		sidecar.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+
+	auto mapped = std::make_unique<MappedTexture>();
+	mapped->m_file = CreateFileW(sidecarPath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mapped->m_file == INVALID_HANDLE_VALUE)
+		return nullptr;
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(mapped->m_file, &fileSize))
+		return nullptr;
+	mapped->m_mapping = CreateFileMappingW(mapped->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapped->m_mapping)
+		return nullptr;
+	mapped->m_view = MapViewOfFile(mapped->m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!mapped->m_view)
+		return nullptr;
+
+	// Every level is checked against the file size, a truncated sidecar is a miss rather than a crash
+	const auto* bytes = static_cast<const uint8_t*>(mapped->m_view);
+	const uint64_t size = static_cast<uint64_t>(fileSize.QuadPart);
+	const uint64_t levelsEnd = sizeof(SidecarHeader) + uint64_t(header.mipLevels) * sizeof(SidecarLevel);
+	if (header.mipLevels == 0 || levelsEnd > size)
+		return nullptr;
+	const auto* levels = reinterpret_cast<const SidecarLevel*>(bytes + sizeof(SidecarHeader));
+	for (uint32_t mip = 0; mip < header.mipLevels; mip++)
+	{
+		const SidecarLevel& level = levels[mip];
+		if (level.offset < levelsEnd || level.slicePitch > size || level.offset > size - level.slicePitch)
+			return nullptr;
+		D3D11_SUBRESOURCE_DATA data = {};
+		data.pSysMem = bytes + level.offset;
+		data.SysMemPitch = static_cast<UINT>(level.rowPitch);
+		data.SysMemSlicePitch = static_cast<UINT>(level.slicePitch);
+		mapped->subresources.push_back(data);
+	}
+
+	D3D11_TEXTURE2D_DESC& desc = mapped->desc;
+	desc.Width = header.width;
+	desc.Height = header.height;
+	desc.MipLevels = header.mipLevels;
+	desc.ArraySize = 1;
+	desc.Format = static_cast<DXGI_FORMAT>(header.format);
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	return mapped;
+}
+
+void TextureCache::store(const std::filesystem::path& sourcePath, bool isNormalMap, const DirectX::ScratchImage& mipChain,
+	bool compress) const
+{
+	const DirectX::TexMetadata& metadata = mipChain.GetMetadata();
+	if (!isEnabled() || metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1
+		|| metadata.depth != 1 || metadata.IsCubemap())
+		return;
+
+	SidecarHeader header;
+	SourceStamp stamp;
+	if (!getSourceStamp(sourcePath, stamp) || !hashFile(sourcePath, header.contentHash))
+		return;
+	header.sourceTime = stamp.time;
+	header.sourceSize = stamp.size;
+	header.width = static_cast<uint32_t>(metadata.width);
+	header.height = static_cast<uint32_t>(metadata.height);
+	header.mipLevels = static_cast<uint32_t>(metadata.mipLevels);
+	header.format = metadata.format;
+
+	std::vector<StoredLevel> stored(metadata.mipLevels);
+	const bool compressed = compress && canCompress(metadata);
+	for (size_t mip = 0; mip < metadata.mipLevels; mip++)
+	{
+		StoredLevel& level = stored[mip];
+		level.image = mipChain.GetImage(mip, 0, 0);
+		if (compressed)
+		{
+			if (!compressLevel(*level.image, level))
+				return;
+		}
+		else
+		{
+			level.rowPitch = level.image->rowPitch;
+			level.slicePitch = level.image->slicePitch;
+		}
+	}
+	if (compressed)
+	{
+		header.format = DirectX::IsSRGB(metadata.format) ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	}
+
+	std::vector<SidecarLevel> levels(stored.size());
+	uint64_t offset = sizeof(SidecarHeader) + levels.size() * sizeof(SidecarLevel);
+	for (size_t mip = 0; mip < stored.size(); mip++)
+	{
+		offset = alignOffset(offset);
+		levels[mip].offset = offset;
+		levels[mip].rowPitch = stored[mip].rowPitch;
+		levels[mip].slicePitch = stored[mip].slicePitch;
+		offset += stored[mip].slicePitch;
+	}
+
+	const std::filesystem::path sidecarPath = getSidecarPath(sourcePath, isNormalMap);
+	std::filesystem::path temporaryPath = sidecarPath;
+	temporaryPath += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(levels.data()), static_cast<std::streamsize>(levels.size() * sizeof(SidecarLevel)));
+		for (size_t mip = 0; mip < stored.size() && file; mip++)
+		{
+			const std::vector<char> padding(levels[mip].offset - static_cast<uint64_t>(file.tellp()), 0);
+			file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+			const StoredLevel& level = stored[mip];
+			const void* data = level.blocks.empty() ? static_cast<const void*>(level.image->pixels) : level.blocks.data();
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(level.slicePitch));
+		}
+		if (!file)
+		{
+			std::cerr << "Failed to write texture cache entry for " << sourcePath.string() << std::endl;
+			file.close();
+			std::error_code error;
+			std::filesystem::remove(temporaryPath, error);
+			return;
+		}
+	}
+	// Fails while another load has the old sidecar mapped, the next load stores it again
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, sidecarPath, error);
+	if (error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+	}
+}
+
+std::filesystem::path TextureCache::getSidecarPath(const std::filesystem::path& sourcePath, bool isNormalMap) const
+{
+	std::error_code error;
+	std::filesystem::path absolutePath = std::filesystem::absolute(sourcePath, error);
+	const std::wstring key = (error ? sourcePath : absolutePath).lexically_normal().wstring();
+	const uint64_t hash = Hash::combine(Hash::bytes(key.data(), key.size() * sizeof(wchar_t)), isNormalMap ? 1 : 0);
+	return m_directory / (Hash::toHex(hash) + ".texcache");
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <d3d11_4.h>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace DirectX
+{
+	class ScratchImage;
+}
+
+// Read-only view of a cached texture. The subresources point into the mapped sidecar file,
+// so uploading it needs no decode and no copy.
+class MappedTexture
+{
+public:
+	MappedTexture() = default;
+	~MappedTexture();
+	MappedTexture(const MappedTexture&) = delete;
+	MappedTexture& operator=(const MappedTexture&) = delete;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	std::vector<D3D11_SUBRESOURCE_DATA> subresources; // one per mip
+
+private:
+	friend class TextureCache;
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+	const void* m_view = nullptr;
+};
+
+// Decoded and mip-mapped textures stored as sidecar files, one per source image and mip filter.
+// A sidecar records the modification time, size and content hash of its source. Matching time and size
+// are trusted; a touched file with the same size is hashed and only decoded again if its content changed.
+// Sidecars are written through a temporary and renamed, like the bake cache.
+class TextureCache
+{
+public:
+	// An empty directory disables the cache
+	explicit TextureCache(std::filesystem::path directory);
+
+	bool isEnabled() const;
+
+	// Maps the sidecar of the source image, nullptr on a miss or when the source changed
+	std::unique_ptr<MappedTexture> find(const std::filesystem::path& sourcePath, bool isNormalMap) const;
+	// Stores a 2D mip chain. With compress set, 8 and 16-bit colour formats are stored as BC7.
+	void store(const std::filesystem::path& sourcePath, bool isNormalMap, const DirectX::ScratchImage& mipChain,
+		bool compress) const;
+
+private:
+	std::filesystem::path getSidecarPath(const std::filesystem::path& sourcePath, bool isNormalMap) const;
+
+	std::filesystem::path m_directory;
+};
@@ -0,0 +1,348 @@
+#include "textureResidency.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include "DirectXTex.h"
+
+#include "appConfig.hpp"
+#include "texture.hpp"
+#include "textureCache.hpp"
+
+namespace
+{
+	constexpr uint64_t k_inUseFrames = 2;      // a texture sampled this many frames ago is still on screen
+	constexpr uint32_t k_minResidentSize = 64; // evicted textures keep the mips up to this size to draw with meanwhile
+	constexpr size_t k_maxStreams = 2;         // textures streamed back at the same time
+	constexpr uint64_t k_retryFrames = 600;    // a failed stream is tried again after this many frames
+
+	uint32_t getMipSize(uint32_t size, uint32_t mip)
+	{
+		return std::max(1u, size >> mip);
+	}
+
+	// Bytes of the mips from firstMip to the end of the chain
+	size_t getChainBytes(const D3D11_TEXTURE2D_DESC& desc, uint32_t firstMip)
+	{
+		size_t bytes = 0;
+		for (uint32_t mip = firstMip; mip < desc.MipLevels; mip++)
+		{
+			size_t rowPitch = 0;
+			size_t slicePitch = 0;
+			if (SUCCEEDED(DirectX::ComputePitch(desc.Format, getMipSize(desc.Width, mip), getMipSize(desc.Height, mip),
+				rowPitch, slicePitch)))
+			{
+				bytes += slicePitch;
+			}
+		}
+		return bytes * desc.ArraySize;
+	}
+
+	// Block-compressed textures need a top mip that is a multiple of the block size
+	bool canStartAt(const D3D11_TEXTURE2D_DESC& desc, uint32_t mip)
+	{
+		return !DirectX::IsCompressed(desc.Format)
+			|| (getMipSize(desc.Width, mip) % 4 == 0 && getMipSize(desc.Height, mip) % 4 == 0);
+	}
+
+	// Smallest mip chain an evicted texture keeps
+	uint32_t getTailMip(const D3D11_TEXTURE2D_DESC& desc)
+	{
+		uint32_t mip = 0;
+		while (mip + 1 < desc.MipLevels
+			&& std::max(getMipSize(desc.Width, mip + 1), getMipSize(desc.Height, mip + 1)) >= k_minResidentSize)
+		{
+			mip++;
+		}
+		return mip;
+	}
+
+	bool canEvict(const Texture& texture)
+	{
+		const D3D11_TEXTURE2D_DESC& desc = texture.residency.fullDesc;
+		if (!texture.textureResource || texture.isWritePending || texture.residency.isStreaming
+			|| desc.ArraySize != 1 || (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE))
+		{
+			return false;
+		}
+		// Evicted mips are streamed back from the file
+		std::error_code error;
+		return !texture.filepath.empty() && std::filesystem::is_regular_file(texture.filepath, error);
+	}
+}
+
+TextureResidency::TextureResidency(ComPtr<ID3D11Device> device, size_t budgetBytes)
+	: m_device(std::move(device))
+	, m_budgetBytes(budgetBytes)
+{
+}
+
+TextureResidency::~TextureResidency()
+{
+	for (Stream& stream : m_streams)
+	{
+		stream.future.wait();
+	}
+}
+
+std::vector<std::shared_ptr<Texture>> TextureResidency::update(const StringUnorderedMap<std::shared_ptr<Texture>>& textures)
+{
+	std::vector<std::shared_ptr<Texture>> restored;
+	finishStreams(restored);
+
+	const uint64_t frame = AppConfig::frameIndex;
+	std::vector<Texture*> idleTextures;
+	std::vector<Texture*> usedTextures;
+	std::vector<std::shared_ptr<Texture>> wantedTextures; // sampled at a mip that is evicted
+	m_residentBytes = 0;
+	m_requestedBytes = 0;
+	for (const auto& [name, texture] : textures)
+	{
+		if (!texture || !texture->textureResource)
+			continue;
+		Texture::Residency& residency = texture->residency;
+		if (residency.residentMip == 0)
+		{
+			// Picks up new textures and reloads
+			residency.fullDesc = texture->texDesc;
+		}
+		m_residentBytes += getChainBytes(residency.fullDesc, residency.residentMip);
+		if (residency.lastUsedFrame + k_inUseFrames < frame)
+		{
+			idleTextures.push_back(texture.get());
+			continue;
+		}
+		m_requestedBytes += getChainBytes(residency.fullDesc, residency.requestedMip);
+		usedTextures.push_back(texture.get());
+		if (residency.requestedMip < residency.residentMip && !residency.isStreaming && residency.retryFrame <= frame)
+		{
+			wantedTextures.push_back(texture);
+		}
+	}
+	if (m_budgetBytes == 0)
+		return restored;
+
+	if (m_residentBytes + m_streamingBytes > m_budgetBytes)
+	{
+		// Textures nobody looks at go first, then the detail the visible ones don't sample, and only then
+		// visible textures lose one mip per frame
+		evict(idleTextures, m_budgetBytes, [](const Texture& texture) { return getTailMip(texture.residency.fullDesc); });
+		evict(usedTextures, m_budgetBytes, [](const Texture& texture) { return texture.residency.requestedMip; });
+		evict(usedTextures, m_budgetBytes, [](const Texture& texture)
+			{
+				return std::max(texture.residency.residentMip, texture.residency.requestedMip) + 1;
+			});
+	}
+
+	// Small textures first, they get sharp the soonest
+	std::ranges::sort(wantedTextures, {}, [](const std::shared_ptr<Texture>& texture)
+		{
+			return getChainBytes(texture->residency.fullDesc, texture->residency.requestedMip);
+		});
+	for (const std::shared_ptr<Texture>& texture : wantedTextures)
+	{
+		if (m_streams.size() >= k_maxStreams)
+			break;
+		const Texture::Residency& residency = texture->residency;
+		const size_t bytes = getChainBytes(residency.fullDesc, residency.requestedMip)
+			- getChainBytes(residency.fullDesc, residency.residentMip);
+		if (bytes > m_budgetBytes)
+			continue;
+		if (m_residentBytes + m_streamingBytes + bytes > m_budgetBytes)
+		{
+			evict(idleTextures, m_budgetBytes - bytes, [](const Texture& texture) { return getTailMip(texture.residency.fullDesc); });
+		}
+		if (m_residentBytes + m_streamingBytes + bytes <= m_budgetBytes)
+		{
+			startStream(texture, bytes);
+		}
+	}
+	return restored;
+}
+
+size_t TextureResidency::getResidentBytes() const
+{
+	return m_residentBytes;
+}
+
+size_t TextureResidency::getRequestedBytes() const
+{
+	return m_requestedBytes;
+}
+
+size_t TextureResidency::getBudgetBytes() const
+{
+	return m_budgetBytes;
+}
+
+void TextureResidency::finishStreams(std::vector<std::shared_ptr<Texture>>& restored)
+{
+	for (auto it = m_streams.begin(); it != m_streams.end();)
+	{
+		if (it->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		Texture& texture = *it->texture;
+		texture.residency.isStreaming = false;
+		StreamedMips mips;
+		try
+		{
+			mips = it->future.get();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Exception while streaming mips of " << texture.filepath << ": " << e.what() << std::endl;
+		}
+
+		if (!mips.resource)
+		{
+			std::cerr << "Failed to stream mips of " << texture.filepath << std::endl;
+			texture.residency.retryFrame = AppConfig::frameIndex + k_retryFrames;
+		}
+		else if (texture.textureResource == it->replacedResource && mips.firstMip < texture.residency.residentMip)
+		{
+			texture.textureResource = std::move(mips.resource);
+			texture.srv = std::move(mips.srv);
+			texture.textureResource->GetDesc(&texture.texDesc);
+			texture.residency.residentMip = mips.firstMip;
+			// A compressed sidecar may replace a texture decoded from the source
+			texture.residency.fullDesc.Format = texture.texDesc.Format;
+			restored.push_back(it->texture);
+		}
+		m_streamingBytes -= it->bytes;
+		it = m_streams.erase(it);
+	}
+}
+
+void TextureResidency::evict(std::vector<Texture*>& candidates, size_t targetBytes,
+	const std::function<uint32_t(const Texture&)>& getTargetMip)
+{
+	if (m_residentBytes + m_streamingBytes <= targetBytes)
+		return;
+
+	std::ranges::sort(candidates, [](const Texture* a, const Texture* b)
+		{
+			if (a->residency.lastUsedFrame != b->residency.lastUsedFrame)
+				return a->residency.lastUsedFrame < b->residency.lastUsedFrame;
+			return getChainBytes(a->residency.fullDesc, a->residency.residentMip)
+				> getChainBytes(b->residency.fullDesc, b->residency.residentMip);
+		});
+	for (Texture* texture : candidates)
+	{
+		if (m_residentBytes + m_streamingBytes <= targetBytes)
+			break;
+		if (!canEvict(*texture))
+			continue;
+
+		const Texture::Residency& residency = texture->residency;
+		uint32_t firstMip = std::min(getTargetMip(*texture), getTailMip(residency.fullDesc));
+		while (firstMip > residency.residentMip && !canStartAt(residency.fullDesc, firstMip))
+		{
+			firstMip--;
+		}
+		if (firstMip <= residency.residentMip)
+			continue;
+
+		const size_t residentBytes = getChainBytes(residency.fullDesc, residency.residentMip);
+		if (evictMips(*texture, firstMip))
+		{
+			m_residentBytes -= residentBytes - getChainBytes(residency.fullDesc, firstMip);
+		}
+	}
+}
+
+bool TextureResidency::evictMips(Texture& texture, uint32_t firstMip)
+{
+	if (!m_context)
+	{
+		m_device->GetImmediateContext(&m_context);
+	}
+
+	// The remaining mips are copied on the GPU into a smaller texture
+	const uint32_t droppedMips = firstMip - texture.residency.residentMip;
+	D3D11_TEXTURE2D_DESC desc = texture.texDesc;
+	desc.Width = getMipSize(desc.Width, droppedMips);
+	desc.Height = getMipSize(desc.Height, droppedMips);
+	desc.MipLevels -= droppedMips;
+	ComPtr<ID3D11Texture2D> resource;
+	HRESULT hr = m_device->CreateTexture2D(&desc, nullptr, &resource);
+	if (FAILED(hr))
+	{
+		std::cerr << "Failed to create the evicted texture " << texture.filepath << " hr=" << hr << std::endl;
+		return false;
+	}
+	for (uint32_t mip = 0; mip < desc.MipLevels; mip++)
+	{
+		m_context->CopySubresourceRegion(resource.Get(), mip, 0, 0, 0, texture.textureResource.Get(), mip + droppedMips, nullptr);
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	texture.srv->GetDesc(&srvDesc);
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = -1;
+	ComPtr<ID3D11ShaderResourceView> srv;
+	hr = m_device->CreateShaderResourceView(resource.Get(), &srvDesc, &srv);
+	if (FAILED(hr))
+	{
+		std::cerr << "Failed to create shader resource view = " << hr << std::endl;
+		return false;
+	}
+
+	texture.textureResource = std::move(resource);
+	texture.srv = std::move(srv);
+	texture.textureResource->GetDesc(&texture.texDesc);
+	texture.residency.residentMip = firstMip;
+	return true;
+}
+
+void TextureResidency::startStream(const std::shared_ptr<Texture>& texture, size_t bytes)
+{
+	texture->residency.isStreaming = true;
+	m_streamingBytes += bytes;
+
+	Stream stream;
+	stream.texture = texture;
+	stream.replacedResource = texture->textureResource;
+	stream.bytes = bytes;
+	stream.future = std::async(std::launch::async, &TextureResidency::loadMips,
+		texture->filepath, texture->isNormalMap, texture->residency.requestedMip, m_device);
+	m_streams.push_back(std::move(stream));
+}
+
+TextureResidency::StreamedMips TextureResidency::loadMips(std::string filepath, bool isNormalMap, uint32_t firstMip,
+	ComPtr<ID3D11Device> device)
+{
+	StreamedMips mips;
+	const TextureCache cache(AppConfig::textureCacheDirectory);
+	if (const std::unique_ptr<MappedTexture> mapped = cache.find(filepath, isNormalMap))
+	{
+		// Only the requested mips are uploaded straight from the mapped sidecar
+		firstMip = std::min(firstMip, mapped->desc.MipLevels - 1);
+		while (firstMip > 0 && !canStartAt(mapped->desc, firstMip))
+		{
+			firstMip--;
+		}
+		D3D11_TEXTURE2D_DESC desc = mapped->desc;
+		desc.Width = getMipSize(desc.Width, firstMip);
+		desc.Height = getMipSize(desc.Height, firstMip);
+		desc.MipLevels -= firstMip;
+		if (FAILED(device->CreateTexture2D(&desc, mapped->subresources.data() + firstMip, &mips.resource))
+			|| FAILED(device->CreateShaderResourceView(mips.resource.Get(), nullptr, &mips.srv)))
+		{
+			return {};
+		}
+		mips.firstMip = firstMip;
+		return mips;
+	}
+
+	// No sidecar, the source is decoded again, which also stores one for the next time
+	Texture texture(std::move(filepath), device, nullptr, isNormalMap);
+	mips.resource = texture.textureResource;
+	mips.srv = texture.srv;
+	return mips;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <d3d11_4.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <wrl.h>
+
+#include "utility/stringUnorderedMap.hpp"
+
+using namespace Microsoft::WRL;
+
+struct Texture;
+
+// Keeps the scene textures within a memory budget. Draws record the mips they sample (Texture::markUsed);
+// when the resident textures exceed the budget, the high mips of the least recently used ones are evicted
+// down to a small tail. Evicted mips a draw asks for again are streamed back in the background from the
+// texture cache sidecar, or decoded from the source if there is none.
+// Only textures loaded from a file can be evicted, embedded glTF images have nothing to stream back from.
+class TextureResidency
+{
+public:
+	// budgetBytes = 0 keeps every mip resident and only tracks the totals
+	TextureResidency(ComPtr<ID3D11Device> device, size_t budgetBytes);
+	~TextureResidency();
+	TextureResidency(const TextureResidency&) = delete;
+	TextureResidency& operator=(const TextureResidency&) = delete;
+
+	// Main thread, once per frame. Applies finished streams, evicts over the budget and starts streams for the
+	// mips the last frame asked for. Returns the textures that got mips back.
+	std::vector<std::shared_ptr<Texture>> update(const StringUnorderedMap<std::shared_ptr<Texture>>& textures);
+
+	size_t getResidentBytes() const;  // all mips currently resident
+	size_t getRequestedBytes() const; // mips sampled by the last frame's draws, whether resident or not
+	size_t getBudgetBytes() const;
+
+private:
+	struct StreamedMips
+	{
+		ComPtr<ID3D11Texture2D> resource;
+		ComPtr<ID3D11ShaderResourceView> srv;
+		uint32_t firstMip = 0;
+	};
+	struct Stream
+	{
+		std::shared_ptr<Texture> texture;
+		ComPtr<ID3D11Texture2D> replacedResource; // the stream is dropped if the texture was reloaded meanwhile
+		size_t bytes = 0;                         // reserved in the budget until the stream finishes
+		std::future<StreamedMips> future;
+	};
+
+	void finishStreams(std::vector<std::shared_ptr<Texture>>& restored);
+	// Evicts the candidates down to the mip getTargetMip returns, least recently used and largest first,
+	// until the resident and streaming mips fit into targetBytes
+	void evict(std::vector<Texture*>& candidates, size_t targetBytes,
+		const std::function<uint32_t(const Texture&)>& getTargetMip);
+	bool evictMips(Texture& texture, uint32_t firstMip);
+	void startStream(const std::shared_ptr<Texture>& texture, size_t bytes);
+	// Worker thread: loads the mips from firstMip on, from the sidecar or else the whole chain from the source
+	static StreamedMips loadMips(std::string filepath, bool isNormalMap, uint32_t firstMip, ComPtr<ID3D11Device> device);
+
+	ComPtr<ID3D11Device> m_device;
+	ComPtr<ID3D11DeviceContext> m_context;
+	size_t m_budgetBytes = 0;
+	size_t m_residentBytes = 0;
+	size_t m_requestedBytes = 0;
+	size_t m_streamingBytes = 0;
+	std::vector<Stream> m_streams;
+};
@@ -28,6 +28,7 @@
 #include "primitiveData.hpp"
 #include "scene.hpp"
 #include "texture.hpp"
+#include "textureResidency.hpp"
 
 #include "commands/commandManager.hpp"
 #include "commands/nodeCommand.hpp"
@@ -261,6 +262,16 @@ void UIManager::showSceneSettings() const
 	ImGui::Separator();
 #endif
 
+	const TextureResidency& textureResidency = m_scene->getTextureResidency();
+	constexpr double bytesPerMB = 1024.0 * 1024.0;
+	ImGui::TextWrapped("Textures: %.1f MB resident, %.1f MB requested", textureResidency.getResidentBytes() / bytesPerMB,
+		textureResidency.getRequestedBytes() / bytesPerMB);
+	if (textureResidency.getBudgetBytes() > 0)
+	{
+		ImGui::TextWrapped("Texture budget: %.0f MB", textureResidency.getBudgetBytes() / bytesPerMB);
+	}
+	ImGui::Separator();
+
 	ImGui::Text("Theme: ");
 	ImGui::Combo("Theme", &currentTheme, "Light\0Dark\0Classic\0");
 
@@ -1480,6 +1491,7 @@ void UIManager::showPrimitiveProperties(Primitive* primitive) const
 void UIManager::showMaterialProperties(std::shared_ptr<Material> material) const
 {
 	ImGui::Text("Name: %s", material->name.c_str());
+	material->markTexturesUsed(128); // thumbnails
 
 	ImGui::Separator();
 
@@ -1546,7 +1558,7 @@ void UIManager::showMaterialProperties(std::shared_ptr<Material> material) const
 		FileDialogResult result = openFileDialog(FileType::IMAGE);
 		if (result)
 		{
-			std::shared_ptr<Texture> newNormal = std::make_shared<Texture>(result.fullPath, m_device);
+			std::shared_ptr<Texture> newNormal = std::make_shared<Texture>(result.fullPath, m_device, nullptr, true);
 			m_scene->addTexture(newNormal);
 			material->normal = newNormal;
 			material->needsPreviewUpdate = true;
@@ -1616,6 +1628,16 @@ void UIManager::showBakerProperties(BakerNode* bakerNode)
 	constexpr uint32_t minVal = 2;
 	constexpr uint32_t maxVal = 4096;
 	ImGui::DragScalar("Texture Size", ImGuiDataType_U32, &baker->textureWidth, 2.0f, &minVal, &maxVal);
+	ImGui::Checkbox("CPU UV Rasterizer", &baker->useCPURasterizer);
+	ImGui::SetItemTooltip("Rasterize low-poly UVs on the CPU with full fp32 precision");
+
+	constexpr uint32_t minPadding = 0;
+	constexpr uint32_t maxPadding = 256;
+	ImGui::BeginDisabled(baker->infiniteDilation);
+	ImGui::DragScalar("Edge Padding", ImGuiDataType_U32, &baker->dilationDistance, 0.25f, &minPadding, &maxPadding, "%u px");
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	ImGui::Checkbox("Infinite", &baker->infiniteDilation);
 
 	for (auto pass : baker->getPasses())
 	{
@@ -1740,6 +1762,11 @@ void UIManager::showBakerProperties(BakerNode* bakerNode)
 			baker->requestBake();
 		}
 	}
+	if (baker->isBaking())
+	{
+		ImGui::SameLine();
+		ImGui::TextDisabled("Baking...");
+	}
 
 	// Center the popup on the viewport window
 	ImGuiWindow* viewportWindow = ImGui::FindWindowByName("Viewport");
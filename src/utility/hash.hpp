@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Small non-cryptographic hashing helpers for building content keys
+namespace Hash
+{
+	// splitmix64 finalizer - cheap full avalanche of a 64-bit value
+	inline uint64_t mix(uint64_t value)
+	{
+		value ^= value >> 30;
+		value *= 0xBF58476D1CE4E5B9ull;
+		value ^= value >> 27;
+		value *= 0x94D049BB133111EBull;
+		value ^= value >> 31;
+		return value;
+	}
+
+	// Order dependent combination, combine(combine(seed, a), b) != combine(combine(seed, b), a)
+	inline uint64_t combine(uint64_t seed, uint64_t value)
+	{
+		return mix(seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2)));
+	}
+
+	// Content hash of a buffer. Four independent lanes keep the multiplies pipelined,
+	// so large geometry buffers hash at memory bandwidth rather than multiply latency.
+	inline uint64_t bytes(const void* data, size_t size, uint64_t seed = 0)
+	{
+		constexpr uint64_t k_prime = 0x9E3779B97F4A7C15ull;
+		const auto* bytePtr = static_cast<const uint8_t*>(data);
+		uint64_t lanes[4] = { seed + 1, seed + 2, seed + 3, seed + 4 };
+
+		size_t offset = 0;
+		for (; offset + 32 <= size; offset += 32)
+		{
+			for (int lane = 0; lane < 4; lane++)
+			{
+				uint64_t word;
+				std::memcpy(&word, bytePtr + offset + lane * 8, sizeof(word));
+				lanes[lane] = (lanes[lane] ^ word) * k_prime;
+				lanes[lane] ^= lanes[lane] >> 29;
+			}
+		}
+
+		uint64_t tail[4] = {};
+		std::memcpy(tail, bytePtr + offset, size - offset);
+		uint64_t result = combine(seed, size);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			result = combine(result, lanes[lane] ^ mix(tail[lane]));
+		}
+		return result;
+	}
+
+	// Hash of the object representation, only for types without padding bytes
+	template <typename T>
+	inline uint64_t combineBytes(uint64_t seed, const T& value)
+	{
+		return combine(seed, bytes(&value, sizeof(T)));
+	}
+
+	// Fixed width, lower case, used for file names and keys exchanged with other tools
+	inline std::string toHex(uint64_t value)
+	{
+		char buffer[17];
+		std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+		return buffer;
+	}
+
+	inline bool fromHex(const std::string& text, uint64_t& outValue)
+	{
+		if (text.empty() || text.size() > 16 || text.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+			return false;
+		outValue = std::strtoull(text.c_str(), nullptr, 16);
+		return true;
+	}
+} // namespace Hash
@@ -0,0 +1,309 @@
+#include "jobSystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <limits>
+
+#include "parallelFor.hpp"
+
+using namespace Jobs;
+
+JobSystem::JobSystem(uint32_t workerCount, size_t memoryBudget)
+	: m_memoryBudget(memoryBudget)
+{
+	if (workerCount == 0)
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+	m_workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back([this, workerCount]()
+			{
+				// Parallel loops inside jobs split the hardware threads with the other workers
+				Parallel::setPoolThreadCount(workerCount);
+				workerLoop();
+			});
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	waitIdle();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shutdown = true;
+	}
+	m_workerCondition.notify_all();
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+JobID JobSystem::submit(JobDesc desc, const std::vector<JobID>& dependencies)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const JobID id = m_nextId++;
+	Job& job = m_jobs[id];
+	job.desc = std::move(desc);
+	job.cancelled = m_cancelledGroups.contains(job.desc.group);
+	m_groupJobCounts[job.desc.group]++;
+
+	for (JobID dependency : dependencies)
+	{
+		auto it = m_jobs.find(dependency);
+		if (it == m_jobs.end() || dependency == id)
+			continue;
+		it->second.dependents.push_back(id);
+		job.pendingDependencies++;
+	}
+
+	if (job.pendingDependencies == 0)
+	{
+		const JobThread thread = job.desc.thread;
+		m_readyJobs[static_cast<int>(thread)].push_back(id);
+		lock.unlock();
+		if (thread == JobThread::Worker)
+			m_workerCondition.notify_one();
+	}
+	return id;
+}
+
+// Picks the best ready job that fits the memory budget. A job always fits when nothing else holds memory,
+// so a single job larger than the budget can't stall the graph. Called with m_mutex held.
+bool JobSystem::takeReadyJob(JobThread thread, JobID& outId, Job& outJob)
+{
+	std::vector<JobID>& ready = m_readyJobs[static_cast<int>(thread)];
+	auto best = ready.end();
+	for (auto it = ready.begin(); it != ready.end(); ++it)
+	{
+		const Job& job = m_jobs.at(*it);
+		const bool fits = m_memoryBudget == 0 || job.cancelled || m_memoryInUse == 0
+			|| m_memoryInUse + job.desc.memoryBytes <= m_memoryBudget;
+		if (!fits)
+			continue;
+		if (best == ready.end())
+		{
+			best = it;
+			continue;
+		}
+
+		const Job& bestJob = m_jobs.at(*best);
+		const bool focused = m_focusGroup != 0 && job.desc.group == m_focusGroup;
+		const bool bestFocused = m_focusGroup != 0 && bestJob.desc.group == m_focusGroup;
+		if (focused != bestFocused)
+		{
+			if (focused)
+				best = it;
+			continue;
+		}
+		if (job.desc.priority != bestJob.desc.priority)
+		{
+			if (job.desc.priority > bestJob.desc.priority)
+				best = it;
+			continue;
+		}
+		if (*it < *best) // submission order
+			best = it;
+	}
+	if (best == ready.end())
+		return false;
+
+	outId = *best;
+	ready.erase(best);
+
+	Job& job = m_jobs.at(outId);
+	job.started = true;
+	if (!job.cancelled)
+		m_memoryInUse += job.desc.memoryBytes;
+	// The work function is moved out, the entry stays to collect dependents until the job finished.
+	// Scalar fields are left intact by the move and are still used by finishJob.
+	outJob.desc = std::move(job.desc);
+	outJob.cancelled = job.cancelled;
+	return true;
+}
+
+void JobSystem::execute(JobID id, Job& job)
+{
+	bool succeeded = !job.cancelled;
+	if (succeeded)
+	{
+		try
+		{
+			job.desc.work();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Job '" << job.desc.name << "' failed: " << e.what() << std::endl;
+			succeeded = false;
+		}
+	}
+	// Release captured state before dependents can run
+	job.desc.work = nullptr;
+	finishJob(id, succeeded);
+}
+
+void JobSystem::finishJob(JobID id, bool succeeded)
+{
+	bool readyWorkerJobs = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_jobs.find(id);
+		Job& job = it->second;
+		if (!job.cancelled)
+			m_memoryInUse -= job.desc.memoryBytes;
+
+		for (JobID dependentId : job.dependents)
+		{
+			Job& dependent = m_jobs.at(dependentId);
+			if (!succeeded)
+				dependent.cancelled = true;
+			if (--dependent.pendingDependencies == 0)
+			{
+				m_readyJobs[static_cast<int>(dependent.desc.thread)].push_back(dependentId);
+				readyWorkerJobs |= dependent.desc.thread == JobThread::Worker;
+			}
+		}
+
+		auto groupIt = m_groupJobCounts.find(job.desc.group);
+		if (--groupIt->second == 0)
+			m_groupJobCounts.erase(groupIt);
+		m_jobs.erase(it);
+	}
+	// Freed memory may unblock jobs that didn't fit before
+	if (readyWorkerJobs || m_memoryBudget != 0)
+		m_workerCondition.notify_all();
+	m_finishedCondition.notify_all();
+}
+
+void JobSystem::workerLoop()
+{
+	while (true)
+	{
+		JobID id = k_invalidJob;
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workerCondition.wait(lock, [&]()
+				{
+					return m_shutdown || takeReadyJob(JobThread::Worker, id, job);
+				});
+			if (id == k_invalidJob)
+				return;
+		}
+		execute(id, job);
+	}
+}
+
+void JobSystem::runMainThreadJobs(double timeBudgetMs)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	while (true)
+	{
+		JobID id = k_invalidJob;
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!takeReadyJob(JobThread::Main, id, job))
+				return;
+		}
+		execute(id, job);
+
+		if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() >= timeBudgetMs)
+			return;
+	}
+}
+
+void JobSystem::waitIdle()
+{
+	while (true)
+	{
+		runMainThreadJobs(std::numeric_limits<double>::infinity());
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_jobs.empty())
+			return;
+		// Wake up on every finished job, it might have made a main thread job ready
+		m_finishedCondition.wait_for(lock, std::chrono::milliseconds(10));
+	}
+}
+
+bool JobSystem::isIdle() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_jobs.empty();
+}
+
+void JobSystem::waitGroup(uint64_t group)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_finishedCondition.wait(lock, [&]() { return !m_groupJobCounts.contains(group); });
+}
+
+void JobSystem::cancelGroup(uint64_t group)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_cancelledGroups.insert(group);
+		for (auto& [id, job] : m_jobs)
+		{
+			if (job.desc.group == group && !job.started)
+				job.cancelled = true;
+		}
+	}
+
+	while (true)
+	{
+		JobID id = k_invalidJob;
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!m_groupJobCounts.contains(group))
+			{
+				m_cancelledGroups.erase(group);
+				return;
+			}
+
+			std::vector<JobID>& ready = m_readyJobs[static_cast<int>(JobThread::Main)];
+			auto it = std::find_if(ready.begin(), ready.end(), [&](JobID readyId) { return m_jobs.at(readyId).desc.group == group; });
+			if (it == ready.end())
+			{
+				// Cancelled worker jobs fit any memory budget, the workers finish them right away
+				m_workerCondition.notify_all();
+				m_finishedCondition.wait_for(lock, std::chrono::milliseconds(10));
+				continue;
+			}
+			id = *it;
+			ready.erase(it);
+			Job& cancelled = m_jobs.at(id);
+			cancelled.started = true;
+			// Moved out like takeReadyJob does, so the captured state is released outside the lock
+			job.desc = std::move(cancelled.desc);
+			job.cancelled = true;
+		}
+		execute(id, job);
+	}
+}
+
+bool JobSystem::isGroupBusy(uint64_t group) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_groupJobCounts.contains(group);
+}
+
+void JobSystem::setFocusGroup(uint64_t group)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_focusGroup = group;
+}
+
+void JobSystem::setMemoryBudget(size_t memoryBudget)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_memoryBudget = memoryBudget;
+	}
+	m_workerCondition.notify_all();
+}
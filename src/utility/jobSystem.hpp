@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Dependency graph of jobs executed by a pool of worker threads.
+// Jobs that touch the D3D11 immediate context are marked JobThread::Main and are only executed
+// from runMainThreadJobs / waitIdle on the render thread; everything else runs on the workers.
+namespace Jobs
+{
+	using JobID = uint64_t;
+	constexpr JobID k_invalidJob = 0;
+
+	enum class JobThread
+	{
+		Worker,
+		Main
+	};
+
+	struct JobDesc
+	{
+		std::string name;
+		std::function<void()> work;
+		JobThread thread = JobThread::Worker;
+		int32_t priority = 0;   // among ready jobs higher priority runs first
+		uint64_t group = 0;     // jobs of the focus group run before all other jobs, 0 = no group
+		size_t memoryBytes = 0; // estimated peak memory while the job runs, counted against the budget
+	};
+
+	class JobSystem
+	{
+	public:
+		// workerCount = 0 uses all hardware threads, memoryBudget = 0 disables the budget
+		explicit JobSystem(uint32_t workerCount = 0, size_t memoryBudget = 0);
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// The job becomes ready once all dependencies finished. Finished or invalid IDs count as satisfied.
+		// If a dependency throws, the job and everything depending on it is cancelled.
+		JobID submit(JobDesc desc, const std::vector<JobID>& dependencies = {});
+
+		// Runs ready main thread jobs until the time budget is used up, at least one job if any is ready
+		void runMainThreadJobs(double timeBudgetMs);
+		// Blocks until every submitted job finished, executing main thread jobs on the calling thread
+		void waitIdle();
+		// Blocks until every job of the group finished. Doesn't run main thread jobs, the group must not contain any.
+		void waitGroup(uint64_t group);
+		// Cancels the jobs of the group that haven't started, also those its running jobs still submit, and blocks
+		// until the running ones finished. Cancelled main thread jobs of the group are finished on the calling thread,
+		// main thread jobs of other groups keep waiting for runMainThreadJobs.
+		void cancelGroup(uint64_t group);
+
+		bool isIdle() const;
+		bool isGroupBusy(uint64_t group) const;
+		void setFocusGroup(uint64_t group);
+		void setMemoryBudget(size_t memoryBudget);
+
+	private:
+		struct Job
+		{
+			JobDesc desc;
+			uint32_t pendingDependencies = 0;
+			bool cancelled = false;
+			bool started = false; // taken by a thread, too late to cancel
+			std::vector<JobID> dependents;
+		};
+
+		bool takeReadyJob(JobThread thread, JobID& outId, Job& outJob);
+		void execute(JobID id, Job& job);
+		void finishJob(JobID id, bool succeeded);
+		void workerLoop();
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_workerCondition;
+		std::condition_variable m_finishedCondition;
+
+		std::unordered_map<JobID, Job> m_jobs; // submitted, not yet finished
+		std::vector<JobID> m_readyJobs[2];     // indexed by JobThread
+		std::unordered_map<uint64_t, uint32_t> m_groupJobCounts;
+		std::unordered_set<uint64_t> m_cancelledGroups; // while cancelGroup waits, jobs submitted to them are cancelled
+		JobID m_nextId = 1;
+
+		size_t m_memoryBudget = 0;
+		size_t m_memoryInUse = 0;
+		uint64_t m_focusGroup = 0;
+		bool m_shutdown = false;
+
+		std::vector<std::thread> m_workers;
+	};
+} // namespace Jobs
@@ -0,0 +1,105 @@
+#include "outputWriter.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+using namespace Jobs;
+
+OutputWriter::OutputWriter(uint32_t threadCount, size_t maxQueuedTasks, size_t memoryBudget)
+	: m_maxQueuedTasks(maxQueuedTasks)
+	, m_memoryBudget(memoryBudget)
+{
+	threadCount = std::max(1u, threadCount);
+	m_threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_threads.emplace_back(&OutputWriter::writerLoop, this);
+	}
+}
+
+OutputWriter::~OutputWriter()
+{
+	flush();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shutdown = true;
+	}
+	m_taskCondition.notify_all();
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+bool OutputWriter::canAccept(const OutputTask& task) const
+{
+	if (m_queue.empty() && m_runningTasks == 0)
+		return true;
+	if (m_maxQueuedTasks != 0 && m_queue.size() >= m_maxQueuedTasks)
+		return false;
+	return m_memoryBudget == 0 || m_memoryInUse + task.memoryBytes <= m_memoryBudget;
+}
+
+void OutputWriter::submit(OutputTask task)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_capacityCondition.wait(lock, [&]() { return canAccept(task); });
+		m_memoryInUse += task.memoryBytes;
+		m_queue.push_back(std::move(task));
+	}
+	m_taskCondition.notify_one();
+}
+
+void OutputWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_capacityCondition.wait(lock, [&]() { return m_queue.empty() && m_runningTasks == 0; });
+}
+
+size_t OutputWriter::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queue.size() + m_runningTasks;
+}
+
+void OutputWriter::writerLoop()
+{
+	while (true)
+	{
+		OutputTask task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskCondition.wait(lock, [&]() { return m_shutdown || !m_queue.empty(); });
+			if (m_queue.empty())
+				return;
+			task = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_runningTasks++;
+		}
+
+		bool succeeded = false;
+		try
+		{
+			succeeded = task.write();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Writing '" << task.name << "' failed: " << e.what() << std::endl;
+		}
+		if (task.onComplete)
+		{
+			task.onComplete(succeeded);
+		}
+		// Release the image before the memory is handed to the next producer
+		const size_t memoryBytes = task.memoryBytes;
+		task = OutputTask();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_memoryInUse -= memoryBytes;
+			m_runningTasks--;
+		}
+		m_capacityCondition.notify_all();
+	}
+}
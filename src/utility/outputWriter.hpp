@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Bounded queue of output encodes served by dedicated threads, so writing the maps of one bake
+// overlaps the trace of the next instead of occupying the bake workers.
+namespace Jobs
+{
+	struct OutputTask
+	{
+		std::string name;
+		std::function<bool()> write;           // encodes and writes the output, false on failure
+		std::function<void(bool)> onComplete;  // called on the writer thread with the result of write
+		size_t memoryBytes = 0;                // held by the queued image until it is written
+	};
+
+	class OutputWriter
+	{
+	public:
+		// threadCount = 0 uses one thread, maxQueuedTasks = 0 and memoryBudget = 0 leave the queue unbounded
+		OutputWriter(uint32_t threadCount, size_t maxQueuedTasks, size_t memoryBudget);
+		// Flushes, every queued output is written before the threads exit
+		~OutputWriter();
+		OutputWriter(const OutputWriter&) = delete;
+		OutputWriter& operator=(const OutputWriter&) = delete;
+
+		// Blocks while the queue is full or its images exceed the memory budget. A task is always accepted
+		// when nothing else is pending, so an image larger than the budget can't block forever.
+		void submit(OutputTask task);
+		// Blocks until every submitted task was written and its completion callback returned
+		void flush();
+		size_t getPendingCount() const;
+
+	private:
+		bool canAccept(const OutputTask& task) const; // called with m_mutex held
+		void writerLoop();
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_taskCondition;     // a task was queued or the writer shuts down
+		std::condition_variable m_capacityCondition; // a task finished, frees queue slots and memory
+
+		std::deque<OutputTask> m_queue;
+		size_t m_runningTasks = 0;
+		size_t m_memoryInUse = 0; // queued and running tasks
+		size_t m_maxQueuedTasks = 0;
+		size_t m_memoryBudget = 0;
+		bool m_shutdown = false;
+
+		std::vector<std::thread> m_threads;
+	};
+} // namespace Jobs
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Minimal fork-join helpers for CPU-side baking work.
+// Work items are handed out through an atomic counter, so uneven items (tiles, triangles, chunks)
+// are balanced automatically. The calling thread participates as one of the workers.
+// Loops started from a thread pool's own threads, e.g. bake jobs, only get that thread's share of the hardware
+// threads, so pools running parallel loops on every thread don't oversubscribe the machine.
+namespace Parallel
+{
+	namespace Detail
+	{
+		inline thread_local uint32_t t_poolThreadCount = 0; // of the pool the calling thread belongs to, 0 outside of pools
+	}
+
+	// Called once by every thread of a pool of poolThreadCount threads
+	inline void setPoolThreadCount(uint32_t poolThreadCount)
+	{
+		Detail::t_poolThreadCount = poolThreadCount;
+	}
+
+	inline uint32_t getWorkerCount()
+	{
+		const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		return std::max(1u, hardwareThreads / std::max(1u, Detail::t_poolThreadCount));
+	}
+
+	// Calls fn(index) for every index in [0, count)
+	template <typename Fn>
+	void parallelFor(size_t count, Fn&& fn, uint32_t maxWorkers = 0)
+	{
+		if (count == 0)
+			return;
+
+		uint32_t workerCount = maxWorkers > 0 ? maxWorkers : getWorkerCount();
+		workerCount = static_cast<uint32_t>(std::min<size_t>(workerCount, count));
+
+		std::atomic<size_t> nextIndex = 0;
+		auto worker = [&]()
+		{
+			for (size_t i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1))
+			{
+				fn(i);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(workerCount - 1);
+		for (uint32_t i = 1; i < workerCount; i++)
+		{
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// Calls fn(begin, end) for contiguous ranges of roughly chunkSize elements
+	template <typename Fn>
+	void parallelForChunks(size_t count, size_t chunkSize, Fn&& fn, uint32_t maxWorkers = 0)
+	{
+		chunkSize = std::max<size_t>(chunkSize, 1);
+		const size_t numChunks = (count + chunkSize - 1) / chunkSize;
+		parallelFor(numChunks, [&](size_t chunk)
+			{
+				const size_t begin = chunk * chunkSize;
+				fn(begin, std::min(begin + chunkSize, count));
+			}, maxWorkers);
+	}
+} // namespace Parallel
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SIMD_SSE2 0
+#include <algorithm>
+#endif
+
+// Four float lanes for loops over texels. SSE2 is part of every x86-64 target, so no compiler flags are needed.
+// Other targets get the same operations as plain loops.
+namespace Simd
+{
+	struct Float4
+	{
+#if SIMD_SSE2
+		__m128 v;
+
+		Float4() : v(_mm_setzero_ps()) {}
+		Float4(__m128 value) : v(value) {}
+		explicit Float4(float value) : v(_mm_set1_ps(value)) {}
+
+		static Float4 load(const float* values) { return _mm_loadu_ps(values); }
+		void store(float* values) const { _mm_storeu_ps(values, v); }
+
+		Float4 operator+(Float4 other) const { return _mm_add_ps(v, other.v); }
+		Float4 operator-(Float4 other) const { return _mm_sub_ps(v, other.v); }
+		Float4 operator*(Float4 other) const { return _mm_mul_ps(v, other.v); }
+		Float4 operator/(Float4 other) const { return _mm_div_ps(v, other.v); }
+#else
+		float v[4];
+
+		Float4() : v{ 0.0f, 0.0f, 0.0f, 0.0f } {}
+		explicit Float4(float value) : v{ value, value, value, value } {}
+
+		static Float4 load(const float* values)
+		{
+			Float4 result;
+			std::copy(values, values + 4, result.v);
+			return result;
+		}
+		void store(float* values) const { std::copy(v, v + 4, values); }
+
+		template <typename Op>
+		Float4 apply(Float4 other, Op op) const
+		{
+			Float4 result;
+			for (int i = 0; i < 4; i++)
+			{
+				result.v[i] = op(v[i], other.v[i]);
+			}
+			return result;
+		}
+		Float4 operator+(Float4 other) const { return apply(other, [](float a, float b) { return a + b; }); }
+		Float4 operator-(Float4 other) const { return apply(other, [](float a, float b) { return a - b; }); }
+		Float4 operator*(Float4 other) const { return apply(other, [](float a, float b) { return a * b; }); }
+		Float4 operator/(Float4 other) const { return apply(other, [](float a, float b) { return a / b; }); }
+#endif
+
+		Float4& operator+=(Float4 other) { return *this = *this + other; }
+	};
+
+#if SIMD_SSE2
+	inline Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+	inline Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+	// Rounds and floors are only needed for values >= 0, where truncation floors
+	inline Float4 floorPositive(Float4 a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v)); }
+
+	inline float sum(Float4 a)
+	{
+		const __m128 pairs = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+	inline float minLane(Float4 a)
+	{
+		const __m128 pairs = _mm_min_ps(a.v, _mm_movehl_ps(a.v, a.v));
+		return _mm_cvtss_f32(_mm_min_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+	inline float maxLane(Float4 a)
+	{
+		const __m128 pairs = _mm_max_ps(a.v, _mm_movehl_ps(a.v, a.v));
+		return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+
+	inline void toInt(Float4 a, int32_t out[4])
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_cvttps_epi32(a.v));
+	}
+#else
+	inline Float4 min(Float4 a, Float4 b) { return a.apply(b, [](float x, float y) { return std::min(x, y); }); }
+	inline Float4 max(Float4 a, Float4 b) { return a.apply(b, [](float x, float y) { return std::max(x, y); }); }
+	inline Float4 floorPositive(Float4 a) { return a.apply(a, [](float x, float) { return static_cast<float>(static_cast<int32_t>(x)); }); }
+
+	inline float sum(Float4 a) { return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]); }
+	inline float minLane(Float4 a) { return std::min(std::min(a.v[0], a.v[1]), std::min(a.v[2], a.v[3])); }
+	inline float maxLane(Float4 a) { return std::max(std::max(a.v[0], a.v[1]), std::max(a.v[2], a.v[3])); }
+
+	inline void toInt(Float4 a, int32_t out[4])
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			out[i] = static_cast<int32_t>(a.v[i]);
+		}
+	}
+#endif
+
+	inline Float4 clamp(Float4 a, float low, float high)
+	{
+		return min(max(a, Float4(low)), Float4(high));
+	}
+
+	inline Float4 roundPositive(Float4 a)
+	{
+		return floorPositive(a + Float4(0.5f));
+	}
+} // namespace Simd